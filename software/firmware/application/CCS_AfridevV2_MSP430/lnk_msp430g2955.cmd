@@ -76,19 +76,22 @@ MEMORY
    SFR                     : origin = 0x0000, length = 0x0010
    PERIPHERALS_8BIT        : origin = 0x0010, length = 0x00F0
    PERIPHERALS_16BIT       : origin = 0x0100, length = 0x0100
-   RAM                     : origin = 0x1100, length = 0x0F00
+   RAM                     : origin = 0x1100, length = 0x0D70
+   // Algorithm state kept over a watchdog reset.  The bootloader runs
+   // first on every reset and leaves this range out of its RAM, so
+   // its variables and comm buffers never overwrite the state.  Must
+   // match the bootloader linker file.
+   ALGO_STATE              : origin = 0x1E70, length = 0x0190
    STACK                   : origin = 0x2000, length = 0x0100
    INFOA                   : origin = 0x10C0, length = 0x0040
    INFOB                   : origin = 0x1080, length = 0x0040
    INFOC                   : origin = 0x1040, length = 0x0040
    INFOD                   : origin = 0x1000, length = 0x0040
-   FLASH_WEEK1_DATA        : origin = 0x7400, length = 0x0400
-   FLASH_WEEK2_DATA        : origin = 0x7800, length = 0x0400
-   FLASH_WEEK3_DATA        : origin = 0x7C00, length = 0x0400
-   FLASH_WEEK4_DATA        : origin = 0x8000, length = 0x0400
-   FLASH_WEEK5_DATA        : origin = 0x8400, length = 0x0400
-   FLASH_WEEK6_DATA        : origin = 0x8800, length = 0x0400
-   FLASH_MANUF_DATA        : origin = 0x8C00, length = 0x0400
+   FLASH_UPGRADE_DATA      : origin = 0x7200, length = 0x0200
+   FLASH_DAILY_LOGS        : origin = 0x7400, length = 0x1400
+   FLASH_STORAGE_DATA      : origin = 0x8800, length = 0x0400
+   FLASH_MANUF_DATA        : origin = 0x8C00, length = 0x0200
+   FLASH_ALGO_DATA         : origin = 0x8E00, length = 0x0200
    FLASH                   : origin = 0x9000, length = 0x4FC6 /* (20K-58 bytes) */
 
    // Interrupt Proxy table from  _App_Proxy_Vector_Start->(RESET-1)
@@ -107,15 +110,14 @@ SECTIONS
     .data       : {} > RAM                /* GLOBAL & STATIC VARS              */
     .sysmem     : {} > RAM                /* DYNAMIC MEMORY ALLOCATION AREA    */
     .commbufs   : {} type=NOINIT > RAM (HIGH)  /* COMM BUFS            */
+    .algoState  : {} type=NOINIT > ALGO_STATE  /* ALGORITHM STATE, KEPT OVER RESETS */
     .stack      : {} > STACK (HIGH)       /* SOFTWARE SYSTEM STACK             */
 
-    .week1Data  : {} type=NOINIT > FLASH_WEEK1_DATA    /* Data Logs   */
-    .week2Data  : {} type=NOINIT > FLASH_WEEK2_DATA    /* Data Logs   */
-    .week3Data  : {} type=NOINIT > FLASH_WEEK3_DATA    /* Data Logs   */
-    .week4Data  : {} type=NOINIT > FLASH_WEEK4_DATA    /* Data Logs   */
-    .week5Data  : {} type=NOINIT > FLASH_WEEK5_DATA    /* Data Logs   */
-    .week6Data  : {} type=NOINIT > FLASH_WEEK6_DATA    /* Data Logs   */
-    .manufdata  : {} type=NOINIT > FLASH_MANUF_DATA    /* Data Logs   */
+    .upgradeProgress : {} type=NOINIT > FLASH_UPGRADE_DATA /* Upgrade Progress */
+    .dailyLogs  : {} type=NOINIT > FLASH_DAILY_LOGS    /* Data Logs   */
+    .storageCheckpoint : {} type=NOINIT > FLASH_STORAGE_DATA /* Storage Checkpoint */
+    .manufdata  : {} type=NOINIT > FLASH_MANUF_DATA    /* Manufacturing Record */
+    .algoCheckpoint : {} type=NOINIT > FLASH_ALGO_DATA /* Algorithm Checkpoint */
 
     .text       : {} > FLASH              /* CODE                              */
     .cinit      : {} > FLASH              /* INITIALIZATION TABLES             */
@@ -90,16 +90,12 @@ FILES=( "../src/CTS_HAL" \
         "../src/uartIsr" \
         "../src/utils" \
         "../src/waterDetect" \
-        "../src/waterAlgorithm/algo-c-code/calculateWaterVolume/calculateWaterVolume" \
         "../src/waterAlgorithm/algo-c-code/calculateWaterVolume/detectWaterChange" \
-        "../src/waterAlgorithm/algo-c-code/clearPadWindowProcess/clearPadWindowProcess" \
-        "../src/waterAlgorithm/algo-c-code/hourlyWaterVolume/hourlyWaterVolume" \
         "../src/waterAlgorithm/algo-c-code/initializeWaterAlgorithm/initializeWaterAlgorithm" \
-        "../src/waterAlgorithm/algo-c-code/initializeWindows/initializeWindows" \
         "../src/waterAlgorithm/algo-c-code/wakeupDataReset/wakeupDataReset" \
-        "../src/waterAlgorithm/algo-c-code/waterPadFiltering/waterPadFiltering" \
-        "../src/waterAlgorithm/algo-c-code/writePadSample/writePadSample" \
         "../src/waterAlgorithm/appAlgo" \
+        "../src/waterAlgorithm/waterPadAverage" \
+        "../src/waterAlgorithm/waterVolumeStream" \
         "../src/waterSense" )
 
 # ------------------------------------------------------------------------------------------------------
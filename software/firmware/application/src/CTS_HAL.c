@@ -94,6 +94,42 @@
 // of waking up and recording counts early
 uint8_t CAPSENSE_ACTIVE;
 
+// Bit n is set when element n of the last non-blocking measurement was
+// stopped late.  Another interrupt held off the gate ISR and the oscillator
+// kept counting, so the count of that element reads high.
+uint8_t CAPSENSE_LATE;
+
+#ifdef RO_PINOSC_TA1_TB0
+/*
+ *  ACLK periods after the gate timer wrapped that the gate ISR may stop an
+ *  element before it is flagged late.  One period (~30us) absorbs the
+ *  latency jitter and adds at most 1/512 of a full gate to the count.
+ */
+#define CTS_LATE_TOLERANCE 1
+
+/*
+ *  State of a measurement started with TI_CTS_RO_PINOSC_TA1_TB0_HAL_start().
+ *  group is NULL when no such measurement is running.  While it runs only
+ *  the TimerB0 ISR touches this data.
+ */
+static struct
+{
+    const struct Sensor *group;
+    uint16_t *counts;
+    TI_CTS_DoneCallback_t doneCallback;
+    uint8_t element;
+    uint8_t lateElements;
+    uint16_t contextSaveTA1CTL, contextSaveTA1CCTL1, contextSaveTA1CCR1;
+    uint16_t contextSaveTB0CTL, contextSaveTB0CCTL0, contextSaveTB0CCR0;
+    uint8_t contextSaveSel, contextSaveSel2;
+} ctsSweep;
+
+static void TI_CTS_RO_PINOSC_TA1_TB0_startElement(void);
+static void TI_CTS_RO_PINOSC_TA1_TB0_stopElement(void);
+static uint16_t TI_CTS_RO_PINOSC_TA1_TB0_gateCycles(const struct Sensor *group,
+                                                    const struct Element *element);
+#endif
+
 #ifdef RO_PINOSC_TA1_TB0
 /*!
  *
@@ -171,7 +207,6 @@ void TI_CTS_RO_PINOSC_TA1_TB0_HAL(const struct Sensor *group, uint16_t *counts)
      *  oscillations counted within the gate interval represents the measured
      *  capacitance.
      */
-    TB0CCR0 = (group->accumulationCycles);
     // Establish source and scale of timerA1, but halt the timer.
     TB0CTL = group->measGateSource + group->sourceScale;
     TB0CCTL0 = CCIE;                                       // Enable Interrupt when timer counts to TB0CCR0.
@@ -192,6 +227,9 @@ void TI_CTS_RO_PINOSC_TA1_TB0_HAL(const struct Sensor *group, uint16_t *counts)
         TA1R = 0;
         TA1CTL &= ~TAIFG;
 
+        // Gate time of this element, the gate timer is halted
+        TB0CCR0 = TI_CTS_RO_PINOSC_TA1_TB0_gateCycles(group, group->arrayPtr[i]);
+
         // Clear and start Gate Timer
         TB0CTL |= (TACLR + MC_1);
 
@@ -249,6 +287,138 @@ void TI_CTS_RO_PINOSC_TA1_TB0_HAL(const struct Sensor *group, uint16_t *counts)
 
     CAPSENSE_ACTIVE = 0;
 }
+
+/*!
+ *
+ *  ======== TI_CTS_RO_PINOSC_TA1_TB0_HAL_start ========
+ * @brief Non-blocking version of TI_CTS_RO_PINOSC_TA1_TB0_HAL()
+ *
+ *
+ * @param group  pointer to the sensor to be measured
+ * @param counts pointer to where the measurements are to be written, must
+ *               stay valid until CAPSENSE_ACTIVE is cleared
+ * @param doneCallback called from the ISR once all elements are measured,
+ *               may be NULL
+ * @return none
+ *
+ *
+ *  Additional Details:
+ *
+ *
+ *  The timer registers are saved once and the first element is started.
+ *  From then on TIMERB0_ISR stores each count, starts the next element and
+ *  returns to low power mode, so the CPU only wakes once per sensor instead
+ *  of once per element.  After the last element the ISR restores the timers,
+ *  calls doneCallback, clears CAPSENSE_ACTIVE and wakes the CPU.
+ *
+ *  Elements whose gate ISR was delayed by another interrupt are flagged in
+ *  CAPSENSE_LATE before doneCallback is called.
+ *
+ *  Interrupts must be enabled and the CPU can sleep in LPM3 while waiting
+ *  (the gate source must be ACLK).  Other interrupts may wake the CPU early,
+ *  so wait on CAPSENSE_ACTIVE rather than on the first wake up.
+ */
+void TI_CTS_RO_PINOSC_TA1_TB0_HAL_start(const struct Sensor *group, uint16_t *counts,
+                                        TI_CTS_DoneCallback_t doneCallback)
+{
+    ctsSweep.contextSaveTA1CTL = TA1CTL;
+    ctsSweep.contextSaveTA1CCTL1 = TA1CCTL1;
+    ctsSweep.contextSaveTA1CCR1 = TA1CCR1;
+    ctsSweep.contextSaveTB0CTL = TB0CTL;
+    ctsSweep.contextSaveTB0CCTL0 = TB0CCTL0;
+    ctsSweep.contextSaveTB0CCR0 = TB0CCR0;
+
+    ctsSweep.group = group;
+    ctsSweep.counts = counts;
+    ctsSweep.doneCallback = doneCallback;
+    ctsSweep.element = 0;
+    ctsSweep.lateElements = 0;
+
+    CAPSENSE_ACTIVE = 1;
+
+    // Same timer setup as the blocking version
+    TA1CTL = TASSEL_3;
+    TB0CTL = group->measGateSource + group->sourceScale;
+    TB0CCTL0 = CCIE;
+
+    TI_CTS_RO_PINOSC_TA1_TB0_startElement();
+}
+
+/*
+ *  Configure the port of the current element for the relaxation
+ *  oscillator and start the count and gate timers.
+ */
+static void TI_CTS_RO_PINOSC_TA1_TB0_startElement(void)
+{
+    const struct Element *elementP = ctsSweep.group->arrayPtr[ctsSweep.element];
+
+    // Context Save Port Registers
+    ctsSweep.contextSaveSel = *(elementP->inputPxselRegister);
+    ctsSweep.contextSaveSel2 = *(elementP->inputPxsel2Register);
+
+    // Configure Ports for relaxation oscillator
+    *(elementP->inputPxselRegister) &= ~(elementP->inputBits);
+    *(elementP->inputPxsel2Register) |= (elementP->inputBits);
+
+    TA1CTL |= (MC_2);
+    TA1R = 0;
+    TA1CTL &= ~TAIFG;
+
+    TB0CCR0 = TI_CTS_RO_PINOSC_TA1_TB0_gateCycles(ctsSweep.group, elementP);
+
+    // Clear and start Gate Timer
+    TB0CTL |= (TACLR + MC_1);
+}
+
+/*
+ *  Stop the timers, store the count of the current element and restore
+ *  its port.
+ */
+static void TI_CTS_RO_PINOSC_TA1_TB0_stopElement(void)
+{
+    const struct Element *elementP = ctsSweep.group->arrayPtr[ctsSweep.element];
+
+    TA1CTL &= ~MC_2;                                       // Stop Timer_A TAR
+    TB0CTL &= ~MC_1;                                       // Halt Timer_B
+
+    // The gate timer sits on TB0CCR0 for one ACLK period after the match
+    // and then wraps to 0.  Wake up and interrupt latency jitter can reach
+    // into the wrapped period, past CTS_LATE_TOLERANCE periods the ISR was
+    // held off by another interrupt.
+    if ((TB0R != TB0CCR0) && (TB0R >= CTS_LATE_TOLERANCE))
+    {
+        ctsSweep.lateElements |= (uint8_t)(1 << ctsSweep.element);
+    }
+
+    if (TA1CTL & TAIFG)
+    {
+        // check for timer overflow
+        ctsSweep.counts[ctsSweep.element] = 0xFFFF;
+    }
+    else
+    {
+        ctsSweep.counts[ctsSweep.element] = TA1R;
+    }
+
+    // Context Restore
+    *(elementP->inputPxselRegister) = ctsSweep.contextSaveSel;
+    *(elementP->inputPxsel2Register) = ctsSweep.contextSaveSel2;
+}
+
+/*
+ *  Gate timer period of one element.  Elements with an accumulationShift
+ *  are measured for a shorter gate, their count is that many bits smaller
+ *  than the count the group accumulationCycles would give.
+ */
+static uint16_t TI_CTS_RO_PINOSC_TA1_TB0_gateCycles(const struct Sensor *group,
+                                                    const struct Element *element)
+{
+    if (element->accumulationShift == NULL)
+    {
+        return group->accumulationCycles;
+    }
+    return group->accumulationCycles >> *(element->accumulationShift);
+}
 #endif
 
 #ifdef TIMERB0_GATE
@@ -260,6 +430,8 @@ void TI_CTS_RO_PINOSC_TA1_TB0_HAL(const struct Sensor *group, uint16_t *counts)
  *
  *
  *  This ISR clears the LPM bits found in the Status Register (SR/R2).
+ *  During a non-blocking measurement it instead chains to the next
+ *  element and only clears the LPM bits after the last one.
  *
  *
  * @param none
@@ -270,6 +442,34 @@ void TI_CTS_RO_PINOSC_TA1_TB0_HAL(const struct Sensor *group, uint16_t *counts)
 #endif
 __interrupt void TIMERB0_ISR(void)
 {
+#ifdef RO_PINOSC_TA1_TB0
+    if (ctsSweep.group != NULL)
+    {
+        TI_CTS_RO_PINOSC_TA1_TB0_stopElement();
+
+        if (++ctsSweep.element < ctsSweep.group->numElements)
+        {
+            // Measure the next element, stay in low power mode
+            TI_CTS_RO_PINOSC_TA1_TB0_startElement();
+            return;
+        }
+
+        TA1CTL = ctsSweep.contextSaveTA1CTL;
+        TA1CCTL1 = ctsSweep.contextSaveTA1CCTL1;
+        TA1CCR1 = ctsSweep.contextSaveTA1CCR1;
+        TB0CTL = ctsSweep.contextSaveTB0CTL;
+        TB0CCTL0 = ctsSweep.contextSaveTB0CCTL0;
+        TB0CCR0 = ctsSweep.contextSaveTB0CCR0;
+
+        ctsSweep.group = NULL;
+        CAPSENSE_LATE = ctsSweep.lateElements;
+        if (ctsSweep.doneCallback != NULL)
+        {
+            ctsSweep.doneCallback(ctsSweep.counts);
+        }
+        CAPSENSE_ACTIVE = 0;
+    }
+#endif
     __bic_SR_register_on_exit(LPM3_bits);                  // Exit LPM3 on reti
 }
 #endif
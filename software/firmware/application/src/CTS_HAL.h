@@ -142,5 +142,15 @@ void TI_CTS_fRO_PINOSC_TA1_TA0_HAL(const struct Sensor *, uint16_t *);
 
 void TI_CTS_fRO_PINOSC_TA1_TB0_HAL(const struct Sensor *, uint16_t *);
 
+/*!
+ *  Completion callback for the non-blocking measurement.  Called from the
+ *  TimerB0 ISR once every element of the sensor has been measured, with
+ *  the filled counts array.  CAPSENSE_LATE flags the elements whose count
+ *  was stopped late.  Keep it short.
+ */
+typedef void (*TI_CTS_DoneCallback_t)(const uint16_t *counts);
+
+void TI_CTS_RO_PINOSC_TA1_TB0_HAL_start(const struct Sensor *, uint16_t *, TI_CTS_DoneCallback_t);
+
 
 #endif /* CTS_HAL_H_ */
@@ -87,3 +87,29 @@ void TI_CAPT_Raw(const struct Sensor *groupOfElements, uint16_t *counts)
 
 }
 
+/***************************************************************************//**
+ * @brief   Start measuring the capacitance of each element within the Sensor
+ *          without waiting for the result
+ * 
+ *          Same as TI_CAPT_Raw() but returns as soon as the first element is
+ *          being measured.  The elements are chained from the gate timer ISR
+ *          and CAPSENSE_ACTIVE is cleared when the last one is done, right
+ *          after doneCallback is called.  counts must stay valid until then.
+ * @param   groupOfElements Pointer to Sensor structure to be measured
+ * @param   counts Address to where the measurements are to be written
+ * @param   doneCallback Called from the ISR when all elements are measured,
+ *          may be NULL
+ * @return  none
+ ******************************************************************************/
+void TI_CAPT_RawStart(const struct Sensor *groupOfElements, uint16_t *counts,
+                      TI_CTS_DoneCallback_t doneCallback)
+{
+#ifdef RO_PINOSC_TA1_TB0
+    if (groupOfElements->halDefinition == RO_PINOSC_TA1_TB0)
+    {
+        TI_CTS_RO_PINOSC_TA1_TB0_HAL_start(groupOfElements, counts, doneCallback);
+    }
+#endif
+
+}
+
@@ -115,6 +115,7 @@ void TI_CAPT_Update_Tracking_DOI(uint8_t);
 void TI_CAPT_Update_Tracking_Rate(uint8_t);
 
 void TI_CAPT_Raw(const struct Sensor*, uint16_t*);
+void TI_CAPT_RawStart(const struct Sensor*, uint16_t*, TI_CTS_DoneCallback_t);
 
 void TI_CAPT_Custom(const struct Sensor *, uint16_t*);
 
@@ -24,17 +24,240 @@
 
 #include "outpour.h"
 
+/***************************
+ * Module Data Definitions
+ **************************/
+
+/**
+ * \def FLASH_SEGMENT_SIZE
+ * \brief Size of one main flash erase segment.
+ */
+#define FLASH_SEGMENT_SIZE ((uint16_t)512)
+
+/**
+ * \def FLASH_WRITE_CHUNK_BYTES
+ * \brief Most bytes programmed by one msp430Flash_poll() call
+ *        (about 5ms of programming).
+ */
+#define FLASH_WRITE_CHUNK_BYTES ((uint16_t)32)
+
+/**
+ * \typedef flashJobType_t
+ * \brief The operation the flash driver is working on.
+ */
+typedef enum flashJobType_e {
+    FLASH_JOB_IDLE,
+    FLASH_JOB_ERASE,
+    FLASH_JOB_WRITE,
+} flashJobType_t;
+
+/**
+ * \typedef flashJob_t
+ * \brief The flash operation in progress.
+ */
+typedef struct flashJob_s {
+    flashJobType_t type;                                   /**< current operation */
+    uint8_t *flashP;                                       /**< next segment to erase or byte to write */
+    const uint8_t *srcP;                                   /**< next byte to write */
+    uint16_t remaining;                                    /**< segments or bytes left */
+} flashJob_t;
+
+/****************************
+ * Module Data Declarations
+ ***************************/
+
+/**
+* \var flashJob
+* \brief The flash operation in progress.
+*/
+static flashJob_t flashJob;
+
+/*************************
+ * Module Prototypes
+ ************************/
+
+static void xEraseSegment(uint8_t *flashSegmentAddrP);
+static void xWriteChunk(void);
+static void xWaitForIdle(void);
+
+/***************************
+ * Module Public Functions
+ **************************/
+
+/**
+* \brief Start erasing consecutive flash segments.  The work is
+*        done by msp430Flash_poll(), one segment per call.
+* \ingroup PUBLIC_API
+*
+* @param flashSegmentAddrP first segment to erase
+* @param num_segments number of segments to erase
+*
+* @return bool false if the driver is busy with another operation
+*/
+bool msp430Flash_submitErase(uint8_t *flashSegmentAddrP, uint16_t num_segments)
+{
+    if (flashJob.type != FLASH_JOB_IDLE)
+    {
+        return false;
+    }
+    flashJob.flashP = flashSegmentAddrP;
+    flashJob.srcP = NULL;
+    flashJob.remaining = num_segments;
+    flashJob.type = (num_segments > 0) ? FLASH_JOB_ERASE : FLASH_JOB_IDLE;
+    return true;
+}
+
+/**
+* \brief Start writing data bytes to flash.  The work is done by
+*        msp430Flash_poll(), FLASH_WRITE_CHUNK_BYTES per call.  srcP
+*        must stay valid until the write is complete.
+* \ingroup PUBLIC_API
+*
+* @param flashP starting flash addr to write to
+* @param srcP starting addr where data is read from
+* @param num_bytes number of bytes to write
+*
+* @return bool false if the driver is busy with another operation
+*/
+bool msp430Flash_submitWrite(uint8_t *flashP, const uint8_t *srcP, uint16_t num_bytes)
+{
+    if (flashJob.type != FLASH_JOB_IDLE)
+    {
+        return false;
+    }
+    flashJob.flashP = flashP;
+    flashJob.srcP = srcP;
+    flashJob.remaining = num_bytes;
+    flashJob.type = (num_bytes > 0) ? FLASH_JOB_WRITE : FLASH_JOB_IDLE;
+    return true;
+}
+
+/**
+* \brief Do the next bounded step of the operation in progress:
+*        erase one segment or write up to FLASH_WRITE_CHUNK_BYTES.
+*        Interrupts are serviced during an erase and between the
+*        bytes of a write (if they were enabled by the caller).
+* \ingroup PUBLIC_API
+*
+* @return bool true while the operation is not complete
+*/
+bool msp430Flash_poll(void)
+{
+    switch (flashJob.type)
+    {
+        case FLASH_JOB_ERASE:
+            xEraseSegment(flashJob.flashP);
+            flashJob.flashP += FLASH_SEGMENT_SIZE;
+            flashJob.remaining--;
+            break;
+        case FLASH_JOB_WRITE:
+            xWriteChunk();
+            break;
+        default:
+            break;
+    }
+    if (flashJob.remaining == 0)
+    {
+        flashJob.type = FLASH_JOB_IDLE;
+    }
+    return (flashJob.type != FLASH_JOB_IDLE);
+}
+
+/**
+* \brief Returns true while a submitted operation is not complete.
+* \ingroup PUBLIC_API
+*/
+bool msp430Flash_isBusy(void)
+{
+    return (flashJob.type != FLASH_JOB_IDLE);
+}
+
 /**
-* \brief Erase one segment of flash (one 512 byte area in flash)
+* \brief Erase one segment of flash (one 512 byte area in flash).
+*        Completes any submitted operation first.
 * \ingroup PUBLIC_API
 * 
 * @param flashSegmentAddrP 
 */
 void msp430Flash_erase_segment(uint8_t *flashSegmentAddrP)
+{
+    xWaitForIdle();
+    msp430Flash_submitErase(flashSegmentAddrP, 1);
+    xWaitForIdle();
+}
+
+/**
+* 
+* \brief Write data bytes to flash.  Completes any submitted
+*        operation first.
+* \ingroup PUBLIC_API
+* 
+* @param flashP  starting flash addr to write to
+* @param srcP starting addr where data is read from
+* @param num_bytes number of bytes to write
+*/
+void msp430Flash_write_bytes(uint8_t *flashP, uint8_t *srcP, uint16_t num_bytes)
+{
+    xWaitForIdle();
+    msp430Flash_submitWrite(flashP, srcP, num_bytes);
+    xWaitForIdle();
+}
+
+/**
+* 
+* \brief Write one 16 bit value to flash.  Write with the 
+*        correct endian-ness for transmit to the server (MSB
+*        first).
+* \ingroup PUBLIC_API
+* 
+* @param flashP  starting flash addr to write to 
+* @param val16 16 bit value to write
+*/
+void msp430Flash_write_int16(uint8_t *flashP, uint16_t val16)
+{
+    uint8_t bytes[2];
+
+    bytes[0] = (val16 >> 8) & 0xff;
+    bytes[1] = val16 & 0xff;
+    msp430Flash_write_bytes(flashP, &bytes[0], ((uint16_t)2));
+}
+
+/**
+* 
+* \brief Write one 32 bit value to flash.  Write with the 
+*        correct endian-ness for transmit to the server (MSB
+*        first).
+* \ingroup PUBLIC_API
+* 
+* @param flashP  starting flash addr to write to 
+* @param val32 32 bit value to write
+*/
+void msp430Flash_write_int32(uint8_t *flashP, uint32_t val32)
+{
+    uint8_t bytes[4];
+
+    bytes[0] = (val32 >> 24) & 0xff;
+    bytes[1] = (val32 >> 16) & 0xff;
+    bytes[2] = (val32 >> 8) & 0xff;
+    bytes[3] = val32 & 0xff;
+    msp430Flash_write_bytes(flashP, &bytes[0], ((uint16_t)4));
+}
+
+/*************************
+ * Module Private Functions
+ ************************/
+
+/**
+* \brief Erase one segment.  With EEI set an interrupt suspends the
+*        erase, is serviced and the erase resumes, so GIE is restored
+*        for the whole erase instead of being held off for ~15ms.
+* 
+* @param flashSegmentAddrP 
+*/
+static void xEraseSegment(uint8_t *flashSegmentAddrP)
 {
     volatile uint16_t ms_check_count;
     volatile uint8_t contextSaveSR;
-    volatile uint8_t checkCount = 0;
 
     contextSaveSR = __get_SR_register();
 
@@ -43,7 +266,13 @@ void msp430Flash_erase_segment(uint8_t *flashSegmentAddrP)
 
     FCTL2 = (FWKEY | FSSEL_1 | FN1);                       // Select clock
     FCTL3 = FWKEY;                                         // Clear Lock bit
-    FCTL1 = (FWKEY | ERASE);                               // Set Erase bit
+    FCTL1 = (FWKEY | ERASE | EEI);                         // Set Erase bit, allow interrupts
+
+    // If the GIE was set, restore it for the erase.
+    if (contextSaveSR & GIE)
+    {
+        __bis_SR_register(GIE);
+    }
 
     *flashSegmentAddrP = 0;                                // dummy write
 
@@ -76,7 +305,9 @@ void msp430Flash_erase_segment(uint8_t *flashSegmentAddrP)
         }
     }
 
-    FCTL1 = (FWKEY | LOCK);                                // Set LOCK bit
+    __bic_SR_register(GIE);
+    FCTL1 = FWKEY;                                         // Clear Erase bit
+    FCTL3 = (FWKEY | LOCK);                                // Set LOCK bit
 
     // If the GIE was set, restore it.
     if (contextSaveSR & GIE)
@@ -86,20 +317,21 @@ void msp430Flash_erase_segment(uint8_t *flashSegmentAddrP)
 }
 
 /**
-* 
-* \brief Write data bytes to flash
-* \ingroup PUBLIC_API
-* 
-* @param flashP  starting flash addr to write to
-* @param srcP starting addr where data is read from
-* @param num_bytes number of bytes to write
+* \brief Write the next chunk of the write operation.  GIE is only
+*        cleared while each byte is programmed (~.15ms), pending
+*        interrupts are serviced between bytes.
 */
-void msp430Flash_write_bytes(uint8_t *flashP, uint8_t *srcP, uint16_t num_bytes)
+static void xWriteChunk(void)
 {
-    volatile uint16_t i;
     volatile uint16_t us100_check_count;
     volatile uint8_t contextSaveSR;
-    volatile uint8_t checkCount = 0;
+    uint16_t chunk = flashJob.remaining;
+
+    if (chunk > FLASH_WRITE_CHUNK_BYTES)
+    {
+        chunk = FLASH_WRITE_CHUNK_BYTES;
+    }
+    flashJob.remaining -= chunk;
 
     contextSaveSR = __get_SR_register();
 
@@ -111,28 +343,17 @@ void msp430Flash_write_bytes(uint8_t *flashP, uint8_t *srcP, uint16_t num_bytes)
     FCTL1 = (FWKEY | WRT);                                 // Enable write
 
     // Write each byte
-    us100_check_count = 0;
-    for (i = 0; i < num_bytes; i++)
+    while (chunk--)
     {
-        us100_check_count = 0;
+        __bic_SR_register(GIE);
 
-        *flashP++ = *srcP++;
+        *flashJob.flashP++ = *flashJob.srcP++;
         /*
-         * From the MSP40 Documentation
-         * When a byte or word write or any erase operation is initiated 
-         * from within flash memory, the flash controller returns op-code 
-         * 03FFFh to the CPU at the next instruction fetch. Op-code 03FFFh 
-         * is the JMP PC instruction. This causes the CPU to loop until the 
-         * flash operation is finished. When the operation is finished and BUSY = 0, 
-         * the flash controller allows the CPU to fetch the proper op-code and program
-         * execution resumes.
-         *
-         * Based on the above, the while loop will never be entered below.   But its 
-         * kept around just to be safe? 
-         * 
          * note - from empirical lab testing, it takes ~.15125ms to
-         * program each byte.
+         * program each byte.  The CPU is held until it is done, see
+         * xEraseSegment().
          */
+        us100_check_count = 0;
         while (FCTL3 & BUSY)
         {
             // rough loop delay of 100us (assumes operating @ 1MHZ Clock);
@@ -144,10 +365,17 @@ void msp430Flash_write_bytes(uint8_t *flashP, uint8_t *srcP, uint16_t num_bytes)
                 break;
             }
         }
+
+        // If the GIE was set, let pending interrupts run
+        if (contextSaveSR & GIE)
+        {
+            __bis_SR_register(GIE);
+        }
     }
 
+    __bic_SR_register(GIE);
     FCTL1 = FWKEY;                                         // Clear WRT
-    FCTL1 = (FWKEY | LOCK);                                // Set Lock
+    FCTL3 = (FWKEY | LOCK);                                // Set Lock
 
     // If the GIE was set, restore it.
     if (contextSaveSR & GIE)
@@ -157,43 +385,14 @@ void msp430Flash_write_bytes(uint8_t *flashP, uint8_t *srcP, uint16_t num_bytes)
 }
 
 /**
-* 
-* \brief Write one 16 bit value to flash.  Write with the 
-*        correct endian-ness for transmit to the server (MSB
-*        first).
-* \ingroup PUBLIC_API
-* 
-* @param flashP  starting flash addr to write to 
-* @param val16 16 bit value to write
-*/
-void msp430Flash_write_int16(uint8_t *flashP, uint16_t val16)
-{
-    uint8_t bytes[2];
-
-    bytes[0] = (val16 >> 8) & 0xff;
-    bytes[1] = val16 & 0xff;
-    msp430Flash_write_bytes(flashP, &bytes[0], ((uint16_t)2));
-}
-
-/**
-* 
-* \brief Write one 32 bit value to flash.  Write with the 
-*        correct endian-ness for transmit to the server (MSB
-*        first).
-* \ingroup PUBLIC_API
-* 
-* @param flashP  starting flash addr to write to 
-* @param val32 32 bit value to write
+* \brief Run the operation in progress to completion.
 */
-void msp430Flash_write_int32(uint8_t *flashP, uint32_t val32)
+static void xWaitForIdle(void)
 {
-    uint8_t bytes[4];
-
-    bytes[0] = (val32 >> 24) & 0xff;
-    bytes[1] = (val32 >> 16) & 0xff;
-    bytes[2] = (val32 >> 8) & 0xff;
-    bytes[3] = val32 & 0xff;
-    msp430Flash_write_bytes(flashP, &bytes[0], ((uint16_t)4));
+    while (msp430Flash_poll())
+    {
+        WATCHDOG_TICKLE();
+    }
 }
 
 /*******************************************************************************
@@ -97,7 +97,10 @@ int main(void)
     WATCHDOG_TICKLE();
 
     // Store the status of the reboot reason (POR, Watchdog, Reset, etc).
+    // The bootloader hands its copy over in IFG1.  Clear it so the next
+    // reboot reason is not clouded by this one.
     rebootReason = IFG1;
+    IFG1 = 0;
 
     // Perform Hardware Initialization
     hal_sysClockInit();
@@ -33,18 +33,23 @@
  * Module Data Definitions
  **************************/
 
-/****************************
- * Module Data Declarations
- ***************************/
-bool manufRecord_checkForValidManufRecord(void);
-
 /**
  * \def MDR_LOCATION
- * \brief Where in flash the app record is located. It is 
- *        located in the Flash INFO C section.
+ * \brief Where in flash the manufacturing record of older
+ *        firmware is located.  It is located in the Flash INFO
+ *        D section.  It is only read to move it to the
+ *        manufacturing record log.
  */
 #define MDR_LOCATION ((uint8_t *)0x1000)  // INFO D
 
+/**
+ * \def MDR_LOCATION_SIZE
+ * \brief Size of the INFO D section.  The record of older
+ *        firmware must fit in it, INFO C after it holds the
+ *        application record the bootloader uses.
+ */
+#define MDR_LOCATION_SIZE ((uint16_t)64)
+
 /**
  * \def MDR_MAGIC
  * \brief Used as a known pattern to perform a "quick" verify 
@@ -52,65 +57,192 @@ bool manufRecord_checkForValidManufRecord(void);
  */
 #define MDR_MAGIC ((uint16_t)0x2468)
 
+/**
+ * \def MDR_LOG_MAGIC
+ * \brief Written at the start of the manufacturing record log
+ *        segment when it is started.
+ */
+#define MDR_LOG_MAGIC ((uint16_t)0x4D52)
+
+/**
+ * \def MDR_LOG_SIZE
+ * \brief Size of the manufacturing record log, one flash
+ *        segment.
+ */
+#define MDR_LOG_SIZE ((uint16_t)512)
+
+/**
+ * \def MDR_TOTAL_SECTIONS
+ * \brief Number of sections of the manufacturing record
+ *        (MDR_type_e).
+ */
+#define MDR_TOTAL_SECTIONS ((uint8_t)(MDR_Gate_Record + 1))
+
+/**
+ * \def MDR_MAX_SECTION_LENGTH
+ * \brief Length of the largest section, the GPS test data
+ */
+#define MDR_MAX_SECTION_LENGTH ((uint8_t)sizeof(MDRgpsRecord_t))
+
+/**
+ * \def MDR_ENTRY_OVERHEAD
+ * \brief Bytes of a log entry besides the section data: tag
+ *        and length before it, crc16 after it.
+ */
+#define MDR_ENTRY_OVERHEAD ((uint8_t)4)
+
+/**
+ * \def MDR_ENTRY_ERASED
+ * \brief Tag of the erased flash after the last log entry
+ */
+#define MDR_ENTRY_ERASED ((uint8_t)0xFF)
+
+/**
+ * \def MDR_NO_ENTRY
+ * \brief Offset used in the log index for a section that has
+ *        no entry in the log.
+ */
+#define MDR_NO_ENTRY ((uint16_t)0xFFFF)
+
+/**
+ * \typedef mdrLog_t
+ * \brief Define the layout of the manufacturing record log.
+ *        Each update of a section appends an entry:
+ * \li tag, the MDR_type_e of the section (1 byte)
+ * \li length of the section data (1 byte)
+ * \li section data (length bytes)
+ * \li crc16 of the tag, length and section data (2 bytes)
+ * \brief The newest valid entry of a section is the one used.
+ *        Entries are not word aligned, so they are always
+ *        copied to RAM before they are used.
+ */
+typedef union mdrLog_s {
+    struct {
+        uint16_t magic;                                    /**< MDR_LOG_MAGIC */
+        uint8_t entries[MDR_LOG_SIZE - sizeof(uint16_t)];  /**< The log entries, followed by erased flash */
+    } log;
+    uint8_t bytes[MDR_LOG_SIZE];                           // force to one flash segment
+} mdrLog_t;
+
+/**
+ * \typedef mdrSections_t
+ * \brief RAM copy of every section of the manufacturing
+ *        record, used while the log is compacted.
+ */
+typedef struct mdrSections_s {
+    manufRecord_t mr;                                      /**< The sections of the record of older firmware */
+    MDRgateRecord_t gt;                                    /**< cap-sense gate calibration */
+} mdrSections_t;
+
+/**
+ * \typedef mdrRecordSizeCheck_t
+ * \brief Does not compile if manufRecord_t no longer fits in
+ *        the INFO D section.
+ */
+typedef uint8_t mdrRecordSizeCheck_t[(sizeof(manufRecord_t) <= MDR_LOCATION_SIZE) ? 1 : -1];
+
+/**
+ * \typedef mdrIndex_t
+ * \brief RAM index of the manufacturing record log.  It is
+ *        built from the log at startup and kept up to date as
+ *        entries are appended.
+ */
+typedef struct mdrIndex_s {
+    uint16_t offset[MDR_TOTAL_SECTIONS];                   /**< Offset of the newest entry of each section, or MDR_NO_ENTRY */
+    uint16_t nextOffset;                                   /**< Offset where the next entry is appended */
+    bool valid;                                            /**< Set if the log is started */
+} mdrIndex_t;
+
+/****************************
+ * Module Data Declarations
+ ***************************/
+
+/*
+ *  This is the manufacturing record log in flash.  An update of a section
+ *  appends an entry, the segment is only erased when it is full and the
+ *  newest entry of each section is written back.
+ */
+#pragma DATA_SECTION(manufLog, ".manufdata")
+const mdrLog_t manufLog;
+
+/**
+ * \var mdrIndex
+ * \brief RAM index of the manufacturing record log
+ */
+static mdrIndex_t mdrIndex;
+
 /********************* 
  * Module Prototypes
  *********************/
 
+static void xBuildIndex(void);
+static void xStartLog(void);
+static void xEraseLog(void);
+static void xSealLog(void);
+static bool xAppendEntry(uint8_t tag, const uint8_t *dataP, uint8_t len);
+static void xCompactLog(void);
+static bool xReadSection(uint8_t tag, uint8_t *dataP);
+static uint8_t* xGetSectionP(manufRecord_t *mrP, MDRgateRecord_t *gtP, uint8_t tag);
+static uint8_t xGetSectionLength(uint8_t tag);
+static bool xIsLegacyRecordValid(void);
+static void xMoveLegacyRecord(void);
+
+/***************************
+ * Module Public Functions
+ **************************/
+
 /**
-* \brief Write a fresh manufacturing test record data structure to the 
-*        INFO flash location.  The count is set to zero.
+* \brief Call once at system startup.  Build the RAM index of the 
+*        manufacturing record log.  A manufacturing record
+*        written by older firmware in the INFO D section is
+*        moved to the log the first time.
+* \ingroup PUBLIC_API
+*/
+void manufRecord_init(void)
+{
+    xBuildIndex();
+    if (!mdrIndex.valid && xIsLegacyRecordValid())
+    {
+        xMoveLegacyRecord();
+    }
+}
+
+/**
+* \brief Start a fresh manufacturing record.  The log is erased
+*        and started with no sections, which reads the same as
+*        the zeroed record written before.
 *
 * @return bool True indicates that a valid Manufacturing data record resides
-*              in the INFO buffer
+*              in flash
 * \ingroup PUBLIC_API
 */
 bool manufRecord_initBootloaderRecord(void) {
-    manufRecord_t manufRecord;
     uint8_t retryCount = 0;
-    bool error = false;
 
     do
     {
-		// init the local RAM structure.
-		memset(&manufRecord, 0, sizeof(manufRecord_t));
-		manufRecord.magic = MDR_MAGIC;
-        manufRecord.recordLength = sizeof(manufRecord_t);
-
-		manufRecord.crc16 = gen_crc16((uint8_t *)&manufRecord, (sizeof(manufRecord_t) - sizeof(uint16_t)));
-		msp430Flash_erase_segment(MDR_LOCATION);
-		msp430Flash_write_bytes(MDR_LOCATION, (uint8_t *)&manufRecord, sizeof(manufRecord_t));
-
-        // Final check
-        if (!manufRecord_checkForValidManufRecord()) {
-            error = true;
-        } else {
-            error = false;
-        }
-
-	} while (error && (retryCount++ < 4));
+        xStartLog();
+    } while (!mdrIndex.valid && (retryCount++ < 4));
 
-    return !error;
+    return mdrIndex.valid;
 }
 
 /**
-* \brief Erase the APP record.  Erases the complete INFO C 
-*        section.
+* \brief Erase the manufacturing record.  Erases the log and
+*        the record of older firmware in the INFO D section.
 * \ingroup PUBLIC_API
 */
 void manufRecord_erase(void) {
+    msp430Flash_erase_segment((uint8_t *)&manufLog);
     msp430Flash_erase_segment(MDR_LOCATION);
+    xBuildIndex();
 }
 
 /**
-* \brief Determine if a valid Manufacturing Record is located in 
-*        the INFO D section.  The record is written by the
-*   	 Application and at startup to validate the startup Air Target
-*   	 data.  The recordLength variable is used to identify where
-*   	 the CRC is located.  This allows the structure to grow and
-*   	 have elements added, and the bootloader will still be able to
-*        verify its contents.  But the original elements must remain in
-*        the structure at their current defined location (except
-*        for the CRC location which always at the end - 2).
+* \brief Determine if a valid Manufacturing Record exists.  The
+*        record exists once the log is started, by the
+*        manufacturing test or by moving the record of older
+*        firmware.
 * 
 * @return bool Returns true if the record is valid.  False 
 *         otherwise.
@@ -118,31 +250,14 @@ void manufRecord_erase(void) {
 * \ingroup PUBLIC_API
 */
 bool manufRecord_checkForValidManufRecord(void) {
-    bool mrFlag = false;
-    manufRecord_t *mrP = (manufRecord_t *)MDR_LOCATION;
-
-    if (mrP->magic == MDR_MAGIC) {
-        // Locate the offset to the CRC in the structure based on the
-        // stored record length of the appRecord. This is to ensure
-        // backward compatibility with future versions.
-        uint8_t crcOffset = mrP->recordLength - sizeof(uint16_t);
-        // Calculate CRC
-        uint16_t calcCrc = gen_crc16(MDR_LOCATION, crcOffset);
-        // Access stored CRC based on stored record length, not structure element
-        // because structure may be added to in the future.
-        uint16_t *storedCrcP = (uint16_t *)(((uint8_t *)mrP) + crcOffset);
-        uint16_t storedCrc =  *storedCrcP;
-        // Compare calculated CRC to the CRC stored in the structure
-        if (calcCrc == storedCrc)
-        {
-           mrFlag = true;
-        }
-    }
-    return mrFlag;
+    return mdrIndex.valid;
 }
 
 /**
-* \brief Update the manuacturing data in the manufacturing record
+* \brief Update the manuacturing data in the manufacturing record.
+*        An entry for the section is appended to the log.  If
+*        the log is full it is compacted first.  Nothing is
+*        written if the section already holds the same data.
 * 
 * @param mr_type The section of Manufacturing Data to update
 * @param mr_in Address of data to be written into the buffer
@@ -154,48 +269,32 @@ bool manufRecord_checkForValidManufRecord(void) {
 * \ingroup PUBLIC_API
 */
 bool manufRecord_updateManufRecord(MDR_type_e mr_type, uint8_t *mr_in, uint8_t len_in) {
-    manufRecord_t manufRecord;
+    uint8_t section[MDR_MAX_SECTION_LENGTH];
+    uint8_t *sectionP = section;
     uint8_t retryCount = 0;
     bool error = false;
-    // Retry up to four times to write the App Record.
-    do {
-        manufRecord_t *mrP = (manufRecord_t *)MDR_LOCATION;
 
-        manufRecord.magic = MDR_MAGIC;
-        manufRecord.recordLength = sizeof(manufRecord_t);
+    if ((xGetSectionLength(mr_type) == 0) || (len_in > xGetSectionLength(mr_type)))
+    {
+        return false;
+    }
 
-        // make a ram copy of current data
-        memcpy(&manufRecord,mrP,sizeof(manufRecord_t)-sizeof(uint16_t));
+    // A section is written as a whole.  Bytes not given keep their
+    // current value.
+    xReadSection(mr_type, sectionP);
+    if (memcmp(sectionP, mr_in, len_in) == 0)
+    {
+        return true;
+    }
+    memcpy(sectionP, mr_in, len_in);
 
-        // copy it all from the manufacturing code
-        switch (mr_type)
+    // Retry up to four times to write the section.
+    do {
+        if (!mdrIndex.valid)
         {
-            case MDR_Water_Record:
-                memcpy(&manufRecord.wr,mr_in,len_in);
-            	break;
-            case MDR_GPS_Record:
-                memcpy(&manufRecord.gr,mr_in,len_in);
-            	break;
-            case MDR_Modem_Record:
-                memcpy(&manufRecord.mr,mr_in,len_in);
-            	break;
-            default:
-            	// do nothing
-            	break;
-        }
-		
-        // Calculate CRC on RAM version
-        manufRecord.crc16 = gen_crc16((const unsigned char *)&manufRecord, (sizeof(manufRecord_t) - sizeof(uint16_t)));
-        // Erase Flash Version
-        msp430Flash_erase_segment(MDR_LOCATION);
-        // Copy RAM version to Flash version
-        msp430Flash_write_bytes(MDR_LOCATION, (uint8_t *)&manufRecord, sizeof(manufRecord_t));
-        // Final check
-        if (!manufRecord_checkForValidManufRecord()) {
-            error = true;
-        } else {
-            error = false;
+            xStartLog();
         }
+        error = !xAppendEntry(mr_type, sectionP, xGetSectionLength(mr_type));
     } while (error && (retryCount++ < 4));
     return !error;
 }
@@ -211,14 +310,11 @@ bool manufRecord_updateManufRecord(MDR_type_e mr_type, uint8_t *mr_in, uint8_t l
 #ifdef WATER_DEBUG
 bool mTestGPSDone()
 {
-    manufRecord_t manufRecord;
+    MDRgpsRecord_t gr;
 
-    manufRecord_t *mrP = (manufRecord_t *)MDR_LOCATION;
-
-    // make a ram copy of current data
-    memcpy(&manufRecord,mrP,sizeof(manufRecord_t)-sizeof(uint16_t));
+    xReadSection(MDR_GPS_Record, (uint8_t *)&gr);
 
-    if (manufRecord.gr.gpsQuality==1)
+    if (gr.gpsQuality==1)
 	   return(true);
     else
        return(false);
@@ -237,16 +333,14 @@ bool mTestGPSDone()
 #ifdef WATER_DEBUG
 bool mTestWaterDone()
 {
-    manufRecord_t manufRecord;
+    MDRwaterRecord_t wr;
     int i;
-    manufRecord_t *mrP = (manufRecord_t *)MDR_LOCATION;
 
-    // make a ram copy of current data
-    memcpy(&manufRecord,mrP,sizeof(manufRecord_t)-sizeof(uint16_t));
+    xReadSection(MDR_Water_Record, (uint8_t *)&wr);
 
     // first sight of a non-zero deviation and we're done
     for(i=0;i<MDR_NUMPADS; i++)
-       if (manufRecord.wr.airDeviation[i]!=0)
+       if (wr.airDeviation[i]!=0)
 	      return(true);
 
     return(false);
@@ -263,19 +357,48 @@ bool mTestWaterDone()
 */
 bool manufRecord_send_test(void)
 {
-    manufRecord_t manufRecord;
-    manufRecord_t *mrP = (manufRecord_t *)MDR_LOCATION;
+    MDRmodemRecord_t mr;
 
-    // make a ram copy of current data
-    memcpy(&manufRecord,mrP,sizeof(manufRecord_t)-sizeof(uint16_t));
+    xReadSection(MDR_Modem_Record, (uint8_t *)&mr);
 
     // check if modem "send test" message was sent yet for this board
-    if (manufRecord.mr.send_test!=0)
+    if (mr.send_test!=0)
 	   return(false);
     else
        return(true);
 }
 
+/**
+* \brief Read the water detect test data from the manufacturing
+*        record.
+*
+* @param wr Returns the water detect test data, zero if it was
+*           not recorded
+*
+* @return bool Returns false if the data was not recorded
+*
+* \ingroup PUBLIC_API
+*/
+bool manufRecord_getWaterInfo(MDRwaterRecord_t *wr)
+{
+    return xReadSection(MDR_Water_Record, (uint8_t *)wr);
+}
+
+/**
+* \brief Read the cap-sense gate calibration from the manufacturing
+*        record.
+*
+* @param gt Returns the gate calibration
+*
+* @return bool Returns false if the gate calibration was not
+*         recorded yet.
+*
+* \ingroup PUBLIC_API
+*/
+bool manufRecord_getGateInfo(MDRgateRecord_t *gt)
+{
+    return xReadSection(MDR_Gate_Record, (uint8_t *)gt);
+}
 
 /**
 * \brief Part two of the State machine that coordinates the Manufacturing Test process 
@@ -331,3 +454,336 @@ void manufRecord_manuf_test_result()
 	;
 #endif
 }
+
+/*************************
+ * Module Private Functions
+ ************************/
+
+/**
+* \brief Build the RAM index of the manufacturing record log.
+*        The entries are read in order up to the erased flash.
+*        An entry with a bad crc16 (a write that did not
+*        finish) is skipped.  If the tag or length of an entry
+*        is not usable, the rest of the log can not be read, it
+*        is treated as full and compacted with the next update.
+*/
+static void xBuildIndex(void)
+{
+    uint16_t offset = 0;
+    uint8_t tag;
+    uint8_t len;
+    uint16_t crc16;
+    const uint8_t *entryP;
+
+    memset(mdrIndex.offset, 0xFF, sizeof(mdrIndex.offset));
+    mdrIndex.valid = (manufLog.log.magic == MDR_LOG_MAGIC);
+    mdrIndex.nextOffset = 0;
+    if (!mdrIndex.valid)
+    {
+        return;
+    }
+
+    while (offset < sizeof(manufLog.log.entries))
+    {
+        entryP = &manufLog.log.entries[offset];
+        tag = entryP[0];
+        if (tag == MDR_ENTRY_ERASED)
+        {
+            break;
+        }
+        len = entryP[1];
+        if ((tag >= MDR_TOTAL_SECTIONS) || (len != xGetSectionLength(tag)) ||
+            ((offset + len + MDR_ENTRY_OVERHEAD) > sizeof(manufLog.log.entries)))
+        {
+            offset = sizeof(manufLog.log.entries);
+            break;
+        }
+        memcpy(&crc16, &entryP[len + 2], sizeof(uint16_t));
+        if (crc16 == gen_crc16(entryP, len + 2))
+        {
+            mdrIndex.offset[tag] = offset;
+        }
+        offset += len + MDR_ENTRY_OVERHEAD;
+    }
+    mdrIndex.nextOffset = offset;
+}
+
+/**
+* \brief Erase the log and write the log magic.  The log holds
+*        no sections after this.
+*/
+static void xStartLog(void)
+{
+    xEraseLog();
+    xSealLog();
+}
+
+/**
+* \brief Erase the log.  The index is left empty and not valid,
+*        entries can be appended before the log is sealed.
+*/
+static void xEraseLog(void)
+{
+    msp430Flash_erase_segment((uint8_t *)&manufLog);
+    xBuildIndex();
+}
+
+/**
+* \brief Write the log magic after the entries of a rewritten log
+*        and rebuild the index from flash.  The magic is written
+*        last so a log that was erased and not completely rewritten
+*        (a reset during xCompactLog or xMoveLegacyRecord) reads as
+*        not started, never as a record with sections missing.
+*/
+static void xSealLog(void)
+{
+    uint16_t magic = MDR_LOG_MAGIC;
+
+    msp430Flash_write_bytes((uint8_t *)&manufLog.log.magic, (uint8_t *)&magic, sizeof(uint16_t));
+    xBuildIndex();
+}
+
+/**
+* \brief Append an entry for a section to the log, compacting the
+*        log first if the entry does not fit.  The crc16 is
+*        calculated on the entry as written in flash and is
+*        written last, so an entry that is not completely
+*        written is not used.
+* 
+* @param tag The section (MDR_type_e)
+* @param dataP The section data
+* @param len Length of the section data
+* 
+* @return bool Returns true if the entry was written
+*/
+static bool xAppendEntry(uint8_t tag, const uint8_t *dataP, uint8_t len)
+{
+    uint8_t header[2];
+    uint16_t crc16;
+    uint16_t offset;
+    uint8_t *entryP;
+
+    if ((mdrIndex.nextOffset + len + MDR_ENTRY_OVERHEAD) > sizeof(manufLog.log.entries))
+    {
+        xCompactLog();
+        if ((mdrIndex.nextOffset + len + MDR_ENTRY_OVERHEAD) > sizeof(manufLog.log.entries))
+        {
+            return false;
+        }
+    }
+
+    offset = mdrIndex.nextOffset;
+    entryP = (uint8_t *)&manufLog.log.entries[offset];
+    header[0] = tag;
+    header[1] = len;
+    msp430Flash_write_bytes(entryP, header, sizeof(header));
+    msp430Flash_write_bytes(&entryP[2], (uint8_t *)dataP, len);
+    crc16 = gen_crc16(entryP, len + 2);
+    msp430Flash_write_bytes(&entryP[len + 2], (uint8_t *)&crc16, sizeof(uint16_t));
+    mdrIndex.nextOffset += len + MDR_ENTRY_OVERHEAD;
+
+    // Final check
+    if ((memcmp(entryP, header, sizeof(header)) != 0) || (memcmp(&entryP[2], dataP, len) != 0) ||
+        (memcmp(&entryP[len + 2], &crc16, sizeof(uint16_t)) != 0))
+    {
+        return false;
+    }
+    mdrIndex.offset[tag] = offset;
+    return true;
+}
+
+/**
+* \brief Erase the full log and write back the newest entry of
+*        each section.  The sections are held in RAM while the
+*        segment is rewritten, and the log magic is written after
+*        them.
+*
+*        A reset before the magic is written leaves a log that is
+*        not started, so mdrIndex.valid stays false and no partial
+*        record is ever used.  At the next start manufRecord_init()
+*        moves the record of older firmware from INFO D again if it
+*        is still there (sections updated since then are lost).
+*        Otherwise the board runs as one without a manufacturing
+*        record until the manufacturing test writes it again.  There
+*        is only one segment for the log, so the sections can not be
+*        kept anywhere else across the reset.
+*/
+static void xCompactLog(void)
+{
+    mdrSections_t sections;
+    bool present[MDR_TOTAL_SECTIONS];
+    uint8_t tag;
+
+    for (tag = 0; tag < MDR_TOTAL_SECTIONS; tag++)
+    {
+        present[tag] = xReadSection(tag, xGetSectionP(&sections.mr, &sections.gt, tag));
+    }
+
+    xEraseLog();
+
+    for (tag = 0; tag < MDR_TOTAL_SECTIONS; tag++)
+    {
+        if (present[tag])
+        {
+            xAppendEntry(tag, xGetSectionP(&sections.mr, &sections.gt, tag), xGetSectionLength(tag));
+        }
+    }
+
+    xSealLog();
+}
+
+/**
+* \brief Copy the newest entry of a section from the log.  If the
+*        section has no entry, it is returned as zero, except
+*        the gate calibration which is returned as not
+*        calibrated (0xFF).
+* 
+* @param tag The section (MDR_type_e)
+* @param dataP Returns the section data
+* 
+* @return bool Returns true if the section has an entry
+*/
+static bool xReadSection(uint8_t tag, uint8_t *dataP)
+{
+    uint8_t len = xGetSectionLength(tag);
+    uint16_t offset = mdrIndex.offset[tag];
+
+    if (offset == MDR_NO_ENTRY)
+    {
+        memset(dataP, (tag == MDR_Gate_Record) ? 0xFF : 0, len);
+        return false;
+    }
+    memcpy(dataP, &manufLog.log.entries[offset + 2], len);
+    return true;
+}
+
+/**
+* \brief Return where a section is kept in the manufacturing
+*        record structure.
+* 
+* @param mrP The manufacturing record
+* @param gtP The gate calibration, NULL if there is none (the
+*            record of older firmware)
+* @param tag The section (MDR_type_e)
+* 
+* @return uint8_t* Pointer to the section, NULL if the section is
+*         not known
+*/
+static uint8_t* xGetSectionP(manufRecord_t *mrP, MDRgateRecord_t *gtP, uint8_t tag)
+{
+    uint8_t *sectionP = NULL;
+
+    switch (tag)
+    {
+        case MDR_Water_Record:
+            sectionP = (uint8_t *)&mrP->wr;
+            break;
+        case MDR_GPS_Record:
+            sectionP = (uint8_t *)&mrP->gr;
+            break;
+        case MDR_Modem_Record:
+            sectionP = (uint8_t *)&mrP->mr;
+            break;
+        case MDR_Gate_Record:
+            sectionP = (uint8_t *)gtP;
+            break;
+        default:
+            // do nothing
+            break;
+    }
+    return sectionP;
+}
+
+/**
+* \brief Return the length of a section.
+* 
+* @param tag The section (MDR_type_e)
+* 
+* @return uint8_t Length of the section, zero if the section is
+*         not known
+*/
+static uint8_t xGetSectionLength(uint8_t tag)
+{
+    uint8_t len = 0;
+
+    switch (tag)
+    {
+        case MDR_Water_Record:
+            len = sizeof(MDRwaterRecord_t);
+            break;
+        case MDR_GPS_Record:
+            len = sizeof(MDRgpsRecord_t);
+            break;
+        case MDR_Modem_Record:
+            len = sizeof(MDRmodemRecord_t);
+            break;
+        case MDR_Gate_Record:
+            len = sizeof(MDRgateRecord_t);
+            break;
+        default:
+            // do nothing
+            break;
+    }
+    return len;
+}
+
+/**
+* \brief Determine if a valid Manufacturing Record written by older
+*        firmware is located in the INFO D section.  The
+*        recordLength variable is used to identify where the CRC
+*        is located.
+* 
+* @return bool Returns true if the record is valid.  False 
+*         otherwise.
+*/
+static bool xIsLegacyRecordValid(void)
+{
+    bool mrFlag = false;
+    manufRecord_t *mrP = (manufRecord_t *)MDR_LOCATION;
+
+    if ((mrP->magic == MDR_MAGIC) && (mrP->recordLength <= sizeof(manufRecord_t)) &&
+        (mrP->recordLength > sizeof(uint16_t)))
+    {
+        // Locate the offset to the CRC in the structure based on the
+        // stored record length of the record.
+        uint8_t crcOffset = mrP->recordLength - sizeof(uint16_t);
+        // Calculate CRC
+        uint16_t calcCrc = gen_crc16(MDR_LOCATION, crcOffset);
+        // Access stored CRC based on stored record length, not structure element
+        uint16_t storedCrc;
+        memcpy(&storedCrc, MDR_LOCATION + crcOffset, sizeof(uint16_t));
+        // Compare calculated CRC to the CRC stored in the structure
+        if (calcCrc == storedCrc)
+        {
+           mrFlag = true;
+        }
+    }
+    return mrFlag;
+}
+
+/**
+* \brief Move the manufacturing record of older firmware from the
+*        INFO D section to the log.  The sections that are
+*        inside the stored record length are copied.  The INFO
+*        D section is left as it is, and the log magic is written
+*        after the entries, so a reset part way through moves the
+*        record again at the next start.
+*/
+static void xMoveLegacyRecord(void)
+{
+    manufRecord_t *mrP = (manufRecord_t *)MDR_LOCATION;
+    uint8_t tag;
+    uint8_t *sectionP;
+
+    xEraseLog();
+    for (tag = 0; tag < MDR_TOTAL_SECTIONS; tag++)
+    {
+        sectionP = xGetSectionP(mrP, NULL, tag);
+        if ((sectionP != NULL) &&
+            ((sectionP + xGetSectionLength(tag)) <= (MDR_LOCATION + mrP->recordLength - sizeof(uint16_t))))
+        {
+            xAppendEntry(tag, sectionP, xGetSectionLength(tag));
+        }
+    }
+    xSealLog();
+}
@@ -68,6 +68,7 @@
  * \li modemMgr_sendModemCmdBatch
  * \li modemMgr_isModemCmdComplete
  * \li modemMgr_isModemCmdError
+ * \li modemMgr_isTransmitting
  * \li modemMgr_stopModemCmdBatch
  * 
  * \brief poll for modem network connection or error
@@ -79,6 +80,8 @@
  * \li modemMgr_getNumOtaMsgsPending
  * \li modemMgr_getSizeOfOtaMsgsPending
  * \li modemMgr_getLastOtaResponse
+ * \li modemMgr_holdOtaResponse
+ * \li modemMgr_releaseOtaResponse
  * 
  * \brief Release the modem and power down the modem
  * \li modemMgr_release
@@ -322,6 +325,27 @@ bool modemMgr_isAllocated(void)
     return (mwBatchData.allocated);
 }
 
+/**
+* \brief Check if the modem may be transmitting over the air.  The
+*        MCU has no signal for the radio itself, so this is true from
+*        when a send data or send test command is written to the modem
+*        until the batch job that sent it is done, and during the
+*        status only jobs that poll for the link while the message
+*        waits for the network.  The modem sends the message while
+*        these jobs poll its status.
+* \ingroup PUBLIC_API
+* 
+* @return bool True while a send command batch job is past the 
+*         command write.
+*/
+bool modemMgr_isTransmitting(void)
+{
+    return (mwBatchData.batchWriteActive &&
+            (mwBatchData.mwBatchState >= MWBATCH_STATE_WRITE_CMD_WAIT) &&
+            ((mwBatchData.cmdWriteP->cmd == OUTPOUR_M_COMMAND_SEND_DATA) ||
+             (mwBatchData.cmdWriteP->cmd == OUTPOUR_M_COMMAND_SEND_TEST)));
+}
+
 /**
 * \brief Release the modem.  Must be called by all upper layer 
 *        message objects when they are done with the modem. Then
@@ -331,6 +355,7 @@ bool modemMgr_isAllocated(void)
 void modemMgr_release(void)
 {
     mwBatchData.batchWriteActive = false;
+    mwBatchData.otaBufHeld = false;
     mwBatchData.mwBatchState = MWBATCH_STATE_IDLE;
 
     mwBatchData.mmShutdownState = M_SHUTDOWN_STATE_WRITE_CMD;
@@ -423,6 +448,32 @@ otaResponse_t* modemMgr_getLastOtaResponse(void)
     return (&mwBatchData.otaResponse);
 }
 
+/**
+* \brief Keep the payload of the last OTA (partial) message in 
+*        the OTA buffer.  A batch job for the next partial
+*        message can be started, but its response is left in the
+*        modemCmd buffer and the job does not complete until the
+*        client calls modemMgr_releaseOtaResponse.  This lets the
+*        client work on one payload while the modem sends the
+*        next one.
+* \ingroup PUBLIC_API
+*/
+void modemMgr_holdOtaResponse(void)
+{
+    mwBatchData.otaBufHeld = true;
+}
+
+/**
+* \brief Allow the next OTA (partial) message response to be 
+*        copied into the OTA buffer.  See
+*        modemMgr_holdOtaResponse.
+* \ingroup PUBLIC_API
+*/
+void modemMgr_releaseOtaResponse(void)
+{
+    mwBatchData.otaBufHeld = false;
+}
+
 /**
 * \brief Retrieve a pointer to the shared buffer that can be
 *        used for other purposes.  Due to limited RAM
@@ -498,6 +549,13 @@ static void modemMgr_batchWriteStateMachine(void)
             }
                 break;
             case MWBATCH_STATE_WRITE_CMD_WAIT:
+                // A partial response is copied into the OTA buffer.  If the
+                // client is still using the buffer, wait for it to be released.
+                if ((mwBatchData.cmdWriteP->cmd == OUTPOUR_M_COMMAND_GET_INCOMING_PARTIAL) &&
+                    mwBatchData.otaBufHeld)
+                {
+                    break;
+                }
                 if (!modemCmd_isBusy())
                 {
                     // If a uart comm error occurred, record it.
@@ -40,6 +40,9 @@ typedef enum messageType {
     MSG_TYPE_SENSOR_DATA = 0x22,
     MSG_TYPE_SOS = 0x23,	
     MSG_TYPE_TIMESTAMP = 0x24,
+    MSG_TYPE_DAILY_LOG_COMPACT = 0x25,
+    MSG_TYPE_DAILY_LOG_BUNDLE = 0x26,
+    MSG_TYPE_DAILY_LOG_QUARTER_HOUR = 0x27,
     // this message type is an internal message (it will never be seen by the IOT server)
     MSG_TYPE_MODEM_SEND_TEST = 0x2F,
 
@@ -70,6 +73,7 @@ typedef enum otaOpcodes_e {
     OTA_OPCODE_SET_GPS_MEAS_PARAMS = 0x0E,
     OTA_OPCODE_SENSOR_DATA = 0x0F,
     OTA_OPCODE_FIRMWARE_UPGRADE = 0x10,
+    OTA_OPCODE_DAILY_LOG_BACKFILL = 0x11,
     OTA_OPCODE_MEMORY_READ = 0x1F,
 } OtaOpcode_t;
 
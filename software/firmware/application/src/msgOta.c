@@ -78,6 +78,13 @@ typedef enum otaState_e {
 // #define MAX_OTA_MEMORY_READ_BYTES (OTA_PAYLOAD_BUF_LENGTH - 8)
 #define MAX_OTA_MEMORY_READ_BYTES (255)
 
+/**
+ * \def DAILY_LOG_BACKFILL_REQUEST_LENGTH
+ * \brief Length of the daily log backfill request: msg opcode,
+ *        msg id, first day and last day.
+ */
+#define DAILY_LOG_BACKFILL_REQUEST_LENGTH (7)
+
 /**
  * \typedef otaData_t
  *  \brief Define a container (i.e. structure) to hold data for
@@ -135,6 +142,7 @@ static bool otaMsgMgr_processSetTransmissionRate(otaResponse_t *otaRespP);
 static bool otaMsgMgr_processClockRequest(otaResponse_t *otaRespP);
 static bool otaMsgMgr_processGpsRequest(otaResponse_t *otaRespP);
 static bool otaMsgMgr_setGpsMeasCriteria(otaResponse_t *otaRespP);
+static bool otaMsgMgr_processDailyLogBackfill(otaResponse_t *otaRespP);
 static bool otaMsgMgr_processUnknownRequest(otaResponse_t *otaRespP);
 static bool otaMsgMgr_processMemoryRead(otaResponse_t *otaRespP);
 static void sendPhase0_OtaCommand(void);
@@ -960,12 +968,17 @@ static bool otaMsgMgr_processSilenceDevice(otaResponse_t *otaRespP)
 * \li msg opcode (1 byte)
 * \li msg id     (2 bytes)
 * \li transmission rate in days (1 byte)
+* \li daily log format (1 byte, optional): bit 0 = compact,
+*     bit 1 = bundled, bit 2 = quarter hour bins (from the next
+*     day), 0 = standard.  If not present the format is not
+*     changed.
 *  
 * \brief Output OTA response
 * \li msg opcode (1 byte)
 * \li msg id     (2 bytes)
 * \li status     (1 byte): 1 = success, 0xFF = failure
 * \li transmission rate in days (1 byte)
+* \li daily log format (1 byte)
 *
 * @return bool Set to true if a OTA response should be sent
 */
@@ -973,25 +986,34 @@ static bool otaMsgMgr_processSetTransmissionRate(otaResponse_t *otaRespP)
 {
     uint8_t *responseDataP = &otaData.responseBufP[RESPONSE_DATA_OFFSET];
     uint8_t transmissionRateInDays = 1;
+    uint8_t dailyLogFormat = storageMgr_getDailyLogFormat();
     uint8_t *bufP = otaRespP->buf;
 
     transmissionRateInDays = bufP[3];
+    if (otaRespP->lengthInBytes > 4)
+    {
+        dailyLogFormat = bufP[4];
+    }
 
     // Prepare OTA response.  It will be sent after this function exits.
     prepareOtaResponse(otaRespP->buf[0], otaRespP->buf[1], otaRespP->buf[2], NULL, 0);
 
-    if (transmissionRateInDays == 0 || transmissionRateInDays > (4 * 7))
+    if ((transmissionRateInDays == 0) || (transmissionRateInDays > (4 * 7)) ||
+        (dailyLogFormat & ~DAILY_LOG_FORMAT_MASK))
     {
         // Add OTA response data
         *responseDataP++ = 0xff;                           // error status
         *responseDataP++ = transmissionRateInDays;
+        *responseDataP++ = dailyLogFormat;
     }
     else
     {
         storageMgr_setTransmissionRate(transmissionRateInDays);
+        storageMgr_setDailyLogFormat(dailyLogFormat);
         // Add OTA response data
         *responseDataP++ = 1;                              // success status
         *responseDataP++ = transmissionRateInDays;
+        *responseDataP++ = dailyLogFormat;
     }
 
     return (true);
@@ -1251,12 +1273,15 @@ static bool otaMsgMgr_setGpsMeasCriteria(otaResponse_t *otaRespP)
 * \li key2       (1 byte)
 * \li key3       (1 byte)
 * \li total sections (1 byte)
-* \li section start byte (1 byte)
+* \li section start byte (1 byte): 0xA5, or 0xD5 for a delta
+*     section built from the running app
 * \li section number (1 byte)
 * \li firmware address in flash (2 bytes, MSB first)
 * \li firmware length in bytes  (2 bytes, MSB first)
 * \li crc16 of firmware         (2 bytes)
-* \li 11264 bytes of firmware   (11K, 0x2C00 bytes)
+* \li 11264 bytes of firmware   (11K, 0x2C00 bytes), or for a
+*     delta section the delta header and delta ops (see
+*     msgOtaUpgrade.c)
 *  
 * \brief Output OTA response
 * \li msg opcode (1 byte)
@@ -1323,6 +1348,72 @@ static bool otaMsgMgr_processFirmwareUpgrade(otaResponse_t *otaRespP)
     return (true);
 }
 
+/**
+* \brief (msgId=0x11) Resend the stored daily logs of a range
+*        of days.  A day is identified by the days activated
+*        field of the daily log header.  The daily logs are sent
+*        with the scheduled messages in the standard daily log
+*        packet with their original header, lowest day first.
+*        Only the first few are sent in one session, the rest
+*        of the range is asked for again from the resume day.
+*  
+* \brief Input OTA parameters
+* \li msg opcode (1 byte)
+* \li msg id     (2 bytes)
+* \li first day  (2 bytes, MSB first)
+* \li last day   (2 bytes, MSB first)
+*  
+* \brief Output OTA response
+* \li msg opcode (1 byte)
+* \li msg id     (2 bytes)
+* \li status     (1 byte): 1 = success, 0xFF = failure
+* \li first day  (2 bytes), 0 if the request is too short
+* \li last day   (2 bytes), 0 if the request is too short
+* \li number of daily logs stored for the range (1 byte)
+* \li resume day (2 bytes): first day not sent in this session,
+*     0xFFFF if all of them are sent
+* 
+* @param otaRespP Pointer to the response data and other info
+*                 received from the modem.
+* 
+* @return bool Set to true if a OTA response should be sent
+*/
+static bool otaMsgMgr_processDailyLogBackfill(otaResponse_t *otaRespP)
+{
+    uint8_t *responseDataP = &otaData.responseBufP[RESPONSE_DATA_OFFSET];
+    uint8_t *bufP = otaRespP->buf;
+    uint16_t firstDay = 0;
+    uint16_t lastDay = 0;
+    uint16_t resumeDay = 0xFFFF;
+    uint8_t found = 0;
+    uint8_t status = 0xFF;
+
+    // The days are only read from a request long enough to hold them
+    if (otaRespP->lengthInBytes >= DAILY_LOG_BACKFILL_REQUEST_LENGTH)
+    {
+        firstDay = ((uint16_t)bufP[3] << 8) | bufP[4];
+        lastDay = ((uint16_t)bufP[5] << 8) | bufP[6];
+        if (firstDay <= lastDay)
+        {
+            found = storageMgr_startDailyLogBackfill(firstDay, lastDay, &resumeDay);
+            status = 1;
+        }
+    }
+
+    // Prepare OTA response.  It will be sent after this function exits.
+    prepareOtaResponse(bufP[0], bufP[1], bufP[2], NULL, 0);
+    *responseDataP++ = status;
+    *responseDataP++ = firstDay >> 8;
+    *responseDataP++ = firstDay & 0xFF;
+    *responseDataP++ = lastDay >> 8;
+    *responseDataP++ = lastDay & 0xFF;
+    *responseDataP++ = found;
+    *responseDataP++ = resumeDay >> 8;
+    *responseDataP++ = resumeDay & 0xFF;
+
+    return (true);
+}
+
 /**
 * \brief Process an unknown OTA message type
 * 
@@ -1649,6 +1740,9 @@ static void otaMsgMgr_processOtaMsg(void)
         case OTA_OPCODE_SENSOR_DATA:
             sendOtaResponse = otaMsgMgr_getSensorData(otaRespP);
             break;
+        case OTA_OPCODE_DAILY_LOG_BACKFILL:
+            sendOtaResponse = otaMsgMgr_processDailyLogBackfill(otaRespP);
+            break;
         case OTA_OPCODE_MEMORY_READ:
             // Fall through for now...
             sendOtaResponse = otaMsgMgr_processMemoryRead(otaRespP);
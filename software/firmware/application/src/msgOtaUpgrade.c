@@ -57,6 +57,79 @@
  *        section description begins with an 0xA5.
  */
 #define FLASH_UPGRADE_SECTION_START ((uint8_t)0xA5)
+/**
+ * \def FLASH_UPGRADE_DELTA_SECTION_START
+ * \brief Specify information about the upgrade message.  A 
+ *        delta section description begins with an 0xD5.  The
+ *        section is rebuilt from the running app and the delta
+ *        ops that follow the delta header.
+ */
+#define FLASH_UPGRADE_DELTA_SECTION_START ((uint8_t)0xD5)
+/**
+ * \def OTA_UPDATE_DELTA_HEADER_SIZE
+ * \brief Specify information about the upgrade message.  A
+ *        delta section header is followed by a delta header:
+ * \li crc16 of the running app section the delta was made
+ *     against (2 bytes, MSB first)
+ * \li length of the delta ops (2 bytes, MSB first)
+ */
+#define OTA_UPDATE_DELTA_HEADER_SIZE ((uint8_t)4)
+/**
+ * \def DELTA_OP_COPY
+ * \brief Delta op: copy length bytes of the running app 
+ *        section from an offset.  Followed by offset (2 bytes)
+ *        and length (2 bytes), MSB first.
+ */
+#define DELTA_OP_COPY ((uint8_t)0x01)
+/**
+ * \def DELTA_OP_INSERT
+ * \brief Delta op: insert length bytes that follow in the 
+ *        message.  Followed by length (2 bytes, MSB first) and
+ *        the data.
+ */
+#define DELTA_OP_INSERT ((uint8_t)0x02)
+/**
+ * \def DELTA_OP_FILL
+ * \brief Delta op: write length bytes of one value.  Followed 
+ *        by length (2 bytes, MSB first) and the value (1 byte).
+ */
+#define DELTA_OP_FILL ((uint8_t)0x03)
+/**
+ * \def DELTA_OP_MAX_HEADER_SIZE
+ * \brief Largest delta op header, the copy op.
+ */
+#define DELTA_OP_MAX_HEADER_SIZE ((uint8_t)5)
+/**
+ * \def DELTA_FILL_BUF_SIZE
+ * \brief Size of the RAM buffer a fill op is written from.
+ */
+#define DELTA_FILL_BUF_SIZE ((uint8_t)16)
+
+/**
+ * \def UPGRADE_SEGMENT_SIZE
+ * \brief Size of one flash erase segment of the backup image.
+ */
+#define UPGRADE_SEGMENT_SIZE ((uint16_t)0x200)
+
+/**
+ * \def UPGRADE_PROGRESS_MAGIC
+ * \brief Known pattern written last to mark the progress 
+ *        record header as complete.
+ */
+#define UPGRADE_PROGRESS_MAGIC ((uint16_t)0x5550)
+
+/**
+ * \def UPGRADE_TOTAL_CHECKPOINTS
+ * \brief Number of checkpoints that fit in the progress record 
+ *        segment after the header.
+ */
+#define UPGRADE_TOTAL_CHECKPOINTS ((uint8_t)((UPGRADE_SEGMENT_SIZE - (4 * sizeof(uint16_t))) / sizeof(upgradeCheckpoint_t)))
+
+/**
+ * \def UPGRADE_NO_CHECKPOINT
+ * \brief Value of an erased checkpoint.
+ */
+#define UPGRADE_NO_CHECKPOINT ((uint16_t)0xFFFF)
 
 /**
  * \typedef modemBatchCmdType_t
@@ -87,8 +160,10 @@ typedef enum otaUpState_e {
  */
 typedef enum otaFlashState_e {
     OTA_FLASH_STATE_GET_SECTION_INFO,
+    OTA_FLASH_STATE_GET_DELTA_INFO,
     OTA_FLASH_STATE_ERASE_SECTION_DATA,
     OTA_FLASH_STATE_WRITE_SECTION_DATA,
+    OTA_FLASH_STATE_WRITE_DELTA_DATA,
     OTA_FLASH_STATE_VERIFY_SECTION_DATA,
 } otaFlashState_t;
 
@@ -104,6 +179,8 @@ typedef enum fwUpgradeErrorCode_e {
     FW_UP_ERR_PARAMETER = -3,
     FW_UP_ERR_CRC = -4,
     FW_UP_ERR_TIMEOUT = -5,
+    FW_UP_ERR_FLASH_WRITE = -6,
+    FW_UP_ERR_DELTA_BASE = -7,
 } fwUpdateErrNum_t;
 
 /**
@@ -127,13 +204,58 @@ typedef struct otaUpData_s {
     fwUpdateErrNum_t fwUpdateErrNum;                       /**< If upgrade failure, identify what step it failed at */
     uint8_t modemRetryCount;                               /**< If modem error, how many retries we have performed */
     bool exitModemProcessing;                              /**< Flag to indicate we need to exit state machine processing */
+    uint16_t runningCrc16;                                 /**< CRC16 of the section data written so far */
+    uint8_t *chunkWriteAddrP;                              /**< Where the chunk in the OTA buffer is being written */
+    uint16_t chunkWriteLength;                             /**< Length of the chunk being written, 0 if none */
     uint16_t lastCalcCrc16;                                /**< Save last calculated CRC16 value */
+    bool delta;                                            /**< Section is rebuilt from the running app and delta ops */
+    uint16_t deltaRemaining;                               /**< Count in bytes of delta ops remaining to retrieve from modem */
+    uint8_t deltaOp[DELTA_OP_MAX_HEADER_SIZE];             /**< Header of the delta op being decoded */
+    uint8_t deltaOpCount;                                  /**< Bytes of the delta op header received */
+    uint16_t deltaInsertRemaining;                         /**< Bytes of the insert op data still to come */
 } otaUpData_t;
 
+/**
+ * \typedef upgradeCheckpoint_t
+ * \brief One checkpoint of the download progress.  Written to
+ *        flash once the data up to a segment boundary is
+ *        written and checked.
+ */
+typedef struct upgradeCheckpoint_s {
+    uint16_t bytesCommitted;                               /**< Section bytes written and checked */
+    uint16_t runningCrc16;                                 /**< CRC16 of those bytes */
+} upgradeCheckpoint_t;
+
+/**
+ * \typedef upgradeProgress_t
+ * \brief Define the layout of the download progress record. 
+ *        The header identifies the image by its section info,
+ *        the magic is written after the other header fields.
+ *        Checkpoints are appended, the segment is erased when a
+ *        new image is started and when the download completes.
+ */
+typedef union upgradeProgress_u {
+    struct {
+        uint16_t magic;                                    /**< UPGRADE_PROGRESS_MAGIC */
+        uint16_t sectionStartAddr;                         /**< Section start address in the backup image */
+        uint16_t sectionDataLength;                        /**< Section length */
+        uint16_t sectionCrc16;                             /**< Section CRC16 from the upgrade message */
+        upgradeCheckpoint_t checkpoints[UPGRADE_TOTAL_CHECKPOINTS]; /**< Appended checkpoints, followed by erased flash */
+    } progress;
+    uint8_t bytes[UPGRADE_SEGMENT_SIZE];                   // force to one flash segment
+} upgradeProgress_t;
+
 /****************************
  * Module Data Declarations
  ***************************/
 
+/*
+ *  This is the download progress record in flash.  It lets an upgrade that
+ *  failed part way continue from the last checkpoint instead of starting over.
+ */
+#pragma DATA_SECTION(upgradeProgress, ".upgradeProgress")
+const upgradeProgress_t upgradeProgress;
+
 /**
 * \var otaUpData
 * \brief Declare a data object to "house" data for this module.
@@ -146,9 +268,17 @@ otaUpData_t otaUpData;
 static void otaUpgrade_modemStateMachine(void);
 static void otaUpgrade_flashStateMachine(void);
 static bool otaUpgrade_processSectionInfo(void);
+static bool otaUpgrade_processDeltaInfo(void);
 static bool otaUpgrade_eraseSection(void);
 static bool otaUpgrade_writeSectionData(void);
+static bool otaUpgrade_writeDeltaData(void);
+static bool otaUpgrade_runDeltaOp(void);
+static bool otaUpgrade_writeDeltaBytes(const uint8_t *srcP, uint16_t len);
 static bool otaUpgrade_verifySection(void);
+static bool otaUpgrade_checkChunkWritten(void);
+static void otaUpgrade_resumeProgress(void);
+static void otaUpgrade_saveProgress(void);
+static void otaUpgrade_clearProgress(void);
 
 /***************************
  * Module Public Functions
@@ -162,10 +292,20 @@ static bool otaUpgrade_verifySection(void);
 *        to move the firmware from the second image location
 *        into the main location.  The steps include:
 *
-* \li Retrieve and check firmware upgrade message header
+* \li Retrieve and check firmware upgrade message header.  For
+*     a delta section, check that the running app is the one
+*     the delta was made against
+* \li If an earlier download of the same image was checkpointed,
+*     continue from the last checkpoint
 * \li Erase flash 
-* \li Retrieve data from the modem in chunks and burn into flash
-* \li Verify flash against CRC16 received in message
+* \li Retrieve data from the modem in chunks and burn into flash.
+*     Each chunk is read back from flash and added to the
+*     section CRC16 as it is written.  The next chunk is
+*     requested from the modem while a chunk is written.
+* \li For a delta section, rebuild the section from the running
+*     app and the delta ops retrieved from the modem
+* \li Verify the section CRC16 against the CRC16 received in
+*     the message
 *
 * \note This function will run the otaUpgrade state machine
 *  until the firmware is completely collected from the modem.
@@ -215,6 +355,18 @@ fwUpdateResult_t otaUpgrade_processOtaUpgradeMessage(void)
         otaUpgrade_modemStateMachine();
         WATCHDOG_TICKLE();
 
+        // Erase the next flash segment or write the next bytes of the
+        // chunk in progress.
+        msp430Flash_poll();
+
+        // Once the chunk is written, check it and release the OTA buffer
+        // for the next chunk.
+        if (!otaUpgrade_checkChunkWritten())
+        {
+            modemMgr_stopModemCmdBatch();
+            otaUpData.otaUpState = OTA_UP_STATE_DONE;
+        }
+
         // Run other lower-level state machines in the system needed to retrieve
         // data from the modem.
         modemCmd_exec();
@@ -235,6 +387,14 @@ fwUpdateResult_t otaUpgrade_processOtaUpgradeMessage(void)
         }
     }
 
+    // Finish any flash operation still in progress and give the OTA
+    // buffer back to the modem manager.
+    while (msp430Flash_poll())
+    {
+        WATCHDOG_TICKLE();
+    }
+    modemMgr_releaseOtaResponse();
+
     return (otaUpData.fwUpdateResult);
 }
 
@@ -278,7 +438,7 @@ uint16_t otaUpgrade_getFwMessageCrc(void)
 */
 uint16_t otaUpgrade_getFwCalculatedCrc(void)
 {
-    return (otaUpData.sectionCrc16);
+    return (otaUpData.lastCalcCrc16);
 }
 
 /**
@@ -428,12 +588,18 @@ static void otaUpgrade_flashStateMachine(void)
             case OTA_FLASH_STATE_GET_SECTION_INFO:
                 continue_processing = otaUpgrade_processSectionInfo();
                 break;
+            case OTA_FLASH_STATE_GET_DELTA_INFO:
+                continue_processing = otaUpgrade_processDeltaInfo();
+                break;
             case OTA_FLASH_STATE_ERASE_SECTION_DATA:
                 continue_processing = otaUpgrade_eraseSection();
                 break;
             case OTA_FLASH_STATE_WRITE_SECTION_DATA:
                 continue_processing = otaUpgrade_writeSectionData();
                 break;
+            case OTA_FLASH_STATE_WRITE_DELTA_DATA:
+                continue_processing = otaUpgrade_writeDeltaData();
+                break;
             case OTA_FLASH_STATE_VERIFY_SECTION_DATA:
                 continue_processing = otaUpgrade_verifySection();
                 break;
@@ -462,8 +628,10 @@ static bool otaUpgrade_processSectionInfo(void)
     uint8_t sectionNumber = *bufP++;
 
     // Check start section byte and section number in message
-    if ((sectionStartId == FLASH_UPGRADE_SECTION_START) && (sectionNumber == 0))
+    if (((sectionStartId == FLASH_UPGRADE_SECTION_START) ||
+         (sectionStartId == FLASH_UPGRADE_DELTA_SECTION_START)) && (sectionNumber == 0))
     {
+        otaUpData.delta = (sectionStartId == FLASH_UPGRADE_DELTA_SECTION_START);
         // Retrieve Start Address from section info in message
         otaUpData.sectionStartAddrP = (*bufP++ << 8);
         otaUpData.sectionStartAddrP |= *bufP++;
@@ -480,27 +648,41 @@ static bool otaUpgrade_processSectionInfo(void)
         // Retrieve CRC from section info in message
         otaUpData.sectionCrc16 = (*bufP++ << 8);
         otaUpData.sectionCrc16 |= *bufP++;
+        otaUpData.runningCrc16 = crc16_init();
 
         // Verify the section parameters
-        // 1. Check that the modem message has enough data to fill the section.
+        // 1. Check that the modem message has enough data to fill the section,
+        //    or for a delta section, at least the delta header.
         // 2. Check that the section start and end address is located in app flash area
         // Otherwise we consider this a catastrophic error.
 
         uint16_t startBurnAddr = otaUpData.sectionStartAddrP;
         uint16_t endBurnAddr = otaUpData.sectionStartAddrP + otaUpData.sectionDataLength - 1;
+        uint16_t minRemaining = otaUpData.delta ? OTA_UPDATE_DELTA_HEADER_SIZE : otaUpData.sectionDataLength;
 
-        if ((otaRespP->remainingInBytes >= otaUpData.sectionDataLength) &&
+        if ((otaRespP->remainingInBytes >= minRemaining) &&
             (otaUpData.sectionDataLength <= backupImageFlashLength) &&
             (startBurnAddr >= backupImageStartAddr) &&
             (startBurnAddr < backupImageEndAddr) &&
             (endBurnAddr > backupImageStartAddr) &&
             (endBurnAddr <= backupImageEndAddr))
         {
-            // Setup state for the erase flash sequence.
-            otaUpData.otaFlashState = OTA_FLASH_STATE_ERASE_SECTION_DATA;
-            // Don't exit flash state machine.  Move to next state immediately to
-            // erase data.
-            continue_processing = true;
+            if (otaUpData.delta)
+            {
+                // Retrieve the delta header next.
+                otaUpData.modemRequestLength = OTA_UPDATE_DELTA_HEADER_SIZE;
+                otaUpData.otaFlashState = OTA_FLASH_STATE_GET_DELTA_INFO;
+            }
+            else
+            {
+                // Skip the data already written by an earlier download of this image.
+                otaUpgrade_resumeProgress();
+                // Setup state for the erase flash sequence.
+                otaUpData.otaFlashState = OTA_FLASH_STATE_ERASE_SECTION_DATA;
+                // Don't exit flash state machine.  Move to next state immediately to
+                // erase data.
+                continue_processing = true;
+            }
         }
         else
         {
@@ -522,47 +704,103 @@ static bool otaUpgrade_processSectionInfo(void)
 }
 
 /**
-* \brief Firmware Upgrade Flash State Machine Function
+* \brief Firmware Upgrade Flash State Machine Function.  Check 
+*        the delta header.  The running app section must have
+*        the CRC16 of the app the delta was made against.  A delta
+*        is not resumed, so once it is accepted the progress of an
+*        earlier full download is cleared before the backup image
+*        is erased for the delta.
+*/
+static bool otaUpgrade_processDeltaInfo(void)
+{
+    bool continue_processing = false;
+    otaResponse_t *otaRespP = modemMgr_getLastOtaResponse();
+    uint8_t *bufP = &otaRespP->buf[0];
+    uint8_t *appSectionP = (uint8_t *)(otaUpData.sectionStartAddrP + (getAppImageStartAddr() - getBackupImageStartAddr()));
+    uint16_t baseCrc16;
+
+    baseCrc16 = (bufP[0] << 8) | bufP[1];
+    otaUpData.deltaRemaining = (bufP[2] << 8) | bufP[3];
+    otaUpData.deltaOpCount = 0;
+    otaUpData.deltaInsertRemaining = 0;
+
+    if ((otaRespP->lengthInBytes < OTA_UPDATE_DELTA_HEADER_SIZE) ||
+        (otaUpData.deltaRemaining == 0) ||
+        (otaRespP->remainingInBytes < otaUpData.deltaRemaining))
+    {
+        otaUpData.fwUpdateResult = RESULT_DONE_ERROR;
+        otaUpData.fwUpdateErrNum = FW_UP_ERR_PARAMETER;
+        otaUpData.exitModemProcessing = true;
+    }
+    else if (crc16_final(crc16_update(crc16_init(), appSectionP, otaUpData.sectionDataLength)) != baseCrc16)
+    {
+        otaUpData.fwUpdateResult = RESULT_DONE_ERROR;
+        otaUpData.fwUpdateErrNum = FW_UP_ERR_DELTA_BASE;
+        otaUpData.exitModemProcessing = true;
+    }
+    else
+    {
+        // The backup image no longer holds the data of any checkpoint.
+        otaUpgrade_clearProgress();
+        // Setup state for the erase flash sequence.
+        otaUpData.otaFlashState = OTA_FLASH_STATE_ERASE_SECTION_DATA;
+        continue_processing = true;
+    }
+    return (continue_processing);
+}
+
+/**
+* \brief Firmware Upgrade Flash State Machine Function.  Erase 
+*        from the section write address, which is the start of
+*        the section or the checkpoint the download continues
+*        from.
 */
 static bool otaUpgrade_eraseSection(void)
 {
 
     uint8_t i;
     uint16_t numSectors = getNumSectorsInImage();
-    uint8_t *flashSegmentAddrP = (uint8_t *)otaUpData.sectionStartAddrP;
+    uint16_t numToErase = 0;
+    uint8_t *flashSegmentAddrP = otaUpData.sectionWriteAddrP;
     uint8_t *backupImageEndAddrP = (uint8_t *)getBackupImageEndAddr();
 
     // Update the APP record with new firmware info. If there was good firmware
     // in there, it's getting erased now.
     appRecord_updateFwInfo(false, 0);
 
-    // Erase the flash segments
+    // Count the flash segments that fall below the bootloader flash area
     for (i = 0; i < numSectors; i++, flashSegmentAddrP += 0x200)
     {
-        // Check that the address falls below the bootloader flash area
         if (flashSegmentAddrP < backupImageEndAddrP)
         {
-            // Tickle the watchdog before erasing
-            WATCHDOG_TICKLE();
-            msp430Flash_erase_segment(flashSegmentAddrP);
+            numToErase++;
         }
     }
 
+    // Start erasing the flash segments.  The erase runs one segment
+    // at a time from the upgrade loop while the modem data is being
+    // requested.  The first write to flash waits for it to complete.
+    msp430Flash_submitErase(otaUpData.sectionWriteAddrP, numToErase);
+
     // Set up for starting the write data to flash.
     // Initialize request size from modem.
     // The maximum data we can request from the modem at one time is
     // OTA_PAYLOAD_MAX_RX_READ_LENGTH
-    if (otaUpData.sectionDataRemaining > OTA_PAYLOAD_MAX_RX_READ_LENGTH)
+    if (otaUpData.delta)
     {
-        otaUpData.modemRequestLength = OTA_PAYLOAD_MAX_RX_READ_LENGTH;
+        otaUpData.modemRequestLength = otaUpData.deltaRemaining;
     }
     else
     {
         otaUpData.modemRequestLength = otaUpData.sectionDataRemaining;
     }
+    if (otaUpData.modemRequestLength > OTA_PAYLOAD_MAX_RX_READ_LENGTH)
+    {
+        otaUpData.modemRequestLength = OTA_PAYLOAD_MAX_RX_READ_LENGTH;
+    }
 
     // Setup state for the write to flash sequence.
-    otaUpData.otaFlashState = OTA_FLASH_STATE_WRITE_SECTION_DATA;
+    otaUpData.otaFlashState = otaUpData.delta ? OTA_FLASH_STATE_WRITE_DELTA_DATA : OTA_FLASH_STATE_WRITE_SECTION_DATA;
 
     // Exit the flash state machine upon return in order to
     // retrieve more more data from the modem.
@@ -570,7 +808,12 @@ static bool otaUpgrade_eraseSection(void)
 }
 
 /**
-* \brief Firmware Upgrade Flash State Machine Function
+* \brief Firmware Upgrade Flash State Machine Function.  Start
+*        writing the chunk of data in the OTA buffer to flash.
+*        The write runs from the upgrade loop while the next
+*        chunk is requested from the modem.  The modem manager
+*        holds the next chunk until this one is written and
+*        checked by otaUpgrade_checkChunkWritten.
 */
 static bool otaUpgrade_writeSectionData(void)
 {
@@ -598,15 +841,33 @@ static bool otaUpgrade_writeSectionData(void)
             writeDataSize = otaUpData.sectionDataRemaining;
         }
 
-        // Write the data to flash.
         // Check that we are not going to write into the bootloader flash area.
-        if ((otaUpData.sectionWriteAddrP + writeDataSize) <= (backupImageEndAddrP + 1))
+        if ((otaUpData.sectionWriteAddrP + writeDataSize) > (backupImageEndAddrP + 1))
+        {
+            otaUpData.fwUpdateResult = RESULT_DONE_ERROR;
+            otaUpData.fwUpdateErrNum = FW_UP_ERR_PARAMETER;
+            otaUpData.exitModemProcessing = true;
+            return (false);
+        }
+
+        // The first chunk can arrive before the section erase is done.
+        while (msp430Flash_poll())
         {
-            // Tickle the watchdog before erasing
             WATCHDOG_TICKLE();
-            msp430Flash_write_bytes(otaUpData.sectionWriteAddrP, &bufP[0], writeDataSize);
         }
 
+        // Start the write.  Use byte mode, a block write holds off
+        // interrupts for ~5ms which is several bytes at the modem
+        // UART rate.
+        msp430Flash_submitWrite(otaUpData.sectionWriteAddrP, &bufP[0], writeDataSize);
+        modemMgr_holdOtaResponse();
+        otaUpData.chunkWriteAddrP = otaUpData.sectionWriteAddrP;
+        otaUpData.chunkWriteLength = writeDataSize;
+
+        // The chunk is compared against flash when the write is done,
+        // so the CRC16 can be calculated from the buffer.
+        otaUpData.runningCrc16 = crc16_update(otaUpData.runningCrc16, &bufP[0], writeDataSize);
+
         // Update counters and flash pointer
         otaUpData.sectionDataRemaining -= writeDataSize;
         otaUpData.sectionWriteAddrP += writeDataSize;
@@ -648,23 +909,237 @@ static bool otaUpgrade_writeSectionData(void)
 }
 
 /**
-* \brief Firmware Upgrade Flash State Machine Function
+* \brief Firmware Upgrade Flash State Machine Function.  Decode
+*        the delta ops in the OTA buffer and write the data they
+*        produce to flash.  An op can span chunks, the op header
+*        and insert data remaining are kept between chunks.
 */
-static bool otaUpgrade_verifySection(void)
+static bool otaUpgrade_writeDeltaData(void)
 {
-    uint16_t calcCrc16 = gen_crc16((const unsigned char *)otaUpData.sectionStartAddrP, otaUpData.sectionDataLength);
+    bool continue_processing = false;
+    otaResponse_t *otaRespP = modemMgr_getLastOtaResponse();
+    uint8_t *bufP = &otaRespP->buf[0];
+    uint16_t len = otaRespP->lengthInBytes;
+    uint16_t insertLen;
+    bool ok = true;
 
-    otaUpData.lastCalcCrc16 = calcCrc16;
-    if (calcCrc16 == otaUpData.sectionCrc16)
+    if ((len == 0) || (len > otaUpData.deltaRemaining))
     {
-        otaUpData.fwUpdateResult = RESULT_DONE_SUCCESS;
+        otaUpData.fwUpdateResult = RESULT_DONE_ERROR;
+        otaUpData.fwUpdateErrNum = FW_UP_ERR_MODEM;
+        otaUpData.exitModemProcessing = true;
+        return (false);
     }
-    else
+    otaUpData.deltaRemaining -= len;
+
+    // The first chunk can arrive before the section erase is done.
+    while (msp430Flash_poll())
     {
-        // The CRC failed.
-        // Error condition.
+        WATCHDOG_TICKLE();
+    }
+
+    while (ok && (len > 0))
+    {
+        if (otaUpData.deltaInsertRemaining > 0)
+        {
+            // Data of an insert op
+            insertLen = (len < otaUpData.deltaInsertRemaining) ? len : otaUpData.deltaInsertRemaining;
+            ok = otaUpgrade_writeDeltaBytes(bufP, insertLen);
+            otaUpData.deltaInsertRemaining -= insertLen;
+            bufP += insertLen;
+            len -= insertLen;
+        }
+        else
+        {
+            // Header of the next op
+            otaUpData.deltaOp[otaUpData.deltaOpCount++] = *bufP++;
+            len--;
+            ok = otaUpgrade_runDeltaOp();
+        }
+    }
+
+    // If an op failed, the error flags are already set.
+    if (ok)
+    {
+        if (otaUpData.sectionDataRemaining == 0)
+        {
+            // Setup state for the verify flash sequence.
+            otaUpData.otaFlashState = OTA_FLASH_STATE_VERIFY_SECTION_DATA;
+            continue_processing = true;
+        }
+        else if (otaUpData.deltaRemaining == 0)
+        {
+            // The ops did not produce the whole section.
+            otaUpData.fwUpdateResult = RESULT_DONE_ERROR;
+            otaUpData.fwUpdateErrNum = FW_UP_ERR_PARAMETER;
+            otaUpData.exitModemProcessing = true;
+        }
+        else if (otaUpData.deltaRemaining > OTA_PAYLOAD_MAX_RX_READ_LENGTH)
+        {
+            // We need more data.
+            otaUpData.modemRequestLength = OTA_PAYLOAD_MAX_RX_READ_LENGTH;
+        }
+        else
+        {
+            otaUpData.modemRequestLength = otaUpData.deltaRemaining;
+        }
+    }
+    return (continue_processing);
+}
+
+/**
+* \brief Run the delta op in deltaOp once its header is 
+*        complete.  A copy or fill op is written right away, an
+*        insert op sets up for its data.  An op is checked before
+*        any of its bytes are written: a copy must lie within the
+*        running app section, and an insert or fill must fit in
+*        the section bytes that are left.
+*
+* @return bool false if the op is not valid or could not be
+*         written
+*/
+static bool otaUpgrade_runDeltaOp(void)
+{
+    uint8_t *appSectionP = (uint8_t *)(otaUpData.sectionStartAddrP + (getAppImageStartAddr() - getBackupImageStartAddr()));
+    uint8_t fillBuf[DELTA_FILL_BUF_SIZE];
+    uint8_t *opP = &otaUpData.deltaOp[0];
+    uint16_t opLen = (opP[1] << 8) | opP[2];
+    uint16_t offset;
+    uint16_t fillLen;
+    bool ok = true;
+
+    switch (opP[0])
+    {
+        case DELTA_OP_COPY:
+            if (otaUpData.deltaOpCount < 5)
+            {
+                return (true);
+            }
+            offset = opLen;
+            opLen = (opP[3] << 8) | opP[4];
+            if ((offset >= otaUpData.sectionDataLength) || (opLen > (otaUpData.sectionDataLength - offset)))
+            {
+                ok = false;
+            }
+            else
+            {
+                ok = otaUpgrade_writeDeltaBytes(&appSectionP[offset], opLen);
+            }
+            break;
+        case DELTA_OP_INSERT:
+            if (otaUpData.deltaOpCount < 3)
+            {
+                return (true);
+            }
+            if (opLen > otaUpData.sectionDataRemaining)
+            {
+                ok = false;
+            }
+            else
+            {
+                otaUpData.deltaInsertRemaining = opLen;
+            }
+            break;
+        case DELTA_OP_FILL:
+            if (otaUpData.deltaOpCount < 4)
+            {
+                return (true);
+            }
+            if (opLen > otaUpData.sectionDataRemaining)
+            {
+                ok = false;
+                break;
+            }
+            memset(fillBuf, opP[3], DELTA_FILL_BUF_SIZE);
+            while (ok && (opLen > 0))
+            {
+                fillLen = (opLen < DELTA_FILL_BUF_SIZE) ? opLen : DELTA_FILL_BUF_SIZE;
+                ok = otaUpgrade_writeDeltaBytes(fillBuf, fillLen);
+                opLen -= fillLen;
+            }
+            break;
+        default:
+            ok = false;
+            break;
+    }
+
+    if (!ok && (otaUpData.fwUpdateErrNum == FW_UP_ERR_NONE))
+    {
+        // Not a valid op
         otaUpData.fwUpdateResult = RESULT_DONE_ERROR;
-        otaUpData.fwUpdateErrNum = FW_UP_ERR_CRC;
+        otaUpData.fwUpdateErrNum = FW_UP_ERR_PARAMETER;
+        otaUpData.exitModemProcessing = true;
+    }
+    otaUpData.deltaOpCount = 0;
+    return (ok);
+}
+
+/**
+* \brief Write data produced by a delta op to the next bytes of 
+*        the section, compare flash against it and add it to
+*        the section CRC16.  The data can be in the running app,
+*        so it is written in byte mode.
+*
+* @param srcP data to write, in RAM or in the running app
+* @param len number of bytes
+*
+* @return bool false if the data does not fit in the section or
+*         did not write correctly
+*/
+static bool otaUpgrade_writeDeltaBytes(const uint8_t *srcP, uint16_t len)
+{
+    if (len > otaUpData.sectionDataRemaining)
+    {
+        otaUpData.fwUpdateResult = RESULT_DONE_ERROR;
+        otaUpData.fwUpdateErrNum = FW_UP_ERR_PARAMETER;
+        otaUpData.exitModemProcessing = true;
+        return (false);
+    }
+
+    msp430Flash_write_bytes(otaUpData.sectionWriteAddrP, (uint8_t *)srcP, len);
+    if (memcmp(otaUpData.sectionWriteAddrP, srcP, len) != 0)
+    {
+        otaUpData.fwUpdateResult = RESULT_DONE_ERROR;
+        otaUpData.fwUpdateErrNum = FW_UP_ERR_FLASH_WRITE;
+        otaUpData.exitModemProcessing = true;
+        return (false);
+    }
+    otaUpData.runningCrc16 = crc16_update(otaUpData.runningCrc16, srcP, len);
+
+    otaUpData.sectionDataRemaining -= len;
+    otaUpData.sectionWriteAddrP += len;
+    return (true);
+}
+
+/**
+* \brief Firmware Upgrade Flash State Machine Function.  The
+*        section CRC16 was calculated as the data was written.
+*/
+static bool otaUpgrade_verifySection(void)
+{
+    uint16_t calcCrc16 = crc16_final(otaUpData.runningCrc16);
+
+    // Finish writing the last chunk and check it.
+    while (msp430Flash_poll())
+    {
+        WATCHDOG_TICKLE();
+    }
+    if (otaUpgrade_checkChunkWritten())
+    {
+        // The download is complete, the next upgrade starts over.
+        otaUpgrade_clearProgress();
+        otaUpData.lastCalcCrc16 = calcCrc16;
+        if (calcCrc16 == otaUpData.sectionCrc16)
+        {
+            otaUpData.fwUpdateResult = RESULT_DONE_SUCCESS;
+        }
+        else
+        {
+            // The CRC failed.
+            // Error condition.
+            otaUpData.fwUpdateResult = RESULT_DONE_ERROR;
+            otaUpData.fwUpdateErrNum = FW_UP_ERR_CRC;
+        }
     }
     otaUpData.exitModemProcessing = true;
 
@@ -672,3 +1147,139 @@ static bool otaUpgrade_verifySection(void)
     return (false);
 }
 
+/**
+* \brief Once the flash write of the chunk in the OTA buffer is
+*        done, compare flash against the buffer and release the
+*        buffer for the next chunk.  What is in flash must match
+*        the data the CRC16 was calculated on.
+*
+* @return bool false if the chunk did not write correctly
+*/
+static bool otaUpgrade_checkChunkWritten(void)
+{
+    otaResponse_t *otaRespP;
+
+    if ((otaUpData.chunkWriteLength == 0) || msp430Flash_isBusy())
+    {
+        return (true);
+    }
+
+    otaRespP = modemMgr_getLastOtaResponse();
+    if (memcmp(otaUpData.chunkWriteAddrP, &otaRespP->buf[0], otaUpData.chunkWriteLength) != 0)
+    {
+        otaUpData.chunkWriteLength = 0;
+        otaUpData.fwUpdateResult = RESULT_DONE_ERROR;
+        otaUpData.fwUpdateErrNum = FW_UP_ERR_FLASH_WRITE;
+        otaUpData.exitModemProcessing = true;
+        return (false);
+    }
+
+    otaUpData.chunkWriteLength = 0;
+    otaUpgrade_saveProgress();
+    modemMgr_releaseOtaResponse();
+    return (true);
+}
+
+/**
+* \brief Look for download progress of the image in the section 
+*        info.  The checkpoints are checked in order against the
+*        data in the backup image.  If one matches, setup to
+*        continue the download after the last one that matches.
+*        Otherwise start a new progress record for the image.
+*/
+static void otaUpgrade_resumeProgress(void)
+{
+    const upgradeCheckpoint_t *cpP = &upgradeProgress.progress.checkpoints[0];
+    uint8_t *sectionP = (uint8_t *)otaUpData.sectionStartAddrP;
+    uint16_t bytesCommitted = 0;
+    uint16_t resumeCrc16 = crc16_init();
+    uint16_t crc16 = resumeCrc16;
+    uint16_t header[3];
+    uint16_t magic = UPGRADE_PROGRESS_MAGIC;
+    uint8_t i;
+
+    if ((upgradeProgress.progress.magic == UPGRADE_PROGRESS_MAGIC) &&
+        (upgradeProgress.progress.sectionStartAddr == otaUpData.sectionStartAddrP) &&
+        (upgradeProgress.progress.sectionDataLength == otaUpData.sectionDataLength) &&
+        (upgradeProgress.progress.sectionCrc16 == otaUpData.sectionCrc16))
+    {
+        for (i = 0; i < UPGRADE_TOTAL_CHECKPOINTS; i++, cpP++)
+        {
+            // Stop at the erased flash or a checkpoint that does not
+            // follow the last one.
+            if ((cpP->bytesCommitted <= bytesCommitted) ||
+                (cpP->bytesCommitted >= otaUpData.sectionDataLength))
+            {
+                break;
+            }
+            crc16 = crc16_update(crc16, &sectionP[bytesCommitted], cpP->bytesCommitted - bytesCommitted);
+            if (crc16 != cpP->runningCrc16)
+            {
+                break;
+            }
+            bytesCommitted = cpP->bytesCommitted;
+            resumeCrc16 = crc16;
+        }
+    }
+
+    if (bytesCommitted > 0)
+    {
+        otaUpData.runningCrc16 = resumeCrc16;
+        otaUpData.sectionWriteAddrP += bytesCommitted;
+        otaUpData.sectionDataRemaining -= bytesCommitted;
+        otaUpData.modemRequestOffset += bytesCommitted;
+    }
+    else
+    {
+        // Start a new progress record.  The magic is written last.
+        header[0] = otaUpData.sectionStartAddrP;
+        header[1] = otaUpData.sectionDataLength;
+        header[2] = otaUpData.sectionCrc16;
+        msp430Flash_erase_segment((uint8_t *)&upgradeProgress);
+        msp430Flash_write_bytes((uint8_t *)&upgradeProgress.progress.sectionStartAddr, (uint8_t *)&header[0], sizeof(header));
+        msp430Flash_write_bytes((uint8_t *)&upgradeProgress.progress.magic, (uint8_t *)&magic, sizeof(uint16_t));
+    }
+}
+
+/**
+* \brief Append a checkpoint for the data written so far.  Only 
+*        done at a segment boundary, a download that continues
+*        from a checkpoint erases from there to the end of the
+*        image.
+*/
+static void otaUpgrade_saveProgress(void)
+{
+    const upgradeCheckpoint_t *cpP = &upgradeProgress.progress.checkpoints[0];
+    upgradeCheckpoint_t checkpoint;
+    uint8_t i;
+
+    if ((otaUpData.sectionDataRemaining == 0) ||
+        (((uint16_t)otaUpData.sectionWriteAddrP & (UPGRADE_SEGMENT_SIZE - 1)) != 0) ||
+        (upgradeProgress.progress.magic != UPGRADE_PROGRESS_MAGIC))
+    {
+        return;
+    }
+
+    checkpoint.bytesCommitted = otaUpData.sectionDataLength - otaUpData.sectionDataRemaining;
+    checkpoint.runningCrc16 = otaUpData.runningCrc16;
+
+    // Write to the first erased checkpoint.  If the record is full, the
+    // download continues from the last checkpoint in it.
+    for (i = 0; i < UPGRADE_TOTAL_CHECKPOINTS; i++, cpP++)
+    {
+        if (cpP->bytesCommitted == UPGRADE_NO_CHECKPOINT)
+        {
+            msp430Flash_write_bytes((uint8_t *)cpP, (uint8_t *)&checkpoint, sizeof(upgradeCheckpoint_t));
+            break;
+        }
+    }
+}
+
+/**
+* \brief Erase the download progress record.
+*/
+static void otaUpgrade_clearProgress(void)
+{
+    msp430Flash_erase_segment((uint8_t *)&upgradeProgress);
+}
+
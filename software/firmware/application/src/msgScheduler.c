@@ -9,6 +9,7 @@
  *        include:
  *        \li Activated message
  *        \li Daily Water Log message
+ *        \li Daily log backfill messages
  *        \li Monthly Check-In message
  *        \li GPS Location message.
  *
@@ -55,6 +56,7 @@
 typedef struct msgSchedData_s {
     bool msgScheduled;                                     /**< Flag to indicate there is at least one message scheduled */
     bool sendDailyWaterLogs;                               /**< Flag to indicate the daily water log message is scheduled */
+    bool sendDailyLogBackfill;                             /**< Flag to indicate the daily log backfill messages are scheduled */
     bool sendActivated;                                    /**< Flag to indicate the Activated message is scheduled */
     bool sendMonthlyCheckIn;                               /**< Flag to indicate the Monthly Check-In message is scheduled */
     bool sendGpsLocation;                                  /**< Flag to indicate the GPS Location message is scheduled */
@@ -171,14 +173,33 @@ void msgSched_getNextMessageToTransmit(modemCmdWriteData_t *cmdWriteP)
     else if (msgSchedData.sendDailyWaterLogs)
     {
         // Start the process of sending the daily logs.
-        // Send the oldest daily log that is ready.
+        // Send the oldest daily log that is ready, or a bundle of the
+        // oldest ready daily logs.
         payloadLength = storageMgr_getNextDailyLogToTransmit(&payloadP);
         payloadMsgId = MSG_TYPE_DAILY_LOG;
+        if (storageMgr_getDailyLogFormat() & DAILY_LOG_FORMAT_BUNDLED)
+        {
+            payloadMsgId = MSG_TYPE_DAILY_LOG_BUNDLE;
+        }
+        else if (storageMgr_getDailyLogFormat() & DAILY_LOG_FORMAT_COMPACT)
+        {
+            payloadMsgId = MSG_TYPE_DAILY_LOG_COMPACT;
+        }
         if (!payloadLength)
         {
             msgSchedData.sendDailyWaterLogs = false;
         }
     }
+    else if (msgSchedData.sendDailyLogBackfill)
+    {
+        // Send the next daily log of the backfill request
+        payloadLength = storageMgr_getNextBackfillDailyLog(&payloadP);
+        payloadMsgId = MSG_TYPE_DAILY_LOG;
+        if (!payloadLength)
+        {
+            msgSchedData.sendDailyLogBackfill = false;
+        }
+    }
     else if (msgSchedData.sendActivated)
     {
         // Retrieve the activated message payload
@@ -227,6 +248,16 @@ void msgSched_scheduleDailyWaterLogMessage(void)
     msgSchedData.sendDailyWaterLogs = true;
 }
 
+/**
+* \brief Schedule the daily logs of a backfill request to be
+*        sent when the Storage clock hour is set to 1:05 AM.
+*/
+void msgSched_scheduleDailyLogBackfillMessage(void)
+{
+    msgSchedData.msgScheduled = true;
+    msgSchedData.sendDailyLogBackfill = true;
+}
+
 /**
 * \brief Schedule the Activated message to be sent when the 
 *        Storage clock hour is set to 1:05 AM.
@@ -99,6 +99,15 @@
  */
 #define TIMER_INTERRUPTS_PER_SECOND 10
 
+/**
+ * \def DRY_WAKE_TIME_DEFAULT
+ * Number of consecutive trends with no water before the pads 
+ * are only probed at a low rate (150 trends = 5 minutes).  Can be 
+ * changed over the air with SENSOR_SET_WAKE_TIME, 0 disables 
+ * the low rate probe. 
+ */
+#define DRY_WAKE_TIME_DEFAULT ((uint16_t)150)
+
 /******************************************************************************/
 
 /**
@@ -374,6 +383,11 @@ void secDelay(uint8_t secCount);
 void ms1Delay(uint8_t msCount);
 void us10Delay(uint8_t us10);
 
+/*******************************************************************************
+*  Main
+*******************************************************************************/
+uint8_t getLastRebootReason(void);
+
 /*******************************************************************************
 * sysExec.c
 *******************************************************************************/
@@ -398,7 +412,7 @@ typedef struct sysExecData_s {
     uint32_t total_flow;                                   /**< Number of milliliters of water poured in current session */
     uint16_t downspout_rate;                               /**< Maximum downspout rate setting for tuning accuracy based on board thickness */
     uint16_t dry_count;                                    /**< Current number of consecutive trends with no water */
-    uint16_t dry_wake_time;                                /**< Number of consecutive trends with no water before sleeping - not used.*/
+    uint16_t dry_wake_time;                                /**< Number of consecutive trends with no water before only probing the pads (0 = never) */
     bool FAMsgWasSent : 1;                                 /**< Flag specifying if Final Assembly msg was sent */
     bool mCheckInMsgWasSent : 1;                           /**< Flag specifying if Monthly Check In msg was sent */
     bool appRecordWasSet: 1;                               /**< Flag specifying if App record was set */
@@ -469,6 +483,9 @@ typedef struct timeCompare_s {
     uint32_t timeDiffInSeconds;
 } timeCompare_t;
 
+uint16_t crc16_init(void);
+uint16_t crc16_update(uint16_t crc, const uint8_t *data, uint16_t size);
+uint16_t crc16_final(uint16_t crc);
 unsigned int gen_crc16(const unsigned char *data, unsigned int size);
 unsigned int gen_crc16_2buf(const unsigned char *data1, unsigned int size1, const unsigned char *data2, unsigned int size2);
 uint32_t timeInSeconds(uint8_t hours, uint8_t minutes, uint8_t seconds);
@@ -730,6 +747,7 @@ typedef struct mwBatchData_s {
     mwBatchState_t mwBatchState;                           /**< current batch job state */
     modemCmdWriteData_t *cmdWriteP;                        /**< A pointer to the command info object provided by user */
     otaResponse_t otaResponse;                             /**< payload of the last ota message received */
+    bool otaBufHeld;                                       /**< client still using otaBuf, hold the next partial response */
     uint8_t numOfOtaMsgsAvailable;                         /**< parsed from modem message status command */
     uint16_t sizeOfOtaMsgsAvailable;                       /**< parsed from modem message status command */
     bool shutdownActive;                                   /**< currently performing a modem shutdown */
@@ -751,9 +769,12 @@ bool modemMgr_isModemCmdError(void);
 void modemMgrRelease(void);
 void modemMgr_restartModem(void);
 bool modemMgr_isAllocated(void);
+bool modemMgr_isTransmitting(void);
 void modemMgr_release(void);
 bool modemMgr_isReleaseComplete(void);
 otaResponse_t* modemMgr_getLastOtaResponse(void);
+void modemMgr_holdOtaResponse(void);
+void modemMgr_releaseOtaResponse(void);
 bool modemMgr_isLinkUp(void);
 bool modemMgr_isLinkUpError(void);
 uint8_t modemMgr_getNumOtaMsgsPending(void);
@@ -915,7 +936,8 @@ typedef enum
 {
     MDR_Water_Record,
     MDR_GPS_Record,
-    MDR_Modem_Record
+    MDR_Modem_Record,
+    MDR_Gate_Record
 } MDR_type_e;
 
 #define MDR_NUMPADS 6
@@ -956,12 +978,25 @@ typedef struct __attribute__((__packed__))mdr_modem_s {
     uint8_t future_use;
 } MDRmodemRecord_t;
 
+/**
+ * \typedef MDRgateRecord_t
+ * \brief Cap-sense gate calibration (6 bytes).  Each pad is measured for
+ *        pad_sensors accumulationCycles >> padGateShift[pad].  0xFF means
+ *        the pads were not calibrated yet.
+ */
+typedef struct __attribute__((__packed__))mdr_gate_s {
+    uint8_t padGateShift[MDR_NUMPADS];                     /**< Gate shift of each pad */
+} MDRgateRecord_t;
+
 extern void manufRecord_manuf_test_result(void);
 extern bool waterDetect_restore_pads_baseline(MDRwaterRecord_t *wr);
 
 /**
  * \typedef manufRecord_t
- * \brief This structure is used to store the results of Manufacturing testing in the factory
+ * \brief This structure is used to store the results of Manufacturing testing in the factory.
+ *        It is the layout of the record older firmware kept in INFO D (64 bytes, the whole
+ *        segment).  The record is now kept as a log of section updates, see manufStore.c.
+ *        The gate calibration section only exists in the log.
  *
  */
 typedef struct __attribute__((__packed__))manufRecord_s {
@@ -974,15 +1009,37 @@ typedef struct __attribute__((__packed__))manufRecord_s {
 } manufRecord_t;
 
 uint16_t gps_getGpsMessage(uint8_t **payloadPP);
+void manufRecord_init(void);
 bool manufRecord_updateManufRecord(MDR_type_e mr_type, uint8_t *mr_in, uint8_t len_in);
 bool manufRecord_checkForValidManufRecord(void);
 bool manufRecord_initBootloaderRecord(void);
 bool manufRecord_send_test(void);
+bool manufRecord_getWaterInfo(MDRwaterRecord_t *wr);
+bool manufRecord_getGateInfo(MDRgateRecord_t *gt);
 
 /*******************************************************************************
 * storage.c
 *******************************************************************************/
 
+/**
+ * \typedef dailyLogFormat_t
+ * \brief Identify the message format used to send the daily
+ *        logs.  The bits can be combined.
+ */
+typedef enum dailyLogFormat_e {
+    DAILY_LOG_FORMAT_STANDARD = 0x00,                      /**< MSG_TYPE_DAILY_LOG, fixed 128 bytes */
+    DAILY_LOG_FORMAT_COMPACT = 0x01,                       /**< MSG_TYPE_DAILY_LOG_COMPACT, variable length */
+    DAILY_LOG_FORMAT_BUNDLED = 0x02,                       /**< Days sent together in a MSG_TYPE_DAILY_LOG_BUNDLE */
+    DAILY_LOG_FORMAT_QUARTER_HOUR = 0x04,                  /**< Days recorded in quarter hour bins, MSG_TYPE_DAILY_LOG_QUARTER_HOUR */
+} dailyLogFormat_t;
+
+/**
+ * \def DAILY_LOG_FORMAT_MASK
+ * \brief All the valid daily log format bits
+ */
+#define DAILY_LOG_FORMAT_MASK ((uint8_t)(DAILY_LOG_FORMAT_COMPACT | DAILY_LOG_FORMAT_BUNDLED | \
+                                         DAILY_LOG_FORMAT_QUARTER_HOUR))
+
 /**
  * \typedef storageData_t
  * \brief Define a container to hold data for the storage
@@ -1000,7 +1057,6 @@ typedef struct storageData_s {
     uint8_t storageTime_hours;                             /**< Current storage time - hour */
     uint8_t storageTime_dayOfWeek;                         /**< Current storage time - day */
     uint8_t storageTime_week;                              /**< Current storage time - week */
-    uint8_t curWeeklyLogNum;                               /**< Current weekly flash log number we are storing to */
 
     bool redFlagCondition;                                 /**< flag for red flag condition */
     uint8_t redFlagDayCount;                               /**< running count of red flag days */
@@ -1011,10 +1067,9 @@ typedef struct storageData_s {
     uint8_t transmissionRateInDays;                        /**< Specify how often to transmit data */
     int8_t daysSinceLastTransmission;                      /**< Track number of days since last transmission */
     bool sendData;                                         /**< True if ready to send water log data */
-    uint8_t startTxWeek;                                   /**< What week's log to start transmitting from */
-    uint8_t curTxWeek;                                     /**< What week's log we are currently transmitting */
     uint8_t totalDailyLogsTransmitted;                     /**< Counter of total daily logs transmitted in current tx session */
     bool haveSentDailyLogs;                                /**< Flag to indicate we have transmitted a daily log */
+    uint8_t dailyLogFormat;                                /**< Message format of the daily logs (dailyLogFormat_t) */
 
 } storageData_t;
 
@@ -1040,11 +1095,16 @@ void storageMgr_resetRedFlag(void);
 bool storageMgr_getRedFlagConditionStatus(void);
 void storageMgr_resetRedFlagAndMap(void);
 void storageMgr_resetWeeklyLogs(void);
+void storageMgr_saveCheckpoint(void);
 void storageMgr_syncStorageTime(uint8_t rtc_Second, uint8_t rtc_Minute, uint8_t rtc_Hour24);
 void storageMgr_setStorageTime(uint8_t rtcSecond, uint8_t rtcMinute, uint8_t rtcHour24);
 void storageMgr_adjustStorageTime(uint8_t hours24Offset);
 void storageMgr_setTransmissionRate(uint8_t transmissionRateInDays);
+bool storageMgr_setDailyLogFormat(uint8_t format);
+uint8_t storageMgr_getDailyLogFormat(void);
 uint16_t storageMgr_getNextDailyLogToTransmit(uint8_t **dataPP);
+uint8_t storageMgr_startDailyLogBackfill(uint16_t firstDay, uint16_t lastDay, uint16_t *resumeDayP);
+uint16_t storageMgr_getNextBackfillDailyLog(uint8_t **dataPP);
 uint8_t storageMgr_getStorageClockInfo(uint8_t *bufP);
 uint8_t storageMgr_getStorageClockHour(void);
 uint8_t storageMgr_getStorageClockMinute(void);
@@ -1078,6 +1138,7 @@ void waterSense_sendDebugDataToUart(void);
 * CTS_HAL.c
 *******************************************************************************/
 extern uint8_t CAPSENSE_ACTIVE;
+extern uint8_t CAPSENSE_LATE;
 
 /*******************************************************************************
 * hal.c
@@ -1096,6 +1157,10 @@ void hal_low_power_enter(void);
 /*******************************************************************************
 * flash.c
 *******************************************************************************/
+bool msp430Flash_submitErase(uint8_t *flashSegmentAddrP, uint16_t num_segments);
+bool msp430Flash_submitWrite(uint8_t *flashP, const uint8_t *srcP, uint16_t num_bytes);
+bool msp430Flash_poll(void);
+bool msp430Flash_isBusy(void);
 void msp430Flash_erase_segment(uint8_t *flashSectorAddrP);
 void msp430Flash_write_bytes(uint8_t *flashP, uint8_t *srcP, uint16_t num_bytes);
 void msp430Flash_write_int16(uint8_t *flashP, uint16_t val16);
@@ -1136,6 +1201,7 @@ void appRecord_test(void);
 void msgSched_init(void);
 void msgSched_exec(void);
 void msgSched_scheduleDailyWaterLogMessage(void);
+void msgSched_scheduleDailyLogBackfillMessage(void);
 void msgSched_scheduleActivatedMessage(void);
 void msgSched_scheduleMonthlyCheckInMessage(void);
 void msgSched_scheduleGpsLocationMessage(void);
@@ -37,17 +37,46 @@
  **************************/
 
 /**
- * \def TOTAL_WEEKLY_LOGS
- * \brief Specify the number of weekly logs in flash.
+ * \def TOTAL_LOG_SEGMENTS
+ * \brief Specify the number of flash segments in the daily log
+ *        region.
  */
-#define TOTAL_WEEKLY_LOGS ((uint8_t)5)
+#define TOTAL_LOG_SEGMENTS ((uint8_t)10)
 
 /**
- * \def WEEKLY_LOG_SIZE
- * \brief Specify the total size of a weekly block allocated in 
- *        flash.
+ * \def RECORDS_PER_LOG_SEGMENT
+ * \brief Specify the number of daily log records that fit in
+ *        one flash segment after the segment header.  A record
+ *        is sized to hold a day of quarter hour bins.
  */
-#define WEEKLY_LOG_SIZE ((uint16_t)0x400)
+#define RECORDS_PER_LOG_SEGMENT ((uint8_t)4)
+
+/**
+ * \def TOTAL_LOG_RECORDS
+ * \brief Specify the number of daily logs the region can hold.
+ */
+#define TOTAL_LOG_RECORDS ((uint8_t)(TOTAL_LOG_SEGMENTS * RECORDS_PER_LOG_SEGMENT))
+
+/**
+ * \def LOG_SEGMENT_SIGNATURE
+ * \brief Written in the segment header when the segment is 
+ *        opened.  Segments without it are not part of the log.
+ *        Change when the log record layout changes.
+ */
+#define LOG_SEGMENT_SIGNATURE ((uint16_t)0x4C48)
+
+/**
+ * \def LOG_SEQUENCE_ERASED
+ * \brief Value of an erased segment sequence number.  Never
+ *        assigned to an open segment.
+ */
+#define LOG_SEQUENCE_ERASED ((uint16_t)0xFFFF)
+
+/**
+ * \def NO_LOG_SEGMENT
+ * \brief Head segment value when no segment has been opened.
+ */
+#define NO_LOG_SEGMENT ((uint8_t)0xFF)
 
 /**
  * \def TOTAL_DAYS_IN_A_WEEK
@@ -61,6 +90,18 @@
  */
 #define TOTAL_HOURS_IN_A_DAY ((uint8_t)24)
 
+/**
+ * \def QUARTERS_IN_A_HOUR
+ * \brief For clarity in the code
+ */
+#define QUARTERS_IN_A_HOUR ((uint8_t)4)
+
+/**
+ * \def MINUTES_IN_A_QUARTER_HOUR
+ * \brief For clarity in the code
+ */
+#define MINUTES_IN_A_QUARTER_HOUR ((uint8_t)15)
+
 /**
  * \def TOTAL_MINUTES_IN_A_HOUR
  * \brief For clarity in the code
@@ -106,6 +147,35 @@
  */
 #define FLASH_BLOCK_SIZE ((uint16_t)512)
 
+/**
+ * \def STORAGE_CHECKPOINT_MAGIC
+ * \brief Used as a known pattern to perform a "quick" verify 
+ *        that a checkpoint slot holds a checkpoint.
+ */
+#define STORAGE_CHECKPOINT_MAGIC ((uint16_t)0x5354)
+
+/**
+ * \def STORAGE_CHECKPOINT_VERSION
+ * \brief Change when the meaning of the checkpoint contents 
+ *        changes.  A checkpoint with another version or length
+ *        is not restored.
+ */
+#define STORAGE_CHECKPOINT_VERSION ((uint16_t)1)
+
+/**
+ * \def TOTAL_CHECKPOINT_SLOTS
+ * \brief Specify the number of checkpoint slots in flash.  The
+ *        slots are written in turn, so the last checkpoint stays
+ *        valid while the next one is written.
+ */
+#define TOTAL_CHECKPOINT_SLOTS ((uint8_t)2)
+
+/**
+ * \def NO_CHECKPOINT_SLOT
+ * \brief Returned when no slot holds a valid checkpoint.
+ */
+#define NO_CHECKPOINT_SLOT ((uint8_t)0xFF)
+
 /**
  * \def DO_RED_FLAG_PROCESSSING
  * \brief If set to non-zero value, then the red flag processing 
@@ -153,6 +223,70 @@
  */
 #define DAYS_PER_MONTH      ((uint8_t)28)
 
+/**
+ * \def TOTAL_PAD_COUNTS
+ * \brief Number of pad submerged counts in the daily log
+ */
+#define TOTAL_PAD_COUNTS ((uint8_t)6)
+
+/**
+ * \def COMPACT_FLAG_RED_FLAG
+ * \brief Compact daily log flags bit, set if the red flag
+ *        condition was set at the end of the day.
+ */
+#define COMPACT_FLAG_RED_FLAG ((uint8_t)0x01)
+
+/**
+ * \def QUARTER_HOUR_BINS_LENGTH
+ * \brief Bytes of coded quarter hour bins a log record holds.
+ *        Sized so the quarter hour log fills the log record and
+ *        fits in the daily packet data.
+ */
+#define QUARTER_HOUR_BINS_LENGTH ((uint8_t)99)
+
+/**
+ * \def QUARTER_HOUR_TOKEN_MAX_LENGTH
+ * \brief Longest quarter hour bin token, a 16 bit zigzag
+ *        difference shifted left one is 18 bits.
+ */
+#define QUARTER_HOUR_TOKEN_MAX_LENGTH ((uint8_t)3)
+
+/**
+ * \def QUARTER_HOUR_RUN_MAX_LENGTH
+ * \brief Longest zero run token, a run of up to 96 bins.
+ */
+#define QUARTER_HOUR_RUN_MAX_LENGTH ((uint8_t)2)
+
+/**
+ * \def QUARTER_HOUR_TOKEN_HOURLY
+ * \brief Token (a zero run of zero bins) that switches the rest
+ *        of the day to hourly bins.
+ */
+#define QUARTER_HOUR_TOKEN_HOURLY ((uint8_t)0x00)
+
+/**
+ * \def COMPACT_DAILY_LOG_MAX_LENGTH
+ * \brief Longest compact daily log message: header, flags,
+ *        three 16 bit varints and 24 hour tokens of up to 3
+ *        bytes each.
+ */
+#define COMPACT_DAILY_LOG_MAX_LENGTH ((uint16_t)(16 + 1 + (3 + 24) * 3))
+
+/**
+ * \def BACKFILL_MAX_LOGS_PER_SESSION
+ * \brief Most daily logs sent for one backfill request.  The
+ *        rest of the day range is asked for again from the
+ *        resume day returned with the request.
+ */
+#define BACKFILL_MAX_LOGS_PER_SESSION ((uint8_t)7)
+
+/**
+ * \def NO_BACKFILL_DAY
+ * \brief Resume day returned when the whole day range of a
+ *        backfill request is sent in one session.
+ */
+#define NO_BACKFILL_DAY ((uint16_t)0xFFFF)
+
 /**
  * \typedef dailyLog_t
  * \brief Define the structure of the daily log data that is 
@@ -165,9 +299,37 @@ typedef struct __attribute__((__packed__))dailyLog_s {
     uint8_t redFlag;                                       /**< 01, 52    */
     uint8_t reserverd;                                     /**< 01, 53    */
     uint16_t errorBits;                                    /**< 02, 54-55 */ //This is a NEW field for algo v 2
-    uint16_t padSubmergedCount[6];                         /**< 12, 56-67 */
+    uint16_t padSubmergedCount[TOTAL_PAD_COUNTS];          /**< 12, 56-67 */
 } dailyLog_t;
 
+/**
+ * \typedef quarterHourLog_t
+ * \brief Define the structure of the daily log data that is
+ *        sent inside the quarter hour daily log message.  The
+ *        fixed fields are in the same order as in dailyLog_t.
+ *        The quarter hour bins are coded by
+ *        writeQuarterHourBins().  The hourly liters are the sum
+ *        of the four quarter hour bins of each hour.
+ */
+typedef struct __attribute__((__packed__))quarterHourLog_s {
+    uint16_t totalLiters;                                  /**< 02, 00-01 */
+    uint16_t averageLiters;                                /**< 02, 02-03 */
+    uint8_t redFlag;                                       /**< 01, 04    */
+    uint8_t reserverd;                                     /**< 01, 05    */
+    uint16_t errorBits;                                    /**< 02, 06-07 */
+    uint8_t bins[QUARTER_HOUR_BINS_LENGTH];                /**< 99, 08-106 */
+} quarterHourLog_t;
+
+/**
+ * \typedef logData_t
+ * \brief The daily log data kept in a log record, hourly or
+ *        quarter hour.
+ */
+typedef union logData_s {
+    dailyLog_t dailyLog;
+    quarterHourLog_t quarterHourLog;
+} logData_t;
+
 typedef union packetHeader_s {
     msgHeader_t msgHeader;
     uint8_t bytes[16];                                     // force to 16 bytes
@@ -175,6 +337,7 @@ typedef union packetHeader_s {
 
 typedef union packetData_s {
     dailyLog_t dailyLog;
+    quarterHourLog_t quarterHourLog;
     uint8_t bytes[112];                                    // force to 112 bytes
 } packetData_t;
 
@@ -192,49 +355,174 @@ typedef struct dailyPacket_s {
 } dailyPacket_t;
 
 /**
- * \typedef weeklyLog_t
- * \brief  Define the layout of the weekly log in flash.  It 
- *         currently consists of the 7 daily log packets and
- *         meta data.
+ * \typedef logRecord_t
+ * \brief Define the layout of one daily log record in flash.
+ *        Only the part of the daily packet that is written is
+ *        stored.  The rest of the packet is erased flash and is
+ *        filled in with 0xFF when the packet is sent.
+ */
+typedef struct logRecord_s {
+    uint8_t clearOnOpen;                                   /**< Byte cleared when the record is given to a day */
+    uint8_t clearForQuarterHour;                           /**< Byte cleared if the record holds quarter hour bins */
+    uint8_t clearOnReady;                                  /**< Byte cleared when log ready to send */
+    uint8_t clearOnTransmit;                               /**< Byte cleared when log transmitted */
+    packetHeader_t packetHeader;                           /**< The daily packet header */
+    logData_t logData;                                     /**< The daily packet data */
+} logRecord_t;
+
+/**
+ * \typedef quarterHourCoder_t
+ * \brief State of the quarter hour bins written to today's log
+ *        record.  A bin is one quarter hour.
+ */
+typedef struct quarterHourCoder_s {
+    uint8_t length;                                        /**< Bytes of the coded bins written */
+    uint8_t binsCoded;                                     /**< Bins covered by the tokens written */
+    uint16_t prevValue;                                    /**< Value of the last bin written */
+    bool hourly;                                           /**< Set once the rest of the day is coded by the hour */
+} quarterHourCoder_t;
+
+/**
+ * \typedef backfill_t
+ * \brief State of a daily log backfill request.  A day is
+ *        identified by the days activated in its packet header.
+ */
+typedef struct backfill_s {
+    uint16_t nextDay;                                      /**< Lowest day still to send */
+    uint16_t lastDay;                                      /**< Last day of the requested range */
+    uint8_t logsLeft;                                      /**< Daily logs that can still be sent this session */
+} backfill_t;
+
+/**
+ * \typedef logSegmentHeader_t
+ * \brief Define the header written when a log segment is
+ *        opened.  The sequence number increments with each
+ *        segment opened, the segment with the highest number is
+ *        the one being written.
+ */
+typedef struct logSegmentHeader_s {
+    uint16_t signature;                                    /**< LOG_SEGMENT_SIGNATURE */
+    uint16_t sequence;                                     /**< Order the segment was opened in */
+} logSegmentHeader_t;
+
+/**
+ * \typedef logSegment_t
+ * \brief  Define the layout of one flash segment of the daily
+ *         log region.  The segment header is followed by the
+ *         daily log records, which are appended in order.  The
+ *         size is forced to one flash segment by the union.
+ */
+typedef union logSegment_s {
+    struct {
+        logSegmentHeader_t header;
+        logRecord_t records[RECORDS_PER_LOG_SEGMENT];
+    } log;
+    uint8_t bytes[FLASH_BLOCK_SIZE];                       // force to one flash segment
+} logSegment_t;
+
+/**
+ * \typedef logIndex_t
+ * \brief RAM index of the daily log region.  It is built from
+ *        the segment headers and record flags at startup.
+ */
+typedef struct logIndex_s {
+    uint16_t sequence[TOTAL_LOG_SEGMENTS];                 /**< LOG_SEQUENCE_ERASED if segment not in the log */
+    uint8_t usedRecords[TOTAL_LOG_SEGMENTS];               /**< Records given out in each segment */
+    uint8_t headSegment;                                   /**< Segment being written, or NO_LOG_SEGMENT */
+    uint16_t nextSequence;                                 /**< Sequence number of the next segment opened */
+} logIndex_t;
+
+
+/**
+ * \typedef storageCheckpoint_t
+ * \brief Define the layout of the storage checkpoint.  It holds
+ *        the module state that spans days: the red flag
+ *        mapping, days activated, transmission state and the
+ *        storage week and day.
  */
-typedef struct weeklyLog_s {
-    dailyPacket_t dailyPackets[7];                         /**< The seven daily logs of the week */
-    uint8_t clearOnTransmit[7];                            /**< Byte cleared for day when log transmitted */
-    uint8_t clearOnReady[7];                               /**< Byte cleared for day when log ready to send */
-} weeklyLog_t;
+typedef struct storageCheckpoint_s {
+    uint16_t magic;                                        /**< A known pattern for "quick" test of structure validity */
+    uint16_t version;                                      /**< STORAGE_CHECKPOINT_VERSION */
+    uint16_t recordLength;                                 /**< Length of structure */
+    uint16_t sequence;                                     /**< Incremented with each checkpoint written */
+    storageData_t stData;                                  /**< The storage module data */
+    uint8_t daysSinceLastTimeSync;                         /**< Days since the last time sync request */
+    uint8_t daysWithNoRtcTimeThisMonth;                    /**< Days without GMT time in the request cycle */
+    uint16_t crc16;                                        /**< crc16 Used to validate the data */
+} storageCheckpoint_t;
 
+/**
+ * \typedef checkpointSlot_t
+ * \brief One checkpoint slot in flash.  The size is forced to
+ *        one flash segment by the union.
+ */
+typedef union checkpointSlot_s {
+    storageCheckpoint_t checkpoint;
+    uint8_t bytes[FLASH_BLOCK_SIZE];                       // force to one flash segment
+} checkpointSlot_t;
 
 /****************************
  * Module Data Declarations
  ***************************/
 
 /*
- *  These are the weekly log entries in flash.  Each weekly log entry
- *  contains 7 daily log entries plus some meta data.  The storage module
- *  rotates through each weekly log, storing the water stats for each day
- *  of the week.  The day's water stats are stored at the end of each
- *  day (midnight of the following day).
- */
-#pragma DATA_SECTION(week1Log, ".week1Data")
-const weeklyLog_t week1Log;
-#pragma DATA_SECTION(week2Log, ".week2Data")
-const weeklyLog_t week2Log;
-#pragma DATA_SECTION(week3Log, ".week3Data")
-const weeklyLog_t week3Log;
-#pragma DATA_SECTION(week4Log, ".week4Data")
-const weeklyLog_t week4Log;
-#pragma DATA_SECTION(week5Log, ".week5Data")
-const weeklyLog_t week5Log;
-
-// Force this table to be located in the .text area
-#pragma DATA_SECTION(weeklyLogAddrTable, ".text")
-static const weeklyLog_t *weeklyLogAddrTable[] = {
-    &week1Log,
-    &week2Log,
-    &week3Log,
-    &week4Log,
-    &week5Log,
-};
+ *  This is the daily log region in flash.  It is written as a log:
+ *  each day that is recorded gets the next record of the segment
+ *  being written (the head).  When the head is full, the next segment
+ *  is erased and opened.  Segments are opened in turn, so the segment
+ *  after the head is always the oldest and each segment is erased once
+ *  for every TOTAL_LOG_RECORDS days recorded.  The ready and transmitted
+ *  state of each day is kept in its record.
+ */
+#pragma DATA_SECTION(logSegments, ".dailyLogs")
+const logSegment_t logSegments[TOTAL_LOG_SEGMENTS];
+
+/**
+ * \var logIndex
+ * \brief RAM index of the daily log region
+ */
+static logIndex_t logIndex;
+
+/**
+ * \var todayRecordP
+ * \brief The log record of the day being recorded.  NULL until
+ *        the first write of the day.
+ */
+static logRecord_t *todayRecordP;
+
+/**
+ * \var quarterHourDay
+ * \brief Set if the day being recorded is kept in quarter hour
+ *        bins.  Latched from the daily log format at the start
+ *        of the day.
+ */
+static bool quarterHourDay;
+
+/**
+ * \var quarterHourMl
+ * \brief Milliliters of each quarter of the current hour
+ */
+static uint32_t quarterHourMl[QUARTERS_IN_A_HOUR];
+
+/**
+ * \var qhCoder
+ * \brief State of the quarter hour bins of today's log record
+ */
+static quarterHourCoder_t qhCoder;
+
+/**
+ * \var backfill
+ * \brief The daily log backfill request being sent
+ */
+static backfill_t backfill;
+
+/*
+ *  These are the checkpoint slots in flash.  A checkpoint is written at
+ *  the end of each day and before a planned reboot, and the newest valid
+ *  one is restored at startup.
+ */
+#pragma DATA_SECTION(storageCheckpoints, ".storageCheckpoint")
+const checkpointSlot_t storageCheckpoints[TOTAL_CHECKPOINT_SLOTS];
 
 /**
  * \var stData 
@@ -242,28 +530,62 @@ static const weeklyLog_t *weeklyLogAddrTable[] = {
  */
 storageData_t stData;
 
+/**
+ * \var dayShadow
+ * \brief RAM copy of today's daily log.  The hours with water are
+ *        also written to the daily log in flash as they are
+ *        recorded, so that they are not lost with a reset.  The
+ *        rest of the log is written in one pass at the end of the
+ *        day.
+ */
+static dailyLog_t dayShadow;
+
 
 static uint8_t xDaysSinceLastTimeSync = 0;
+static uint8_t xDaysWithNoRtcTimeThisMonth = 0;
 
 /********************* 
  * Module Prototypes
  *********************/
+static void recordLastQuarterHour(uint8_t quarter);
 static void recordLastHour(uint8_t hour_to_store);
 static void recordLastDay(void);
-static weeklyLog_t* getWeeklyLogAddr(uint8_t weeklyLogNum);
-static dailyLog_t* getDailyLogAddr(uint8_t weeklyLogNum, uint8_t dayOfTheWeek);
-static msgHeader_t* getDailyHeaderAddr(uint8_t weeklyLogNum, uint8_t dayOfTheWeek);
-static dailyPacket_t* getDailyPacketAddr(uint8_t weeklyLogNum, uint8_t dayOfTheWeek);
-static uint8_t getNextWeeklyLogNum(uint8_t weeklyLogNum);
-static void eraseWeeklyLog(uint8_t weeklyLogNum);
-static void prepareNextWeeklyLog(void);
+static logRecord_t* getLogRecordAddr(uint8_t segmentNum, uint8_t recordNum);
+static uint8_t getNextLogSegmentNum(uint8_t segmentNum);
+static void buildLogIndex(void);
+static void openNextLogSegment(void);
+static logRecord_t* getTodayLogRecord(void);
+static logRecord_t* findOpenDailyLog(void);
 static void prepareDailyLog(void);
-static void markDailyLogAsReady(uint8_t dayOfTheWeek, uint8_t weeklyLogNum);
-static bool isDailyLogReady(uint8_t dayOfTheWeek, uint8_t weeklyLogNum);
-static void markDailyLogAsTransmitted(uint8_t dayOfTheWeek, uint8_t weeklyLogNum);
-static bool wasDailyLogTransmitted(uint8_t dayOfTheWeek, uint8_t weeklyLogNum);
+static void writeDailyLogHeader(logRecord_t *recordP);
+static void markDailyLogAsReady(logRecord_t *recordP);
+static bool isDailyLogReady(const logRecord_t *recordP);
+static void markDailyLogAsTransmitted(logRecord_t *recordP);
+static bool wasDailyLogTransmitted(const logRecord_t *recordP);
 static void checkAndTransmitMonthlyCheckin(void);
 static void checkAndTransmitDailyLogs(bool overrideTransmissionRate);
+static void clearDayShadow(void);
+static uint32_t restoreDayShadow(void);
+static void setLogInt16(uint16_t *fieldP, uint16_t val16);
+static uint16_t getLogInt16(const uint16_t *fieldP);
+static uint16_t getLogUnits(uint32_t milliliters);
+static bool isQuarterHourRecord(const logRecord_t *recordP);
+static void writeQuarterHourBins(uint8_t hour, const uint16_t *binsP, uint16_t hourValue);
+static uint8_t* putBinToken(uint8_t *bufP, quarterHourCoder_t *coderP, uint8_t bin, uint16_t value);
+static uint32_t restoreQuarterHourBins(void);
+static const uint8_t* getVarint(const uint8_t *bufP, const uint8_t *endP, uint32_t *valueP);
+static logRecord_t* findNextDailyLogToTransmit(void);
+static bool countDailyLogTransmitted(void);
+static uint16_t encodeDailyLog(uint8_t *bufP, const logRecord_t *recordP, bool compact);
+static logRecord_t* findNextBackfillDailyLog(uint16_t fromDay, uint16_t lastDay);
+static uint16_t getLogDayIndex(const logRecord_t *recordP);
+static uint16_t bundleDailyLogs(uint8_t *bufP);
+static uint16_t encodeCompactDailyLog(uint8_t *bufP, const logRecord_t *recordP);
+static uint8_t* putVarint(uint8_t *bufP, uint32_t value);
+static uint32_t zigzagDelta(uint16_t value, uint16_t prevValue);
+static bool isCheckpointValid(const storageCheckpoint_t *checkpointP);
+static uint8_t findNewestCheckpoint(void);
+static bool restoreCheckpoint(void);
 
 #if (DO_RED_FLAG_PROCESSING != 0)
 static bool redFlagProcessing(int16_t dayLiterSum);
@@ -289,6 +611,10 @@ void storageMgr_init(void)
 #endif
 
     memset(&stData, 0, sizeof(storageData_t));
+
+    // Set default transmission rate
+    stData.transmissionRateInDays = STORAGE_TRANSMISSION_RATE_DEFAULT;
+
 #ifdef RED_FLAG_TEST
     // set the threshold to start for testing purposes
     for (i = 0; i < TOTAL_DAYS_IN_A_WEEK; i++) 
@@ -299,16 +625,38 @@ void storageMgr_init(void)
     stData.redFlagDataFullyPopulated = 1;
 #endif
 
-    // Erase flash for all the weekly data logs
-    storageMgr_resetWeeklyLogs();
+    // Find the daily logs kept in flash.  Logs that are ready and
+    // not yet transmitted are sent with the next transmission.
+    todayRecordP = NULL;
+    buildLogIndex();
+
+    // Restore the state saved at the last day end or planned reboot.
+    // If the unit stays activated, today's log carries on in the record
+    // left open by the reset, or is started right away.
+    restoreCheckpoint();
+    quarterHourDay = (stData.dailyLogFormat & DAILY_LOG_FORMAT_QUARTER_HOUR) != 0;
+    memset(quarterHourMl, 0, sizeof(quarterHourMl));
+    if (stData.daysActivated)
+    {
+        todayRecordP = findOpenDailyLog();
+        if (todayRecordP != NULL)
+        {
+            quarterHourDay = isQuarterHourRecord(todayRecordP);
+        }
+        else
+        {
+            prepareDailyLog();
+        }
+    }
+
+    // Start today's log in RAM, and the day total, from the values
+    // already in flash
+    stData.dayMilliliterSum = restoreDayShadow();
 
 #ifdef SEND_DEBUG_TIME_DATA
     // the system time starts at 0, before the clock setting message is received
     TimeStamp_LastHour = 0;
 #endif
-
-    // Set default transmission rate
-    stData.transmissionRateInDays = STORAGE_TRANSMISSION_RATE_DEFAULT;
 }
 
 /**
@@ -320,11 +668,19 @@ void storageMgr_exec(void)
 {
     timePacket_t NowTime;
     uint8_t last_hour24 = stData.storageTime_hours;
+    uint8_t last_quarter = stData.storageTime_minutes / MINUTES_IN_A_QUARTER_HOUR;
 
     // get the latest RTC, and compare to last storage clock
     getBinTime(&NowTime);
     storageMgr_syncStorageTime(NowTime.second, NowTime.minute, NowTime.hour24);
 
+    if (quarterHourDay &&
+        ((NowTime.hour24 != last_hour24) || ((NowTime.minute / MINUTES_IN_A_QUARTER_HOUR) != last_quarter)))
+    {
+        // Record the water of the quarter hour that ended
+        recordLastQuarterHour(last_quarter);
+    }
+
     if (NowTime.hour24 != last_hour24)
     {
         // Record data
@@ -344,13 +700,17 @@ void storageMgr_exec(void)
             // to timer resolution (10 seconds)
             recordLastDay();
 
+            // The daily log format picks hourly or quarter hour bins
+            // for the whole day
+            quarterHourDay = (stData.dailyLogFormat & DAILY_LOG_FORMAT_QUARTER_HOUR) != 0;
+
             // Update Time
             stData.storageTime_dayOfWeek++;
 
             // Prepare data storage for next day
             if (stData.storageTime_dayOfWeek < TOTAL_DAYS_IN_A_WEEK)
             {
-                // Write daily log header for day if activated
+                // Open the daily log, with its header, if activated
                 if (stData.daysActivated)
                 {
                     prepareDailyLog();
@@ -362,9 +722,7 @@ void storageMgr_exec(void)
                 // Update Time
                 stData.storageTime_dayOfWeek = 0;
                 stData.storageTime_week++;
-                // Prepare data storage for next week and day
-                prepareNextWeeklyLog();
-                // Write daily log header for day if activated
+                // Open the daily log, with its header, if activated
                 if (stData.daysActivated)
                 {
                     prepareDailyLog();
@@ -377,6 +735,9 @@ void storageMgr_exec(void)
 
             //Adjust time to account for drift accumulated throughout the day
             all_timers_adjust_time_end_of_day();
+
+            // Save the state for the new day so a reset does not lose it
+            storageMgr_saveCheckpoint();
         } // end if mignight
     } // end if hour change
 
@@ -427,7 +788,8 @@ void storageMgr_setStorageTime(uint8_t rtc_Second, uint8_t rtc_Minute, uint8_t r
     stData.storageTime_week = 0;
     stData.minuteMilliliterSum = 0;
     stData.hourMilliliterSum = 0;
-    stData.dayMilliliterSum = 0;
+    // The water already in today's log stays in the day total
+    stData.dayMilliliterSum = restoreDayShadow();
 #ifdef SEND_DEBUG_TIME_DATA
     TimeStamp_LastHour = rtc_Hour24;
 #endif
@@ -553,41 +915,80 @@ void storageMgr_resetRedFlagAndMap(void)
 }
 
 /**
-* \brief Resets flash for all weekly logs.  This erases all 
-*        weekly log containers and resets the current weekly log
-*        number.
+* \brief Resets flash for all daily logs.  This erases the whole
+*        daily log region and empties the log index.  The logs
+*        start over in the first segment.  If the unit is
+*        activated, today's log starts over in a new record with
+*        its packet header.
 * \ingroup PUBLIC_API
 */
 void storageMgr_resetWeeklyLogs(void)
 {
     int i;
 
-    stData.curWeeklyLogNum = 0;
-    for (i = 0; i < TOTAL_WEEKLY_LOGS; i++)
+    for (i = 0; i < TOTAL_LOG_SEGMENTS; i++)
+    {
+        msp430Flash_erase_segment((uint8_t *)&logSegments[i]);
+    }
+    todayRecordP = NULL;
+    buildLogIndex();
+    if (stData.daysActivated)
     {
-        eraseWeeklyLog(i);
+        prepareDailyLog();
+        stData.dayMilliliterSum = restoreDayShadow();
     }
     return;
 }
 
+/**
+* \brief Write a checkpoint of the storage state to flash.  The
+*        slot that does not hold the newest checkpoint is erased
+*        and written, so a reset during the write leaves the
+*        previous checkpoint to restore.  Called at the end of
+*        each day and before a planned reboot.
+* \ingroup PUBLIC_API
+*/
+void storageMgr_saveCheckpoint(void)
+{
+    storageCheckpoint_t checkpoint;
+    uint8_t newestSlot = findNewestCheckpoint();
+    uint8_t slot = 0;
+
+    memset(&checkpoint, 0, sizeof(storageCheckpoint_t));
+    checkpoint.magic = STORAGE_CHECKPOINT_MAGIC;
+    checkpoint.version = STORAGE_CHECKPOINT_VERSION;
+    checkpoint.recordLength = sizeof(storageCheckpoint_t);
+    if (newestSlot != NO_CHECKPOINT_SLOT)
+    {
+        checkpoint.sequence = storageCheckpoints[newestSlot].checkpoint.sequence + 1;
+        slot = (newestSlot == 0) ? 1 : 0;
+    }
+    checkpoint.stData = stData;
+    checkpoint.daysSinceLastTimeSync = xDaysSinceLastTimeSync;
+    checkpoint.daysWithNoRtcTimeThisMonth = xDaysWithNoRtcTimeThisMonth;
+
+    // Calculate CRC on RAM version
+    checkpoint.crc16 = gen_crc16((const unsigned char *)&checkpoint, (sizeof(storageCheckpoint_t) - sizeof(uint16_t)));
+    // Erase Flash Version
+    msp430Flash_erase_segment((uint8_t *)&storageCheckpoints[slot]);
+    // Copy RAM version to Flash version
+    msp430Flash_write_bytes((uint8_t *)&storageCheckpoints[slot], (uint8_t *)&checkpoint, sizeof(storageCheckpoint_t));
+}
+
 /**
  * \brief This function is used to identify the next daily water
  *        log that is ready to transmit.  If there is a log
  *        ready for transmit, the pointer and size are returned.
  *        If no daily log is ready for transmit, the function
  *        returns 0.  If a daily log pointer is returned, then
- *        that daily log is marked as being transmitted in the
- *        weekly info meta data.
- * \brief To Determine if a daily log is ready or has been 
- *        transmitted, it looks at the weekly info meta data
- *        associated with each weekly log.  Status bits are
- *        maintained in the meta data area to mark if a daily
- *        log is ready for transmit and if it has already been
- *        transmitted.
- * \brief The function will sequentially search all the daily 
- *        logs of every weekly log from oldest to newest looking
- *        for any daily logs that are marked as ready but not
- *        yet transmitted.
+ *        that daily log is marked as being transmitted in its
+ *        log record.
+ * \brief The daily packet is assembled in the shared buffer by
+ *        encodeDailyLog().  If the bundled format is selected,
+ *        as many of the oldest ready daily logs as fit in the
+ *        shared buffer are sent together in one message, see
+ *        bundleDailyLogs().  Each one is marked as transmitted
+ *        in its own log record.
  *  
  * \ingroup PUBLIC_API
  * 
@@ -599,86 +1000,134 @@ void storageMgr_resetWeeklyLogs(void)
  */
 uint16_t storageMgr_getNextDailyLogToTransmit(uint8_t **dataPP)
 {
-    uint8_t i;
+    uint8_t *bufP = modemMgr_getSharedBuffer();
     uint16_t length = 0;
-    bool allDailyLogsTransmitted = false;
+    logRecord_t *recordP;
 
-    do
+    if (stData.dailyLogFormat & DAILY_LOG_FORMAT_BUNDLED)
+    {
+        length = bundleDailyLogs(bufP);
+    }
+    else
     {
-        // Loop for each day of the week until a daily log is found
-        // that is ready and has not been transmitted.
-        for (i = 0; i < TOTAL_DAYS_IN_A_WEEK; i++)
+        recordP = findNextDailyLogToTransmit();
+        if ((recordP != NULL) && countDailyLogTransmitted())
         {
-            // Get the flags to check if daily log is ready
-            // and has not yet been transmitted.
-            bool logReady = isDailyLogReady(i, stData.curTxWeek);
-            bool wasTransmitted = wasDailyLogTransmitted(i, stData.curTxWeek);
+            length = encodeDailyLog(bufP, recordP, stData.dailyLogFormat & DAILY_LOG_FORMAT_COMPACT);
+            // Mark this daily log as being transmitted
+            markDailyLogAsTransmitted(recordP);
+        }
+    }
 
-            if (logReady && !wasTransmitted)
-            {
-                // Get the address of the daily log
-                dailyPacket_t *dpP = getDailyPacketAddr(stData.curTxWeek, i);
+    *dataPP = bufP;
+    return (length);
+}
 
-                *dataPP = (uint8_t *)dpP;
-                length = sizeof(dailyPacket_t);
-                // Mark this daily log as being transmitted
-                markDailyLogAsTransmitted(i, stData.curTxWeek);
-                break;
-            }
-        }
+/**
+ * \brief Start a backfill of the stored daily logs of a range
+ *        of days.  A day is identified by the days activated in
+ *        its packet header.  The daily logs are sent with the
+ *        scheduled messages, lowest day first, in the standard
+ *        packet with their original header.  At most
+ *        BACKFILL_MAX_LOGS_PER_SESSION are sent, the rest of
+ *        the range is asked for again from the resume day.
+ *        The ready and transmitted state of the daily logs is
+ *        not changed.
+ * \ingroup PUBLIC_API
+ * 
+ * @param firstDay First day of the range
+ * @param lastDay Last day of the range
+ * @param resumeDayP Filled in with the first day that is not
+ *                   sent in this session, NO_BACKFILL_DAY if
+ *                   all of them are sent
+ * 
+ * @return uint8_t Number of daily logs stored for the range
+ */
+uint8_t storageMgr_startDailyLogBackfill(uint16_t firstDay, uint16_t lastDay, uint16_t *resumeDayP)
+{
+    uint8_t found = 0;
+    uint16_t day = firstDay;
+    logRecord_t *recordP;
 
-        // Check if we transmitted all days of current transmit week.
-        // If so, move to following week.
-        if (i == TOTAL_DAYS_IN_A_WEEK)
+    *resumeDayP = NO_BACKFILL_DAY;
+    while ((day <= lastDay) && ((recordP = findNextBackfillDailyLog(day, lastDay)) != NULL))
+    {
+        day = getLogDayIndex(recordP);
+        if (found == BACKFILL_MAX_LOGS_PER_SESSION)
         {
-            stData.curTxWeek = getNextWeeklyLogNum(stData.curTxWeek);
-            // If we have wrapped around all weekly logs, then halt transmitting.
-            // We assume all daily logs that were marked as ready have been
-            // transmitted.
-            if (stData.curTxWeek == stData.startTxWeek)
-            {
-                length = 0;
-                allDailyLogsTransmitted = true;
-            }
+            *resumeDayP = day;
         }
-    } while ((length == 0) && !allDailyLogsTransmitted);
-
-    // Perform a safety check to makes sure we are not stuck transmitting
-    // a daily log over and over.  We should never transmit more than the
-    // total number of daily logs stored.
-    if (length != 0)
-    {
-        if (stData.totalDailyLogsTransmitted < (TOTAL_DAYS_IN_A_WEEK * TOTAL_WEEKLY_LOGS))
+        found++;
+        if (day == NO_BACKFILL_DAY)
         {
-            stData.totalDailyLogsTransmitted++;
-            // Mark flag to indicate that at least one daily log has been sent
-            stData.haveSentDailyLogs = true;
+            break;
         }
-        else
+        day++;
+    }
+
+    backfill.nextDay = firstDay;
+    backfill.lastDay = lastDay;
+    backfill.logsLeft = BACKFILL_MAX_LOGS_PER_SESSION;
+    if (found)
+    {
+        msgSched_scheduleDailyLogBackfillMessage();
+    }
+    return (found);
+}
+
+/**
+ * \brief Return the next daily log of the backfill request.
+ *        The daily packet is assembled in the shared buffer.
+ * \ingroup PUBLIC_API
+ * 
+ * @param dataPP Pointer to a pointer that is filled in with the
+ *               address of the daily log.
+ * 
+ * @return uint16_t Size of the daily log to send, otherwise set
+ *         to zero if the backfill is done
+ */
+uint16_t storageMgr_getNextBackfillDailyLog(uint8_t **dataPP)
+{
+    uint8_t *bufP = modemMgr_getSharedBuffer();
+    uint16_t length = 0;
+    uint16_t day;
+    logRecord_t *recordP = NULL;
+
+    if (backfill.logsLeft && (backfill.nextDay <= backfill.lastDay))
+    {
+        recordP = findNextBackfillDailyLog(backfill.nextDay, backfill.lastDay);
+    }
+    if (recordP != NULL)
+    {
+        length = encodeDailyLog(bufP, recordP, false);
+        backfill.logsLeft--;
+        day = getLogDayIndex(recordP);
+        backfill.nextDay = day + 1;
+        if (day == NO_BACKFILL_DAY)
         {
-            length = 0;
+            backfill.logsLeft = 0;
         }
     }
+    else
+    {
+        backfill.logsLeft = 0;
+    }
 
+    *dataPP = bufP;
     return (length);
 }
 
 /**
  *  \brief Set how often to transmit the daily logs (in days).
- *         We currently limit the max rate to 4 weeks worth of
- *         data even though there is storage allocated for 5
- *         weeks of daily logs. That way when the transmission
- *         rate is set to max (4 weeks x 7 days = 28 days) the
- *         current week that is collecting data is not one of
- *         the weekly logs that has to be transmitted. It makes
- *         things simpler by not having to worry about the logic
- *         for erasing and preparing the current weekly log
- *         which would contain daily logs that need to be
- *         transmitted first. 
+ *         We limit the max rate to one segment less than the
+ *         number of daily logs the log region holds.  That way
+ *         when the transmission rate is set to max, opening a
+ *         new segment never erases daily logs that are still
+ *         waiting to be transmitted.
  */
 void storageMgr_setTransmissionRate(uint8_t transmissionRateInDays)
 {
-    uint8_t maxAllowedDays = (TOTAL_DAYS_IN_A_WEEK * (TOTAL_WEEKLY_LOGS - 1));
+    uint8_t maxAllowedDays = (TOTAL_LOG_RECORDS - RECORDS_PER_LOG_SEGMENT);
 
     stData.transmissionRateInDays = transmissionRateInDays;
     if ((stData.transmissionRateInDays < 1) || (stData.transmissionRateInDays > maxAllowedDays))
@@ -687,6 +1136,35 @@ void storageMgr_setTransmissionRate(uint8_t transmissionRateInDays)
     }
 }
 
+/**
+ *  \brief Set the message format used to send the daily logs.
+ *
+ *  @param format The daily log format (dailyLogFormat_t)
+ *
+ *  @return bool Returns false if the format is not known.  The
+ *          current format is kept.
+ */
+bool storageMgr_setDailyLogFormat(uint8_t format)
+{
+    bool known = false;
+
+    if ((format & ~DAILY_LOG_FORMAT_MASK) == 0)
+    {
+        stData.dailyLogFormat = format;
+        known = true;
+    }
+    return (known);
+}
+
+/**
+ *  \brief Return the message format used to send the daily
+ *         logs (dailyLogFormat_t).
+ */
+uint8_t storageMgr_getDailyLogFormat(void)
+{
+    return (stData.dailyLogFormat);
+}
+
 /**
 * \brief Read the storage time parameters.
 * 
@@ -905,12 +1383,9 @@ static void checkAndTransmitDailyLogs(bool overrideTransmissionRate)
             }
 
             // Its time to transmit the accumulated daily logs
-            // Start with the oldest week, which is the next weekly log from
-            // the current week.  We will march through all the weekly logs
-            // looking for any daily logs that are marked as ready but have
-            // not been transmitted.
-            stData.startTxWeek = getNextWeeklyLogNum(stData.curWeeklyLogNum);
-            stData.curTxWeek = stData.startTxWeek;
+            // The log records are searched from oldest to newest
+            // looking for any daily logs that are marked as ready but
+            // have not been transmitted.
             stData.totalDailyLogsTransmitted = 0;
             // Schedule transmitting all the daily water logs that are ready.
             msgSched_scheduleDailyWaterLogMessage();
@@ -943,48 +1418,82 @@ static void checkAndTransmitMonthlyCheckin(void)
 }
 
 /**
- * \brief Write the total liters for the current hour into 
- *        flash. Update the running sum for the total daily
- *        liters. The liters for the hour is stored in the
- *        current daily log contained in the current weekly log
- *        section.
+* \brief Read the water of the quarter hour that ended from the
+*        algorithm.  Only called on quarter hour days.  The
+*        volume of a water session still in progress is cut at
+*        the quarter hour, the same as at the hour otherwise.
+* 
+* @param quarter The quarter of the hour that ended (0-3)
+*/
+static void recordLastQuarterHour(uint8_t quarter)
+{
+    if (quarter < QUARTERS_IN_A_HOUR)
+    {
+        quarterHourMl[quarter] += APP_ALGO_getHourlyWaterVolume_ml();
+    }
+}
+
+/**
+ * \brief Store the total liters for the current hour in the RAM
+ *        copy of today's daily log.  Update the running sum for
+ *        the total daily liters.  Hours with water are also
+ *        written to the current daily log in flash so they
+ *        survive a reset, hours without water are written at
+ *        the end of the day.
  * \note The hourly water volume is stored in the log as Total 
  *     Milliliters/32
  */
 static void recordLastHour(uint8_t hour_to_store)
 {
-    // Get pointer to today's dailyLog in flash.
-    dailyLog_t *dailyLogsP = getDailyLogAddr(stData.curWeeklyLogNum, stData.storageTime_dayOfWeek);
-
-    // Get address to liters parameter in the dailyLog
-    uint8_t *addr = (uint8_t *)&(dailyLogsP->litersPerHour[hour_to_store]);
-
     //mL/32
-    uint32_t tempmLForCloudMsg = 0;
     uint16_t mLForCloudMsgThisHr = 0;
+    uint16_t quarterHourBins[QUARTERS_IN_A_HOUR];
+    uint32_t hourBinsSum = 0;
+    uint8_t i;
 
-    // The algorithm reports water in terms of mL:
-    stData.hourMilliliterSum = APP_ALGO_getHourlyWaterVolume_ml();
-
-    //divide by 32 - Max value will be 2097 liters (2097000mL)
-    //(65535mL*32)/1000mL/L = 2097 liters
-    tempmLForCloudMsg = (stData.hourMilliliterSum/32);
-
-    //check for overflow
-    if ( tempmLForCloudMsg > (uint16_t)0xFFFF )
+    if (quarterHourDay)
     {
-        //subtract one - values of 0xFFFF get written to 0 later on in the code
-        mLForCloudMsgThisHr = ((uint16_t)0xFFFF - 1);
+        // The hour is the sum of its quarter hours, each one is already
+        // read from the algorithm.
+        stData.hourMilliliterSum = 0;
+        for (i = 0; i < QUARTERS_IN_A_HOUR; i++)
+        {
+            stData.hourMilliliterSum += quarterHourMl[i];
+            quarterHourBins[i] = getLogUnits(quarterHourMl[i]);
+            hourBinsSum += quarterHourBins[i];
+            quarterHourMl[i] = 0;
+        }
+        mLForCloudMsgThisHr = getLogUnits(hourBinsSum << 5);
     }
     else
     {
-        mLForCloudMsgThisHr = (uint16_t)tempmLForCloudMsg;
+        // The algorithm reports water in terms of mL:
+        stData.hourMilliliterSum = APP_ALGO_getHourlyWaterVolume_ml();
+        mLForCloudMsgThisHr = getLogUnits(stData.hourMilliliterSum);
     }
 
-    if (stData.daysActivated)
+    if (stData.daysActivated && (hour_to_store < TOTAL_HOURS_IN_A_DAY))
     {
-        // Store the hourly milliliter value to the flash log
-        msp430Flash_write_int16(addr, mLForCloudMsgThisHr);
+        if (quarterHourDay)
+        {
+            // Store the hourly milliliter value in today's log
+            setLogInt16(&dayShadow.litersPerHour[hour_to_store], mLForCloudMsgThisHr);
+            writeQuarterHourBins(hour_to_store, quarterHourBins, mLForCloudMsgThisHr);
+        }
+        else if (!getLogInt16(&dayShadow.litersPerHour[hour_to_store]))
+        {
+            // Store the hourly milliliter value in today's log.  An hour
+            // already holding water is not written again (the clock was
+            // set back), flash can not be rewritten without an erase.
+            setLogInt16(&dayShadow.litersPerHour[hour_to_store], mLForCloudMsgThisHr);
+            if (mLForCloudMsgThisHr)
+            {
+                // Get pointer to today's log record in flash.
+                logRecord_t *recordP = getTodayLogRecord();
+
+                msp430Flash_write_int16((uint8_t *)&(recordP->logData.dailyLog.litersPerHour[hour_to_store]), mLForCloudMsgThisHr);
+            }
+        }
     }
 
     // Track the total daily milliliters
@@ -1019,12 +1528,9 @@ static void recordLastDay(void)
 {
 
     uint16_t temp;
-    uint8_t log_hour;
     bool newRedFlagCondition = false;
     uint16_t errorBitsForThisDay = 0;
-    uint8_t *errBitAddr;
     uint32_t errorBits = 0;
-    static uint8_t xDaysWithNoRtcTimeThisMonth = 0;
 
     //first get error bits to see if we have a timestamp
     errorBits = sysExec_getErrorBits();
@@ -1034,16 +1540,11 @@ static void recordLastDay(void)
     {
         uint16_t dayLiterSum = stData.dayMilliliterSum / ML_PER_LITER;
 
-        // Get pointer to today's dailyLog in flash.
-        dailyLog_t *dailyLogsP = getDailyLogAddr(stData.curWeeklyLogNum, stData.storageTime_dayOfWeek);
-        
-        // zero out leading liter counts that were not filled in because of a partial day of data
-        for (log_hour = 0; log_hour < 24; log_hour++){
-            if (dailyLogsP->litersPerHour[log_hour] == 0xFFFF) {
-                msp430Flash_write_int16((uint8_t *)&(dailyLogsP->litersPerHour[log_hour]), 0);
-                WATCHDOG_TICKLE();
-            }
-        }
+        // Get pointer to today's log record in flash.
+        logRecord_t *recordP = getTodayLogRecord();
+
+        // Liter counts that were not filled in because of a partial day of
+        // data are left at zero in today's log.
 
         //update with any error bits recorded during this day
         errorBitsForThisDay = APP_ALGO_reportAlgoErrors();
@@ -1051,15 +1552,11 @@ static void recordLastDay(void)
         //now OR the bits with the system level error bits
         errorBitsForThisDay |= sysExec_getErrorBits();
 
-        // Write error bit value to flash
-        errBitAddr = (uint8_t *)&(dailyLogsP->errorBits);
-        msp430Flash_write_int16(errBitAddr, errorBitsForThisDay);
+        // Store error bit value in today's log
+        setLogInt16(&dayShadow.errorBits, errorBitsForThisDay);
 
-        // Mark the current daily log as ready in the weekly log meta data.
-        markDailyLogAsReady(stData.storageTime_dayOfWeek, stData.curWeeklyLogNum);
-
-        // Write the total liters for the day to the daily log
-        msp430Flash_write_int16((uint8_t *)&(dailyLogsP->totalLiters), dayLiterSum);
+        // Store the total liters for the day in today's log
+        setLogInt16(&dayShadow.totalLiters, dayLiterSum);
 
 #if (DO_RED_FLAG_PROCESSING != 0)
 #if (DO_RED_FLAG_TRANSMISSION != 0)
@@ -1071,17 +1568,36 @@ static void recordLastDay(void)
 #endif
 #endif
 
-        // Write the redFlag condition to the daily log
-        msp430Flash_write_bytes((uint8_t *)&(dailyLogsP->redFlag), (uint8_t *)&stData.redFlagCondition, FLASH_WRITE_ONE_BYTE);
+        // Store the redFlag condition in today's log
+        dayShadow.redFlag = stData.redFlagCondition;
 
-        // Write the red flag threshold value for today to the daily log
-        // Only write the value if the red flag threshold table has been fully populated, otherwise write zero
+        // Store the red flag threshold value for today in today's log
+        // Only store the value if the red flag threshold table has been fully populated, otherwise store zero
         temp = 0;
         if (stData.redFlagDataFullyPopulated)
         {
             temp = stData.redFlagThreshTable[stData.storageTime_dayOfWeek];
         }
-        msp430Flash_write_int16((uint8_t *)&(dailyLogsP->averageLiters), temp);
+        setLogInt16(&dayShadow.averageLiters, temp);
+
+        if (isQuarterHourRecord(recordP))
+        {
+            // The quarter hour bins are already written, write the
+            // fields that follow the hourly liters in dailyLog_t.
+            msp430Flash_write_bytes((uint8_t *)&recordP->logData.quarterHourLog, (uint8_t *)&dayShadow.totalLiters,
+                                    sizeof(quarterHourLog_t) - QUARTER_HOUR_BINS_LENGTH);
+        }
+        else
+        {
+            // Write today's log to flash in one pass.  The pad submerged
+            // counts are the last field and are not recorded, they are
+            // left erased.
+            msp430Flash_write_bytes((uint8_t *)&recordP->logData.dailyLog, (uint8_t *)&dayShadow,
+                                    sizeof(dailyLog_t) - sizeof(dayShadow.padSubmergedCount));
+        }
+
+        // Mark the current daily log as ready in its log record.
+        markDailyLogAsReady(recordP);
 
         // Check if its time to transmit data
         // Data is only sent if we are activated and we have reached
@@ -1152,16 +1668,748 @@ static void recordLastDay(void)
     
     // Reset the daily based statistics
     stData.dayMilliliterSum = 0;
+    clearDayShadow();
+
+    // The next day gets a new log record
+    todayRecordP = NULL;
 }
 
-#if (DO_RED_FLAG_PROCESSING != 0)
 /**
-* @brief Monitor for a redFlag condition.
+* \brief Start a new day in the RAM copy of the daily log.  The
+*        fields that are not recorded are left erased.
+*/
+static void clearDayShadow(void)
+{
+    memset(&dayShadow, 0, sizeof(dailyLog_t));
+    dayShadow.reserverd = 0xFF;
+    memset(dayShadow.padSubmergedCount, 0xFF, sizeof(dayShadow.padSubmergedCount));
+}
+
+/**
+* \brief Rebuild the RAM copy of today's daily log from the 
+*        hourly values already written to the daily log in
+*        flash.  At most the current hour is lost with a reset.
 * 
-* @return bool Returns true if a new red flag condition is 
-*         detected.
+* @return uint32_t The milliliters recorded so far today.  The
+*         value is rounded down to 32 mL per hour.
 */
-static bool redFlagProcessing(int16_t dayLiterSum)
+static uint32_t restoreDayShadow(void)
+{
+    uint8_t i;
+    uint16_t value;
+    uint32_t dayMilliliters = 0;
+
+    clearDayShadow();
+    memset(&qhCoder, 0, sizeof(quarterHourCoder_t));
+    if (todayRecordP == NULL)
+    {
+        return (0);
+    }
+    if (isQuarterHourRecord(todayRecordP))
+    {
+        return (restoreQuarterHourBins());
+    }
+    for (i = 0; i < TOTAL_HOURS_IN_A_DAY; i++)
+    {
+        value = getLogInt16(&todayRecordP->logData.dailyLog.litersPerHour[i]);
+        if (value != 0xFFFF)
+        {
+            setLogInt16(&dayShadow.litersPerHour[i], value);
+            dayMilliliters += (uint32_t)value << 5;
+        }
+    }
+    return (dayMilliliters);
+}
+
+/**
+* \brief Store a 16 bit value in the RAM copy of the daily log.
+*        Same byte order as msp430Flash_write_int16() (MSB first).
+* 
+* @param fieldP The field in the daily log
+* @param val16 The value to store
+*/
+static void setLogInt16(uint16_t *fieldP, uint16_t val16)
+{
+    uint8_t *bytesP = (uint8_t *)fieldP;
+
+    bytesP[0] = val16 >> 8;
+    bytesP[1] = val16 & 0xFF;
+}
+
+/**
+* \brief Read a 16 bit value stored in a daily log.
+* 
+* @param fieldP The field in the daily log
+* 
+* @return uint16_t The stored value
+*/
+static uint16_t getLogInt16(const uint16_t *fieldP)
+{
+    const uint8_t *bytesP = (const uint8_t *)fieldP;
+
+    return (((uint16_t)bytesP[0] << 8) | bytesP[1]);
+}
+
+/**
+* \brief Convert milliliters to the units of the daily log,
+*        mL/32.
+* 
+* @param milliliters The water volume
+* 
+* @return uint16_t The volume in mL/32
+*/
+static uint16_t getLogUnits(uint32_t milliliters)
+{
+    //divide by 32 - Max value will be 2097 liters (2097000mL)
+    //(65535mL*32)/1000mL/L = 2097 liters
+    uint32_t tempmLForCloudMsg = (milliliters/32);
+
+    //check for overflow
+    if ( tempmLForCloudMsg > (uint16_t)0xFFFF )
+    {
+        //subtract one - values of 0xFFFF get written to 0 later on in the code
+        tempmLForCloudMsg = ((uint16_t)0xFFFF - 1);
+    }
+    return ((uint16_t)tempmLForCloudMsg);
+}
+
+/**
+* \brief Utility function to check if a log record holds
+*        quarter hour bins.
+* 
+* @param recordP The log record to check
+*/
+static bool isQuarterHourRecord(const logRecord_t *recordP)
+{
+    return (recordP->clearForQuarterHour ? false : true);
+}
+
+/**
+* \brief Append the quarter hour bins of an hour to today's log
+*        record.  The bins are coded as varint tokens, the same
+*        as the hourly bins of the compact daily log:
+* \li A token with bit 0 clear is a run of (token >> 1) zero
+*     bins.  Zero bins are not written until a non-zero bin
+*     follows them, bins after the last token are zero.
+* \li A token with bit 0 set is a non-zero bin, (token >> 1) is
+*     the zigzag difference from the previous bin.
+* \li The QUARTER_HOUR_TOKEN_HOURLY token switches the rest of
+*     the day to one bin per hour.
+* \brief An hour is only written in quarter hour bins if the
+*        space left after it can still hold the rest of the day
+*        in hourly bins.  That way a heavy day loses the quarter
+*        hour detail of its last hours, but never an hourly
+*        total.  The tokens of an hour are written to flash in
+*        one pass at the end of the hour.
+* 
+* @param hour The hour that ended
+* @param binsP The quarter hour bins of the hour (mL/32)
+* @param hourValue The sum of the bins (mL/32)
+*/
+static void writeQuarterHourBins(uint8_t hour, const uint16_t *binsP, uint16_t hourValue)
+{
+    uint8_t tokens[QUARTER_HOUR_RUN_MAX_LENGTH + (QUARTERS_IN_A_HOUR * QUARTER_HOUR_TOKEN_MAX_LENGTH)];
+    uint8_t *outP = tokens;
+    uint8_t firstBin = hour * QUARTERS_IN_A_HOUR;
+    uint8_t reserve = 0;
+    uint8_t i;
+    quarterHourCoder_t coder = qhCoder;
+    logRecord_t *recordP;
+
+    // Bins already coded are not coded again (the clock was set back)
+    if (!hourValue || (firstBin < qhCoder.binsCoded))
+    {
+        return;
+    }
+
+    // Room to switch to hourly bins and code the hours left
+    if (hour < (TOTAL_HOURS_IN_A_DAY - 1))
+    {
+        reserve = QUARTER_HOUR_RUN_MAX_LENGTH + 1 +
+                  ((TOTAL_HOURS_IN_A_DAY - 1 - hour) * QUARTER_HOUR_TOKEN_MAX_LENGTH);
+    }
+
+    if (!coder.hourly)
+    {
+        for (i = 0; i < QUARTERS_IN_A_HOUR; i++)
+        {
+            if (binsP[i])
+            {
+                outP = putBinToken(outP, &coder, firstBin + i, binsP[i]);
+            }
+        }
+    }
+
+    if (coder.hourly || ((qhCoder.length + (outP - tokens) + reserve) > QUARTER_HOUR_BINS_LENGTH))
+    {
+        coder = qhCoder;
+        outP = tokens;
+        if (!coder.hourly)
+        {
+            // Zero bins up to this hour, then switch to hourly bins
+            if (firstBin > coder.binsCoded)
+            {
+                outP = putVarint(outP, (uint32_t)(firstBin - coder.binsCoded) << 1);
+                coder.binsCoded = firstBin;
+            }
+            *outP++ = QUARTER_HOUR_TOKEN_HOURLY;
+            coder.hourly = true;
+            coder.prevValue = 0;
+        }
+        outP = putBinToken(outP, &coder, firstBin, hourValue);
+    }
+
+    coder.length += outP - tokens;
+    if (coder.length <= QUARTER_HOUR_BINS_LENGTH)
+    {
+        recordP = getTodayLogRecord();
+        msp430Flash_write_bytes(&recordP->logData.quarterHourLog.bins[qhCoder.length], tokens, outP - tokens);
+        qhCoder = coder;
+    }
+}
+
+/**
+* \brief Code one non-zero bin, preceded by the run of zero bins
+*        since the last token.  Hourly bins count as four quarter
+*        hour bins.
+* 
+* @param bufP Where to write the tokens
+* @param coderP The coder state, updated
+* @param bin The quarter hour bin of the day (0-95)
+* @param value The bin value (mL/32)
+* 
+* @return uint8_t* The byte after the tokens
+*/
+static uint8_t* putBinToken(uint8_t *bufP, quarterHourCoder_t *coderP, uint8_t bin, uint16_t value)
+{
+    uint8_t binsPerToken = coderP->hourly ? QUARTERS_IN_A_HOUR : 1;
+
+    if (bin > coderP->binsCoded)
+    {
+        bufP = putVarint(bufP, (uint32_t)((bin - coderP->binsCoded) / binsPerToken) << 1);
+        coderP->prevValue = 0;
+    }
+    bufP = putVarint(bufP, (zigzagDelta(value, coderP->prevValue) << 1) | 1);
+    coderP->prevValue = value;
+    coderP->binsCoded = bin + binsPerToken;
+    return (bufP);
+}
+
+/**
+* \brief Rebuild the quarter hour coder state and the hourly
+*        liters of the RAM copy of today's log from the quarter
+*        hour bins in flash.  The bins end at the first token
+*        that is not complete (erased flash).
+* 
+* @return uint32_t The milliliters recorded so far today.  The
+*         value is rounded down to 32 mL per bin.
+*/
+static uint32_t restoreQuarterHourBins(void)
+{
+    const uint8_t *binsP = todayRecordP->logData.quarterHourLog.bins;
+    const uint8_t *endP = binsP + QUARTER_HOUR_BINS_LENGTH;
+    const uint8_t *nextP;
+    uint32_t token;
+    uint16_t value;
+    uint8_t hour;
+    uint32_t dayMilliliters = 0;
+
+    while ((nextP = getVarint(binsP + qhCoder.length, endP, &token)) != NULL)
+    {
+        if (token == QUARTER_HOUR_TOKEN_HOURLY)
+        {
+            qhCoder.hourly = true;
+            qhCoder.prevValue = 0;
+        }
+        else if (!(token & 1))
+        {
+            qhCoder.binsCoded += (token >> 1) * (qhCoder.hourly ? QUARTERS_IN_A_HOUR : 1);
+            qhCoder.prevValue = 0;
+        }
+        else
+        {
+            token >>= 1;
+            value = qhCoder.prevValue + ((token & 1) ? -(uint16_t)((token + 1) >> 1) : (uint16_t)(token >> 1));
+            hour = qhCoder.binsCoded / QUARTERS_IN_A_HOUR;
+            if (hour >= TOTAL_HOURS_IN_A_DAY)
+            {
+                break;
+            }
+            setLogInt16(&dayShadow.litersPerHour[hour], getLogInt16(&dayShadow.litersPerHour[hour]) + value);
+            dayMilliliters += (uint32_t)value << 5;
+            qhCoder.prevValue = value;
+            qhCoder.binsCoded += qhCoder.hourly ? QUARTERS_IN_A_HOUR : 1;
+        }
+        qhCoder.length = nextP - binsP;
+    }
+    return (dayMilliliters);
+}
+
+/**
+* \brief Read a varint written by putVarint().
+* 
+* @param bufP Where to read the varint
+* @param endP The end of the buffer
+* @param valueP Returns the value
+* 
+* @return const uint8_t* The byte after the varint, NULL if it
+*         is longer than a bin token or runs past the end
+*/
+static const uint8_t* getVarint(const uint8_t *bufP, const uint8_t *endP, uint32_t *valueP)
+{
+    uint8_t i;
+
+    *valueP = 0;
+    for (i = 0; (i < QUARTER_HOUR_TOKEN_MAX_LENGTH) && (bufP < endP); i++)
+    {
+        *valueP |= (uint32_t)(*bufP & 0x7F) << (7 * i);
+        if (!(*bufP++ & 0x80))
+        {
+            return (bufP);
+        }
+    }
+    return (NULL);
+}
+
+/**
+* \brief Find the oldest daily log that is ready and has not
+*        been transmitted.  The records are searched from oldest
+*        to newest, starting with the segment after the head
+*        segment.
+* 
+* @return logRecord_t* The daily log record, or NULL if none is
+*         waiting to be transmitted
+*/
+static logRecord_t* findNextDailyLogToTransmit(void)
+{
+    uint8_t i;
+    uint8_t r;
+    uint8_t segmentNum = logIndex.headSegment;
+
+    if (segmentNum != NO_LOG_SEGMENT)
+    {
+        for (i = 0; i < TOTAL_LOG_SEGMENTS; i++)
+        {
+            segmentNum = getNextLogSegmentNum(segmentNum);
+            for (r = 0; r < logIndex.usedRecords[segmentNum]; r++)
+            {
+                logRecord_t *recordP = getLogRecordAddr(segmentNum, r);
+
+                if (isDailyLogReady(recordP) && !wasDailyLogTransmitted(recordP))
+                {
+                    return (recordP);
+                }
+            }
+        }
+    }
+    return (NULL);
+}
+
+/**
+* \brief Perform a safety check to makes sure we are not stuck
+*        transmitting daily logs over and over.  We should never
+*        transmit more than the total number of daily logs
+*        stored in one transmit session.
+* 
+* @return bool Returns true if one more daily log can be sent.
+*/
+static bool countDailyLogTransmitted(void)
+{
+    bool allowed = false;
+
+    if (stData.totalDailyLogsTransmitted < TOTAL_LOG_RECORDS)
+    {
+        stData.totalDailyLogsTransmitted++;
+        // Mark flag to indicate that at least one daily log has been sent
+        stData.haveSentDailyLogs = true;
+        allowed = true;
+    }
+    return (allowed);
+}
+
+/**
+* \brief Find the ready daily log of the lowest day in a range.
+*        A day is identified by the days activated in its packet
+*        header.  Looking for the lowest day, and not the
+*        oldest log, makes each day that is sent move the
+*        backfill forward.
+* 
+* @param fromDay First day of the range
+* @param lastDay Last day of the range
+* 
+* @return logRecord_t* The daily log record, or NULL if no
+*         daily log of the range is stored
+*/
+static logRecord_t* findNextBackfillDailyLog(uint16_t fromDay, uint16_t lastDay)
+{
+    uint8_t i;
+    uint8_t r;
+    uint16_t day;
+    logRecord_t *foundP = NULL;
+
+    for (i = 0; i < TOTAL_LOG_SEGMENTS; i++)
+    {
+        for (r = 0; r < logIndex.usedRecords[i]; r++)
+        {
+            logRecord_t *recordP = getLogRecordAddr(i, r);
+
+            if (isDailyLogReady(recordP))
+            {
+                day = getLogDayIndex(recordP);
+                if ((day >= fromDay) && (day <= lastDay) &&
+                    ((foundP == NULL) || (day < getLogDayIndex(foundP))))
+                {
+                    foundP = recordP;
+                }
+            }
+        }
+    }
+    return (foundP);
+}
+
+/**
+* \brief Return the day of a daily log, the days activated
+*        written in its packet header.
+* 
+* @param recordP The daily log record
+* 
+* @return uint16_t The days activated
+*/
+static uint16_t getLogDayIndex(const logRecord_t *recordP)
+{
+    const msgHeader_t *headerP = &recordP->packetHeader.msgHeader;
+
+    return (((uint16_t)headerP->daysActivatedMsb << 8) | headerP->daysActivatedLsb);
+}
+
+/**
+* \brief Assemble the daily packet of one daily log in the
+*        selected format.  In the standard format the part of
+*        the packet that is not stored in the log record is
+*        filled in with 0xFF, the same as erased flash.  A
+*        quarter hour daily log is sent as the
+*        MSG_TYPE_DAILY_LOG_QUARTER_HOUR packet, in the compact
+*        format without the unused end of the bins.
+* 
+* @param bufP Buffer to assemble the packet in
+* @param recordP The daily log record to send
+* @param compact Set to use the compact format
+* 
+* @return uint16_t Length of the packet
+*/
+static uint16_t encodeDailyLog(uint8_t *bufP, const logRecord_t *recordP, bool compact)
+{
+    dailyPacket_t *dpP = (dailyPacket_t *)bufP;
+    uint16_t minLength = sizeof(packetHeader_t) + sizeof(quarterHourLog_t) - QUARTER_HOUR_BINS_LENGTH;
+    uint16_t length;
+
+    if (isQuarterHourRecord(recordP))
+    {
+        memset(dpP, 0xFF, sizeof(dailyPacket_t));
+        memcpy(&dpP->packetHeader, &recordP->packetHeader, sizeof(packetHeader_t));
+        dpP->packetHeader.msgHeader.payloadMsgId = MSG_TYPE_DAILY_LOG_QUARTER_HOUR;
+        memcpy(&dpP->packetData.quarterHourLog, &recordP->logData.quarterHourLog, sizeof(quarterHourLog_t));
+        length = sizeof(dailyPacket_t);
+        if (compact)
+        {
+            // Drop the erased end of the bins.  The last byte of a
+            // token is never 0xFF.
+            length = minLength + QUARTER_HOUR_BINS_LENGTH;
+            while ((length > minLength) && (bufP[length - 1] == 0xFF))
+            {
+                length--;
+            }
+        }
+    }
+    else if (compact)
+    {
+        length = encodeCompactDailyLog(bufP, recordP);
+    }
+    else
+    {
+        memset(dpP, 0xFF, sizeof(dailyPacket_t));
+        memcpy(&dpP->packetHeader, &recordP->packetHeader, sizeof(packetHeader_t));
+        memcpy(&dpP->packetData.dailyLog, &recordP->logData.dailyLog, sizeof(dailyLog_t));
+        length = sizeof(dailyPacket_t);
+    }
+    return (length);
+}
+
+/**
+* \brief Assemble a bundle of the oldest ready daily logs.  The
+*        bundle is:
+* \li header with the MSG_TYPE_DAILY_LOG_BUNDLE message id and
+*     the current time (16 bytes)
+* \li number of daily logs in the bundle (1 byte)
+* \li for each daily log, oldest first, its length (1 byte)
+*     followed by the daily packet exactly as it is sent on its
+*     own (standard or compact format)
+* \brief A daily log is only added while the shared buffer still
+*        has room for its length byte and the longest daily log
+*        of the selected format, whatever the next log holds.
+*        Adding stops when no ready daily log is left or the
+*        session limit of countDailyLogTransmitted() is reached.
+*        The ready logs left over are sent in the next bundle.
+* 
+* @param bufP Buffer to assemble the bundle in
+* 
+* @return uint16_t Length of the bundle, zero if no daily log
+*         is waiting to be transmitted
+*/
+static uint16_t bundleDailyLogs(uint8_t *bufP)
+{
+    uint16_t maxDailyLogLength = sizeof(dailyPacket_t);
+    uint16_t length;
+    uint8_t *countP;
+    logRecord_t *recordP;
+
+    if (stData.dailyLogFormat & DAILY_LOG_FORMAT_COMPACT)
+    {
+        // The longest compact daily log is a quarter hour log with
+        // all of its bins, longer than any compact hourly log
+        maxDailyLogLength = sizeof(packetHeader_t) + sizeof(quarterHourLog_t);
+    }
+
+    length = storageMgr_prepareMsgHeader(bufP, MSG_TYPE_DAILY_LOG_BUNDLE);
+    countP = &bufP[length++];
+    *countP = 0;
+
+    while ((length + 1 + maxDailyLogLength) <= SHARED_BUFFER_SIZE)
+    {
+        recordP = findNextDailyLogToTransmit();
+        if ((recordP == NULL) || !countDailyLogTransmitted())
+        {
+            break;
+        }
+        bufP[length] = encodeDailyLog(&bufP[length + 1], recordP, stData.dailyLogFormat & DAILY_LOG_FORMAT_COMPACT);
+        length += 1 + bufP[length];
+        (*countP)++;
+        // Mark this daily log as being transmitted
+        markDailyLogAsTransmitted(recordP);
+    }
+
+    if (*countP == 0)
+    {
+        length = 0;
+    }
+    return (length);
+}
+
+/**
+* \brief Encode a daily log in the compact daily log format.
+*        The message is variable length, at most
+*        COMPACT_DAILY_LOG_MAX_LENGTH bytes:
+* \li header, same as the standard packet but with the
+*     MSG_TYPE_DAILY_LOG_COMPACT message id (16 bytes)
+* \li flags (1 byte): COMPACT_FLAG_RED_FLAG, the other bits are
+*     zero
+* \li totalLiters, averageLiters, errorBits (varint each)
+* \li hourly bins, hour 0 first (one varint token per run of
+*     zero hours or per non-zero hour).  A token with bit 0
+*     clear is a run of (token >> 1) zero hours.  A token with
+*     bit 0 set is a non-zero hour, (token >> 1) is the zigzag
+*     difference from the previous hour (hour 0 is compared to
+*     zero).
+* \brief A varint is 7 bits per byte, least significant group
+*        first, bit 7 set on all bytes but the last.  The
+*        reserved byte and the pad submerged counts are not
+*        sent, they are not recorded and always 0xFF.
+* 
+* @param bufP Buffer to encode the message in
+* @param recordP The daily log record to send
+* 
+* @return uint16_t Length of the encoded message
+*/
+static uint16_t encodeCompactDailyLog(uint8_t *bufP, const logRecord_t *recordP)
+{
+    const dailyLog_t *logP = &recordP->logData.dailyLog;
+    uint8_t *outP = bufP;
+    uint8_t flags = 0;
+    uint8_t zeroRun = 0;
+    uint16_t prevValue = 0;
+    uint16_t value;
+    uint8_t i;
+
+    memcpy(outP, &recordP->packetHeader, sizeof(packetHeader_t));
+    ((msgHeader_t *)outP)->payloadMsgId = MSG_TYPE_DAILY_LOG_COMPACT;
+    outP += sizeof(packetHeader_t);
+
+    if (logP->redFlag)
+    {
+        flags |= COMPACT_FLAG_RED_FLAG;
+    }
+    *outP++ = flags;
+
+    outP = putVarint(outP, getLogInt16(&logP->totalLiters));
+    outP = putVarint(outP, getLogInt16(&logP->averageLiters));
+    outP = putVarint(outP, getLogInt16(&logP->errorBits));
+
+    for (i = 0; i < TOTAL_HOURS_IN_A_DAY; i++)
+    {
+        value = getLogInt16(&logP->litersPerHour[i]);
+        if (value == 0)
+        {
+            zeroRun++;
+        }
+        else
+        {
+            if (zeroRun)
+            {
+                outP = putVarint(outP, (uint32_t)zeroRun << 1);
+                zeroRun = 0;
+            }
+            outP = putVarint(outP, (zigzagDelta(value, prevValue) << 1) | 1);
+        }
+        prevValue = value;
+    }
+    if (zeroRun)
+    {
+        outP = putVarint(outP, (uint32_t)zeroRun << 1);
+    }
+
+    return (outP - bufP);
+}
+
+/**
+* \brief Write a varint, 7 bits per byte, least significant
+*        group first.
+* 
+* @param bufP Where to write the varint
+* @param value The value to write
+* 
+* @return uint8_t* The byte after the varint
+*/
+static uint8_t* putVarint(uint8_t *bufP, uint32_t value)
+{
+    while (value > 0x7F)
+    {
+        *bufP++ = (value & 0x7F) | 0x80;
+        value >>= 7;
+    }
+    *bufP++ = value;
+    return (bufP);
+}
+
+/**
+* \brief Return the zigzag coded difference between two values,
+*        so that small negative differences stay small:
+*        0, -1, 1, -2 ... become 0, 1, 2, 3 ...
+* 
+* @param value The value
+* @param prevValue The value the difference is taken from
+* 
+* @return uint32_t The zigzag coded difference
+*/
+static uint32_t zigzagDelta(uint16_t value, uint16_t prevValue)
+{
+    uint32_t zigzag;
+
+    if (value >= prevValue)
+    {
+        zigzag = (uint32_t)(value - prevValue) << 1;
+    }
+    else
+    {
+        zigzag = ((uint32_t)(prevValue - value) << 1) - 1;
+    }
+    return (zigzag);
+}
+
+/**
+* \brief Determine if a checkpoint slot holds a valid checkpoint
+*        of the current layout.
+* 
+* @param checkpointP The checkpoint in flash
+* 
+* @return bool Returns true if the checkpoint is valid.
+*/
+static bool isCheckpointValid(const storageCheckpoint_t *checkpointP)
+{
+    bool valid = false;
+
+    if ((checkpointP->magic == STORAGE_CHECKPOINT_MAGIC) &&
+        (checkpointP->version == STORAGE_CHECKPOINT_VERSION) &&
+        (checkpointP->recordLength == sizeof(storageCheckpoint_t)))
+    {
+        uint16_t calcCrc = gen_crc16((const unsigned char *)checkpointP,
+                                     (sizeof(storageCheckpoint_t) - sizeof(uint16_t)));
+
+        valid = (calcCrc == checkpointP->crc16);
+    }
+    return (valid);
+}
+
+/**
+* \brief Find the slot holding the newest valid checkpoint.
+* 
+* @return uint8_t The slot number, or NO_CHECKPOINT_SLOT if no
+*         slot holds a valid checkpoint.
+*/
+static uint8_t findNewestCheckpoint(void)
+{
+    uint8_t i;
+    uint8_t newestSlot = NO_CHECKPOINT_SLOT;
+
+    for (i = 0; i < TOTAL_CHECKPOINT_SLOTS; i++)
+    {
+        const storageCheckpoint_t *checkpointP = &storageCheckpoints[i].checkpoint;
+
+        if (!isCheckpointValid(checkpointP))
+        {
+            continue;
+        }
+        // The difference handles the sequence number rolling over
+        if ((newestSlot == NO_CHECKPOINT_SLOT) ||
+            ((int16_t)(checkpointP->sequence - storageCheckpoints[newestSlot].checkpoint.sequence) > 0))
+        {
+            newestSlot = i;
+        }
+    }
+    return (newestSlot);
+}
+
+/**
+* \brief Restore the storage state from the newest valid 
+*        checkpoint.  The RTC restarts at boot and the storage
+*        clock follows it, so only the storage week and day are
+*        kept from the checkpoint.  The day total of the day
+*        being recorded is rebuilt from its log record by
+*        storageMgr_init().
+* 
+* @return bool Returns true if a checkpoint was restored.
+*/
+static bool restoreCheckpoint(void)
+{
+    uint8_t slot = findNewestCheckpoint();
+    const storageCheckpoint_t *checkpointP;
+    timePacket_t tp;
+
+    if (slot == NO_CHECKPOINT_SLOT)
+    {
+        return (false);
+    }
+    checkpointP = &storageCheckpoints[slot].checkpoint;
+
+    stData = checkpointP->stData;
+    xDaysSinceLastTimeSync = checkpointP->daysSinceLastTimeSync;
+    xDaysWithNoRtcTimeThisMonth = checkpointP->daysWithNoRtcTimeThisMonth;
+
+    getBinTime(&tp);
+    storageMgr_syncStorageTime(tp.second, tp.minute, tp.hour24);
+    stData.minuteMilliliterSum = 0;
+    stData.hourMilliliterSum = 0;
+    stData.dayMilliliterSum = 0;
+    return (true);
+}
+
+#if (DO_RED_FLAG_PROCESSING != 0)
+/**
+* @brief Monitor for a redFlag condition.
+* 
+* @return bool Returns true if a new red flag condition is 
+*         detected.
+*/
+static bool redFlagProcessing(int16_t dayLiterSum)
 {
 
     bool newRedFlagCondition = false;
@@ -1272,212 +2520,293 @@ static bool redFlagProcessing(int16_t dayLiterSum)
 
 
 /**
-*  \brief Utility function to get the address from the weekly
-*         log number.
+* \brief Utility function to get the address of a log record.
 * 
-* @param weeklyLogNum Weekly log number
+* @param segmentNum Which log segment
+* @param recordNum Which record of the segment
 * 
-* @return weeklyLog_t*  Returns a pointer to the weekly log 
-*         section.
+* @return logRecord_t* Returns a pointer to the log record
 */
-static weeklyLog_t* getWeeklyLogAddr(uint8_t weeklyLogNum)
+static logRecord_t* getLogRecordAddr(uint8_t segmentNum, uint8_t recordNum)
 {
-    const weeklyLog_t *wlP;
+    const logRecord_t *recordP;
 
-    if (weeklyLogNum < TOTAL_WEEKLY_LOGS)
+    if ((segmentNum < TOTAL_LOG_SEGMENTS) && (recordNum < RECORDS_PER_LOG_SEGMENT))
     {
-        wlP = weeklyLogAddrTable[weeklyLogNum];
+        recordP = &logSegments[segmentNum].log.records[recordNum];
     }
     else
     {
         sysError();
     }
-    return ((weeklyLog_t *)wlP);
+    return ((logRecord_t *)recordP);
 }
 
 /**
-* \brief Utility function to get the daily log address contained
-*        in the weekly log.
+* \brief   Utility function to increment to the next log 
+*          segment.  Handles rollover condition.
 * 
-* @param weeklyLogNum  Which weekly log container
-* @param dayOfTheWeek  Which day of the week.
+* @param segmentNum Current log segment number
 * 
-* @return dailyLog_t* Returns a pointer to the daily log
+* @return uint8_t Next sequential log segment number
 */
-static dailyLog_t* getDailyLogAddr(uint8_t weeklyLogNum, uint8_t dayOfTheWeek)
+static uint8_t getNextLogSegmentNum(uint8_t segmentNum)
 {
-    weeklyLog_t *wlP = getWeeklyLogAddr(weeklyLogNum);
-    dailyLog_t *dailyLogP = &wlP->dailyPackets[dayOfTheWeek].packetData.dailyLog;
+    uint8_t nextSegmentNum = segmentNum + 1;
 
-    return (dailyLogP);
+    if (nextSegmentNum >= TOTAL_LOG_SEGMENTS)
+    {
+        nextSegmentNum = 0;
+    }
+    return (nextSegmentNum);
 }
 
 /**
-* \brief   Utility function to get the address to the header 
-*          portion of a daily packet.
-* 
-* @param weeklyLogNum Which weekly log container to access
-* @param dayOfTheWeek Which day of the week
-* 
-* @return msgHeader_t*  Pointer to the packet header.
+* \brief Build the RAM index of the daily log region from the 
+*        segment headers and the record flags in flash.  The
+*        head is the segment with the highest sequence number.
+*        Segments without a valid header (erased, or written by
+*        an older firmware layout) are left out of the log and
+*        are erased when they are opened.
 */
-static msgHeader_t* getDailyHeaderAddr(uint8_t weeklyLogNum, uint8_t dayOfTheWeek)
+static void buildLogIndex(void)
 {
-    weeklyLog_t *wlP = getWeeklyLogAddr(weeklyLogNum);
-    msgHeader_t *msgHeaderP = &wlP->dailyPackets[dayOfTheWeek].packetHeader.msgHeader;
+    uint8_t i;
+    uint8_t r;
 
-    return (msgHeaderP);
+    logIndex.headSegment = NO_LOG_SEGMENT;
+    logIndex.nextSequence = 0;
+
+    for (i = 0; i < TOTAL_LOG_SEGMENTS; i++)
+    {
+        const logSegmentHeader_t *headerP = &logSegments[i].log.header;
+
+        logIndex.sequence[i] = LOG_SEQUENCE_ERASED;
+        logIndex.usedRecords[i] = 0;
+
+        if ((headerP->signature != LOG_SEGMENT_SIGNATURE) || (headerP->sequence == LOG_SEQUENCE_ERASED))
+        {
+            continue;
+        }
+        logIndex.sequence[i] = headerP->sequence;
+
+        // Records are given out in order, count up to the first unused one
+        for (r = 0; r < RECORDS_PER_LOG_SEGMENT; r++)
+        {
+            if (logSegments[i].log.records[r].clearOnOpen)
+            {
+                break;
+            }
+        }
+        logIndex.usedRecords[i] = r;
+
+        // The difference handles the sequence number rolling over
+        if ((logIndex.headSegment == NO_LOG_SEGMENT) ||
+            ((int16_t)(headerP->sequence - logIndex.sequence[logIndex.headSegment]) > 0))
+        {
+            logIndex.headSegment = i;
+        }
+    }
+
+    if (logIndex.headSegment != NO_LOG_SEGMENT)
+    {
+        logIndex.nextSequence = logIndex.sequence[logIndex.headSegment] + 1;
+        if (logIndex.nextSequence == LOG_SEQUENCE_ERASED)
+        {
+            logIndex.nextSequence = 0;
+        }
+    }
 }
 
 /**
-* \brief Utility function to get the address to a daily packet.
-* 
-* @param weeklyLogNum Which weekly log container to access
-* @param dayOfTheWeek Which day of the week
-* 
-* @return msgHeader_t*  Pointer to the packet.
+* \brief Advance the head to the next log segment (rollover if
+*        required).  The segment is erased unless it is already
+*        erased, then the segment header is written.  The next
+*        segment is always the oldest one, so the logs it holds
+*        are the ones dropped when the region is full.
 */
-static dailyPacket_t* getDailyPacketAddr(uint8_t weeklyLogNum, uint8_t dayOfTheWeek)
+static void openNextLogSegment(void)
 {
-    weeklyLog_t *wlP = getWeeklyLogAddr(weeklyLogNum);
-    dailyPacket_t *dailyPacketP = &wlP->dailyPackets[dayOfTheWeek];
+    uint8_t segmentNum = 0;
+    uint16_t i;
+    logSegmentHeader_t header;
+    const uint8_t *bytesP;
 
-    return (dailyPacketP);
+    if (logIndex.headSegment != NO_LOG_SEGMENT)
+    {
+        segmentNum = getNextLogSegmentNum(logIndex.headSegment);
+    }
+
+    // Only erase the segment if something was written to it
+    bytesP = logSegments[segmentNum].bytes;
+    for (i = 0; i < FLASH_BLOCK_SIZE; i++)
+    {
+        if (bytesP[i] != 0xFF)
+        {
+            msp430Flash_erase_segment((uint8_t *)bytesP);
+            break;
+        }
+    }
+
+    header.signature = LOG_SEGMENT_SIGNATURE;
+    header.sequence = logIndex.nextSequence;
+    msp430Flash_write_bytes((uint8_t *)&logSegments[segmentNum].log.header, (uint8_t *)&header,
+                            sizeof(logSegmentHeader_t));
+
+    logIndex.sequence[segmentNum] = logIndex.nextSequence;
+    logIndex.usedRecords[segmentNum] = 0;
+    logIndex.headSegment = segmentNum;
+    logIndex.nextSequence++;
+    if (logIndex.nextSequence == LOG_SEQUENCE_ERASED)
+    {
+        logIndex.nextSequence = 0;
+    }
 }
 
 /**
-* \brief   Utility function to increment to the next weekly log.
-*          Handles rollover condition.
+* \brief Return the log record of the day being recorded.  The 
+*        first call of the day takes the next record of the head
+*        segment, opening a new segment if the head is full.  The
+*        record is marked if the day is kept in quarter hour bins
+*        and its packet header is written, so a reset during the
+*        day finds it again (see findOpenDailyLog()).
 * 
-* @param weeklyLogNum Current weekly log number
-* 
-* @return uint8_t Next sequential weekly log number
+* @return logRecord_t* Pointer to today's log record in flash
 */
-static uint8_t getNextWeeklyLogNum(uint8_t weeklyLogNum)
+static logRecord_t* getTodayLogRecord(void)
 {
-    uint8_t nextWeeklyLogNum = weeklyLogNum + 1;
+    // clearOnOpen and clearForQuarterHour
+    uint8_t openVal[2] = { 0, 0xFF };
 
-    if (nextWeeklyLogNum >= TOTAL_WEEKLY_LOGS)
+    if (todayRecordP == NULL)
     {
-        nextWeeklyLogNum = 0;
+        if ((logIndex.headSegment == NO_LOG_SEGMENT) ||
+            (logIndex.usedRecords[logIndex.headSegment] >= RECORDS_PER_LOG_SEGMENT))
+        {
+            openNextLogSegment();
+        }
+        todayRecordP = getLogRecordAddr(logIndex.headSegment, logIndex.usedRecords[logIndex.headSegment]);
+        logIndex.usedRecords[logIndex.headSegment]++;
+        if (quarterHourDay)
+        {
+            openVal[1] = 0;
+        }
+        msp430Flash_write_bytes(&todayRecordP->clearOnOpen, openVal, sizeof(openVal));
+        writeDailyLogHeader(todayRecordP);
+        memset(&qhCoder, 0, sizeof(quarterHourCoder_t));
     }
-    return (nextWeeklyLogNum);
+    return (todayRecordP);
 }
 
 /**
-* \brief Erase the weekly log container (in flash).
+* \brief Find the log record left open by a reset during the day.
+*        It is the newest record given out, not yet marked ready,
+*        with the days activated of today in its packet header.
 * 
-* @param weeklyLogNum  The weekly log number.
+* @return logRecord_t* The open log record, or NULL if today's
+*         log has not been started
 */
-static void eraseWeeklyLog(uint8_t weeklyLogNum)
+static logRecord_t* findOpenDailyLog(void)
 {
-    uint8_t *addr = (uint8_t *)getWeeklyLogAddr(weeklyLogNum);
+    uint8_t segmentNum = logIndex.headSegment;
+    logRecord_t *recordP;
 
-    msp430Flash_erase_segment(addr);
-    msp430Flash_erase_segment(addr + FLASH_BLOCK_SIZE);
+    if ((segmentNum == NO_LOG_SEGMENT) || (logIndex.usedRecords[segmentNum] == 0))
+    {
+        return (NULL);
+    }
+    recordP = getLogRecordAddr(segmentNum, logIndex.usedRecords[segmentNum] - 1);
+    if (isDailyLogReady(recordP) || (getLogDayIndex(recordP) != stData.daysActivated))
+    {
+        return (NULL);
+    }
+    return (recordP);
 }
 
 /**
-* \brief Advance to the next weekly log container (rollover if 
-*        required).  Erase the identified weekly log container.
+* \brief Start today's log record at the beginning of the day,
+*        unless it is already open.
 */
-static void prepareNextWeeklyLog(void)
+static void prepareDailyLog(void)
 {
-    volatile uint8_t curWeeklyLogNum = stData.curWeeklyLogNum;
-    volatile uint8_t nextWeeklyLogNum = getNextWeeklyLogNum(curWeeklyLogNum);
-
-    stData.curWeeklyLogNum = nextWeeklyLogNum;
-    eraseWeeklyLog(nextWeeklyLogNum);
+    getTodayLogRecord();
 }
 
 /**
-* \brief Update the packet header portion of the daily log based
-*        on beginning-of-day info.
+* \brief Write the packet header portion of a daily log based on
+*        beginning-of-day info.
+* 
+* @param recordP The log record being opened
 */
-static void prepareDailyLog(void)
+static void writeDailyLogHeader(logRecord_t *recordP)
 {
-    msgHeader_t *msgHeaderP = getDailyHeaderAddr(stData.curWeeklyLogNum, stData.storageTime_dayOfWeek);
+    msgHeader_t header;
     timePacket_t tp;
-    uint8_t temp8;
 
     // Get current time
     getBinTime(&tp);
 
+    // Build the header in RAM and write it to flash in one pass
+
     // Payload start byte
-    temp8 = 0x1;
-    msp430Flash_write_bytes((uint8_t *)&(msgHeaderP->payloadStartByte), &temp8, FLASH_WRITE_ONE_BYTE);
+    header.payloadStartByte = 0x1;
 
     // Payload Message Type
-    temp8 = MSG_TYPE_DAILY_LOG;
-    msp430Flash_write_bytes((uint8_t *)&(msgHeaderP->payloadMsgId), &temp8, FLASH_WRITE_ONE_BYTE);
+    header.payloadMsgId = MSG_TYPE_DAILY_LOG;
 
     // Product ID
-    temp8 = AFRIDEV2_PRODUCT_ID;
-    msp430Flash_write_bytes((uint8_t *)&(msgHeaderP->productId), &temp8, FLASH_WRITE_ONE_BYTE);
+    header.productId = AFRIDEV2_PRODUCT_ID;
 
     // Time
-    temp8 = 0;
-    msp430Flash_write_bytes((uint8_t *)&(msgHeaderP->GMTsecond), &temp8, FLASH_WRITE_ONE_BYTE);
-    msp430Flash_write_bytes((uint8_t *)&(msgHeaderP->GMTminute), &temp8, FLASH_WRITE_ONE_BYTE);
-    msp430Flash_write_bytes((uint8_t *)&(msgHeaderP->GMThour), &temp8, FLASH_WRITE_ONE_BYTE);
-    msp430Flash_write_bytes((uint8_t *)&(msgHeaderP->GMTday), &tp.day, FLASH_WRITE_ONE_BYTE);
-    msp430Flash_write_bytes((uint8_t *)&(msgHeaderP->GMTmonth), &tp.month, FLASH_WRITE_ONE_BYTE);
-    msp430Flash_write_bytes((uint8_t *)&(msgHeaderP->GMTyear), &tp.year, FLASH_WRITE_ONE_BYTE);
+    header.GMTsecond = 0;
+    header.GMTminute = 0;
+    header.GMThour = 0;
+    header.GMTday = tp.day;
+    header.GMTmonth = tp.month;
+    header.GMTyear = tp.year;
 
     // FW Version
-    temp8 = FW_VERSION_MAJOR;
-    msp430Flash_write_bytes((uint8_t *)&(msgHeaderP->fwMajor), &temp8, FLASH_WRITE_ONE_BYTE);
-    temp8 = FW_VERSION_MINOR;
-    msp430Flash_write_bytes((uint8_t *)&(msgHeaderP->fwMinor), &temp8, FLASH_WRITE_ONE_BYTE);
+    header.fwMajor = FW_VERSION_MAJOR;
+    header.fwMinor = FW_VERSION_MINOR;
 
     // Days Activated
-    msp430Flash_write_int16((uint8_t *)&(msgHeaderP->daysActivatedMsb), stData.daysActivated);
+    header.daysActivatedMsb = stData.daysActivated >> 8;
+    header.daysActivatedLsb = stData.daysActivated & 0xFF;
 
     // Storage Week Number
-    temp8 = stData.storageTime_week;
-    msp430Flash_write_bytes((uint8_t *)&(msgHeaderP->storageWeek), &temp8, FLASH_WRITE_ONE_BYTE);
+    header.storageWeek = stData.storageTime_week;
 
     // Storage day of the week
-    temp8 = stData.storageTime_dayOfWeek;
-    msp430Flash_write_bytes((uint8_t *)&(msgHeaderP->storageDay), &temp8, FLASH_WRITE_ONE_BYTE);
+    header.storageDay = stData.storageTime_dayOfWeek;
 
     // Unused
-    temp8 = 0xA5;
-    msp430Flash_write_bytes((uint8_t *)&(msgHeaderP->reserve1), &temp8, FLASH_WRITE_ONE_BYTE);
+    header.reserve1 = 0xA5;
+
+    msp430Flash_write_bytes((uint8_t *)&recordP->packetHeader, (uint8_t *)&header, sizeof(msgHeader_t));
 }
 
 /**
 * \brief Updates the record for tracking that a daily log is
 *        ready for transmit.
 * 
-* @param dayOfTheWeek The day of the week to record
-* @param weeklyLogNum The weekly log container to use
+* @param recordP The log record of the day
 */
-static void markDailyLogAsReady(uint8_t dayOfTheWeek, uint8_t weeklyLogNum)
+static void markDailyLogAsReady(logRecord_t *recordP)
 {
     uint8_t zeroVal = 0;
-    weeklyLog_t *wlP = getWeeklyLogAddr(weeklyLogNum);
 
-    if (dayOfTheWeek >= TOTAL_DAYS_IN_A_WEEK)
-    {
-        return;
-    }
-    uint8_t *entryP = &(wlP->clearOnReady[dayOfTheWeek]);
-
-    msp430Flash_write_bytes(entryP, &zeroVal, FLASH_WRITE_ONE_BYTE);
+    msp430Flash_write_bytes(&recordP->clearOnReady, &zeroVal, FLASH_WRITE_ONE_BYTE);
 }
 
 /**
 * \brief Utility function to check if a daily log is ready for
 *        transmit.
 * 
-* @param dayOfTheWeek The day of the week to record
-* @param weeklyLogNum The weekly log container to use
+* @param recordP The log record to check
 */
-static bool isDailyLogReady(uint8_t dayOfTheWeek, uint8_t weeklyLogNum)
+static bool isDailyLogReady(const logRecord_t *recordP)
 {
-    weeklyLog_t *wlP = getWeeklyLogAddr(weeklyLogNum);
-    bool isReady = !wlP->clearOnReady[dayOfTheWeek];
+    bool isReady = !recordP->clearOnReady;
 
     return (isReady);
 }
@@ -1486,35 +2815,25 @@ static bool isDailyLogReady(uint8_t dayOfTheWeek, uint8_t weeklyLogNum)
 * \brief Updates the record for tracking that a daily log has 
 *        been transmitted.
 * 
-* @param dayOfTheWeek The day of the week to record
-* @param weeklyLogNum The weekly log container to use
+* @param recordP The log record of the day
 */
-static void markDailyLogAsTransmitted(uint8_t dayOfTheWeek, uint8_t weeklyLogNum)
+static void markDailyLogAsTransmitted(logRecord_t *recordP)
 {
     uint8_t zeroVal = 0;
-    weeklyLog_t *wlP = getWeeklyLogAddr(weeklyLogNum);
-    uint8_t *entryP = (uint8_t *)&(wlP->clearOnTransmit[dayOfTheWeek]);
 
-    if (dayOfTheWeek >= TOTAL_DAYS_IN_A_WEEK)
-    {
-        return;
-    }
-    msp430Flash_write_bytes(entryP, &zeroVal, FLASH_WRITE_ONE_BYTE);
+    msp430Flash_write_bytes(&recordP->clearOnTransmit, &zeroVal, FLASH_WRITE_ONE_BYTE);
 }
 
 /**
 * \brief Utility function to check if a daily log has been 
 *        transmitted.
 * 
-* @param dayOfTheWeek The day of the week to record
-* @param weeklyLogNum The weekly log container to use
+* @param recordP The log record to check
 */
-static bool wasDailyLogTransmitted(uint8_t dayOfTheWeek, uint8_t weeklyLogNum)
+static bool wasDailyLogTransmitted(const logRecord_t *recordP)
 {
-    weeklyLog_t *wlP = getWeeklyLogAddr(weeklyLogNum);
-
     // If zero, it means we transmitted packet.
-    return (wlP->clearOnTransmit[dayOfTheWeek] ? false : true);
+    return (recordP->clearOnTransmit ? false : true);
 }
 
 #ifdef SEND_DEBUG_TIME_DATA
@@ -52,11 +52,16 @@
 
 #ifdef RO_PINOSC_TA1_TB0
 
+// Per pad gate shift, loaded from the manufacturing record by waterSense.
+// Zero measures the pad for the full accumulationCycles of its sensor.
+uint8_t padGateShift[TOTAL_NUMBER_OF_ELEMENTS];
+
 // First Element (P4.7)
 const struct Element pad0 = {
 
     .inputPxselRegister = (unsigned char *)&P4SEL,
     .inputPxsel2Register = (unsigned char *)&P4SEL2,
+    .accumulationShift = &padGateShift[0],
     .inputBits = BIT7,
     .threshold = 80
 };
@@ -67,6 +72,7 @@ const struct Element pad1 = {
 
     .inputPxselRegister = (unsigned char *)&P2SEL,
     .inputPxsel2Register = (unsigned char *)&P2SEL2,
+    .accumulationShift = &padGateShift[1],
     .inputBits = BIT1,
     .threshold = 80
 };
@@ -77,6 +83,7 @@ const struct Element pad2 = {
 
     .inputPxselRegister = (unsigned char *)&P4SEL,
     .inputPxsel2Register = (unsigned char *)&P4SEL2,
+    .accumulationShift = &padGateShift[2],
     .inputBits = BIT6,
     .threshold = 80
 };
@@ -86,6 +93,7 @@ const struct Element pad3 = {
 
     .inputPxselRegister = (unsigned char *)&P2SEL,
     .inputPxsel2Register = (unsigned char *)&P2SEL2,
+    .accumulationShift = &padGateShift[3],
     .inputBits = BIT2,
     .threshold = 80
 };
@@ -96,6 +104,7 @@ const struct Element pad4 = {
 
     .inputPxselRegister = (unsigned char *)&P4SEL,
     .inputPxsel2Register = (unsigned char *)&P4SEL2,
+    .accumulationShift = &padGateShift[4],
     .inputBits = BIT5,
     .threshold = 80
 };
@@ -105,6 +114,7 @@ const struct Element pad5 = {
 
     .inputPxselRegister = (unsigned char *)&P3SEL,
     .inputPxsel2Register = (unsigned char *)&P3SEL2,
+    .accumulationShift = &padGateShift[5],
     .inputBits = BIT0,
     .threshold = 80
 };
@@ -132,5 +142,22 @@ const struct Sensor pad_sensors =
     .accumulationCycles = 512                              //  Count for 512 cycles (at 32768HZ) = 15.625ms
 };
 
+// Presence pads only (pad3, pad4, pad5).  These are the only pads the
+// algorithm looks at while it is waiting for water to arrive.
+const struct Sensor pad_presence_sensors =
+{
+    .halDefinition = RO_PINOSC_TA1_TB0,
+    .numElements = 3,
+    .baseOffset = 3,
+    // Pointer to elements
+    .arrayPtr[0] = &pad3,                                  // point to pad3
+    .arrayPtr[1] = &pad4,
+    .arrayPtr[2] = &pad5,
+    // Timer Information
+    .sourceScale = TIMER_SOURCE_DIV_0,                     //  No divider
+    .measGateSource = TIMER_ACLK,                          //  0->SMCLK, 1-> ACLK
+    .accumulationCycles = 512                              //  Count for 512 cycles (at 32768HZ) = 15.625ms
+};
+
 #endif
 
@@ -66,6 +66,9 @@ extern const struct Element pad4;
 extern const struct Element pad5;
 
 extern const struct Sensor pad_sensors;
+extern const struct Sensor pad_presence_sensors;
+
+extern uint8_t padGateShift[];
 
 //****** RAM ALLOCATION ********************************************************
 // TOTAL_NUMBER_OF_ELEMENTS represents the total number of elements used, even if
@@ -415,6 +418,9 @@ struct Element
     // when using the PinOsc method
     uint8_t *inputPxselRegister;                           // PinOsc: port selection address
     uint8_t *inputPxsel2Register;                          // PinOsc: port selection 2 address
+    const uint8_t *accumulationShift;                      // PinOsc: gate time of this element is
+                                                           // accumulationCycles >> *accumulationShift,
+                                                           // NULL uses accumulationCycles
 #endif
 
 #ifdef RC_PAIR_TYPE
@@ -112,6 +112,9 @@ void sysExec_exec(void)
     // Set how long to wait until first startup message should be transmitted
     sysExecData.secondsTillStartUpMsgTx = START_UP_MSG_TX_DELAY_IN_SECONDS;
 
+    // Set how long the pump must be dry before the pads are only probed
+    sysExecData.dry_wake_time = DRY_WAKE_TIME_DEFAULT;
+
     // Initialize the date for Jan 1, 2018
     // h, m, s, am/pm (must be in BCD)
     setTime(0x00, 0x00, 0x00, 0x00);
@@ -134,6 +137,7 @@ void sysExec_exec(void)
 #else
     dbg_uart_init();
 #endif
+    manufRecord_init();
     waterSense_init();
     storageMgr_init();
 
@@ -180,18 +184,21 @@ void sysExec_exec(void)
         // Restart the one-second watchdog timeout
         WATCHDOG_TICKLE();
 
-        // Don't take a measurement if the modem or GPS is in use
-#ifndef WATER_DEBUG
-        if (!modemMgr_isAllocated() && !gps_isActive())
-#else
-        if (!gps_isActive())
-#endif
-        {
-            //take cap sense reading
-            waterSense_takeReading();
+        // Measurements continue while the modem or GPS is in use,
+        // waterSense drops the readings disturbed by them
+        //take cap sense reading
+        waterSense_takeReading();
+
+        //Run algorithm nest
+        APP_ALGO_runNest();
 
-            //Run algorithm nest
-            APP_ALGO_runNest();
+        // Run one bounded step of any flash erase or write in progress
+        msp430Flash_poll();
+
+        // Any sign of water returns the pads to the full sample rate
+        if (APP_ALGO_needsAllPads() || APP_ALGO_isFrontCandidate())
+        {
+            sysExecData.dry_count = 0;
         }
 
         // Increment main loop counter
@@ -203,6 +210,12 @@ void sysExec_exec(void)
         {
             exec_main_loop_counter = 0;
 
+            // Count the trends with no water, see waterSense_isProbing()
+            if (sysExecData.dry_count < UINT16_MAX)
+            {
+                sysExecData.dry_count++;
+            }
+
             // Record the water stats and initiate periodic communication if it is time to do so
             storageMgr_exec();
 
@@ -561,6 +574,10 @@ static void sysExec_doReboot(void)
         disableGlobalInterrupt();
         // Modem should already be off, but just for safety, turn it off
         modemPower_powerDownModem();
+        // Let the algorithm resume where it left off after the reboot
+        APP_ALGO_saveCheckpoint();
+        // Keep the red flag mapping, activation and transmission state
+        storageMgr_saveCheckpoint();
         while (1)
         {
             // Force watchdog reset
@@ -26,73 +26,158 @@
 
 /**
  * \def CRC16
- * \brief The CRC-16-ANSI polynomial constant.
+ * \brief The CRC-16-ANSI polynomial constant.  The CRC is
+ *        calculated bit reversed (CRC-16/ARC: reversed 0x8005,
+ *        initial value 0, no final xor), the same as crcmod
+ *        mkCrcFun(0x18005, rev=True) in afridevV2RomToMsg.py.
  */
 #define CRC16 0x8005
 
 /**
-* \brief Utility function to calculate a 16 bit CRC on data in a
-*        buffer.
+ * \def CRC16_BYTE_TABLE
+ * \brief Set to 1 to use a 256 entry table (512 bytes of flash,
+ *        one lookup per byte).  Set to 0 to use a 16 entry
+ *        table (32 bytes of flash, two lookups per byte).
+ */
+#define CRC16_BYTE_TABLE 1
+
+/**
+ * \def CRC16_WATCHDOG_BYTES
+ * \brief Number of bytes between watchdog tickles.  Must be a
+ *        power of two.
+ */
+#define CRC16_WATCHDOG_BYTES ((uint16_t)64)
+
+#if (CRC16_BYTE_TABLE != 0)
+/**
+ * \var crc16Table
+ * \brief The bit reversed CRC16 of each byte value
+ */
+static const uint16_t crc16Table[256] = {
+    0x0000, 0xC0C1, 0xC181, 0x0140, 0xC301, 0x03C0, 0x0280, 0xC241,
+    0xC601, 0x06C0, 0x0780, 0xC741, 0x0500, 0xC5C1, 0xC481, 0x0440,
+    0xCC01, 0x0CC0, 0x0D80, 0xCD41, 0x0F00, 0xCFC1, 0xCE81, 0x0E40,
+    0x0A00, 0xCAC1, 0xCB81, 0x0B40, 0xC901, 0x09C0, 0x0880, 0xC841,
+    0xD801, 0x18C0, 0x1980, 0xD941, 0x1B00, 0xDBC1, 0xDA81, 0x1A40,
+    0x1E00, 0xDEC1, 0xDF81, 0x1F40, 0xDD01, 0x1DC0, 0x1C80, 0xDC41,
+    0x1400, 0xD4C1, 0xD581, 0x1540, 0xD701, 0x17C0, 0x1680, 0xD641,
+    0xD201, 0x12C0, 0x1380, 0xD341, 0x1100, 0xD1C1, 0xD081, 0x1040,
+    0xF001, 0x30C0, 0x3180, 0xF141, 0x3300, 0xF3C1, 0xF281, 0x3240,
+    0x3600, 0xF6C1, 0xF781, 0x3740, 0xF501, 0x35C0, 0x3480, 0xF441,
+    0x3C00, 0xFCC1, 0xFD81, 0x3D40, 0xFF01, 0x3FC0, 0x3E80, 0xFE41,
+    0xFA01, 0x3AC0, 0x3B80, 0xFB41, 0x3900, 0xF9C1, 0xF881, 0x3840,
+    0x2800, 0xE8C1, 0xE981, 0x2940, 0xEB01, 0x2BC0, 0x2A80, 0xEA41,
+    0xEE01, 0x2EC0, 0x2F80, 0xEF41, 0x2D00, 0xEDC1, 0xEC81, 0x2C40,
+    0xE401, 0x24C0, 0x2580, 0xE541, 0x2700, 0xE7C1, 0xE681, 0x2640,
+    0x2200, 0xE2C1, 0xE381, 0x2340, 0xE101, 0x21C0, 0x2080, 0xE041,
+    0xA001, 0x60C0, 0x6180, 0xA141, 0x6300, 0xA3C1, 0xA281, 0x6240,
+    0x6600, 0xA6C1, 0xA781, 0x6740, 0xA501, 0x65C0, 0x6480, 0xA441,
+    0x6C00, 0xACC1, 0xAD81, 0x6D40, 0xAF01, 0x6FC0, 0x6E80, 0xAE41,
+    0xAA01, 0x6AC0, 0x6B80, 0xAB41, 0x6900, 0xA9C1, 0xA881, 0x6840,
+    0x7800, 0xB8C1, 0xB981, 0x7940, 0xBB01, 0x7BC0, 0x7A80, 0xBA41,
+    0xBE01, 0x7EC0, 0x7F80, 0xBF41, 0x7D00, 0xBDC1, 0xBC81, 0x7C40,
+    0xB401, 0x74C0, 0x7580, 0xB541, 0x7700, 0xB7C1, 0xB681, 0x7640,
+    0x7200, 0xB2C1, 0xB381, 0x7340, 0xB101, 0x71C0, 0x7080, 0xB041,
+    0x5000, 0x90C1, 0x9181, 0x5140, 0x9301, 0x53C0, 0x5280, 0x9241,
+    0x9601, 0x56C0, 0x5780, 0x9741, 0x5500, 0x95C1, 0x9481, 0x5440,
+    0x9C01, 0x5CC0, 0x5D80, 0x9D41, 0x5F00, 0x9FC1, 0x9E81, 0x5E40,
+    0x5A00, 0x9AC1, 0x9B81, 0x5B40, 0x9901, 0x59C0, 0x5880, 0x9841,
+    0x8801, 0x48C0, 0x4980, 0x8941, 0x4B00, 0x8BC1, 0x8A81, 0x4A40,
+    0x4E00, 0x8EC1, 0x8F81, 0x4F40, 0x8D01, 0x4DC0, 0x4C80, 0x8C41,
+    0x4400, 0x84C1, 0x8581, 0x4540, 0x8701, 0x47C0, 0x4680, 0x8641,
+    0x8201, 0x42C0, 0x4380, 0x8341, 0x4100, 0x81C1, 0x8081, 0x4040
+};
+#else
+/**
+ * \var crc16Table
+ * \brief The bit reversed CRC16 of each nibble value
+ */
+static const uint16_t crc16Table[16] = {
+    0x0000, 0xCC01, 0xD801, 0x1400, 0xF001, 0x3C00, 0x2800, 0xE401,
+    0xA001, 0x6C00, 0x7800, 0xB401, 0x5000, 0x9C01, 0x8801, 0x4400
+};
+#endif
+
+/**
+* \brief Return the starting value of an incremental CRC16.
+*        Update it with crc16_update() and get the CRC with
+*        crc16_final().
+* 
+* \ingroup PUBLIC_API
+* 
+* @return uint16_t The starting CRC value
+*/
+uint16_t crc16_init(void)
+{
+    return (0);
+}
+
+/**
+* \brief Add data to an incremental CRC16.  The data can be
+*        added in as many parts as needed.
 * 
 * \ingroup PUBLIC_API
 * 
+* @param crc The CRC value returned by crc16_init() or the
+*            last crc16_update()
 * @param data Pointer to the data buffer to calculate the CRC
 *             over
 * @param size Length of the data in bytes to calculate over.
 * 
-* @return unsigned int The CRC calculated value
+* @return uint16_t The updated CRC value
 */
-unsigned int gen_crc16(const unsigned char *data, unsigned int size)
+uint16_t crc16_update(uint16_t crc, const uint8_t *data, uint16_t size)
 {
-    volatile unsigned int out = 0;
-    volatile int bits_read = 0;
-    volatile int bit_flag;
-
     while (size > 0)
     {
-        bit_flag = out >> 15;
-        /* Get next bit: */
-        out <<= 1;
-        out |= (*data >> bits_read) & 1;                   // item a) work from the least significant bits
-        /* Increment bit counter: */
-        bits_read++;
-        if (bits_read > 7)
+#if (CRC16_BYTE_TABLE != 0)
+        crc = (crc >> 8) ^ crc16Table[(crc ^ *data) & 0xFF];
+#else
+        crc = (crc >> 4) ^ crc16Table[(crc ^ *data) & 0x0F];
+        crc = (crc >> 4) ^ crc16Table[(crc ^ (*data >> 4)) & 0x0F];
+#endif
+        data++;
+        size--;
+        if ((size & (CRC16_WATCHDOG_BYTES - 1)) == 0)
         {
-            bits_read = 0;
-            data++;
-            size--;
             WATCHDOG_TICKLE();
         }
-        /* Cycle check: */
-        if (bit_flag)
-            out ^= CRC16;
-    }
-
-    // item b) "push out" the last 16 bits
-    unsigned int i;
-
-    for (i = 0; i < 16; ++i)
-    {
-        bit_flag = out >> 15;
-        out <<= 1;
-        if (bit_flag)
-            out ^= CRC16;
     }
+    return (crc);
+}
 
-    // item c) reverse the bits
-    unsigned int crc = 0;
-
-    i = 0x8000;
-    unsigned int j = 0x0001;
-
-    for (; i != 0; i >>= 1, j <<= 1)
-    {
-        if (i & out)
-            crc |= j;
-    }
+/**
+* \brief Return the CRC16 of the data added to an incremental
+*        CRC16.
+* 
+* \ingroup PUBLIC_API
+* 
+* @param crc The CRC value returned by the last crc16_update()
+* 
+* @return uint16_t The CRC calculated value
+*/
+uint16_t crc16_final(uint16_t crc)
+{
     return (crc);
 }
 
+/**
+* \brief Utility function to calculate a 16 bit CRC on data in a
+*        buffer.
+* 
+* \ingroup PUBLIC_API
+* 
+* @param data Pointer to the data buffer to calculate the CRC
+*             over
+* @param size Length of the data in bytes to calculate over.
+* 
+* @return unsigned int The CRC calculated value
+*/
+unsigned int gen_crc16(const unsigned char *data, unsigned int size)
+{
+    return (crc16_final(crc16_update(crc16_init(), data, size)));
+}
+
 /**
 * \brief Utility function to calculate a 16 bit CRC on data 
 *        located in two buffers. The first buffer is most likely
@@ -110,75 +195,11 @@ unsigned int gen_crc16(const unsigned char *data, unsigned int size)
 */
 unsigned int gen_crc16_2buf(const unsigned char *data1, unsigned int size1, const unsigned char *data2, unsigned int size2)
 {
-    volatile unsigned int out = 0;
-    volatile int bits_read = 0;
-    volatile int bit_flag;
-
-    while (size1 > 0)
-    {
-        bit_flag = out >> 15;
-        /* Get next bit: */
-        out <<= 1;
-        out |= (*data1 >> bits_read) & 1;                  // item a) work from the least significant bits
-        /* Increment bit counter: */
-        bits_read++;
-        if (bits_read > 7)
-        {
-            bits_read = 0;
-            data1++;
-            size1--;
-            WATCHDOG_TICKLE();
-        }
-        /* Cycle check: */
-        if (bit_flag)
-            out ^= CRC16;
-    }
-
-    while (size2 > 0)
-    {
-        bit_flag = out >> 15;
-
-        /* Get next bit: */
-        out <<= 1;
-        out |= (*data2 >> bits_read) & 1;                  // item a) work from the least significant bits
-
-        /* Increment bit counter: */
-        bits_read++;
-        if (bits_read > 7)
-        {
-            bits_read = 0;
-            data2++;
-            size2--;
-            WATCHDOG_TICKLE();
-        }
-        /* Cycle check: */
-        if (bit_flag)
-            out ^= CRC16;
-    }
-
-    // item b) "push out" the last 16 bits
-    unsigned int i;
-
-    for (i = 0; i < 16; ++i)
-    {
-        bit_flag = out >> 15;
-        out <<= 1;
-        if (bit_flag)
-            out ^= CRC16;
-    }
+    uint16_t crc = crc16_init();
 
-    // item c) reverse the bits
-    unsigned int crc = 0;
-
-    i = 0x8000;
-    unsigned int j = 0x0001;
-
-    for (; i != 0; i >>= 1, j <<= 1)
-    {
-        if (i & out)
-            crc |= j;
-    }
-    return (crc);
+    crc = crc16_update(crc, data1, size1);
+    crc = crc16_update(crc, data2, size2);
+    return (crc16_final(crc));
 }
 
 /**
@@ -23,62 +23,178 @@
  */
 
 /* Algorithm Includes */
-#include "algo-c-code/calculateWaterVolume/calculateWaterVolume.h"
-#include "algo-c-code/clearPadWindowProcess/clearPadWindowProcess.h"
-#include "algo-c-code/hourlyWaterVolume/hourlyWaterVolume.h"
 #include "algo-c-code/initializeWaterAlgorithm/initializeWaterAlgorithm.h"
-#include "algo-c-code/initializeWindows/initializeWindows.h"
-#include "algo-c-code/waterPadFiltering/waterPadFiltering.h"
-#include "algo-c-code/writePadSample/writePadSample.h"
 
 #include "../waterDetect.h"
 #include "../outpour.h"
 #include "appAlgo.h"
+#include "waterPadAverage.h"
+#include "waterVolumeStream.h"
 
-#define MAX_RETURNED_REASON_CODES       4
+/**
+ * \typedef appAlgoState_t
+ * \brief Everything the algorithm carries from one sample to the
+ *        next.  Restoring it lets detection continue on the next
+ *        sample instead of after the 60 sample warm-up.
+ */
+typedef struct appAlgoState_s {
+    uint16_t seal;                                         /**< APP_ALGO_SEAL when the state is complete */
+    padHistory_t padHistory;                               /**< sample history and window bookkeeping */
+    padAverage_t padAverage;                               /**< pad filter */
+    waterAlgoData_t waterAlgoData;                         /**< detector and volume state */
+} appAlgoState_t;
+
+/**
+ * \typedef appAlgoCheckpoint_t
+ * \brief Flash copy of the algorithm state, written before a planned
+ *        reboot.  Must fit in one 512 byte flash segment.
+ */
+typedef struct appAlgoCheckpoint_s {
+    uint16_t version;                                      /**< APP_ALGO_STATE_VERSION of state */
+    appAlgoState_t state;                                  /**< the algorithm state */
+    uint16_t crc16;                                        /**< crc16 of state */
+} appAlgoCheckpoint_t;
+
+/**
+ * \def APP_ALGO_STATE_VERSION
+ * \brief Layout version of appAlgoState_t and of the structures in
+ *        it.  Bump it on any change to their fields, their order or
+ *        their meaning, so state left by other firmware is not used.
+ *        At most 15.
+ */
+#define APP_ALGO_STATE_VERSION 1
+
+/**
+ * \def APP_ALGO_SEAL
+ * \brief Marks a complete state.  Includes the layout version, and
+ *        the state size in case a change missed the version.
+ */
+#define APP_ALGO_SEAL ((uint16_t)(0xA150 ^ ((uint16_t)APP_ALGO_STATE_VERSION << 12) ^ sizeof(appAlgoState_t)))
+
+/**
+ * \def APP_ALGO_COLD_RESETS
+ * \brief IFG1 flags of the resets after which RAM can not be trusted.
+ *        A brown out or a short power loss can leave RAM looking
+ *        intact.
+ */
+#define APP_ALGO_COLD_RESETS (PORIFG | RSTIFG)
+
+// The state lives in RAM that the C startup does not clear, so it
+// survives a watchdog or software reset as well as low power mode.
+// ALGO_STATE in the linker files is left out of the bootloader's RAM.
+#pragma DATA_SECTION(algoState, ".algoState")
+static appAlgoState_t algoState;
+
+// Checkpoint written before a planned reboot, in its own flash segment
+#pragma DATA_SECTION(algoCheckpoint, ".algoCheckpoint")
+const appAlgoCheckpoint_t algoCheckpoint;
 
-static padWindows_t padWindow;
 static padSample_t currentPadSample;
-static waterAlgoData_t waterAlgoData;
-static padFilteringData_t padFilterData;
 static uint16_t algoErrorBits = 0u;
 static uint16_t tempErrorBits = 0u;
 
 static void xGetLatestSamples(void);
 static void xWaterpadProcess(void);
 static void xHandleError(ReasonCodes reason);
+static bool xStateIsUsable(const appAlgoState_t *stateP);
+static bool xSumsMatchSamples(const padAverage_t *averageP);
+static bool xCheckpointIsValid(void);
 
 void APP_ALGO_init(void)
 {
-    initializeWindows( &padWindow );
-    initializeWaterAlgorithm( &waterAlgoData, &padFilterData );
+    // The generated filter buffers are not used, only the algorithm
+    // data is kept from initializeWaterAlgorithm().
+    padFilteringData_t unusedFilterData;
+    bool checkpointIsValid = xCheckpointIsValid();
+    uint8_t resetFlags = getLastRebootReason();
+
+    // Warm restart: keep the state left in RAM after a watchdog reset,
+    // or take the one saved before a planned reboot if RAM was lost.
+    // The flags are zero under a bootloader that does not hand them
+    // over, RAM is not used then.
+    if (!(resetFlags & WDTIFG) ||
+        (resetFlags & APP_ALGO_COLD_RESETS) ||
+        !xStateIsUsable( &algoState ) ||
+        !xSumsMatchSamples( &algoState.padAverage ))
+    {
+        if (checkpointIsValid)
+        {
+            algoState = algoCheckpoint.state;
+        }
+        else
+        {
+            waterVolumeStream_initHistory( &algoState.padHistory );
+            waterPadAverage_init( &algoState.padAverage );
+            initializeWaterAlgorithm( &algoState.waterAlgoData, &unusedFilterData );
+            algoState.seal = APP_ALGO_SEAL;
+        }
+    }
+
+    // A checkpoint is only used once, a later power loss must not
+    // bring back old state.
+    if (checkpointIsValid)
+    {
+        msp430Flash_erase_segment( (uint8_t *)&algoCheckpoint );
+    }
 }
 
 void APP_ALGO_runNest(void)
 {
+    // A reset before the seal is restored leaves the state unusable
+    algoState.seal = 0;
+
     xGetLatestSamples();
 
-    waterPadFiltering( &currentPadSample, &padFilterData, &currentPadSample );
-    writePadSample( &padWindow,  &currentPadSample );
+    waterPadAverage_filter( &algoState.padAverage, &currentPadSample, &currentPadSample );
+    waterVolumeStream_writeSample( &algoState.padHistory, &currentPadSample );
 
-    if (padWindow.process)
+    // The volume is computed one sample at a time, so a completed
+    // window only needs its process flag cleared.
+    xWaterpadProcess();
+
+    if (algoState.padHistory.process)
     {
-       xWaterpadProcess();
+       waterVolumeStream_clearProcess( &algoState.padHistory );
     }
+
+    algoState.seal = APP_ALGO_SEAL;
+}
+
+// Call before a planned reboot, with interrupts disabled
+void APP_ALGO_saveCheckpoint(void)
+{
+    uint16_t version = APP_ALGO_STATE_VERSION;
+    uint16_t crc16 = gen_crc16( (const unsigned char *)&algoState, sizeof(appAlgoState_t) );
+
+    msp430Flash_erase_segment( (uint8_t *)&algoCheckpoint );
+    msp430Flash_write_bytes( (uint8_t *)&algoCheckpoint.version, (uint8_t *)&version, sizeof(uint16_t) );
+    msp430Flash_write_bytes( (uint8_t *)&algoCheckpoint.state, (uint8_t *)&algoState, sizeof(appAlgoState_t) );
+    msp430Flash_write_bytes( (uint8_t *)&algoCheckpoint.crc16, (uint8_t *)&crc16, sizeof(uint16_t) );
 }
 
 bool APP_ALGO_isWaterPresent(void)
 {
-    return waterAlgoData.present;
+    return algoState.waterAlgoData.present;
+}
+
+// While waiting for water to arrive only pads 3, 4 and 5 are used
+bool APP_ALGO_needsAllPads(void)
+{
+    return (algoState.waterAlgoData.algo_state != b_water_present);
+}
+
+// Early sign of a water front, used to leave the low rate probe mode
+bool APP_ALGO_isFrontCandidate(void)
+{
+    return waterVolumeStream_isFrontCandidate( &algoState.padHistory );
 }
 
 uint32_t APP_ALGO_getHourlyWaterVolume_ml(void)
 {
     ReasonCodes reason;
-    uint32_T hourlyVolume_l;
-    uint32_T hourlyVolume_ml;
+    uint32_t hourlyVolume_ml;
 
-    hourlyWaterVolume( &waterAlgoData, &reason, &hourlyVolume_ml, &hourlyVolume_l);
+    hourlyVolume_ml = waterVolumeStream_hourlyVolume( &algoState.waterAlgoData, &reason );
 
     if ( reason != reason_code_none )
     {
@@ -99,9 +215,10 @@ uint16_t APP_ALGO_reportAlgoErrors(void)
     return currentErrorBits;
 }
 
+// Nothing to reset, the algorithm state is kept through low power
+// mode and resets (see APP_ALGO_init).
 void APP_ALGO_wakeUpInit(void)
 {
-   // wakeupDataReset( &padFilterData, &waterAlgoData);
 }
 
 static void xGetLatestSamples(void)
@@ -118,20 +235,71 @@ static void xGetLatestSamples(void)
 static void xWaterpadProcess(void)
 {
     int i = 0;
-    ReasonCodes reasonCodes[MAX_RETURNED_REASON_CODES];
+    ReasonCodes reasonCodes[WVS_MAX_REASON_CODES];
 
-    calculateWaterVolume( &waterAlgoData, &padWindow, reasonCodes );
+    waterVolumeStream_processSample( &algoState.waterAlgoData, &algoState.padHistory, reasonCodes );
 
     //get reason codes:
-    for (i = 0; i< MAX_RETURNED_REASON_CODES; i++)
+    for (i = 0; i< WVS_MAX_REASON_CODES; i++)
     {
         if ( reasonCodes[i] != reason_code_none)
         {
             xHandleError(reasonCodes[i]);
         }
     }
+}
 
-    clearPadWindowProcess( &padWindow );
+// Bounds of the indices and flags of a state left in RAM.  Anything
+// that passes is safe to run the algorithm on.
+static bool xStateIsUsable(const appAlgoState_t *stateP)
+{
+    const padHistory_t *historyP = &stateP->padHistory;
+    const padAverage_t *averageP = &stateP->padAverage;
+
+    return ((stateP->seal == APP_ALGO_SEAL) &&
+            (historyP->newest < WVS_HISTORY_DEPTH) &&
+            (historyP->process <= 1) &&
+            (historyP->first_pass <= 1) &&
+            (averageP->oldest < WPA_DEPTH) &&
+            (averageP->count < WPA_DEPTH) &&
+            (stateP->waterAlgoData.algo_state <= water_volume));
+}
+
+// The filter sums are kept up to date with the stored samples, so a
+// state left in RAM where they differ has been disturbed.
+static bool xSumsMatchSamples(const padAverage_t *averageP)
+{
+    uint32_t sums[6] = { 0, 0, 0, 0, 0, 0 };
+    int i;
+
+    for (i = 0; i < WPA_DEPTH; i++)
+    {
+        sums[0] += averageP->sample[i].pad0;
+        sums[1] += averageP->sample[i].pad1;
+        sums[2] += averageP->sample[i].pad2;
+        sums[3] += averageP->sample[i].pad3;
+        sums[4] += averageP->sample[i].pad4;
+        sums[5] += averageP->sample[i].pad5;
+    }
+    return ((sums[0] == averageP->pad0_sum) &&
+            (sums[1] == averageP->pad1_sum) &&
+            (sums[2] == averageP->pad2_sum) &&
+            (sums[3] == averageP->pad3_sum) &&
+            (sums[4] == averageP->pad4_sum) &&
+            (sums[5] == averageP->pad5_sum));
+}
+
+static bool xCheckpointIsValid(void)
+{
+    uint16_t crc16;
+
+    if ((algoCheckpoint.version != APP_ALGO_STATE_VERSION) ||
+        !xStateIsUsable( &algoCheckpoint.state ))
+    {
+        return false;
+    }
+    crc16 = gen_crc16( (const unsigned char *)&algoCheckpoint.state, sizeof(appAlgoState_t) );
+    return (crc16 == algoCheckpoint.crc16);
 }
 
 //Map reason code to an error bit to include in the sensor data log for this day
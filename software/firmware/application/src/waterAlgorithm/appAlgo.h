@@ -28,8 +28,11 @@
 extern void APP_ALGO_init(void);
 extern void APP_ALGO_wakeUpInit(void);
 extern void APP_ALGO_runNest(void);
+extern void APP_ALGO_saveCheckpoint(void);
 extern uint32_t APP_ALGO_getHourlyWaterVolume_ml(void);
 extern uint16_t APP_ALGO_reportAlgoErrors(void);
 extern bool APP_ALGO_isWaterPresent(void);
+extern bool APP_ALGO_needsAllPads(void);
+extern bool APP_ALGO_isFrontCandidate(void);
 
 #endif /* SRC_WATERALGORITHM_APPALGO_H_ */
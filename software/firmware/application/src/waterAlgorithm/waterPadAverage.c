@@ -0,0 +1,130 @@
+/**
+ * @file waterPadAverage.c
+ * \n Source File
+ * \n AfridevV2 MSP430 Firmware
+ *
+ * \brief Running sum pad filter - replacement for the MATLAB generated
+ *        waterPadFiltering()
+ *
+ * \par   Copyright Notice
+ *        Copyright 2021 charity: water
+ *
+ *        Licensed under the Apache License, Version 2.0 (the "License");
+ *        you may not use this file except in compliance with the License.
+ *        You may obtain a copy of the License at
+ *
+ *            http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *        Unless required by applicable law or agreed to in writing, software
+ *        distributed under the License is distributed on an "AS IS" BASIS,
+ *        WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *        See the License for the specific language governing permissions and
+ *        limitations under the License.
+ *
+ * \note  The generated waterPadFiltering() re-sums and shifts all four
+ *        entries of every pad buffer on each sample.  This filter keeps a
+ *        running sum per pad instead, so each sample costs one add, one
+ *        subtract and one store per pad.  The output is identical: the
+ *        first three samples after a reset pass through unfiltered, after
+ *        that each output is the sum of the last four samples >> 2.
+ */
+
+#include <stdint.h>
+#include <string.h>
+#include "waterPadAverage.h"
+
+/***************************
+ * Module Data Definitions
+ **************************/
+
+/**
+ * \def WPA_SUM_SHIFT
+ * \brief Shift that divides the running sum by WPA_DEPTH.
+ */
+#define WPA_SUM_SHIFT 2
+
+/**
+ * \def WPA_WARMUP_COUNT
+ * \brief Number of samples passed through unfiltered after a reset.
+ */
+#define WPA_WARMUP_COUNT ((uint8_t)(WPA_DEPTH - 1))
+
+/*************************
+ * Module Prototypes
+ ************************/
+
+static uint16_t xAddSample(uint32_t *sumP, uint16_T *oldestP, uint16_T newest);
+
+/***************************
+ * Module Public Functions
+ **************************/
+
+/**
+* \brief Reset the filter.  Same effect on the filter output as the
+*        buffer reset in initializeWaterAlgorithm().
+*
+* @param avgP The filter state
+*
+* \ingroup PUBLIC_API
+*/
+void waterPadAverage_init(padAverage_t *avgP)
+{
+    memset(avgP, 0, sizeof(padAverage_t));
+}
+
+/**
+* \brief Filter a raw pad sample.  sampleP and filteredP may point
+*        to the same sample.
+*
+* @param avgP The filter state
+* @param sampleP The raw pad sample
+* @param filteredP Returns the filtered pad sample
+*
+* \ingroup PUBLIC_API
+*/
+void waterPadAverage_filter(padAverage_t *avgP, const padSample_t *sampleP, padSample_t *filteredP)
+{
+    padSample_t *oldestP = &avgP->sample[avgP->oldest];
+    padSample_t average;
+
+    average.pad5 = xAddSample(&avgP->pad5_sum, &oldestP->pad5, sampleP->pad5);
+    average.pad4 = xAddSample(&avgP->pad4_sum, &oldestP->pad4, sampleP->pad4);
+    average.pad3 = xAddSample(&avgP->pad3_sum, &oldestP->pad3, sampleP->pad3);
+    average.pad2 = xAddSample(&avgP->pad2_sum, &oldestP->pad2, sampleP->pad2);
+    average.pad1 = xAddSample(&avgP->pad1_sum, &oldestP->pad1, sampleP->pad1);
+    average.pad0 = xAddSample(&avgP->pad0_sum, &oldestP->pad0, sampleP->pad0);
+
+    avgP->oldest = (avgP->oldest + 1) & (WPA_DEPTH - 1);
+
+    // Until the buffer is full the raw sample is returned
+    if (avgP->count < WPA_WARMUP_COUNT)
+    {
+        avgP->count++;
+        *filteredP = *sampleP;
+    }
+    else
+    {
+        *filteredP = average;
+    }
+}
+
+/*************************
+ * Module Private Functions
+ ************************/
+
+/**
+* \brief Replace the oldest value of one pad with the newest one
+*        and return the updated average.
+*
+* @param sumP The running sum for the pad
+* @param oldestP The stored value to replace
+* @param newest The new value
+*
+* @return uint16_t The average of the stored values
+*/
+static uint16_t xAddSample(uint32_t *sumP, uint16_T *oldestP, uint16_T newest)
+{
+    *sumP = (*sumP - *oldestP) + newest;
+    *oldestP = newest;
+    return (uint16_t)(*sumP >> WPA_SUM_SHIFT);
+}
@@ -0,0 +1,59 @@
+/**
+ * @file waterPadAverage.h
+ * \n Header File
+ * \n AfridevV2 MSP430 Firmware
+ *
+ * \brief Running sum pad filter - replacement for the MATLAB generated
+ *        waterPadFiltering()
+ *
+ * \par   Copyright Notice
+ *        Copyright 2021 charity: water
+ *
+ *        Licensed under the Apache License, Version 2.0 (the "License");
+ *        you may not use this file except in compliance with the License.
+ *        You may obtain a copy of the License at
+ *
+ *            http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *        Unless required by applicable law or agreed to in writing, software
+ *        distributed under the License is distributed on an "AS IS" BASIS,
+ *        WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *        See the License for the specific language governing permissions and
+ *        limitations under the License.
+ *
+ */
+
+#ifndef SRC_WATERALGORITHM_WATERPADAVERAGE_H_
+#define SRC_WATERALGORITHM_WATERPADAVERAGE_H_
+
+#include <stdint.h>
+#include "algo-c-code/waterPadFiltering/waterPadFiltering_types.h"
+
+/**
+ * \def WPA_DEPTH
+ * \brief Number of samples averaged.  Must be a power of two, the
+ *        average is taken with a shift and the index wraps with a mask.
+ */
+#define WPA_DEPTH 4
+
+/**
+ * \typedef padAverage_t
+ * \brief Last WPA_DEPTH raw pad samples plus the running sum of
+ *        each pad over those samples.
+ */
+typedef struct padAverage_s {
+    padSample_t sample[WPA_DEPTH];                         /**< circular raw sample store */
+    uint32_t pad5_sum;                                     /**< sum of the stored pad5 samples */
+    uint32_t pad4_sum;                                     /**< sum of the stored pad4 samples */
+    uint32_t pad3_sum;                                     /**< sum of the stored pad3 samples */
+    uint32_t pad2_sum;                                     /**< sum of the stored pad2 samples */
+    uint32_t pad1_sum;                                     /**< sum of the stored pad1 samples */
+    uint32_t pad0_sum;                                     /**< sum of the stored pad0 samples */
+    uint8_t oldest;                                        /**< index of the sample replaced next */
+    uint8_t count;                                         /**< warm-up count, same as buffer_idx */
+} padAverage_t;
+
+extern void waterPadAverage_init(padAverage_t *avgP);
+extern void waterPadAverage_filter(padAverage_t *avgP, const padSample_t *sampleP, padSample_t *filteredP);
+
+#endif /* SRC_WATERALGORITHM_WATERPADAVERAGE_H_ */
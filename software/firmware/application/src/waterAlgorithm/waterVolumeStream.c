@@ -0,0 +1,723 @@
+/**
+ * @file waterVolumeStream.c
+ * \n Source File
+ * \n AfridevV2 MSP430 Firmware
+ *
+ * \brief Per-sample water volume engine - incremental replacement for the
+ *        MATLAB generated calculateWaterVolume()
+ *
+ * \par   Copyright Notice
+ *        Copyright 2021 charity: water
+ *
+ *        Licensed under the Apache License, Version 2.0 (the "License");
+ *        you may not use this file except in compliance with the License.
+ *        You may obtain a copy of the License at
+ *
+ *            http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *        Unless required by applicable law or agreed to in writing, software
+ *        distributed under the License is distributed on an "AS IS" BASIS,
+ *        WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *        See the License for the specific language governing permissions and
+ *        limitations under the License.
+ *
+ * \note  The generated calculateWaterVolume() waits until a 60 sample
+ *        window is complete and then evaluates window samples 26..60 in
+ *        one call, comparing each one against the samples 21 and 5
+ *        positions earlier.  The windows overlap so that every sample
+ *        after the 25th one stored is evaluated exactly once, in order.
+ *        This engine performs the same evaluation as soon as each sample
+ *        is written, so the per-tick cost is one sample instead of a
+ *        burst of 35 samples every 3.5 seconds.
+ *
+ * \note  Because samples are evaluated as they arrive, only the last
+ *        22 samples are ever read.  They are kept in a circular buffer
+ *        (padHistory_t) instead of the four window blocks of
+ *        padWindows_t, which hold 70 samples.  The window bookkeeping
+ *        (process and first_pass flags) is kept so that a completed
+ *        window is still reported at the same sample as writePadSample().
+ */
+
+#include <stdint.h>
+#include "algo-c-code/calculateWaterVolume/detectWaterChange.h"
+#include "waterVolumeStream.h"
+
+/***************************
+ * Module Data Definitions
+ **************************/
+
+/**
+ * \def WVS_FIRST_WINDOW_LENGTH
+ * \brief Number of samples written after a reset before the first
+ *        window is complete (blocks OA, A and OB).
+ */
+#define WVS_FIRST_WINDOW_LENGTH ((uint8_t)60)
+
+/**
+ * \def WVS_WINDOW_STEP
+ * \brief Number of new samples in every window after the first
+ *        one (a 10 sample block plus a 25 sample overlap block).
+ */
+#define WVS_WINDOW_STEP ((uint8_t)35)
+
+/**
+ * \def WVS_PRESENT_LAG
+ * \brief Distance back to the sample used for the water present
+ *        differential (window index 26 vs 5).
+ */
+#define WVS_PRESENT_LAG    ((uint8_t)21)
+
+/**
+ * \def WVS_VOLUME_LAG
+ * \brief Distance back to the sample used for the water volume
+ *        differential (window index 26 vs 21).
+ */
+#define WVS_VOLUME_LAG     ((uint8_t)5)
+
+/**
+ * \def WVS_FIRST_PASS_SKIP
+ * \brief The first window only evaluates samples 26..60, so the
+ *        first 25 samples after a reset are history only.
+ */
+#define WVS_FIRST_PASS_SKIP ((uint8_t)25)
+
+/**
+ * \def WVS_CANDIDATE_DIFF_SUM
+ * \def WVS_CANDIDATE_PAD5_DIFF
+ * \brief Half of the front detection thresholds (-1000 and -30).
+ *        A sample past either one is treated as a possible water front.
+ */
+#define WVS_CANDIDATE_DIFF_SUM  (-500L)
+#define WVS_CANDIDATE_PAD5_DIFF (-15L)
+
+/**
+ * \def WVS_MEAN_HEIGHT_MASK
+ * \brief The generated code scales the mean height with a 32 bit
+ *        (mean << 15), so only the low 17 bits of the mean are used.
+ */
+#define WVS_MEAN_HEIGHT_MASK ((uint32_t)0x1FFFFUL)
+
+/**
+ * \def WVS_VOLUME_INTERCEPT
+ * \brief Intercept of the Q15 volume scale (3221225472 >> 15).
+ */
+#define WVS_VOLUME_INTERCEPT ((uint32_t)98304UL)
+
+/*************************
+ * Module Prototypes
+ ************************/
+static const padSample_t* xReadSample(const padHistory_t *historyP, uint8_t samplesBack);
+static void xPromoteState(const padWaterState_t *masterP, padWaterState_t *padP);
+static void xAddReasonCode(ReasonCodes reason_code, ReasonCodes reason_codes[WVS_MAX_REASON_CODES]);
+static uint32_t xSessionVolume(const waterAlgoData_t *algo_data);
+static uint32_t xMeanHeight(uint32_t accum, uint32_t count);
+static void xEndSession(waterAlgoData_t *algo_data, ReasonCodes reason_codes[WVS_MAX_REASON_CODES]);
+
+/***************************
+ * Module Public Functions
+ **************************/
+
+/**
+* \brief Reset the sample history.  Same effect on the window
+*        bookkeeping as initializeWindows().
+*
+* @param historyP The pad sample history
+*
+* \ingroup PUBLIC_API
+*/
+void waterVolumeStream_initHistory(padHistory_t *historyP)
+{
+    historyP->newest = WVS_HISTORY_DEPTH - 1;
+    historyP->write_count = 0U;
+    historyP->process = 0U;
+    historyP->first_pass = 1U;
+}
+
+/**
+* \brief Store a new filtered sample.  The process flag is set on
+*        the same samples that writePadSample() would set it.
+*
+* @param historyP The pad sample history
+* @param sampleP The filtered sample to store
+*
+* \ingroup PUBLIC_API
+*/
+void waterVolumeStream_writeSample(padHistory_t *historyP, const padSample_t *sampleP)
+{
+    if (++historyP->newest >= WVS_HISTORY_DEPTH)
+    {
+        historyP->newest = 0U;
+    }
+    historyP->sample[historyP->newest] = *sampleP;
+
+    historyP->write_count++;
+    if (historyP->first_pass)
+    {
+        if (historyP->write_count >= WVS_FIRST_WINDOW_LENGTH)
+        {
+            historyP->first_pass = 0U;
+            historyP->process = 1U;
+            historyP->write_count = 0U;
+        }
+    }
+    else if (historyP->write_count >= WVS_WINDOW_STEP)
+    {
+        historyP->process = 1U;
+        historyP->write_count = 0U;
+    }
+}
+
+/**
+* \brief Clear the window process flag.  Same as
+*        clearPadWindowProcess().
+*
+* @param historyP The pad sample history
+*
+* \ingroup PUBLIC_API
+*/
+void waterVolumeStream_clearProcess(padHistory_t *historyP)
+{
+    historyP->process = 0U;
+}
+
+/**
+* \brief Check the newest sample for a possible water front.  Uses
+*        the same differentials as the front detector but with half
+*        its thresholds, so it fires before water is detected.
+*
+* @param historyP The pad sample history
+*
+* @return bool Returns true if the newest sample looks like the start
+*         of a water front
+*
+* \ingroup PUBLIC_API
+*/
+bool waterVolumeStream_isFrontCandidate(const padHistory_t *historyP)
+{
+    const padSample_t *currP;
+    const padSample_t *prevP;
+    int32_t pad5_diff;
+    int32_t diff_sum;
+
+    if (historyP->first_pass && (historyP->write_count <= WVS_FIRST_PASS_SKIP))
+    {
+        return false;
+    }
+
+    currP = xReadSample(historyP, 0);
+    prevP = xReadSample(historyP, WVS_PRESENT_LAG);
+
+    pad5_diff = (int32_t)currP->pad5 - prevP->pad5;
+    diff_sum = (((pad5_diff + currP->pad4) - prevP->pad4) + currP->pad3) - prevP->pad3;
+
+    return ((diff_sum <= WVS_CANDIDATE_DIFF_SUM) || (pad5_diff <= WVS_CANDIDATE_PAD5_DIFF));
+}
+
+/**
+* \brief Evaluate the sample that was just stored.  Must be
+*        called once after every waterVolumeStream_writeSample().
+*        The algo_data updates and reason codes are the same as
+*        calculateWaterVolume() produces for this sample when it
+*        processes the window containing it.
+*
+* @param algo_data The water algorithm session data
+* @param historyP The pad sample history
+* @param reason_codes Returns the reason codes raised by this
+*                     sample (reason_code_none when unused)
+*
+* \ingroup PUBLIC_API
+*/
+void waterVolumeStream_processSample(waterAlgoData_t *algo_data,
+                                     const padHistory_t *historyP,
+                                     ReasonCodes reason_codes[WVS_MAX_REASON_CODES])
+{
+    const padSample_t *currP;
+    const padSample_t *prevPresentP;
+    const padSample_t *prevVolP;
+    int32_t pad5_present_diff;
+    int32_t present_diff_sum;
+    int32_t pad4_diff;
+    int32_t pad5_diff;
+    uint8_t pad0_state_changed;
+    uint8_t pad1_state_changed;
+    uint8_t pad2_state_changed;
+    uint8_t pad3_state_changed;
+    uint8_t pad4_state_changed;
+    uint8_t pad5_state_changed;
+    uint8_t state_changed;
+    int16_t water_height;
+    uint8_t water_stopped;
+
+    reason_codes[0] = reason_code_none;
+    reason_codes[1] = reason_code_none;
+    reason_codes[2] = reason_code_none;
+    reason_codes[3] = reason_code_none;
+
+    // Until the first window completes, only samples past the
+    // first overlap block are evaluated.
+    if (historyP->first_pass && (historyP->write_count <= WVS_FIRST_PASS_SKIP))
+    {
+        return;
+    }
+
+    currP = xReadSample(historyP, 0);
+    prevPresentP = xReadSample(historyP, WVS_PRESENT_LAG);
+    prevVolP = xReadSample(historyP, WVS_VOLUME_LAG);
+
+    // Differential signal for present detection
+    pad5_present_diff = (int32_t)currP->pad5 - prevPresentP->pad5;
+    present_diff_sum = (((pad5_present_diff + currP->pad4) - prevPresentP->pad4) + currP->pad3) - prevPresentP->pad3;
+    pad4_diff = (int32_t)currP->pad4 - prevVolP->pad4;
+    pad5_diff = (int32_t)currP->pad5 - prevVolP->pad5;
+
+    if (algo_data->algo_state == b_water_present)
+    {
+        // Detect the front of the water ON point
+        if ((present_diff_sum <= -1000L) || (pad5_present_diff <= -30L))
+        {
+            algo_data->present = 1U;
+            algo_data->algo_state = water_volume;
+        }
+        return;
+    }
+
+    // Water present for each pad
+    pad0_state_changed = detectWaterChange((int32_t)currP->pad0 - prevVolP->pad0, &algo_data->pad0_present, 10U);
+    pad1_state_changed = detectWaterChange((int32_t)currP->pad1 - prevVolP->pad1, &algo_data->pad1_present, 10U);
+    pad2_state_changed = detectWaterChange((int32_t)currP->pad2 - prevVolP->pad2, &algo_data->pad2_present, 10U);
+    pad3_state_changed = detectWaterChange((int32_t)currP->pad3 - prevVolP->pad3, &algo_data->pad3_present, 20U);
+    pad4_state_changed = detectWaterChange(pad4_diff, &algo_data->pad4_present, 30U);
+    pad5_state_changed = detectWaterChange(pad5_diff, &algo_data->pad5_present, 40U);
+
+    // Calculate water height - start with the highest pad and work
+    // down until we find a pad that is covered.  A covered pad
+    // promotes its state to every pad below it.
+    state_changed = 0U;
+    water_height = 0;
+
+    // Check pad 0
+    if ((algo_data->pad0_present.present_type == water_present) &&
+        ((algo_data->pad1_present.present_type != water_not_present) ||
+         (algo_data->pad2_present.present_type != water_not_present)))
+    {
+        water_height = 197;
+        if (pad0_state_changed)
+        {
+            state_changed = 1U;
+        }
+        xPromoteState(&algo_data->pad0_present, &algo_data->pad1_present);
+        xPromoteState(&algo_data->pad0_present, &algo_data->pad2_present);
+        xPromoteState(&algo_data->pad0_present, &algo_data->pad3_present);
+        xPromoteState(&algo_data->pad0_present, &algo_data->pad4_present);
+        xPromoteState(&algo_data->pad0_present, &algo_data->pad5_present);
+    }
+
+    // Check pad 1
+    if ((water_height == 0) &&
+        (algo_data->pad1_present.present_type == water_present) &&
+        ((algo_data->pad2_present.present_type != water_not_present) ||
+         (algo_data->pad3_present.present_type != water_not_present)))
+    {
+        water_height = 164;
+        if (pad1_state_changed)
+        {
+            state_changed = 1U;
+        }
+        xPromoteState(&algo_data->pad1_present, &algo_data->pad2_present);
+        xPromoteState(&algo_data->pad1_present, &algo_data->pad3_present);
+        xPromoteState(&algo_data->pad1_present, &algo_data->pad4_present);
+        xPromoteState(&algo_data->pad1_present, &algo_data->pad5_present);
+    }
+
+    // Check pad 2
+    if ((water_height == 0) &&
+        (algo_data->pad2_present.present_type == water_present) &&
+        ((algo_data->pad3_present.present_type != water_not_present) ||
+         (algo_data->pad4_present.present_type != water_not_present)))
+    {
+        water_height = 131;
+        if (pad2_state_changed)
+        {
+            state_changed = 1U;
+        }
+        xPromoteState(&algo_data->pad2_present, &algo_data->pad3_present);
+        xPromoteState(&algo_data->pad2_present, &algo_data->pad4_present);
+        xPromoteState(&algo_data->pad2_present, &algo_data->pad5_present);
+    }
+
+    // Check pad 3
+    if ((water_height == 0) &&
+        (algo_data->pad3_present.present_type == water_present) &&
+        ((algo_data->pad4_present.present_type != water_not_present) ||
+         (algo_data->pad5_present.present_type != water_not_present)))
+    {
+        water_height = 98;
+        if (pad3_state_changed)
+        {
+            state_changed = 1U;
+        }
+        xPromoteState(&algo_data->pad3_present, &algo_data->pad4_present);
+        xPromoteState(&algo_data->pad3_present, &algo_data->pad5_present);
+    }
+
+    // Check pad 4
+    if ((water_height == 0) &&
+        (algo_data->pad4_present.present_type == water_present) &&
+        (algo_data->pad5_present.present_type != water_not_present))
+    {
+        water_height = 66;
+        if (pad4_state_changed)
+        {
+            state_changed = 1U;
+        }
+        xPromoteState(&algo_data->pad4_present, &algo_data->pad5_present);
+    }
+
+    // Check pad 5
+    if ((water_height == 0) && (algo_data->pad5_present.present_type != water_not_present))
+    {
+        water_height = 33;
+        if (pad5_state_changed)
+        {
+            state_changed = 1U;
+        }
+    }
+
+    // Check for water not present - pads 4 and 5 are stable, keep
+    // the height at pad 5 while the not present counter runs
+    if ((algo_data->prev_water_height > 0UL) && (water_height == 0) &&
+        (pad4_diff < 15L) && (pad5_diff < 15L))
+    {
+        if (algo_data->not_present_counter < UINT32_MAX)
+        {
+            algo_data->not_present_counter++;
+        }
+        water_height = 33;
+        algo_data->pad5_present.present_type = water_draining;
+        algo_data->pad5_present.draining_count = 40U;
+    }
+    else
+    {
+        algo_data->not_present_counter = 0UL;
+    }
+
+    if ((water_height > 0) && (algo_data->water_height_counter < UINT32_MAX))
+    {
+        algo_data->water_height_counter++;
+    }
+
+    // Timeout when the water height is constant for a long time
+    if ((water_height > 0) && (algo_data->prev_water_height == (uint32_t)water_height) && (state_changed == 0))
+    {
+        if (algo_data->constant_height_counter < UINT32_MAX)
+        {
+            algo_data->constant_height_counter++;
+        }
+
+        // Check for standing water or clogged pump
+        if ((algo_data->constant_height_counter >= 3000UL) && ((uint16_t)water_height <= 66U))
+        {
+            xAddReasonCode(water_flow_standing_water, reason_codes);
+        }
+    }
+    else
+    {
+        algo_data->constant_height_counter = 0UL;
+    }
+
+    // Detect the water OFF point - the closest point when the water
+    // is only dribbling
+    water_stopped = 0U;
+    if (present_diff_sum >= 300L)
+    {
+        algo_data->water_stop_detected = 1U;
+    }
+
+    // Reset water stopped flag if we get down to average again
+    if ((present_diff_sum < 0L) && algo_data->water_stop_detected)
+    {
+        algo_data->pad5_stop_detected = 0U;
+        algo_data->water_stop_detected = 0U;
+    }
+
+    if (algo_data->water_stop_detected && (pad5_present_diff >= 50L))
+    {
+        algo_data->pad5_stop_detected = 1U;
+    }
+
+    if ((present_diff_sum < 20L) && algo_data->water_stop_detected && algo_data->pad5_stop_detected)
+    {
+        water_stopped = 1U;
+    }
+
+    // Add height to integral value
+    if (algo_data->accum_water_height <= UINT32_MAX - water_height)
+    {
+        algo_data->accum_water_height += water_height;
+    }
+    else
+    {
+        algo_data->accum_water_height = UINT32_MAX;
+    }
+
+    algo_data->prev_water_height = (uint32_t)water_height;
+
+    // Check for end of session
+    if ((algo_data->not_present_counter > 10UL) ||
+        (algo_data->constant_height_counter >= 3000UL) ||
+        water_stopped)
+    {
+        xEndSession(algo_data, reason_codes);
+    }
+}
+
+/**
+* \brief Return the water volume for the hour and reset the
+*        accumulated volume.  A session still in progress is cut at
+*        this point.  Same result as the generated hourlyWaterVolume().
+*
+* @param algo_data The water algorithm session data
+* @param reason_code Returns water_volume_capped if the volume
+*                    saturated, otherwise reason_code_none
+*
+* @return uint32_t The hourly water volume in milliliters
+*
+* \ingroup PUBLIC_API
+*/
+uint32_t waterVolumeStream_hourlyVolume(waterAlgoData_t *algo_data, ReasonCodes *reason_code)
+{
+    uint32_t sessionVolume = 0UL;
+    uint32_t volume_ml;
+
+    *reason_code = reason_code_none;
+
+    if (algo_data->present)
+    {
+        sessionVolume = xSessionVolume(algo_data);
+
+        // Reset the session volume variables but not the pad variables
+        algo_data->accum_water_height = 0UL;
+        algo_data->water_height_counter = 0UL;
+    }
+
+    if (algo_data->accum_water_volume <= UINT32_MAX - sessionVolume)
+    {
+        volume_ml = algo_data->accum_water_volume + sessionVolume;
+    }
+    else
+    {
+        volume_ml = UINT32_MAX;
+        *reason_code = water_volume_capped;
+    }
+
+    algo_data->accum_water_volume = 0UL;
+
+    return volume_ml;
+}
+
+/*************************
+ * Module Private Functions
+ ************************/
+
+/**
+* \brief Return a previously stored sample.
+*
+* @param historyP The pad sample history
+* @param samplesBack How many samples before the newest one to
+*                    read (0 is the newest sample)
+*
+* @return const padSample_t* The sample
+*/
+static const padSample_t* xReadSample(const padHistory_t *historyP, uint8_t samplesBack)
+{
+    int8_t idx = (int8_t)historyP->newest - (int8_t)samplesBack;
+
+    if (idx < 0)
+    {
+        idx += WVS_HISTORY_DEPTH;
+    }
+    return &historyP->sample[idx];
+}
+
+/**
+* \brief Promote a pad's water state to the state of a covered
+*        pad above it.
+*/
+static void xPromoteState(const padWaterState_t *masterP, padWaterState_t *padP)
+{
+    if (padP->present_type < masterP->present_type)
+    {
+        padP->present_type = masterP->present_type;
+        padP->draining_count = 0U;
+    }
+}
+
+/**
+* \brief Add a reason code to the list if it is not already in
+*        the list and there is a free slot.
+*/
+static void xAddReasonCode(ReasonCodes reason_code, ReasonCodes reason_codes[WVS_MAX_REASON_CODES])
+{
+    uint8_t i;
+
+    for (i = 0; i < WVS_MAX_REASON_CODES; i++)
+    {
+        if (reason_codes[i] == reason_code)
+        {
+            return;
+        }
+    }
+    for (i = 0; i < WVS_MAX_REASON_CODES; i++)
+    {
+        if (reason_codes[i] == reason_code_none)
+        {
+            reason_codes[i] = reason_code;
+            return;
+        }
+    }
+}
+
+/**
+* \brief Convert the accumulated water height of the current
+*        session into milliliters.
+*
+*        Bit exact with the generated
+*        (accum * ((842 * (mean << 15) + 3221225472) >> 15) * 1000) >> 30
+*        but built from 32 bit shifts and adds, so the no hardware
+*        multiply build does not need the 64 bit multiply or the 32 bit
+*        divide library routines.  The Q15 scale reduces to
+*        842 * mean + 98304, and the 64 bit product is kept as two
+*        32 bit halves.
+*
+* @param algo_data The water algorithm session data
+*
+* @return uint32_t The session volume in milliliters
+*/
+static uint32_t xSessionVolume(const waterAlgoData_t *algo_data)
+{
+    uint32_t accum = algo_data->accum_water_height;
+    uint32_t mean = 0UL;
+    uint32_t scale;
+    uint32_t addHi;
+    uint32_t addLo;
+    uint32_t borrow;
+    uint32_t sumHi = 0UL;
+    uint32_t sumLo = 0UL;
+
+    if (algo_data->water_height_counter != 0UL)
+    {
+        mean = xMeanHeight(accum, algo_data->water_height_counter);
+    }
+
+    // scale = 842 * mean + 98304 (842 = 512 + 256 + 64 + 8 + 2)
+    mean &= WVS_MEAN_HEIGHT_MASK;
+    scale = (mean << 9) + (mean << 8) + (mean << 6) + (mean << 3) + (mean << 1) + WVS_VOLUME_INTERCEPT;
+
+    // accum * 1000 = accum * 1024 - accum * 16 - accum * 8
+    addHi = accum >> 22;
+    addLo = accum << 10;
+    borrow = (addLo < (accum << 4)) ? 1UL : 0UL;
+    addLo -= accum << 4;
+    addHi -= (accum >> 28) + borrow;
+    borrow = (addLo < (accum << 3)) ? 1UL : 0UL;
+    addLo -= accum << 3;
+    addHi -= (accum >> 29) + borrow;
+
+    // sum = accum * 1000 * scale, one shift and add per scale bit
+    while (scale != 0UL)
+    {
+        if (scale & 1UL)
+        {
+            sumLo += addLo;
+            sumHi += addHi + ((sumLo < addLo) ? 1UL : 0UL);
+        }
+        addHi = (addHi << 1) | (addLo >> 31);
+        addLo <<= 1;
+        scale >>= 1;
+    }
+
+    return (sumHi << 2) | (sumLo >> 30);
+}
+
+/**
+* \brief Return accum / count with shift and subtract steps.  The
+*        mean water height is at most 197, so this takes a handful
+*        of steps instead of a full 32 bit divide.
+*
+* @param accum The accumulated water height
+* @param count The number of samples accumulated, must not be 0
+*
+* @return uint32_t The mean water height
+*/
+static uint32_t xMeanHeight(uint32_t accum, uint32_t count)
+{
+    uint32_t divisor = count;
+    uint32_t bit = 1UL;
+    uint32_t quotient = 0UL;
+
+    while (divisor <= (accum >> 1))
+    {
+        divisor <<= 1;
+        bit <<= 1;
+    }
+
+    while (bit != 0UL)
+    {
+        if (accum >= divisor)
+        {
+            accum -= divisor;
+            quotient |= bit;
+        }
+        divisor >>= 1;
+        bit >>= 1;
+    }
+
+    return quotient;
+}
+
+/**
+* \brief Close out the current session: add its volume to the
+*        accumulated volume and reset the session state.
+*/
+static void xEndSession(waterAlgoData_t *algo_data, ReasonCodes reason_codes[WVS_MAX_REASON_CODES])
+{
+    uint32_t sessionVolume = xSessionVolume(algo_data);
+
+    if (algo_data->accum_water_volume <= UINT32_MAX - sessionVolume)
+    {
+        algo_data->accum_water_volume += sessionVolume;
+    }
+    else
+    {
+        algo_data->accum_water_volume = UINT32_MAX;
+        xAddReasonCode(water_volume_capped, reason_codes);
+    }
+
+    // Move to water present state and reset session variables
+    algo_data->algo_state = b_water_present;
+    algo_data->present = 0U;
+    algo_data->water_stop_detected = 0U;
+    algo_data->pad5_stop_detected = 0U;
+    algo_data->not_present_counter = 0UL;
+    algo_data->constant_height_counter = 0UL;
+    algo_data->prev_water_height = 0UL;
+
+    algo_data->pad5_present.present_type = water_not_present;
+    algo_data->pad5_present.draining_count = 0U;
+    algo_data->pad4_present.present_type = water_not_present;
+    algo_data->pad4_present.draining_count = 0U;
+    algo_data->pad3_present.present_type = water_not_present;
+    algo_data->pad3_present.draining_count = 0U;
+    algo_data->pad2_present.present_type = water_not_present;
+    algo_data->pad2_present.draining_count = 0U;
+    algo_data->pad1_present.present_type = water_not_present;
+    algo_data->pad1_present.draining_count = 0U;
+    algo_data->pad0_present.present_type = water_not_present;
+    algo_data->pad0_present.draining_count = 0U;
+
+    algo_data->accum_water_height = 0UL;
+    algo_data->water_height_counter = 0UL;
+
+    // NOTE: do not reset the accumulated water volume - this is
+    // reset when the hourly water volume is computed
+}
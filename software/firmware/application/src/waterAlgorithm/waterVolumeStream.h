@@ -0,0 +1,69 @@
+/**
+ * @file waterVolumeStream.h
+ * \n Header File
+ * \n AfridevV2 MSP430 Firmware
+ *
+ * \brief Per-sample water volume engine - incremental replacement for the
+ *        MATLAB generated calculateWaterVolume()
+ *
+ * \par   Copyright Notice
+ *        Copyright 2021 charity: water
+ *
+ *        Licensed under the Apache License, Version 2.0 (the "License");
+ *        you may not use this file except in compliance with the License.
+ *        You may obtain a copy of the License at
+ *
+ *            http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *        Unless required by applicable law or agreed to in writing, software
+ *        distributed under the License is distributed on an "AS IS" BASIS,
+ *        WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *        See the License for the specific language governing permissions and
+ *        limitations under the License.
+ *
+ */
+
+#ifndef SRC_WATERALGORITHM_WATERVOLUMESTREAM_H_
+#define SRC_WATERALGORITHM_WATERVOLUMESTREAM_H_
+
+#include <stdint.h>
+#include "algo-c-code/calculateWaterVolume/calculateWaterVolume_types.h"
+#include "algo-c-code/writePadSample/writePadSample_types.h"
+
+/**
+ * \def WVS_MAX_REASON_CODES
+ * \brief Size of the reason code list returned for each sample.
+ *        Matches the list returned by calculateWaterVolume().
+ */
+#define WVS_MAX_REASON_CODES 4
+
+/**
+ * \def WVS_HISTORY_DEPTH
+ * \brief Number of samples kept in the history.  The oldest sample
+ *        the detector reads is 21 samples before the newest one.
+ */
+#define WVS_HISTORY_DEPTH 22
+
+/**
+ * \typedef padHistory_t
+ * \brief Circular store of the most recent filtered pad samples
+ *        plus the window bookkeeping from padWindows_t.
+ */
+typedef struct padHistory_s {
+    padSample_t sample[WVS_HISTORY_DEPTH];                 /**< circular sample store */
+    uint8_t newest;                                        /**< index of the most recent sample */
+    uint8_t write_count;                                   /**< samples written since the last window completed */
+    uint8_t process;                                       /**< set when a window completes, same as padWindows_t */
+    uint8_t first_pass;                                    /**< set until the first window completes */
+} padHistory_t;
+
+extern void waterVolumeStream_initHistory(padHistory_t *historyP);
+extern void waterVolumeStream_writeSample(padHistory_t *historyP, const padSample_t *sampleP);
+extern void waterVolumeStream_clearProcess(padHistory_t *historyP);
+extern bool waterVolumeStream_isFrontCandidate(const padHistory_t *historyP);
+extern void waterVolumeStream_processSample(waterAlgoData_t *algo_data,
+                                            const padHistory_t *historyP,
+                                            ReasonCodes reason_codes[WVS_MAX_REASON_CODES]);
+extern uint32_t waterVolumeStream_hourlyVolume(waterAlgoData_t *algo_data, ReasonCodes *reason_code);
+
+#endif /* SRC_WATERALGORITHM_WATERVOLUMESTREAM_H_ */
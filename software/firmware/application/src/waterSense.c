@@ -26,6 +26,7 @@
 #include "CTS_Layer.h"
 #include "waterDetect.h"
 #include "waterSense.h"
+#include "appAlgo.h"
 #ifdef WATER_DEBUG
 #include "debugUart.h"
 #endif
@@ -34,14 +35,149 @@
  * Module Data Definitions
  **************************/
 
+/**
+ * \def PRESENCE_PAD_FIRST
+ * \brief First pad number in the pad_presence_sensors group.  The
+ *        group measures this pad and the ones above it (3, 4, 5).
+ */
+#define PRESENCE_PAD_FIRST 3
+
+/**
+ * \def PRESENCE_PAD_COUNT
+ * \brief Number of pads in the pad_presence_sensors group.
+ */
+#define PRESENCE_PAD_COUNT (NUM_PADS - PRESENCE_PAD_FIRST)
+
+/**
+ * \def FULL_SWEEP_REFRESH_TICKS
+ * \brief While only the presence pads are measured, all six pads
+ *        are still measured once every this many main loop ticks
+ *        (5 seconds) so the held values of the skipped pads track slow
+ *        drift.  Counted in ticks, not readings, so the refresh keeps
+ *        the same period while probing.
+ */
+#define FULL_SWEEP_REFRESH_TICKS 50
+
+/**
+ * \def PROBE_INTERVAL_TICKS
+ * \brief While probing, the pads are measured once every this many
+ *        main loop ticks (2 Hz).  The algorithm still runs every tick
+ *        on the last measured values.
+ */
+#define PROBE_INTERVAL_TICKS 5
+
+/**
+ * \def GATE_MAX_SHIFT
+ * \brief Shortest gate the calibration tries, pad_sensors
+ *        accumulationCycles >> GATE_MAX_SHIFT (128 ACLK cycles).
+ */
+#define GATE_MAX_SHIFT 2
+
+/**
+ * \def GATE_MAX_ERROR
+ * \brief Largest error in scaled counts a shortened gate may add to
+ *        a reading, half of the smallest count delta detectWaterChange()
+ *        acts on (+10).
+ */
+#define GATE_MAX_ERROR 5
+
+/**
+ * \def GATE_CAL_SAMPLES
+ * \brief Number of readings taken at each gate length during the
+ *        gate calibration.
+ */
+#define GATE_CAL_SAMPLES 16
+
+/**
+ * \def GATE_CAL_DRY_TRENDS
+ * \brief The gate calibration waits until the algorithm has seen
+ *        no water for this many consecutive trends (5 minutes), so
+ *        the pads are dry while they are calibrated.
+ */
+#define GATE_CAL_DRY_TRENDS 150
+
+/**
+ * \def MAX_HELD_SAMPLES
+ * \brief Most consecutive disturbed readings of a pad that are
+ *        dropped.  The next one is used anyway so a pad can never be
+ *        frozen by persistent noise.
+ */
+#define MAX_HELD_SAMPLES 10
+
+/**
+ * \def MAX_TX_HELD_SAMPLES
+ * \brief Most consecutive readings of a pad dropped while the modem
+ *        is transmitting (5 seconds at the full rate).  Longer than
+ *        MAX_HELD_SAMPLES since every reading of a transmit is noisy,
+ *        not just the late ones, but still bounded so a pad cannot be
+ *        frozen by a modem that never finishes.
+ */
+#define MAX_TX_HELD_SAMPLES 50
+
 /****************************
  * Module Data Declarations
  ***************************/
 
+/**
+ * \var presenceOnlyTicks
+ * \brief Number of main loop ticks covered by presence-only
+ *        readings since the last full six pad reading.
+ */
+static uint8_t presenceOnlyTicks;
+
+/**
+ * \var probeTickCount
+ * \brief Number of ticks since the last probe reading.
+ */
+static uint8_t probeTickCount;
+
+/**
+ * \var padCounts
+ * \brief Measurement results, written by the cap-sense ISR while a
+ *        sweep is in progress.
+ */
+static uint16_t padCounts[TOTAL_PADS];
+
+/**
+ * \var commsSweep
+ * \brief Set while the current sweep is taken with the modem or
+ *        GPS in use.
+ */
+static bool commsSweep;
+
+/**
+ * \var txSweep
+ * \brief Set while the current sweep is taken with the modem
+ *        transmitting.
+ */
+static bool txSweep;
+
+/**
+ * \var heldCount
+ * \brief Number of consecutive disturbed readings dropped per pad.
+ */
+static uint8_t heldCount[NUM_PADS];
+
+/**
+ * \var gateCalPending
+ * \brief Set when the pads have no stored gate calibration yet.
+ *        They use the full gate until it is done.
+ */
+static bool gateCalPending;
+
 /*************************
  * Module Prototypes
  ************************/
 
+static void xLoadGateShifts(void);
+static uint16_t xScaleCount(uint8_t pad_number, uint16_t count);
+static bool xCommsActive(void);
+static bool xPadsAreDry(void);
+static void xAddSweep(uint8_t first_pad, uint8_t num_pads, const uint16_t *counts);
+static void xAllPadsDone(const uint16_t *counts);
+static void xPresencePadsDone(const uint16_t *counts);
+static void xWaitForSweep(void);
+
 /***************************
  * Module Public Functions
  **************************/
@@ -55,6 +191,104 @@ void waterSense_init(void)
 {
     // initialize pad-data analysis
     waterDetect_init();
+
+    // Per pad gate time
+    xLoadGateShifts();
+
+    // The first reading must measure all pads, waterDetect starts
+    // out with every pad marked as an outlier.
+    presenceOnlyTicks = FULL_SWEEP_REFRESH_TICKS;
+}
+
+/**
+* \brief Find the shortest cap-sense gate of each pad that still
+*        resolves the water detect thresholds.
+*
+*        Each gate shift from GATE_MAX_SHIFT down is tried on all pads.
+*        A pad keeps the largest shift where the spread of its readings
+*        plus the count lost to the shorter gate, both scaled back to
+*        the full gate, stays within GATE_MAX_ERROR.  Pads that never
+*        meet it keep the full gate.  The result is applied and, when
+*        the board has a manufacturing record, stored in it.
+*
+*        The pads must be dry.  The sweeps are ISR chained, so the
+*        system tick cannot cut a gate short.  Blocks for about a
+*        second.
+*
+* \ingroup PUBLIC_API
+*/
+void waterSense_calibrateGates(void)
+{
+    MDRgateRecord_t gt;
+    uint16_t minCount[NUM_PADS];
+    uint16_t maxCount[NUM_PADS];
+    uint8_t shift;
+    uint8_t sample;
+    uint8_t pad_number;
+
+    memset(&gt, 0, sizeof(MDRgateRecord_t));
+
+    for (shift = GATE_MAX_SHIFT; shift > 0; shift--)
+    {
+        for (pad_number = 0; pad_number < NUM_PADS; pad_number++)
+        {
+            padGateShift[pad_number] = shift;
+            minCount[pad_number] = 0xFFFF;
+            maxCount[pad_number] = 0;
+        }
+
+        for (sample = 0; sample < GATE_CAL_SAMPLES; sample++)
+        {
+            WATCHDOG_TICKLE();
+            TI_CAPT_RawStart(&pad_sensors, &padCounts[0], NULL);
+            xWaitForSweep();
+
+            for (pad_number = 0; pad_number < NUM_PADS; pad_number++)
+            {
+                if (padCounts[pad_number] < minCount[pad_number])
+                {
+                    minCount[pad_number] = padCounts[pad_number];
+                }
+                if (padCounts[pad_number] > maxCount[pad_number])
+                {
+                    maxCount[pad_number] = padCounts[pad_number];
+                }
+            }
+        }
+
+        // ((spread + 1) << shift) <= GATE_MAX_ERROR, the + 1 is the
+        // count a shorter gate can lose to quantization
+        for (pad_number = 0; pad_number < NUM_PADS; pad_number++)
+        {
+            if ((gt.padGateShift[pad_number] == 0) &&
+                ((uint16_t)(maxCount[pad_number] - minCount[pad_number]) < (GATE_MAX_ERROR >> shift)))
+            {
+                gt.padGateShift[pad_number] = shift;
+            }
+        }
+    }
+
+    memcpy(padGateShift, gt.padGateShift, NUM_PADS);
+    gateCalPending = false;
+
+    // Without a record the manufacturing test has not run yet, writing
+    // one here would fill its other sections with erased flash.
+    if (manufRecord_checkForValidManufRecord())
+    {
+        manufRecord_updateManufRecord(MDR_Gate_Record, (uint8_t *)&gt, sizeof(MDRgateRecord_t));
+    }
+}
+
+/**
+* \brief Returns true when the pump has been dry for dry_wake_time
+*        trends and the pads are only probed at a low rate.
+*
+* \ingroup PUBLIC_API
+*/
+bool waterSense_isProbing(void)
+{
+    return ((sysExecData.dry_wake_time != 0) &&
+            (sysExecData.dry_count >= sysExecData.dry_wake_time));
 }
 
 /*************************
@@ -63,9 +297,31 @@ void waterSense_init(void)
 
 /**
 * 
-* \brief Returns estimate of mL for this second. Will
-*    update pad max values and next pad max values when
-*    appropriate.
+* \brief Measure the pads and add the readings to waterDetect.
+*
+*        While the algorithm is waiting for water to arrive it only
+*        looks at pads 3, 4 and 5, so only those pads are measured
+*        (with a full six pad refresh every FULL_SWEEP_REFRESH_TICKS
+*        ticks).  waterDetect keeps the last reading of each pad, so
+*        the skipped pads keep feeding the algorithm their last measured
+*        (dry) value and the windows stay consistent when the full
+*        sweep resumes.
+*
+*        Once the pump has been dry long enough (waterSense_isProbing())
+*        only one tick in PROBE_INTERVAL_TICKS takes a reading.  The
+*        other ticks leave the last readings in waterDetect, so the
+*        algorithm keeps running at the tick rate on held values and
+*        its windows stay on the same time base.
+*
+*        Readings continue while the modem or GPS is in use.  Their UART
+*        traffic does not touch the cap-sense pins or timers, but the UART
+*        ISR can delay the gate ISR.  While they are in use, the elements
+*        the HAL flags late keep their last reading, see xAddSweep().  A
+*        six pad sweep takes 94 ms of the 100 ms tick, so there is no time
+*        to measure the pads twice.  The modem radio is a separate
+*        disturbance: its bursts couple into the pads whatever the
+*        timing, so the sweeps taken while it transmits are flagged as
+*        noisy on their own and also keep the last readings.
 *
 * \li INPUTS:  
 * \li padCounts[TOTAL_PADS]: Taken from TI_CAPT_Raw. Generated
@@ -75,19 +331,208 @@ void waterSense_init(void)
 */
 void waterSense_takeReading(void)
 {
-    uint8_t pad_number;
-    uint16_t padCounts[TOTAL_PADS];
+    const struct Sensor *groupP;
+    TI_CTS_DoneCallback_t doneCallback;
+    uint8_t readingTicks = 1;
+
+    // Calibrate once the pads are known to be dry and nothing is
+    // transmitting.  The ticks it blocks for are dry anyway.
+    if (gateCalPending && xPadsAreDry() && !xCommsActive())
+    {
+        waterSense_calibrateGates();
+    }
+
+    if (waterSense_isProbing())
+    {
+        if (++probeTickCount < PROBE_INTERVAL_TICKS)
+        {
+            return;
+        }
+        readingTicks = PROBE_INTERVAL_TICKS;
+    }
+    probeTickCount = 0;
+
+    if (!APP_ALGO_needsAllPads() && (presenceOnlyTicks < FULL_SWEEP_REFRESH_TICKS))
+    {
+        presenceOnlyTicks += readingTicks;
+
+        // Measure only the presence pads
+        groupP = &pad_presence_sensors;
+        doneCallback = xPresencePadsDone;
+    }
+    else
+    {
+        presenceOnlyTicks = 0;
+
+        groupP = &pad_sensors;
+        doneCallback = xAllPadsDone;
+    }
+
+    commsSweep = xCommsActive();
+    txSweep = modemMgr_isTransmitting();
 
     // Perform the capacitive measurements
-    TI_CAPT_Raw(&pad_sensors, &padCounts[0]);
+    TI_CAPT_RawStart(groupP, &padCounts[0], doneCallback);
 
     // make sure measurement is done
-    while (CAPSENSE_ACTIVE);
+    xWaitForSweep();
+}
 
-    // Loop for each pad.
+/**
+* \brief Apply the gate calibration stored in the manufacturing
+*        record.  If there is none or it is not usable the pads
+*        use the full gate.  They are calibrated later, once they
+*        are dry, if the calibration can be stored: a board
+*        without a manufacturing record keeps the full gate rather
+*        than calibrating again after every reset.
+*/
+static void xLoadGateShifts(void)
+{
+    MDRgateRecord_t gt;
+    uint8_t pad_number;
 
-    for (pad_number = 0; pad_number < NUM_PADS; pad_number++)
+    if (manufRecord_getGateInfo(&gt))
+    {
+        for (pad_number = 0; pad_number < NUM_PADS; pad_number++)
+        {
+            if (gt.padGateShift[pad_number] > GATE_MAX_SHIFT)
+            {
+                break;
+            }
+        }
+        if (pad_number == NUM_PADS)
+        {
+            memcpy(padGateShift, gt.padGateShift, NUM_PADS);
+            return;
+        }
+    }
+    memset(padGateShift, 0, NUM_PADS);
+    gateCalPending = manufRecord_checkForValidManufRecord();
+}
+
+/**
+* \brief Scale a count measured with a shortened gate back to the
+*        count the full gate would give, so the algorithm sees the
+*        same scale for every pad.  Overflow saturates at 0xFFFF like
+*        a timer overflow.
+*
+* @param pad_number The pad that was measured
+* @param count The measured count
+*
+* @return uint16_t The count for the full gate
+*/
+static uint16_t xScaleCount(uint8_t pad_number, uint16_t count)
+{
+    uint8_t shift = padGateShift[pad_number];
+
+    if (count > (0xFFFF >> shift))
+    {
+        return 0xFFFF;
+    }
+    return count << shift;
+}
+
+/**
+* \brief Returns true while the modem or GPS is in use.
+*/
+static bool xCommsActive(void)
+{
+#ifndef WATER_DEBUG
+    return (modemMgr_isAllocated() || gps_isActive());
+#else
+    return gps_isActive();
+#endif
+}
+
+/**
+* \brief Returns true when the algorithm has seen no water and no
+*        sign of a water front for GATE_CAL_DRY_TRENDS trends.
+*/
+static bool xPadsAreDry(void)
+{
+    return ((sysExecData.dry_count >= GATE_CAL_DRY_TRENDS) && !APP_ALGO_isWaterPresent());
+}
+
+/**
+* \brief Add the readings of a sweep to waterDetect.  A reading is
+*        disturbed when the HAL flagged it late while the modem or GPS
+*        was in use, the only time another ISR can hold off the gate ISR
+*        for long, or when it was taken while the modem was transmitting
+*        (modemMgr_isTransmitting()), which makes the counts noisy even
+*        on time.  A disturbed reading is dropped and waterDetect keeps
+*        the last one, unless MAX_HELD_SAMPLES (MAX_TX_HELD_SAMPLES during
+*        a transmit) readings of the pad were dropped in a row or the
+*        pad has no reading yet.
+*        Called from the TimerB0 ISR.
+*
+* @param first_pad Pad number of the first element of the sweep
+* @param num_pads Number of pads in the sweep
+* @param counts The measured counts, one per pad
+*/
+static void xAddSweep(uint8_t first_pad, uint8_t num_pads, const uint16_t *counts)
+{
+    uint8_t late = commsSweep ? CAPSENSE_LATE : 0;
+    uint8_t maxHeld = txSweep ? MAX_TX_HELD_SAMPLES : MAX_HELD_SAMPLES;
+    uint8_t i;
+
+    for (i = 0; i < num_pads; i++)
+    {
+        uint8_t pad_number = first_pad + i;
+        uint16_t count = xScaleCount(pad_number, counts[i]);
+        bool disturbed = txSweep || ((late & (1 << i)) != 0);
+
+        // A pad without a reading yet (after a reset) takes any reading,
+        // a restored algorithm state must not see OUTLIER
+        if (disturbed && (heldCount[pad_number] < maxHeld) &&
+            (waterDetect_getCurrSample(pad_number) != OUTLIER))
+        {
+            heldCount[pad_number]++;
+        }
+        else
+        {
+            heldCount[pad_number] = 0;
+            waterDetect_add_sample(pad_number, count);
+        }
+    }
+}
+
+/**
+* \brief Cap-sense completion callback for the six pad sweep.
+*        Called from the TimerB0 ISR.
+*
+* @param counts The measured counts, one per pad
+*/
+static void xAllPadsDone(const uint16_t *counts)
+{
+    xAddSweep(0, NUM_PADS, counts);
+}
+
+/**
+* \brief Cap-sense completion callback for the presence pad sweep.
+*        Called from the TimerB0 ISR.
+*
+* @param counts The measured counts of pads 3, 4 and 5
+*/
+static void xPresencePadsDone(const uint16_t *counts)
+{
+    xAddSweep(PRESENCE_PAD_FIRST, PRESENCE_PAD_COUNT, counts);
+}
+
+/**
+* \brief Sleep in LPM3 until the cap-sense sweep is complete.  The
+*        TimerB0 ISR chains the pads without waking the CPU and wakes
+*        it once at the end.  The system tick or the UART can also
+*        wake the CPU, so the flag is checked again after every wake.
+*        Interrupts are off while the flag is checked so the final ISR
+*        cannot run between the check and going to sleep.
+*/
+static void xWaitForSweep(void)
+{
+    disableGlobalInterrupt();
+    while (CAPSENSE_ACTIVE)
     {
-        waterDetect_add_sample(pad_number, padCounts[pad_number]);
+        __bis_SR_register(LPM3_bits + GIE);
+        disableGlobalInterrupt();
     }
+    enableGlobalInterrupt();
 }
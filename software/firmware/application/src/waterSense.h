@@ -30,6 +30,8 @@
 #define PUMP_ACTIVE_LEVEL 3
 
 void waterSense_takeReading(void);
+bool waterSense_isProbing(void);
+void waterSense_calibrateGates(void);
 void waterSenseReadInternalTemp(void);
 
 #endif /* SRC_WATERSENSE_H_ */
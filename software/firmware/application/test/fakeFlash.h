@@ -0,0 +1,323 @@
+/**
+ * @file fakeFlash.h
+ * \n Header File
+ * \n AfridevV2 MSP430 Firmware Host Tests
+ *
+ * \brief Model of the flash controller for the flash driver host
+ *        tests.  The model sees each access to the FCTL registers
+ *        and the status register (see stub/msp430.h) and checks the
+ *        flash bytes changed since the last access.  A byte store is
+ *        an erase (the dummy write), a byte program or a block
+ *        program, depending on the FCTL1 mode.  Like the device,
+ *        programming can only clear bits, and a store while locked,
+ *        busy or in no mode is an access violation.  BUSY stays set
+ *        for a set number of delay loops after each operation, or
+ *        for ever to check the timeouts.
+ *
+ *        In block mode (BLKWRT and WRT) WAIT is always set, every
+ *        store of one block write must fall in the same 64 byte
+ *        block, and BUSY is set from when FCTL1 leaves block mode.
+ *
+ *        A store is only seen if it changes the byte.  The tests
+ *        never erase a segment whose first byte is 0 (the dummy write)
+ *        and never program 0xFF over an erased byte.
+ *
+ *        FAKE_SEGMENTS can be defined before including this file.
+ *
+ * \par   Copyright Notice
+ *        Copyright 2021 charity: water
+ *
+ *        Licensed under the Apache License, Version 2.0 (the "License");
+ *        you may not use this file except in compliance with the License.
+ *        You may obtain a copy of the License at
+ *
+ *            http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *        Unless required by applicable law or agreed to in writing, software
+ *        distributed under the License is distributed on an "AS IS" BASIS,
+ *        WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *        See the License for the specific language governing permissions and
+ *        limitations under the License.
+ *
+ */
+
+#ifndef TEST_FAKEFLASH_H_
+#define TEST_FAKEFLASH_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "msp430.h"
+
+/**
+ * \def FAKE_SEGMENT_SIZE
+ * \brief Size of one flash erase segment.
+ */
+#define FAKE_SEGMENT_SIZE 512
+
+/**
+ * \def FAKE_BLOCK_SIZE
+ * \brief Size of one flash block, the most one block write
+ *        programs.
+ */
+#define FAKE_BLOCK_SIZE 64
+
+#ifndef FAKE_SEGMENTS
+/**
+ * \def FAKE_SEGMENTS
+ * \brief Number of segments in the fake flash.
+ */
+#define FAKE_SEGMENTS 4
+#endif
+
+/**
+ * \def FAKE_FLASH_SIZE
+ * \brief Size of the fake flash.
+ */
+#define FAKE_FLASH_SIZE (FAKE_SEGMENT_SIZE * FAKE_SEGMENTS)
+
+/**
+ * \def BUSY_FOREVER
+ * \brief busyLoops value that never lets BUSY clear.
+ */
+#define BUSY_FOREVER 0xFFFF
+
+/**
+ * \def FCTL_STATUS_BITS
+ * \brief FCTL3 bits set by the controller, not by writes.
+ */
+#define FCTL_STATUS_BITS (BUSY | WAIT)
+
+/**
+ * \def FAKE_BLOCK_MODE
+ * \brief FCTL1 mode bits of a block write.
+ */
+#define FAKE_BLOCK_MODE (BLKWRT | WRT)
+
+/**
+ * \typedef fakeFlash_t
+ * \brief State of the flash controller model.
+ */
+typedef struct fakeFlash_s {
+    uint8_t mem[FAKE_FLASH_SIZE];                          /**< flash as the driver sees it */
+    uint8_t cell[FAKE_FLASH_SIZE];                         /**< flash as programmed */
+    volatile uint16_t fctl[4];                             /**< FCTL1..FCTL3 as last written */
+    uint16_t sr;                                           /**< status register */
+    uint16_t busyLoops;                                    /**< delay loops BUSY stays set */
+    uint16_t busyLeft;                                     /**< delay loops left in the operation */
+    bool inBlock;                                          /**< FCTL1 is in block mode */
+    bool dropBlocks;                                       /**< block stores are lost, to force a retry */
+    int blockStart;                                        /**< offset of the block being written, -1 if none yet */
+    long blockLimit;                                       /**< most block writes before giving up, 0 for no limit */
+    long keyViolations;                                    /**< FCTL writes without FWKEY */
+    long accessViolations;                                 /**< stores while locked or in no mode */
+    long busyStores;                                       /**< stores while BUSY */
+    long setBits;                                          /**< programs that try to set a bit */
+    long gieStores;                                        /**< byte or block programs with GIE set */
+    long blockCrossings;                                   /**< block stores outside the first block */
+    long erases;
+    long programs;
+    long blockWrites;
+    long delayCycles;
+} fakeFlash_t;
+
+static fakeFlash_t fake __attribute__((aligned(FAKE_SEGMENT_SIZE)));
+
+/**
+* \brief Program one flash byte from a byte or block write.
+*/
+static void fakeFlash_program(int i, uint8_t stored)
+{
+    if (stored & ~fake.cell[i])
+    {
+        fake.setBits++;
+    }
+    if (fake.sr & GIE)
+    {
+        fake.gieStores++;
+    }
+    fake.cell[i] &= stored;
+    fake.mem[i] = fake.cell[i];
+    fake.programs++;
+}
+
+/**
+* \brief Apply the flash stores made since the last access.
+*/
+static void fakeFlash_update(void)
+{
+    uint16_t mode;
+    bool unlocked;
+    int i;
+
+    for (i = 1; i <= 3; i++)
+    {
+        if ((fake.fctl[i] & 0xFF00) != FWKEY)
+        {
+            fake.keyViolations++;
+            fake.fctl[i] = (fake.fctl[i] & 0x00FF) | FWKEY;
+        }
+    }
+    mode = fake.fctl[1] & (ERASE | MERAS | WRT | BLKWRT);
+    unlocked = !(fake.fctl[3] & LOCK);
+
+    // Start or end of a block write
+    if (!fake.inBlock && (mode == FAKE_BLOCK_MODE))
+    {
+        fake.inBlock = true;
+        fake.blockStart = -1;
+        fake.blockWrites++;
+        if ((fake.blockLimit != 0) && (fake.blockWrites > fake.blockLimit))
+        {
+            printf("FAIL more than %ld block writes\n", fake.blockLimit);
+            exit(1);
+        }
+    }
+    else if (fake.inBlock && (mode != FAKE_BLOCK_MODE))
+    {
+        fake.inBlock = false;
+        fake.busyLeft = fake.busyLoops;
+    }
+
+    for (i = 0; i < FAKE_FLASH_SIZE; i++)
+    {
+        uint8_t stored = fake.mem[i];
+
+        if (stored == fake.cell[i])
+        {
+            continue;
+        }
+        if (fake.busyLeft != 0)
+        {
+            fake.busyStores++;
+            fake.mem[i] = fake.cell[i];
+        }
+        else if (unlocked && (mode == ERASE))
+        {
+            int start = i - (i % FAKE_SEGMENT_SIZE);
+
+            memset(&fake.cell[start], 0xFF, FAKE_SEGMENT_SIZE);
+            memset(&fake.mem[start], 0xFF, FAKE_SEGMENT_SIZE);
+            fake.erases++;
+            fake.busyLeft = fake.busyLoops;
+            i = start + FAKE_SEGMENT_SIZE - 1;
+        }
+        else if (unlocked && (mode == WRT))
+        {
+            fakeFlash_program(i, stored);
+            fake.busyLeft = fake.busyLoops;
+        }
+        else if (unlocked && (mode == FAKE_BLOCK_MODE))
+        {
+            if (fake.blockStart < 0)
+            {
+                fake.blockStart = i - (i % FAKE_BLOCK_SIZE);
+            }
+            if ((i < fake.blockStart) || (i >= fake.blockStart + FAKE_BLOCK_SIZE))
+            {
+                fake.blockCrossings++;
+            }
+            if (fake.dropBlocks)
+            {
+                fake.mem[i] = fake.cell[i];
+            }
+            else
+            {
+                fakeFlash_program(i, stored);
+            }
+        }
+        else
+        {
+            fake.accessViolations++;
+            fake.mem[i] = fake.cell[i];
+        }
+    }
+}
+
+volatile uint16_t *fakeFlash_register(int num)
+{
+    fakeFlash_update();
+    fake.fctl[3] &= ~FCTL_STATUS_BITS;
+    if (fake.inBlock)
+    {
+        fake.fctl[3] |= (BUSY | WAIT);
+    }
+    else if (fake.busyLeft != 0)
+    {
+        fake.fctl[3] |= BUSY;
+    }
+    return (&fake.fctl[num]);
+}
+
+uint16_t __get_SR_register(void)
+{
+    fakeFlash_update();
+    return (fake.sr);
+}
+
+void __bic_SR_register(uint16_t bits)
+{
+    fakeFlash_update();
+    fake.sr &= ~bits;
+}
+
+void __bis_SR_register(uint16_t bits)
+{
+    fakeFlash_update();
+    fake.sr |= bits;
+}
+
+void _delay_cycles(uint32_t cycles)
+{
+    fakeFlash_update();
+    fake.delayCycles += cycles;
+    if ((fake.busyLeft != 0) && (fake.busyLoops != BUSY_FOREVER))
+    {
+        fake.busyLeft--;
+    }
+}
+
+/**
+* \brief Reset the model.  The flash is filled with a pattern that
+*        has no zero bytes.
+*/
+static void fakeFlash_reset(uint16_t busyLoops)
+{
+    int i;
+
+    memset(&fake, 0, sizeof(fake));
+    for (i = 0; i < FAKE_FLASH_SIZE; i++)
+    {
+        fake.cell[i] = (uint8_t)((i % 251) + 1);
+    }
+    memcpy(fake.mem, fake.cell, FAKE_FLASH_SIZE);
+    fake.fctl[1] = FWKEY;
+    fake.fctl[2] = FWKEY;
+    fake.fctl[3] = FWKEY | LOCK;
+    fake.sr = GIE;
+    fake.busyLoops = busyLoops;
+}
+
+/**
+* \brief Check the model saw no key, access or GIE violations, and
+*        no block write left its block.
+*
+* @return bool false on a failure
+*/
+static bool fakeFlash_checkViolations(const char *nameP, bool allowBusyStores)
+{
+    if ((fake.keyViolations != 0) || (fake.accessViolations != 0) ||
+        (fake.gieStores != 0) || (fake.blockCrossings != 0) ||
+        (!allowBusyStores && (fake.busyStores != 0)))
+    {
+        printf("FAIL %s: key %ld access %ld gie %ld block %ld busy %ld\n", nameP,
+               fake.keyViolations, fake.accessViolations, fake.gieStores,
+               fake.blockCrossings, fake.busyStores);
+        return (false);
+    }
+    return (true);
+}
+
+#endif /* TEST_FAKEFLASH_H_ */
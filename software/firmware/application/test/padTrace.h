@@ -0,0 +1,188 @@
+/**
+ * @file padTrace.h
+ * \n Header File
+ * \n AfridevV2 MSP430 Firmware Host Tests
+ *
+ * \brief Pad sample traces for the algorithm host tests.  A trace is
+ *        either read from a recorded file or generated: each pad
+ *        has a dry level and drops by a per-pad amount when the
+ *        water covers it.  The water level rises and falls between
+ *        random targets, with long holds to reach the standing
+ *        water cases, and one of four noise modes.
+ *
+ *        A recorded trace is a text file with six pad counts per
+ *        line, pad0 first, separated by spaces or commas.
+ *
+ * \par   Copyright Notice
+ *        Copyright 2021 charity: water
+ *
+ *        Licensed under the Apache License, Version 2.0 (the "License");
+ *        you may not use this file except in compliance with the License.
+ *        You may obtain a copy of the License at
+ *
+ *            http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *        Unless required by applicable law or agreed to in writing, software
+ *        distributed under the License is distributed on an "AS IS" BASIS,
+ *        WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *        See the License for the specific language governing permissions and
+ *        limitations under the License.
+ *
+ */
+
+#ifndef TEST_PADTRACE_H_
+#define TEST_PADTRACE_H_
+
+#include <stdint.h>
+#include <stdio.h>
+
+/**
+ * \typedef padTrace_t
+ * \brief State of a generated or recorded trace.
+ */
+typedef struct padTrace_s {
+    uint32_t rand;                                         /**< xorshift state */
+    int base[6];                                           /**< dry level of each pad */
+    int drop[6];                                           /**< count drop of each pad when covered */
+    int level;                                             /**< number of pads covered, from pad5 up */
+    int target;                                            /**< level the water is moving to */
+    int hold;                                              /**< samples until the next target */
+    int mode;                                              /**< noise mode */
+    FILE *fileP;                                           /**< recorded trace, NULL if generated */
+} padTrace_t;
+
+static inline uint32_t padTrace_rand(padTrace_t *traceP)
+{
+    traceP->rand ^= traceP->rand << 13;
+    traceP->rand ^= traceP->rand >> 17;
+    traceP->rand ^= traceP->rand << 5;
+    return (traceP->rand);
+}
+
+static inline int padTrace_range(padTrace_t *traceP, int lo, int hi)
+{
+    return (lo + (int)(padTrace_rand(traceP) % (uint32_t)(hi - lo + 1)));
+}
+
+static inline void padTrace_init(padTrace_t *traceP, uint32_t seed)
+{
+    int i;
+
+    traceP->rand = seed ? seed : 1;
+    traceP->fileP = NULL;
+    for (i = 0; i < 6; i++)
+    {
+        traceP->base[i] = padTrace_range(traceP, 400, 1200);
+        traceP->drop[i] = padTrace_range(traceP, 20, 220);
+    }
+    traceP->level = 0;
+    traceP->target = 0;
+    traceP->hold = padTrace_range(traceP, 10, 400);
+    traceP->mode = padTrace_range(traceP, 0, 3);
+}
+
+/**
+ * \brief Open a recorded trace.
+ *
+ * @return int 0 if the file could not be opened
+ */
+static inline int padTrace_open(padTrace_t *traceP, const char *fileName)
+{
+    padTrace_init(traceP, 1);
+    traceP->fileP = fopen(fileName, "r");
+    return (traceP->fileP != NULL);
+}
+
+/**
+ * \brief Return the next sample of the six pads, pad0 first.
+ *
+ * @return int 0 at the end of a recorded trace
+ */
+static inline int padTrace_next(padTrace_t *traceP, uint16_t pads[6])
+{
+    int i;
+
+    if (traceP->fileP != NULL)
+    {
+        unsigned v[6];
+        if (fscanf(traceP->fileP, " %u%*[ ,] %u%*[ ,] %u%*[ ,] %u%*[ ,] %u%*[ ,] %u",
+                   &v[0], &v[1], &v[2], &v[3], &v[4], &v[5]) != 6)
+        {
+            return (0);
+        }
+        for (i = 0; i < 6; i++)
+        {
+            pads[i] = (uint16_t)v[i];
+        }
+        return (1);
+    }
+
+    if (--traceP->hold <= 0)
+    {
+        traceP->target = (padTrace_range(traceP, 0, 9) < 4) ? 0 : padTrace_range(traceP, 1, 6);
+        // Now and then hold long enough to reach the standing water cases
+        if (padTrace_range(traceP, 0, 30) == 0)
+        {
+            traceP->hold = padTrace_range(traceP, 3000, 4000);
+        }
+        else
+        {
+            traceP->hold = padTrace_range(traceP, 5, 600);
+        }
+        if (padTrace_range(traceP, 0, 20) == 0)
+        {
+            traceP->mode = padTrace_range(traceP, 0, 3);
+        }
+    }
+    if ((traceP->level < traceP->target) && (padTrace_range(traceP, 0, 2) == 0))
+    {
+        traceP->level++;
+    }
+    else if ((traceP->level > traceP->target) && (padTrace_range(traceP, 0, 3) == 0))
+    {
+        traceP->level--;
+    }
+
+    for (i = 0; i < 6; i++)
+    {
+        int covered = (5 - i) < traceP->level;
+        int v = traceP->base[i] - (covered ? traceP->drop[i] : 0);
+        switch (traceP->mode)
+        {
+            case 0:
+                v += padTrace_range(traceP, -2, 2);
+                break;
+            case 1:
+                v += padTrace_range(traceP, -15, 15);
+                break;
+            case 2:
+                v += padTrace_range(traceP, -60, 60);
+                break;
+            default:
+                // Mostly quiet with large spikes
+                if (padTrace_range(traceP, 0, 50) == 0)
+                {
+                    v += padTrace_range(traceP, -400, 400);
+                }
+                v += padTrace_range(traceP, -5, 5);
+                break;
+        }
+        // Slow drift of the dry level
+        if (padTrace_range(traceP, 0, 5000) == 0)
+        {
+            traceP->base[i] += padTrace_range(traceP, -30, 30);
+        }
+        if (v < 0)
+        {
+            v = 0;
+        }
+        if (v > 0xFFFF)
+        {
+            v = 0xFFFF;
+        }
+        pads[i] = (uint16_t)v;
+    }
+    return (1);
+}
+
+#endif /* TEST_PADTRACE_H_ */
@@ -0,0 +1,134 @@
+#!/bin/bash
+
+#
+# Build and run the application host tests using gcc
+#
+# Each test is built from the firmware sources it checks plus the host
+# stubs in stub/.  The MATLAB generated algorithm code is built in as the
+# reference the replacement modules are checked against.
+#
+# Usage: ./run_tests.sh [test_name ...]
+#   With no test names all the tests are run.
+#
+
+COMPILER="gcc"
+OUTPUT_DIR="out"
+
+SRC="../src"
+ALGO="../src/waterAlgorithm"
+ALGO_GEN="../src/waterAlgorithm/algo-c-code"
+BOOT_SRC="../../bootloader/src"
+
+# stub/rtwtypes.h is included first so the generated code uses MSP430
+# sized types on the host.  The firmware casts link addresses to 16
+# bits, uses the TI section pragmas and packs its flash records.  The
+# flash regions are const and not initialized, as common symbols they
+# stay writable for the flash models and their reads are not folded.
+OPTIONS=(   -std=gnu99 \
+            -O2 \
+            -fcommon \
+            -g \
+            -Wall \
+            -Wno-unused-function \
+            -Wno-pointer-to-int-cast \
+            -Wno-int-to-pointer-cast \
+            -Wno-unknown-pragmas \
+            -Wno-address-of-packed-member \
+            -include stub/rtwtypes.h )
+
+INCLUDE_PATHS=( -I. \
+                -Istub \
+                -I$SRC \
+                -I$ALGO \
+                -I$ALGO_GEN/calculateWaterVolume \
+                -I$ALGO_GEN/clearPadWindowProcess \
+                -I$ALGO_GEN/hourlyWaterVolume \
+                -I$ALGO_GEN/initializeWaterAlgorithm \
+                -I$ALGO_GEN/initializeWindows \
+                -I$ALGO_GEN/wakeupDataReset \
+                -I$ALGO_GEN/waterPadFiltering \
+                -I$ALGO_GEN/writePadSample )
+
+# The generated algorithm code, used as the reference
+ALGO_GEN_FILES=(    $ALGO_GEN/calculateWaterVolume/calculateWaterVolume.c \
+                    $ALGO_GEN/calculateWaterVolume/detectWaterChange.c \
+                    $ALGO_GEN/clearPadWindowProcess/clearPadWindowProcess.c \
+                    $ALGO_GEN/hourlyWaterVolume/hourlyWaterVolume.c \
+                    $ALGO_GEN/initializeWaterAlgorithm/initializeWaterAlgorithm.c \
+                    $ALGO_GEN/initializeWindows/initializeWindows.c \
+                    $ALGO_GEN/waterPadFiltering/waterPadFiltering.c \
+                    $ALGO_GEN/writePadSample/writePadSample.c )
+
+# The tests, in the order they are run
+TESTS=( "test_waterVolumeStream" \
+        "test_waterPadAverage" \
+        "test_hourlyVolume" \
+        "test_flash" \
+        "test_bootFlash" \
+        "test_storage" \
+        "test_crc16" \
+        "test_ctsHal" \
+        "test_probeSim" \
+        "test_otaUpgrade" )
+
+# Files that each test is built from, in addition to the test itself
+testFiles()
+{
+    case $1 in
+        test_waterVolumeStream)
+            echo ${ALGO_GEN_FILES[@]} $ALGO/waterVolumeStream.c ;;
+        test_waterPadAverage)
+            echo ${ALGO_GEN_FILES[@]} $ALGO/waterPadAverage.c ;;
+        test_hourlyVolume)
+            echo ${ALGO_GEN_FILES[@]} $ALGO/waterVolumeStream.c ;;
+        test_flash)
+            echo $SRC/flash.c ;;
+        test_bootFlash)
+            echo $BOOT_SRC/utils.c ;;
+        test_storage)
+            echo $SRC/utils.c ;;
+        test_crc16)
+            echo $SRC/utils.c ;;
+        test_ctsHal)
+            echo $SRC/CTS_HAL.c $SRC/CTS_Layer.c $SRC/structure.c ;;
+        test_probeSim)
+            echo ${ALGO_GEN_FILES[@]} $ALGO/appAlgo.c $ALGO/waterVolumeStream.c $ALGO/waterPadAverage.c \
+                 $SRC/waterSense.c $SRC/waterDetect.c $SRC/structure.c $SRC/utils.c ;;
+        test_otaUpgrade)
+            echo $SRC/utils.c ;;
+    esac
+}
+
+if [ $# -gt 0 ]; then
+    TESTS=( "$@" )
+fi
+
+cd "$(dirname "$0")" || exit 1
+mkdir -p $OUTPUT_DIR
+
+failed=0
+for TEST in ${TESTS[@]}; do
+    echo Building test: $TEST
+    BUILD_COMMAND="$COMPILER ${OPTIONS[@]} ${INCLUDE_PATHS[@]} -o $OUTPUT_DIR/$TEST $TEST.c $(testFiles $TEST)"
+    $BUILD_COMMAND
+    if [ $? -ne 0 ]
+    then
+        echo $BUILD_COMMAND
+        failed=1
+        continue
+    fi
+    echo Running test: $TEST
+    ./$OUTPUT_DIR/$TEST
+    if [ $? -ne 0 ]
+    then
+        failed=1
+    fi
+    echo
+done
+
+if [ $failed -ne 0 ]
+then
+    echo Host tests FAILED
+    exit 1
+fi
+echo All host tests passed
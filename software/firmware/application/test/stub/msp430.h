@@ -0,0 +1,130 @@
+/**
+ * @file msp430.h
+ * \n Header File
+ * \n AfridevV2 MSP430 Firmware Host Tests
+ *
+ * \brief Host build of the TI device header.  Only what the firmware
+ *        modules under test use is defined.  The flash controller
+ *        registers and the status register are reached through
+ *        functions so test_flash.c can model the flash controller.
+ *        The timer and port registers are plain variables, defined
+ *        by the tests that use them.
+ *
+ * \par   Copyright Notice
+ *        Copyright 2021 charity: water
+ *
+ *        Licensed under the Apache License, Version 2.0 (the "License");
+ *        you may not use this file except in compliance with the License.
+ *        You may obtain a copy of the License at
+ *
+ *            http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *        Unless required by applicable law or agreed to in writing, software
+ *        distributed under the License is distributed on an "AS IS" BASIS,
+ *        WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *        See the License for the specific language governing permissions and
+ *        limitations under the License.
+ *
+ */
+
+#ifndef TEST_STUB_MSP430_H_
+#define TEST_STUB_MSP430_H_
+
+#include <stdint.h>
+
+#define BIT0                (0x0001u)
+#define BIT1                (0x0002u)
+#define BIT2                (0x0004u)
+#define BIT3                (0x0008u)
+#define BIT4                (0x0010u)
+#define BIT5                (0x0020u)
+#define BIT6                (0x0040u)
+#define BIT7                (0x0080u)
+
+/* Status register */
+#define GIE                 (0x0008u)
+#define CPUOFF              (0x0010u)
+#define OSCOFF              (0x0020u)
+#define SCG0                (0x0040u)
+#define SCG1                (0x0080u)
+#define LPM0_bits           (CPUOFF)
+#define LPM3_bits           (SCG1 | SCG0 | CPUOFF)
+
+/* Flash controller, same values as msp430g2955.h */
+#define FCTL1               (*fakeFlash_register(1))
+#define FCTL2               (*fakeFlash_register(2))
+#define FCTL3               (*fakeFlash_register(3))
+
+#define FRKEY               (0x9600u)
+#define FWKEY               (0xA500u)
+
+#define ERASE               (0x0002u)
+#define MERAS               (0x0004u)
+#define EEI                 (0x0008u)
+#define EEIEX               (0x0010u)
+#define WRT                 (0x0040u)
+#define BLKWRT              (0x0080u)
+
+#define FN1                 (0x0002u)
+#define FSSEL_1             (0x0040u)
+
+#define BUSY                (0x0001u)
+#define KEYV                (0x0002u)
+#define ACCVIFG             (0x0004u)
+#define WAIT                (0x0008u)
+#define LOCK                (0x0010u)
+#define LOCKA               (0x0040u)
+#define FAIL                (0x0080u)
+
+/* Watchdog and timer registers, plain variables */
+#define WDTPW               (0x5A00u)
+#define WDTHOLD             (0x0080u)
+#define WDT_ARST_1000       (0x5A0Cu)
+#define CCIE                (0x0010u)
+#define CCIFG               (0x0001u)
+
+/* IFG1 reset flags */
+#define WDTIFG              (0x0001u)
+#define PORIFG              (0x0004u)
+#define RSTIFG              (0x0008u)
+
+/* Timer_A/Timer_B control bits */
+#define TASSEL_3            (0x0300u)
+#define MC_1                (0x0010u)
+#define MC_2                (0x0020u)
+#define TACLR               (0x0004u)
+#define TAIFG               (0x0001u)
+
+extern volatile uint16_t WDTCTL;
+extern volatile uint16_t TA1CTL;
+extern volatile uint16_t TA1CCTL0;
+extern volatile uint16_t TA1CCTL1;
+extern volatile uint16_t TA1CCR1;
+extern volatile uint16_t TA1R;
+extern volatile uint16_t TB0CTL;
+extern volatile uint16_t TB0CCTL0;
+extern volatile uint16_t TB0CCR0;
+extern volatile uint16_t TB0R;
+
+/* Port select registers of the cap-sense pads */
+extern volatile uint8_t P2SEL;
+extern volatile uint8_t P2SEL2;
+extern volatile uint8_t P3SEL;
+extern volatile uint8_t P3SEL2;
+extern volatile uint8_t P4SEL;
+extern volatile uint8_t P4SEL2;
+
+volatile uint16_t *fakeFlash_register(int num);
+
+/* Intrinsics */
+#define __interrupt
+uint16_t __get_SR_register(void);
+void __bic_SR_register(uint16_t bits);
+void __bis_SR_register(uint16_t bits);
+void __bic_SR_register_on_exit(uint16_t bits);
+void _delay_cycles(uint32_t cycles);
+#define __delay_cycles(cycles) _delay_cycles(cycles)
+#define _BIS_SR(bits) __bis_SR_register(bits)
+#define _BIC_SR(bits) __bic_SR_register(bits)
+
+#endif /* TEST_STUB_MSP430_H_ */
@@ -0,0 +1,174 @@
+/*
+ * File: rtwtypes.h
+ *
+ * Host build of the MATLAB Coder rtwtypes.h.  The fixed width types are
+ * sized as on the MSP430 (int is 16 bits) so the generated algorithm code
+ * behaves the same on the host as on the target.  The test build includes
+ * it first, which stops the copies next to the generated code from being
+ * used.
+ *
+ * \par  Copyright Notice
+ *       Copyright 2021 charity: water
+ *
+ *       Licensed under the Apache License, Version 2.0 (the "License");
+ *       you may not use this file except in compliance with the License.
+ *       You may obtain a copy of the License at
+ *
+ *           http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *       Unless required by applicable law or agreed to in writing, software
+ *       distributed under the License is distributed on an "AS IS" BASIS,
+ *       WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *       See the License for the specific language governing permissions and
+ *       limitations under the License.
+ *
+ */
+
+#ifndef RTWTYPES_H
+#define RTWTYPES_H
+#ifndef __cplusplus
+#include <stdbool.h>
+#endif
+#include <stdint.h>
+
+/*=======================================================================*
+ * Target hardware information
+ *   Device type: Texas Instruments->MSP430
+ *   Number of bits:     char:   8    short:   16    int:  16
+ *                       long:  32     long long:  64
+ *                       native word size:  16
+ *   Byte ordering: LittleEndian
+ *   Signed integer division rounds to: Zero
+ *   Shift right on a signed integer as arithmetic shift: on
+ *=======================================================================*/
+
+/*=======================================================================*
+ * Fixed width word size data types:                                     *
+ *   int8_T, int16_T, int32_T     - signed 8, 16, or 32 bit integers     *
+ *   uint8_T, uint16_T, uint32_T  - unsigned 8, 16, or 32 bit integers   *
+ *   real32_T, real64_T           - 32 and 64 bit floating point numbers *
+ *=======================================================================*/
+typedef int8_t int8_T;
+typedef uint8_t uint8_T;
+typedef int16_t int16_T;
+typedef uint16_t uint16_T;
+typedef int32_t int32_T;
+typedef uint32_t uint32_T;
+typedef int64_t int64_T;
+typedef uint64_t uint64_T;
+typedef float real32_T;
+typedef double real64_T;
+
+/*===========================================================================*
+ * Generic type definitions: real_T, time_T, boolean_T, int_T, uint_T,       *
+ *                           ulong_T, ulonglong_T, char_T and byte_T.        *
+ *===========================================================================*/
+typedef double real_T;
+typedef double time_T;
+typedef bool boolean_T;
+typedef int int_T;
+typedef unsigned int uint_T;
+typedef unsigned long ulong_T;
+typedef unsigned long long ulonglong_T;
+typedef char char_T;
+typedef char_T byte_T;
+
+/*===========================================================================*
+ * Complex number type definitions                                           *
+ *===========================================================================*/
+#define CREAL_T
+
+typedef struct {
+  real32_T re;
+  real32_T im;
+} creal32_T;
+
+typedef struct {
+  real64_T re;
+  real64_T im;
+} creal64_T;
+
+typedef struct {
+  real_T re;
+  real_T im;
+} creal_T;
+
+typedef struct {
+  int8_T re;
+  int8_T im;
+} cint8_T;
+
+typedef struct {
+  uint8_T re;
+  uint8_T im;
+} cuint8_T;
+
+typedef struct {
+  int16_T re;
+  int16_T im;
+} cint16_T;
+
+typedef struct {
+  uint16_T re;
+  uint16_T im;
+} cuint16_T;
+
+typedef struct {
+  int32_T re;
+  int32_T im;
+} cint32_T;
+
+typedef struct {
+  uint32_T re;
+  uint32_T im;
+} cuint32_T;
+
+typedef struct {
+  int64_T re;
+  int64_T im;
+} cint64_T;
+
+typedef struct {
+  uint64_T re;
+  uint64_T im;
+} cuint64_T;
+
+/*=======================================================================*
+ * Min and Max:                                                          *
+ *   int8_T, int16_T, int32_T     - signed 8, 16, or 32 bit integers     *
+ *   uint8_T, uint16_T, uint32_T  - unsigned 8, 16, or 32 bit integers   *
+ *=======================================================================*/
+#define MAX_int8_T                     ((int8_T)(127))
+#define MIN_int8_T                     ((int8_T)(-128))
+#define MAX_uint8_T                    ((uint8_T)(255))
+#define MIN_uint8_T                    ((uint8_T)(0))
+#define MAX_int16_T                    ((int16_T)(32767))
+#define MIN_int16_T                    ((int16_T)(-32768))
+#define MAX_uint16_T                   ((uint16_T)(65535))
+#define MIN_uint16_T                   ((uint16_T)(0))
+#define MAX_int32_T                    ((int32_T)(2147483647))
+#define MIN_int32_T                    ((int32_T)(-2147483647-1))
+#define MAX_uint32_T                   ((uint32_T)(0xFFFFFFFFU))
+#define MIN_uint32_T                   ((uint32_T)(0))
+#define MAX_int64_T                    ((int64_T)(9223372036854775807LL))
+#define MIN_int64_T                    ((int64_T)(-9223372036854775807LL-1LL))
+#define MAX_uint64_T                   ((uint64_T)(0xFFFFFFFFFFFFFFFFULL))
+#define MIN_uint64_T                   ((uint64_T)(0ULL))
+
+/* Logical type definitions */
+#if (!defined(__cplusplus)) && (!defined(__true_false_are_keywords)) && (!defined(__bool_true_false_are_defined))
+#  ifndef false
+#   define false                       (0U)
+#  endif
+
+#  ifndef true
+#   define true                        (1U)
+#  endif
+#endif
+#endif
+
+/*
+ * File trailer for rtwtypes.h
+ *
+ * [EOF]
+ */
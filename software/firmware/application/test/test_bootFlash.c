@@ -0,0 +1,248 @@
+/**
+ * @file test_bootFlash.c
+ * \n Source File
+ * \n AfridevV2 MSP430 Firmware Host Tests
+ *
+ * \brief Run the bootloader's backup-to-app copy against the model
+ *        of the flash controller in fakeFlash.h.  The bootloader's
+ *        flash.c is built into this file so its link address
+ *        helpers can point into the fake flash, which holds a four
+ *        segment backup image, the app image and the first
+ *        bootloader segment.  The copy uses block writes the first
+ *        time and byte writes on a retry.
+ *
+ * \par   Copyright Notice
+ *        Copyright 2021 charity: water
+ *
+ *        Licensed under the Apache License, Version 2.0 (the "License");
+ *        you may not use this file except in compliance with the License.
+ *        You may obtain a copy of the License at
+ *
+ *            http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *        Unless required by applicable law or agreed to in writing, software
+ *        distributed under the License is distributed on an "AS IS" BASIS,
+ *        WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *        See the License for the specific language governing permissions and
+ *        limitations under the License.
+ *
+ */
+#include <stdio.h>
+#include <string.h>
+
+/**
+ * \def IMAGE_SEGMENTS
+ * \brief Number of segments in the fake app image.
+ */
+#define IMAGE_SEGMENTS 4
+
+/**
+ * \def IMAGE_SIZE
+ * \brief Size of the fake app image.
+ */
+#define IMAGE_SIZE (IMAGE_SEGMENTS * FAKE_SEGMENT_SIZE)
+
+/**
+ * \def APP_OFFSET
+ * \brief Offset of the app image in the fake flash.
+ */
+#define APP_OFFSET IMAGE_SIZE
+
+/**
+ * \def BACKUP_OFFSET
+ * \brief Offset of the backup image in the fake flash.
+ */
+#define BACKUP_OFFSET 0
+
+/**
+ * \def BOOT_OFFSET
+ * \brief Offset of the bootloader in the fake flash.
+ */
+#define BOOT_OFFSET (2 * IMAGE_SIZE)
+
+/**
+ * \def IMAGE_BLOCKS
+ * \brief Number of block writes that copy the image once.
+ */
+#define IMAGE_BLOCKS (IMAGE_SIZE / FAKE_BLOCK_SIZE)
+
+#define FAKE_SEGMENTS (2 * IMAGE_SEGMENTS + 1)
+#include "fakeFlash.h"
+#include "../../bootloader/src/outpour.h"
+#include "../../bootloader/src/linkAddr.h"
+
+// Point the link addresses into the fake flash.  The app reset
+// vector is the last word before the bootloader, as in the linker
+// command file.
+#define getAppImageStartAddr() ((uintptr_t)&fake.mem[APP_OFFSET])
+#define getBackupImageStartAddr() ((uintptr_t)&fake.mem[BACKUP_OFFSET])
+#define getBootImageStartAddr() ((uintptr_t)&fake.mem[BOOT_OFFSET])
+#define getNumSectorsInImage() (IMAGE_SEGMENTS)
+#define getAppImageLength() (IMAGE_SIZE)
+#define __App_Reset_Vector (*(uint16_t *)&fake.mem[BOOT_OFFSET - 2])
+
+#include "../../bootloader/src/flash.c"
+
+volatile uint16_t WDTCTL;
+
+static bool backupExists;
+static uint16_t backupCrc;
+
+bool appRecord_getNewFirmwareInfo(bool *newFwReadyP, uint16_t *newFwCrcP)
+{
+    *newFwReadyP = backupExists;
+    *newFwCrcP = backupCrc;
+    return (true);
+}
+
+/**
+* \brief Reset the model and put a backup image in the fake flash.
+*        The image has no 0x00 or 0xFF bytes and differs from the
+*        old app image everywhere.
+*/
+static void setupBackup(uint16_t busyLoops)
+{
+    int i;
+
+    fakeFlash_reset(busyLoops);
+    for (i = 0; i < IMAGE_SIZE; i++)
+    {
+        fake.cell[BACKUP_OFFSET + i] = (uint8_t)(((i * 7 + (i >> 9)) % 127) + 128);
+        fake.cell[APP_OFFSET + i] = (uint8_t)((i % 127) + 1);
+    }
+    memcpy(fake.mem, fake.cell, FAKE_FLASH_SIZE);
+    backupExists = true;
+    backupCrc = gen_crc16(&fake.mem[BACKUP_OFFSET], IMAGE_SIZE);
+    // Two copies of the image is the most the bootloader writes
+    // before it gives up
+    fake.blockLimit = 2 * IMAGE_BLOCKS;
+}
+
+/**
+* \brief Check the copy left the controller idle and locked with GIE
+*        restored, and did not touch the bootloader.
+*
+* @return bool false on a failure
+*/
+static bool checkDone(const char *nameP, const uint8_t *bootP)
+{
+    fakeFlash_update();
+    if (fake.inBlock ||
+        ((fake.fctl[1] & 0x00FF) != 0) ||
+        !(fake.fctl[3] & LOCK) ||
+        !(fake.sr & GIE))
+    {
+        printf("FAIL %s: not idle, FCTL1 %04x FCTL3 %04x SR %04x\n",
+               nameP, fake.fctl[1], fake.fctl[3], fake.sr);
+        return (false);
+    }
+    if (memcmp(&fake.cell[BOOT_OFFSET], bootP, FAKE_SEGMENT_SIZE) != 0)
+    {
+        printf("FAIL %s: bootloader changed\n", nameP);
+        return (false);
+    }
+    return (fakeFlash_checkViolations(nameP, false) && (fake.setBits == 0));
+}
+
+/**
+* \brief Copy the backup with block writes.  The whole image is
+*        copied in one block write per 64 bytes.
+*
+* @return bool false on a failure
+*/
+static bool testBlockCopy(uint16_t busyLoops)
+{
+    uint8_t boot[FAKE_SEGMENT_SIZE];
+    fwCopyResult_t result;
+
+    setupBackup(busyLoops);
+    memcpy(boot, &fake.cell[BOOT_OFFSET], FAKE_SEGMENT_SIZE);
+    result = msp430Flash_moveAndVerifyBackupToApp();
+    if ((result != FW_COPY_SUCCESS) ||
+        (memcmp(&fake.cell[APP_OFFSET], &fake.cell[BACKUP_OFFSET], IMAGE_SIZE) != 0))
+    {
+        printf("FAIL block copy: result %d\n", result);
+        return (false);
+    }
+    if ((fake.erases != IMAGE_SEGMENTS) || (fake.blockWrites != IMAGE_BLOCKS) ||
+        (fake.programs != 2 + IMAGE_SIZE))
+    {
+        printf("FAIL block copy: %ld erases %ld blocks %ld programs\n",
+               fake.erases, fake.blockWrites, fake.programs);
+        return (false);
+    }
+    if ((busyLoops != 0) && (fake.delayCycles == 0))
+    {
+        printf("FAIL BUSY was not waited for\n");
+        return (false);
+    }
+    return (checkDone("block copy", boot));
+}
+
+/**
+* \brief The block writes are lost.  The verify fails, and the retry
+*        erases the app image again and copies it with byte writes.
+*
+* @return bool false on a failure
+*/
+static bool testByteRetry(void)
+{
+    uint8_t boot[FAKE_SEGMENT_SIZE];
+    fwCopyResult_t result;
+
+    setupBackup(2);
+    memcpy(boot, &fake.cell[BOOT_OFFSET], FAKE_SEGMENT_SIZE);
+    fake.dropBlocks = true;
+    result = msp430Flash_moveAndVerifyBackupToApp();
+    if ((result != FW_COPY_SUCCESS) ||
+        (memcmp(&fake.cell[APP_OFFSET], &fake.cell[BACKUP_OFFSET], IMAGE_SIZE) != 0) ||
+        (fake.erases != 2 * IMAGE_SEGMENTS) || (fake.blockWrites != IMAGE_BLOCKS))
+    {
+        printf("FAIL byte retry: result %d, %ld erases %ld blocks\n",
+               result, fake.erases, fake.blockWrites);
+        return (false);
+    }
+    return (checkDone("byte retry", boot));
+}
+
+/**
+* \brief No backup image, or one that fails its CRC, leaves the app
+*        image alone.
+*
+* @return bool false on a failure
+*/
+static bool testBadBackup(void)
+{
+    uint8_t app[IMAGE_SIZE];
+    fwCopyResult_t noBackup;
+    fwCopyResult_t badCrc;
+
+    setupBackup(0);
+    memcpy(app, &fake.cell[APP_OFFSET], IMAGE_SIZE);
+    backupExists = false;
+    noBackup = msp430Flash_moveAndVerifyBackupToApp();
+    backupExists = true;
+    backupCrc++;
+    badCrc = msp430Flash_moveAndVerifyBackupToApp();
+    if ((noBackup != FW_COPY_ERR_NO_BACKUP_IMAGE) || (badCrc != FW_COPY_ERR_BAD_BACKUP_CRC) ||
+        (memcmp(&fake.cell[APP_OFFSET], app, IMAGE_SIZE) != 0) ||
+        (fake.erases != 0) || (fake.programs != 0))
+    {
+        printf("FAIL bad backup: results %d %d\n", noBackup, badCrc);
+        return (false);
+    }
+    return (true);
+}
+
+int main(void)
+{
+    if (!testBlockCopy(0) ||
+        !testBlockCopy(3) ||
+        !testByteRetry() ||
+        !testBadBackup())
+    {
+        return (1);
+    }
+    printf("PASS bootloader flash copy\n");
+    return (0);
+}
@@ -0,0 +1,247 @@
+/**
+ * @file test_crc16.c
+ * \n Source File
+ * \n AfridevV2 MSP430 Firmware Host Tests
+ *
+ * \brief Check the table driven CRC16 of utils.c against the bit
+ *        serial CRC16 it replaces, then time both.  The bit serial
+ *        version below is the old gen_crc16(), with its 16 bit
+ *        shift register and volatile locals.  gen_crc16(),
+ *        gen_crc16_2buf() and the incremental crc16_init(),
+ *        crc16_update() and crc16_final() must all give the same
+ *        CRC, and the CRC-16/ARC check value 0xBB3D for
+ *        "123456789".
+ *
+ *        Usage: test_crc16 [random buffers]
+ *
+ * \par   Copyright Notice
+ *        Copyright 2021 charity: water
+ *
+ *        Licensed under the Apache License, Version 2.0 (the "License");
+ *        you may not use this file except in compliance with the License.
+ *        You may obtain a copy of the License at
+ *
+ *            http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *        Unless required by applicable law or agreed to in writing, software
+ *        distributed under the License is distributed on an "AS IS" BASIS,
+ *        WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *        See the License for the specific language governing permissions and
+ *        limitations under the License.
+ *
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "outpour.h"
+#include "padTrace.h"
+
+/**
+ * \def CRC16
+ * \brief The CRC-16-ANSI polynomial constant.
+ */
+#define CRC16 0x8005
+
+/**
+ * \def CRC16_CHECK
+ * \brief CRC-16/ARC of "123456789".
+ */
+#define CRC16_CHECK 0xBB3D
+
+/**
+ * \def TEST_BUFFER_SIZE
+ * \brief Size of the random data the buffers are taken from,
+ *        about the size of the application image.
+ */
+#define TEST_BUFFER_SIZE 20480
+
+/**
+ * \def MAX_TEST_LENGTH
+ * \brief Longest random buffer checked.
+ */
+#define MAX_TEST_LENGTH 1200
+
+/**
+ * \def BENCH_BYTES
+ * \brief Number of bytes the table driven version is timed over.
+ *        The bit serial version is timed over 1/100 of it.
+ */
+#define BENCH_BYTES 100000000L
+
+volatile uint16_t WDTCTL;
+
+static uint8_t testData[TEST_BUFFER_SIZE];
+static long checkCount;
+
+/**
+* \brief The bit serial CRC16 that gen_crc16() used before.
+*/
+static unsigned int refCrc16(const unsigned char *data, unsigned int size)
+{
+    volatile uint16_t out = 0;
+    volatile int bits_read = 0;
+    volatile int bit_flag;
+    unsigned int crc = 0;
+    unsigned int i;
+    unsigned int j;
+
+    while (size > 0)
+    {
+        bit_flag = out >> 15;
+        /* Get next bit: */
+        out <<= 1;
+        out |= (*data >> bits_read) & 1;                   // item a) work from the least significant bits
+        /* Increment bit counter: */
+        bits_read++;
+        if (bits_read > 7)
+        {
+            bits_read = 0;
+            data++;
+            size--;
+            WATCHDOG_TICKLE();
+        }
+        /* Cycle check: */
+        if (bit_flag)
+            out ^= CRC16;
+    }
+
+    // item b) "push out" the last 16 bits
+    for (i = 0; i < 16; ++i)
+    {
+        bit_flag = out >> 15;
+        out <<= 1;
+        if (bit_flag)
+            out ^= CRC16;
+    }
+
+    // item c) reverse the bits
+    for (i = 0x8000, j = 0x0001; i != 0; i >>= 1, j <<= 1)
+    {
+        if (i & out)
+            crc |= j;
+    }
+    return (crc);
+}
+
+/**
+* \brief Check one buffer with every entry point, split at a
+*        given point for the two part calls.
+*
+* @return bool false on a mismatch
+*/
+static bool check(const uint8_t *data, uint16_t size, uint16_t split)
+{
+    unsigned int ref = refCrc16(data, size);
+    uint16_t crc;
+
+    crc = crc16_init();
+    crc = crc16_update(crc, data, split);
+    crc = crc16_update(crc, &data[split], size - split);
+    checkCount++;
+
+    if ((gen_crc16(data, size) != ref) ||
+        (gen_crc16_2buf(data, split, &data[split], size - split) != ref) ||
+        (crc16_final(crc) != ref))
+    {
+        printf("FAIL size %u split %u: %04X %04X %04X %04X\n", size, split, ref, gen_crc16(data, size),
+               gen_crc16_2buf(data, split, &data[split], size - split), crc16_final(crc));
+        return (false);
+    }
+    return (true);
+}
+
+/**
+* \brief Time one version over a 512 byte flash segment.
+*
+* @return double nanoseconds per byte
+*/
+static double benchCrc(bool bitSerial)
+{
+    long bytes = bitSerial ? (BENCH_BYTES / 100) : BENCH_BYTES;
+    unsigned int sink = 0;
+    clock_t start;
+    long i;
+
+    start = clock();
+    for (i = 0; i < bytes; i += 512)
+    {
+        testData[0] = (uint8_t)i;
+        sink += bitSerial ? refCrc16(testData, 512) : gen_crc16(testData, 512);
+    }
+    if (sink == 1U)
+    {
+        printf(" ");
+    }
+    return ((double)(clock() - start) * 1e9 / CLOCKS_PER_SEC / bytes);
+}
+
+int main(int argc, char **argv)
+{
+    long numRandom = 50000L;
+    padTrace_t rng;
+    uint16_t size;
+    uint16_t split;
+    long i;
+
+    if ((argc > 1) && (atol(argv[1]) > 0))
+    {
+        numRandom = atol(argv[1]);
+    }
+    padTrace_init(&rng, 0x1D872B41UL);
+    for (i = 0; i < TEST_BUFFER_SIZE; i++)
+    {
+        testData[i] = (uint8_t)padTrace_rand(&rng);
+    }
+
+    // The CRC-16/ARC check value
+    if ((refCrc16((const unsigned char *)"123456789", 9) != CRC16_CHECK) ||
+        !check((const uint8_t *)"123456789", 9, 4))
+    {
+        printf("FAIL check value\n");
+        return (1);
+    }
+
+    // Every length across the watchdog tickle boundaries, split in
+    // the middle, and all zero and all one bytes
+    for (size = 0; size <= MAX_TEST_LENGTH; size++)
+    {
+        if (!check(testData, size, size / 2) || !check(&testData[size], size, 0) ||
+            !check(&testData[size], size, size))
+        {
+            return (1);
+        }
+    }
+    memset(testData, 0x00, 512);
+    memset(&testData[512], 0xFF, 512);
+    if (!check(testData, 512, 100) || !check(&testData[512], 512, 300) || !check(testData, 1024, 512))
+    {
+        return (1);
+    }
+    for (i = 0; i < 1024; i++)
+    {
+        testData[i] = (uint8_t)padTrace_rand(&rng);
+    }
+
+    // Random buffers and splits
+    for (i = 0; i < numRandom; i++)
+    {
+        size = padTrace_rand(&rng) % (MAX_TEST_LENGTH + 1);
+        split = padTrace_rand(&rng) % (size + 1);
+        if (!check(&testData[padTrace_rand(&rng) % (TEST_BUFFER_SIZE - MAX_TEST_LENGTH)], size, split))
+        {
+            return (1);
+        }
+    }
+
+    // The whole image, the same as otaUpgrade_verifySection()
+    if (gen_crc16(testData, TEST_BUFFER_SIZE) != refCrc16(testData, TEST_BUFFER_SIZE))
+    {
+        printf("FAIL image\n");
+        return (1);
+    }
+
+    printf("PASS %ld buffers\n", checkCount);
+    printf("bit serial %.2f ns/byte, table %.2f ns/byte\n", benchCrc(true), benchCrc(false));
+    return (0);
+}
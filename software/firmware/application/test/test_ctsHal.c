@@ -0,0 +1,572 @@
+/**
+ * @file test_ctsHal.c
+ * \n Source File
+ * \n AfridevV2 MSP430 Firmware Host Tests
+ *
+ * \brief Time the cap-sense sweeps of CTS_HAL.c against a model of
+ *        the gate and count timers.  Time is counted in ACLK periods
+ *        (32768Hz).  Each pad oscillates at its own rate while its
+ *        port is set up for the pin oscillator and TA1 counts, and
+ *        TIMERB0_ISR() runs when the gate timer reaches TB0CCR0.
+ *        Interrupts only happen while the CPU sleeps: the gate ISR,
+ *        and a system tick when one is set up.  Another interrupt
+ *        can hold off the gate ISR of one pad.
+ *
+ *        The chained sweep of TI_CAPT_RawStart() is checked against
+ *        the blocking TI_CAPT_Raw() it replaces:
+ *        - the counts match, for full and shortened gates and a
+ *          count that overflows;
+ *        - the CPU wakes once per sweep, not once per pad;
+ *        - the timers and ports are restored;
+ *        - a system tick during the sweep wakes the CPU but does not
+ *          cut a gate short, as it does in the blocking sweep;
+ *        - a held off gate ISR flags the pad in CAPSENSE_LATE, a
+ *          wake up jitter of one ACLK period does not.
+ *
+ * \par   Copyright Notice
+ *        Copyright 2021 charity: water
+ *
+ *        Licensed under the Apache License, Version 2.0 (the "License");
+ *        you may not use this file except in compliance with the License.
+ *        You may obtain a copy of the License at
+ *
+ *            http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *        Unless required by applicable law or agreed to in writing, software
+ *        distributed under the License is distributed on an "AS IS" BASIS,
+ *        WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *        See the License for the specific language governing permissions and
+ *        limitations under the License.
+ *
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "outpour.h"
+#include "CTS_Layer.h"
+
+/**
+ * \def NUM_TEST_PADS
+ * \brief Number of pads in the full sweep.
+ */
+#define NUM_TEST_PADS 6
+
+/**
+ * \def NO_TICK
+ * \brief tickPeriod value for no system tick.
+ */
+#define NO_TICK 0
+
+/**
+ * \def MAX_EVENTS
+ * \brief Most interrupts in one sleep before the model gives up.
+ */
+#define MAX_EVENTS 100
+
+/**
+ * \def SAVED_TA1CTL
+ * \brief Timer register values set before each sweep, that the
+ *        sweep must restore.  The system tick runs on TA1 CCR0.
+ */
+#define SAVED_TA1CTL 0x0116
+#define SAVED_TA1CCTL1 0x0030
+#define SAVED_TA1CCR1 0x1234
+#define SAVED_TB0CTL 0x0200
+#define SAVED_TB0CCTL0 0x0000
+#define SAVED_TB0CCR0 0x4321
+
+/**
+ * \def SAVED_SEL
+ * \brief Port select values set before each sweep.  Only the bits of
+ *        the pad being measured may change during its gate.
+ */
+#define SAVED_SEL 0x5A
+#define SAVED_SEL2 0x00
+
+void TIMERB0_ISR(void);
+
+volatile uint16_t WDTCTL;
+volatile uint16_t TA1CTL;
+volatile uint16_t TA1CCTL0;
+volatile uint16_t TA1CCTL1;
+volatile uint16_t TA1CCR1;
+volatile uint16_t TA1R;
+volatile uint16_t TB0CTL;
+volatile uint16_t TB0CCTL0;
+volatile uint16_t TB0CCR0;
+volatile uint16_t TB0R;
+volatile uint8_t P2SEL;
+volatile uint8_t P2SEL2;
+volatile uint8_t P3SEL;
+volatile uint8_t P3SEL2;
+volatile uint8_t P4SEL;
+volatile uint8_t P4SEL2;
+
+/**
+ * \typedef ctsModel_t
+ * \brief State of the timer model and what it measured.
+ */
+typedef struct ctsModel_s {
+    uint16_t sr;                                           /**< status register */
+    bool inIsr;                                            /**< an ISR is running */
+    bool wakeOnExit;                                       /**< the ISR cleared the LPM bits */
+    uint32_t now;                                          /**< ACLK periods since the model was reset */
+    uint32_t gateStart;                                    /**< when the running gate started */
+    bool gateRunning;                                      /**< a gate has been started */
+    uint32_t tickPeriod;                                   /**< system tick period, NO_TICK for none */
+    uint32_t nextTick;                                     /**< time of the next system tick */
+    uint16_t rate[NUM_TEST_PADS];                          /**< oscillator counts per ACLK period */
+    int lateGate;                                          /**< gate number whose ISR is held off, -1 for none */
+    uint16_t lateBy;                                       /**< ACLK periods that ISR is held off */
+    int gates;                                             /**< gate ISRs run */
+    int wakes;                                             /**< CPU wakes from LPM */
+    int ticks;                                             /**< system ticks while asleep */
+    int portErrors;                                        /**< gates without exactly one pad set up */
+} ctsModel_t;
+
+static ctsModel_t model;
+
+static uint16_t counts[NUM_TEST_PADS];
+static const uint16_t *doneCountsP;
+static int doneCalls;
+
+/**
+* \brief The pads of the full sweep, in order.
+*/
+static const struct Element *const pads[NUM_TEST_PADS] = { &pad0, &pad1, &pad2, &pad3, &pad4, &pad5 };
+
+/**
+* \brief The pad whose port is set up for the pin oscillator, -1 if
+*        none or more than one.
+*/
+static int oscillatingPad(void)
+{
+    int found = -1;
+    int i;
+
+    for (i = 0; i < NUM_TEST_PADS; i++)
+    {
+        if ((*pads[i]->inputPxsel2Register & pads[i]->inputBits) &&
+            !(*pads[i]->inputPxselRegister & pads[i]->inputBits))
+        {
+            if (found >= 0)
+            {
+                return (-1);
+            }
+            found = i;
+        }
+    }
+    return (found);
+}
+
+/**
+* \brief Bring TA1R up to date.  TA1 counts the oscillator of the pad
+*        set up while it runs in continuous mode, and sets TAIFG when
+*        it wraps.
+*/
+static void updateCount(void)
+{
+    int pad = oscillatingPad();
+    uint32_t count;
+
+    if (!model.gateRunning || !(TA1CTL & MC_2) || (pad < 0))
+    {
+        return;
+    }
+    count = (uint32_t)model.rate[pad] * (model.now - model.gateStart);
+    if (count > 0xFFFF)
+    {
+        TA1CTL |= TAIFG;
+    }
+    TA1R = (uint16_t)count;
+}
+
+/**
+* \brief Follow the gate timer.  TACLR starts a gate, it reads back
+*        as 0 like on the device.
+*/
+static void updateGate(void)
+{
+    if (TB0CTL & TACLR)
+    {
+        TB0CTL &= ~TACLR;
+        model.gateRunning = true;
+        model.gateStart = model.now;
+    }
+    if (!(TB0CTL & MC_1))
+    {
+        model.gateRunning = false;
+    }
+}
+
+/**
+* \brief Sleep until an ISR clears the LPM bits.  Runs the gate ISR
+*        and the system tick in time order.
+*/
+static void sleep(void)
+{
+    int events;
+
+    for (events = 0; events < MAX_EVENTS; events++)
+    {
+        bool gatePending;
+        uint32_t gateIsr;
+
+        updateGate();
+        gatePending = model.gateRunning && (TB0CTL & MC_1) && (TB0CCTL0 & CCIE);
+        gateIsr = model.gateStart + TB0CCR0;
+
+        if (gatePending && (model.gates == model.lateGate))
+        {
+            gateIsr += model.lateBy;
+        }
+        if ((model.tickPeriod != NO_TICK) && (!gatePending || (model.nextTick < gateIsr)))
+        {
+            // The system tick wakes the CPU
+            model.now = model.nextTick;
+            model.nextTick += model.tickPeriod;
+            model.ticks++;
+            updateCount();
+            return;
+        }
+        if (!gatePending)
+        {
+            printf("FAIL asleep with no gate running\n");
+            exit(1);
+        }
+
+        // The gate timer sits on TB0CCR0 for one period, then wraps
+        model.now = gateIsr;
+        TB0R = (model.now - model.gateStart == TB0CCR0) ? TB0CCR0 :
+               (uint16_t)(model.now - model.gateStart - TB0CCR0 - 1);
+        updateCount();
+        if (oscillatingPad() < 0)
+        {
+            model.portErrors++;
+        }
+        model.gates++;
+
+        model.inIsr = true;
+        model.wakeOnExit = false;
+        TIMERB0_ISR();
+        model.inIsr = false;
+        if (model.wakeOnExit)
+        {
+            return;
+        }
+    }
+    printf("FAIL more than %d interrupts in one sleep\n", MAX_EVENTS);
+    exit(1);
+}
+
+uint16_t __get_SR_register(void)
+{
+    return (model.sr);
+}
+
+void __bic_SR_register(uint16_t bits)
+{
+    model.sr &= ~bits;
+}
+
+void __bis_SR_register(uint16_t bits)
+{
+    if (model.inIsr)
+    {
+        printf("FAIL LPM entered from an ISR\n");
+        exit(1);
+    }
+    if (bits & CPUOFF)
+    {
+        sleep();
+        model.wakes++;
+        // GIE is set on the way out of the ISR
+        model.sr |= GIE;
+        return;
+    }
+    model.sr |= bits;
+}
+
+void __bic_SR_register_on_exit(uint16_t bits)
+{
+    if (bits & CPUOFF)
+    {
+        model.wakeOnExit = true;
+    }
+}
+
+/**
+* \brief Reset the model, with the saved timer and port registers
+*        and interrupts enabled.
+*/
+static void resetModel(uint32_t tickPeriod)
+{
+    int i;
+
+    memset(&model, 0, sizeof(model));
+    model.sr = GIE;
+    model.lateGate = -1;
+    model.tickPeriod = tickPeriod;
+    model.nextTick = tickPeriod;
+    for (i = 0; i < NUM_TEST_PADS; i++)
+    {
+        // 40 to 65 counts per ACLK period, about 1.3 to 2.1MHz
+        model.rate[i] = (uint16_t)(40 + 5 * i);
+    }
+    TA1CTL = SAVED_TA1CTL;
+    TA1CCTL1 = SAVED_TA1CCTL1;
+    TA1CCR1 = SAVED_TA1CCR1;
+    TB0CTL = SAVED_TB0CTL;
+    TB0CCTL0 = SAVED_TB0CCTL0;
+    TB0CCR0 = SAVED_TB0CCR0;
+    P2SEL = P3SEL = P4SEL = SAVED_SEL;
+    P2SEL2 = P3SEL2 = P4SEL2 = SAVED_SEL2;
+    memset(counts, 0, sizeof(counts));
+    doneCountsP = NULL;
+    doneCalls = 0;
+    CAPSENSE_LATE = 0;
+}
+
+static void sweepDone(const uint16_t *countsP)
+{
+    doneCountsP = countsP;
+    doneCalls++;
+}
+
+/**
+* \brief Run one sweep and wait for it the way waterSense does.
+*/
+static void chainedSweep(const struct Sensor *groupP)
+{
+    TI_CAPT_RawStart(groupP, counts, sweepDone);
+    disableGlobalInterrupt();
+    while (CAPSENSE_ACTIVE)
+    {
+        __bis_SR_register(LPM3_bits + GIE);
+        disableGlobalInterrupt();
+    }
+    enableGlobalInterrupt();
+}
+
+/**
+* \brief The count a pad gives for its whole gate.
+*/
+static uint16_t expectedCount(const struct Sensor *groupP, int element, uint16_t extra)
+{
+    const struct Element *elementP = groupP->arrayPtr[element];
+    int pad;
+    uint32_t count;
+
+    for (pad = 0; pads[pad] != elementP; pad++)
+    {
+    }
+    count = (uint32_t)model.rate[pad] * ((groupP->accumulationCycles >> *elementP->accumulationShift) + extra);
+    return ((count > 0xFFFF) ? 0xFFFF : (uint16_t)count);
+}
+
+/**
+* \brief The sum of the gates of a sweep in ACLK periods.
+*/
+static uint32_t sweepGates(const struct Sensor *groupP)
+{
+    uint32_t total = 0;
+    int i;
+
+    for (i = 0; i < groupP->numElements; i++)
+    {
+        total += groupP->accumulationCycles >> *groupP->arrayPtr[i]->accumulationShift;
+    }
+    return (total);
+}
+
+/**
+* \brief Check the registers were restored, interrupts are enabled
+*        and every gate had exactly one pad set up.
+*
+* @return bool false on a failure
+*/
+static bool checkRestored(const char *nameP)
+{
+    if ((TA1CTL != SAVED_TA1CTL) || (TA1CCTL1 != SAVED_TA1CCTL1) || (TA1CCR1 != SAVED_TA1CCR1) ||
+        (TB0CTL != SAVED_TB0CTL) || (TB0CCTL0 != SAVED_TB0CCTL0) || (TB0CCR0 != SAVED_TB0CCR0))
+    {
+        printf("FAIL %s: timers not restored\n", nameP);
+        return (false);
+    }
+    if ((P2SEL != SAVED_SEL) || (P3SEL != SAVED_SEL) || (P4SEL != SAVED_SEL) ||
+        (P2SEL2 != SAVED_SEL2) || (P3SEL2 != SAVED_SEL2) || (P4SEL2 != SAVED_SEL2))
+    {
+        printf("FAIL %s: ports not restored\n", nameP);
+        return (false);
+    }
+    if (!(model.sr & GIE) || (model.portErrors != 0) || CAPSENSE_ACTIVE)
+    {
+        printf("FAIL %s: SR %04x, %d port errors, active %u\n", nameP, model.sr,
+               model.portErrors, CAPSENSE_ACTIVE);
+        return (false);
+    }
+    return (true);
+}
+
+/**
+* \brief Chained and blocking sweeps of one group give the same
+*        counts in the same time.  The chained sweep wakes the CPU
+*        once.
+*
+* @return bool false on a failure
+*/
+static bool testSweep(const char *nameP, const struct Sensor *groupP)
+{
+    uint16_t blocking[NUM_TEST_PADS];
+    int blockingWakes;
+    uint32_t blockingTime;
+    int i;
+
+    resetModel(NO_TICK);
+    TI_CAPT_Raw(groupP, counts);
+    memcpy(blocking, counts, sizeof(blocking));
+    blockingWakes = model.wakes;
+    blockingTime = model.now;
+    if (!checkRestored(nameP))
+    {
+        return (false);
+    }
+
+    resetModel(NO_TICK);
+    chainedSweep(groupP);
+    for (i = 0; i < groupP->numElements; i++)
+    {
+        if ((counts[i] != blocking[i]) || (counts[i] != expectedCount(groupP, i, 0)))
+        {
+            printf("FAIL %s: element %d chained %u blocking %u expected %u\n", nameP, i,
+                   counts[i], blocking[i], expectedCount(groupP, i, 0));
+            return (false);
+        }
+    }
+    if ((model.wakes != 1) || (blockingWakes != groupP->numElements) ||
+        (model.gates != groupP->numElements) || (doneCalls != 1) || (doneCountsP != counts) ||
+        (model.now != sweepGates(groupP)) || (blockingTime != model.now) || (CAPSENSE_LATE != 0))
+    {
+        printf("FAIL %s: wakes %d/%d gates %d done %d time %u/%u late %02x\n", nameP,
+               model.wakes, blockingWakes, model.gates, doneCalls, model.now, blockingTime,
+               CAPSENSE_LATE);
+        return (false);
+    }
+    printf("%s: %u pads in %.2fms, CPU wakes %d blocking, %d chained\n", nameP,
+           groupP->numElements, model.now * 1000.0 / 32768, blockingWakes, model.wakes);
+    return (checkRestored(nameP));
+}
+
+/**
+* \brief A system tick in the middle of the sweep.  The chained sweep
+*        wakes for it, goes back to sleep and keeps every gate whole.
+*        The blocking sweep stops the pad it was measuring early.
+*
+* @return bool false on a failure
+*/
+static bool testTick(void)
+{
+    // Half way through the gate of pad1
+    uint32_t tick = (512 >> padGateShift[0]) + (512 >> padGateShift[1]) / 2;
+    int i;
+
+    resetModel(tick);
+    TI_CAPT_Raw(&pad_sensors, counts);
+    if (counts[1] >= expectedCount(&pad_sensors, 1, 0))
+    {
+        printf("FAIL tick: blocking count %u not cut short\n", counts[1]);
+        return (false);
+    }
+
+    resetModel(tick);
+    chainedSweep(&pad_sensors);
+    for (i = 0; i < NUM_TEST_PADS; i++)
+    {
+        if (counts[i] != expectedCount(&pad_sensors, i, 0))
+        {
+            printf("FAIL tick: element %d count %u expected %u\n", i, counts[i],
+                   expectedCount(&pad_sensors, i, 0));
+            return (false);
+        }
+    }
+    if ((model.ticks == 0) || (model.wakes != model.ticks + 1) || (CAPSENSE_LATE != 0))
+    {
+        printf("FAIL tick: %d ticks %d wakes late %02x\n", model.ticks, model.wakes, CAPSENSE_LATE);
+        return (false);
+    }
+    return (checkRestored("tick"));
+}
+
+/**
+* \brief A gate ISR held off by another interrupt.  One ACLK period
+*        of wake up jitter is not flagged, two are.  The pad counts for
+*        as long as it was held off.
+*
+* @return bool false on a failure
+*/
+static bool testLate(void)
+{
+    uint16_t lateBy;
+
+    for (lateBy = 1; lateBy <= 3; lateBy++)
+    {
+        uint8_t expectedLate = (lateBy >= 2) ? BIT2 : 0;
+
+        resetModel(NO_TICK);
+        model.lateGate = 2;
+        model.lateBy = lateBy;
+        chainedSweep(&pad_sensors);
+        if ((CAPSENSE_LATE != expectedLate) ||
+            (counts[2] != expectedCount(&pad_sensors, 2, lateBy)) ||
+            (counts[3] != expectedCount(&pad_sensors, 3, 0)))
+        {
+            printf("FAIL late by %u: flags %02x count %u expected %u\n", lateBy, CAPSENSE_LATE,
+                   counts[2], expectedCount(&pad_sensors, 2, lateBy));
+            return (false);
+        }
+        if (!checkRestored("late"))
+        {
+            return (false);
+        }
+    }
+    return (true);
+}
+
+/**
+* \brief A pad that counts past 0xFFFF reads 0xFFFF.
+*
+* @return bool false on a failure
+*/
+static bool testOverflow(void)
+{
+    resetModel(NO_TICK);
+    model.rate[4] = 300;
+    chainedSweep(&pad_sensors);
+    if ((counts[4] != 0xFFFF) || (counts[5] != expectedCount(&pad_sensors, 5, 0)))
+    {
+        printf("FAIL overflow: count %u\n", counts[4]);
+        return (false);
+    }
+    return (checkRestored("overflow"));
+}
+
+int main(void)
+{
+    static const uint8_t shifts[2][NUM_TEST_PADS] = { { 0, 0, 0, 0, 0, 0 }, { 0, 1, 2, 0, 1, 3 } };
+    int i;
+
+    for (i = 0; i < 2; i++)
+    {
+        memcpy(padGateShift, shifts[i], NUM_TEST_PADS);
+        if (!testSweep(i ? "all pads, shortened gates" : "all pads", &pad_sensors) ||
+            !testSweep(i ? "presence pads, shortened gates" : "presence pads", &pad_presence_sensors) ||
+            !testTick() ||
+            !testLate() ||
+            !testOverflow())
+        {
+            return (1);
+        }
+    }
+    printf("PASS cap-sense sweep\n");
+    return (0);
+}
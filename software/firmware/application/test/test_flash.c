@@ -0,0 +1,245 @@
+/**
+ * @file test_flash.c
+ * \n Source File
+ * \n AfridevV2 MSP430 Firmware Host Tests
+ *
+ * \brief Run the flash driver against the model of the flash
+ *        controller in fakeFlash.h.
+ *
+ * \par   Copyright Notice
+ *        Copyright 2021 charity: water
+ *
+ *        Licensed under the Apache License, Version 2.0 (the "License");
+ *        you may not use this file except in compliance with the License.
+ *        You may obtain a copy of the License at
+ *
+ *            http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *        Unless required by applicable law or agreed to in writing, software
+ *        distributed under the License is distributed on an "AS IS" BASIS,
+ *        WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *        See the License for the specific language governing permissions and
+ *        limitations under the License.
+ *
+ */
+#include <stdio.h>
+#include <string.h>
+#include "outpour.h"
+#include "fakeFlash.h"
+
+volatile uint16_t WDTCTL;
+volatile uint16_t TA1CCTL0;
+
+/**
+* \brief Check the driver left the controller idle and locked with
+*        GIE restored, and made no violations.
+*
+* @return bool false on a failure
+*/
+static bool fakeFlash_checkIdle(const char *nameP, bool allowBusyStores)
+{
+    fakeFlash_update();
+    if (msp430Flash_isBusy() ||
+        ((fake.fctl[1] & 0x00FF) != 0) ||
+        !(fake.fctl[3] & LOCK) ||
+        !(fake.sr & GIE))
+    {
+        printf("FAIL %s: not idle, FCTL1 %04x FCTL3 %04x SR %04x\n",
+               nameP, fake.fctl[1], fake.fctl[3], fake.sr);
+        return (false);
+    }
+    return (fakeFlash_checkViolations(nameP, allowBusyStores));
+}
+
+/**
+* \brief Erase two segments, then write across the segment boundary,
+*        one bounded step per poll.
+*
+* @return bool false on a failure
+*/
+static bool testEraseThenWrite(uint16_t busyLoops)
+{
+    uint8_t src[300];
+    uint8_t third[FAKE_SEGMENT_SIZE];
+    int polls;
+    int i;
+
+    fakeFlash_reset(busyLoops);
+    memcpy(third, &fake.cell[2 * FAKE_SEGMENT_SIZE], FAKE_SEGMENT_SIZE);
+    for (i = 0; i < (int)sizeof(src); i++)
+    {
+        src[i] = (uint8_t)(i % 200);
+    }
+
+    if (!msp430Flash_submitErase(fake.mem, 2))
+    {
+        printf("FAIL erase not accepted\n");
+        return (false);
+    }
+    // One operation at a time
+    if (msp430Flash_submitErase(fake.mem, 1) ||
+        msp430Flash_submitWrite(fake.mem, src, 1))
+    {
+        printf("FAIL second operation accepted while busy\n");
+        return (false);
+    }
+    for (polls = 1; msp430Flash_poll(); polls++)
+    {
+        if (polls != (int)fake.erases)
+        {
+            printf("FAIL more than one segment erased per poll\n");
+            return (false);
+        }
+    }
+    if ((polls != 2) || (fake.erases != 2))
+    {
+        printf("FAIL erase took %d polls, %ld erases\n", polls, fake.erases);
+        return (false);
+    }
+    for (i = 0; i < 2 * FAKE_SEGMENT_SIZE; i++)
+    {
+        if (fake.cell[i] != 0xFF)
+        {
+            printf("FAIL byte %d not erased\n", i);
+            return (false);
+        }
+    }
+
+    msp430Flash_submitWrite(&fake.mem[FAKE_SEGMENT_SIZE - 100], src, sizeof(src));
+    for (polls = 1; msp430Flash_poll(); polls++)
+    {
+    }
+    // 32 byte chunks
+    if ((polls != 10) || (fake.programs != (long)sizeof(src)))
+    {
+        printf("FAIL write took %d polls, %ld programs\n", polls, fake.programs);
+        return (false);
+    }
+    if ((memcmp(&fake.cell[FAKE_SEGMENT_SIZE - 100], src, 100) != 0) ||
+        (fake.cell[FAKE_SEGMENT_SIZE - 101] != 0xFF) ||
+        (fake.cell[2 * FAKE_SEGMENT_SIZE - 1] != 0xFF) ||
+        (memcmp(third, &fake.cell[2 * FAKE_SEGMENT_SIZE], FAKE_SEGMENT_SIZE) != 0))
+    {
+        printf("FAIL flash contents after write\n");
+        return (false);
+    }
+    if ((busyLoops != 0) && (fake.delayCycles == 0))
+    {
+        printf("FAIL BUSY was not waited for\n");
+        return (false);
+    }
+    return (fakeFlash_checkIdle("erase then write", false) && (fake.setBits == 0));
+}
+
+/**
+* \brief The blocking calls finish a submitted operation first, and
+*        the multi byte writes are MSB first.
+*
+* @return bool false on a failure
+*/
+static bool testBlockingCalls(void)
+{
+    uint8_t src[40];
+    static const uint8_t expected[6] = { 0x12, 0x34, 0xDE, 0xAD, 0xBE, 0xEF };
+    int i;
+
+    fakeFlash_reset(2);
+    for (i = 0; i < (int)sizeof(src); i++)
+    {
+        src[i] = (uint8_t)(0x80 + i);
+    }
+    msp430Flash_submitErase(&fake.mem[FAKE_SEGMENT_SIZE], 1);
+    msp430Flash_erase_segment(fake.mem);
+    msp430Flash_submitWrite(fake.mem, src, sizeof(src));
+    msp430Flash_write_int16(&fake.mem[100], 0x1234);
+    msp430Flash_write_int32(&fake.mem[102], 0xDEADBEEFUL);
+
+    if ((fake.erases != 2) ||
+        (memcmp(fake.cell, src, sizeof(src)) != 0) ||
+        (memcmp(&fake.cell[100], expected, sizeof(expected)) != 0) ||
+        (fake.cell[FAKE_SEGMENT_SIZE + 10] != 0xFF))
+    {
+        printf("FAIL blocking calls, %ld erases\n", fake.erases);
+        return (false);
+    }
+    // Zero length operations complete at once
+    if (!msp430Flash_submitErase(fake.mem, 0) ||
+        !msp430Flash_submitWrite(fake.mem, src, 0) ||
+        msp430Flash_poll())
+    {
+        printf("FAIL zero length operation\n");
+        return (false);
+    }
+    return (fakeFlash_checkIdle("blocking calls", false) && (fake.setBits == 0));
+}
+
+/**
+* \brief The model catches a write over programmed data.  Only checks
+*        the model, the driver leaves erasing to the caller.
+*
+* @return bool false on a failure
+*/
+static bool testWriteWithoutErase(void)
+{
+    uint8_t src[4] = { 0xFF, 0xFF, 0xFF, 0xFF };
+
+    fakeFlash_reset(0);
+    msp430Flash_write_bytes(fake.mem, src, sizeof(src));
+    if (fake.setBits == 0)
+    {
+        printf("FAIL write over programmed data not seen\n");
+        return (false);
+    }
+    return (fakeFlash_checkIdle("write without erase", false));
+}
+
+/**
+* \brief BUSY never clears.  The driver gives up on each wait after
+*        its timeout, locks the controller and restores GIE.  The
+*        failure is not reported, the stores made while BUSY are lost.
+*
+* @return bool false on a failure
+*/
+static bool testBusyTimeout(void)
+{
+    uint8_t src[8] = { 1, 2, 3, 4, 5, 6, 7, 8 };
+    long eraseCycles;
+
+    fakeFlash_reset(BUSY_FOREVER);
+    msp430Flash_erase_segment(fake.mem);
+    eraseCycles = fake.delayCycles;
+    // About 100ms at 1MHz
+    if ((fake.erases != 1) || (eraseCycles < 100000L) || (eraseCycles > 110000L))
+    {
+        printf("FAIL erase timeout, %ld cycles\n", eraseCycles);
+        return (false);
+    }
+    if (!fakeFlash_checkIdle("erase timeout", false))
+    {
+        return (false);
+    }
+
+    msp430Flash_write_bytes(&fake.mem[FAKE_SEGMENT_SIZE], src, sizeof(src));
+    if ((fake.busyStores != (long)sizeof(src)) || (fake.programs != 0) ||
+        (fake.delayCycles - eraseCycles > (long)sizeof(src) * 11000L))
+    {
+        printf("FAIL write timeout, %ld stores lost, %ld cycles\n",
+               fake.busyStores, fake.delayCycles - eraseCycles);
+        return (false);
+    }
+    return (fakeFlash_checkIdle("write timeout", true));
+}
+
+int main(void)
+{
+    if (!testEraseThenWrite(0) ||
+        !testEraseThenWrite(3) ||
+        !testBlockingCalls() ||
+        !testWriteWithoutErase() ||
+        !testBusyTimeout())
+    {
+        return (1);
+    }
+    printf("PASS flash driver\n");
+    return (0);
+}
@@ -0,0 +1,206 @@
+/**
+ * @file test_hourlyVolume.c
+ * \n Source File
+ * \n AfridevV2 MSP430 Firmware Host Tests
+ *
+ * \brief Check waterVolumeStream_hourlyVolume() and its shift and add
+ *        session volume against the MATLAB generated hourlyWaterVolume()
+ *        it replaces, then time both.  Each check sets up the same
+ *        session in both waterAlgoData_t copies.  The milliliter result,
+ *        the reason code and the data left behind must all match.
+ *
+ *        Usage: test_hourlyVolume [random pairs]
+ *
+ * \par   Copyright Notice
+ *        Copyright 2021 charity: water
+ *
+ *        Licensed under the Apache License, Version 2.0 (the "License");
+ *        you may not use this file except in compliance with the License.
+ *        You may obtain a copy of the License at
+ *
+ *            http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *        Unless required by applicable law or agreed to in writing, software
+ *        distributed under the License is distributed on an "AS IS" BASIS,
+ *        WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *        See the License for the specific language governing permissions and
+ *        limitations under the License.
+ *
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "hourlyWaterVolume.h"
+#include "waterVolumeStream.h"
+#include "padTrace.h"
+
+/**
+ * \def MAX_MEAN_HEIGHT
+ * \brief Largest mean water height the pads can report.
+ */
+#define MAX_MEAN_HEIGHT 197UL
+
+/**
+ * \def BENCH_CALLS
+ * \brief Number of hourly volume calls each version is timed over.
+ */
+#define BENCH_CALLS 20000000L
+
+static long checkCount;
+
+/**
+* \brief Set up one session in a waterAlgoData_t.
+*/
+static void setSession(waterAlgoData_t *dataP, uint32_t accum, uint32_t count, uint32_t volume, uint8_t present)
+{
+    memset(dataP, 0, sizeof(waterAlgoData_t));
+    dataP->present = present;
+    dataP->accum_water_height = accum;
+    dataP->water_height_counter = count;
+    dataP->accum_water_volume = volume;
+    dataP->prev_water_height = count ^ accum;
+    dataP->algo_state = b_water_present;
+}
+
+/**
+* \brief Run one session through both versions.
+*
+* @return bool false on a mismatch
+*/
+static bool check(uint32_t accum, uint32_t count, uint32_t volume, uint8_t present)
+{
+    waterAlgoData_t dataRef;
+    waterAlgoData_t dataNew;
+    ReasonCodes reasonRef;
+    ReasonCodes reasonNew;
+    uint32_T mlRef;
+    uint32_T litersRef;
+    uint32_t mlNew;
+
+    setSession(&dataRef, accum, count, volume, present);
+    setSession(&dataNew, accum, count, volume, present);
+    hourlyWaterVolume(&dataRef, &reasonRef, &mlRef, &litersRef);
+    mlNew = waterVolumeStream_hourlyVolume(&dataNew, &reasonNew);
+    checkCount++;
+
+    if ((mlRef != mlNew) || (reasonRef != reasonNew) ||
+        (memcmp(&dataRef, &dataNew, sizeof(waterAlgoData_t)) != 0))
+    {
+        printf("FAIL accum %lu count %lu volume %lu: %lu %lu\n",
+               (unsigned long)accum, (unsigned long)count, (unsigned long)volume,
+               (unsigned long)mlRef, (unsigned long)mlNew);
+        return (false);
+    }
+    return (true);
+}
+
+/**
+* \brief Time one version over BENCH_CALLS reachable sessions.
+*
+* @return double nanoseconds per call
+*/
+static double benchVolume(bool generated)
+{
+    waterAlgoData_t data;
+    ReasonCodes reason;
+    uint32_T ml;
+    uint32_T liters;
+    uint32_t sink = 0;
+    clock_t start;
+    long i;
+
+    start = clock();
+    for (i = 0; i < BENCH_CALLS; i++)
+    {
+        uint32_t count = (uint32_t)(i & 0xFFFF) + 1UL;
+        setSession(&data, count * (uint32_t)(1 + (i % MAX_MEAN_HEIGHT)), count, 0UL, 1U);
+        if (generated)
+        {
+            hourlyWaterVolume(&data, &reason, &ml, &liters);
+        }
+        else
+        {
+            ml = waterVolumeStream_hourlyVolume(&data, &reason);
+        }
+        sink += ml;
+    }
+    if (sink == 1UL)
+    {
+        printf(" ");
+    }
+    return ((double)(clock() - start) * 1e9 / CLOCKS_PER_SEC / BENCH_CALLS);
+}
+
+int main(int argc, char **argv)
+{
+    long numRandom = 4000000L;
+    padTrace_t rng;
+    uint32_t mean;
+    uint32_t count;
+    long i;
+    int k;
+
+    if ((argc > 1) && (atol(argv[1]) > 0))
+    {
+        numRandom = atol(argv[1]);
+    }
+    padTrace_init(&rng, 0x2545F491UL);
+
+    // Every reachable mean with counts up to one day of samples at the
+    // ends, the middle and a random point of each mean's range.
+    for (mean = 1; mean <= MAX_MEAN_HEIGHT; mean++)
+    {
+        for (count = 1; count <= 864000UL; count += (count < 4096UL) ? 1UL : 97UL)
+        {
+            if (!check(mean * count, count, 0UL, 1U) ||
+                !check(mean * count + count - 1UL, count, 0UL, 1U) ||
+                !check(mean * count + (padTrace_rand(&rng) % count), count, 0UL, 1U))
+            {
+                return (1);
+            }
+        }
+    }
+
+    // Random pairs, reachable and full 32 bit range
+    for (i = 0; i < numRandom; i++)
+    {
+        uint32_t accum;
+
+        count = padTrace_rand(&rng) >> (padTrace_rand(&rng) & 31);
+        if (i & 1)
+        {
+            accum = padTrace_rand(&rng);
+        }
+        else
+        {
+            accum = (count * (padTrace_rand(&rng) % (MAX_MEAN_HEIGHT + 1UL))) + (padTrace_rand(&rng) % (count + 1UL));
+        }
+        if (!check(accum, count, padTrace_rand(&rng) >> (padTrace_rand(&rng) & 31), 1U))
+        {
+            return (1);
+        }
+    }
+
+    // Powers of two, the volume cap and no session in progress
+    for (k = 0; k < 32; k++)
+    {
+        int j;
+
+        for (j = 0; j < 32; j++)
+        {
+            if (!check(1UL << k, 1UL << j, 0UL, 1U) ||
+                !check((1UL << k) - 1UL, 1UL << j, 0xFFFFFFFFUL - (1UL << j), 1U) ||
+                !check(0xFFFFFFFFUL >> k, (1UL << j) + 1UL, 0UL, 1U) ||
+                !check(0xFFFFFFFFUL, 1UL << j, 0xFFFFFFFFUL >> k, 0U))
+            {
+                return (1);
+            }
+        }
+    }
+
+    printf("PASS %ld sessions\n", checkCount);
+    printf("generated hourly volume %.1f ns/call, shift and add %.1f ns/call\n",
+           benchVolume(true), benchVolume(false));
+    return (0);
+}
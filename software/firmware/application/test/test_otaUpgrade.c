@@ -0,0 +1,937 @@
+/**
+ * @file test_otaUpgrade.c
+ * \n Source File
+ * \n AfridevV2 MSP430 Firmware Host Tests
+ *
+ * \brief Run firmware upgrade messages through msgOtaUpgrade.c
+ *        against a model of the flash and of the modem.  The
+ *        images come from the rom files in ci/helpers/
+ *        image_builder_legacy: the full upgrade message is the one
+ *        built there, and the delta messages are built here the way
+ *        afridevV2RomToDeltaMsg.py builds them.  The patch image is
+ *        the app image with six bytes inserted, which shifts the
+ *        code after it.
+ *
+ *        msgOtaUpgrade.c works on 16 bit flash addresses, so the
+ *        backup and app images are mapped at their MSP430 addresses.
+ *        The test is skipped if the host does not allow the mapping.
+ *
+ * \par   Copyright Notice
+ *        Copyright 2021 charity: water
+ *
+ *        Licensed under the Apache License, Version 2.0 (the "License");
+ *        you may not use this file except in compliance with the License.
+ *        You may obtain a copy of the License at
+ *
+ *            http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *        Unless required by applicable law or agreed to in writing, software
+ *        distributed under the License is distributed on an "AS IS" BASIS,
+ *        WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *        See the License for the specific language governing permissions and
+ *        limitations under the License.
+ *
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include "outpour.h"
+
+/**
+ * \def BACKUP_START
+ * \brief Backup image address, see lnk_msp430g2955.cmd.
+ */
+#define BACKUP_START 0x2200
+
+/**
+ * \def APP_START
+ * \brief App image address.
+ */
+#define APP_START 0x9000
+
+/**
+ * \def IMAGE_LENGTH
+ * \brief Length of the app and backup images.
+ */
+#define IMAGE_LENGTH 0x5000
+
+/**
+ * \def IMAGE_SEGMENTS
+ * \brief Number of flash segments in an image.
+ */
+#define IMAGE_SEGMENTS 40
+
+/**
+ * \def MAP_START
+ * \brief Start of the host mapping of the MSP430 flash, the first
+ *        segment below the backup image.
+ */
+#define MAP_START 0x2000
+
+/**
+ * \def MAP_LENGTH
+ * \brief Length of the host mapping, up to the bootloader.
+ */
+#define MAP_LENGTH (0xE000 - MAP_START)
+
+/**
+ * \def ROM_DIR
+ * \brief Where the legacy image builder keeps the rom files.
+ */
+#define ROM_DIR "../../ci/helpers/image_builder_legacy/"
+
+/**
+ * \def MAX_MSG_SIZE
+ * \brief Largest upgrade message.
+ */
+#define MAX_MSG_SIZE 0x10000
+
+/**
+ * \def MSG_HEADER_SIZE
+ * \brief Size of the message header and the section header.
+ */
+#define MSG_HEADER_SIZE 16
+
+/**
+ * \def FLASH_WRITE_STEP
+ * \brief Bytes the flash model writes per poll.
+ */
+#define FLASH_WRITE_STEP 32
+
+/**
+ * \def PATCH_OFFSET
+ * \brief Where the six bytes of the patch image are inserted.
+ */
+#define PATCH_OFFSET 0x1234
+
+/**
+ * \def MIN_COPY_LENGTH
+ * \brief Shortest copy op the delta builder uses, as in
+ *        afridevV2RomToDeltaMsg.py.
+ */
+#define MIN_COPY_LENGTH 8
+
+/**
+ * \def MIN_FILL_LENGTH
+ * \brief Shortest fill op the delta builder uses.
+ */
+#define MIN_FILL_LENGTH 6
+
+/**
+ * \def MAX_CANDIDATES
+ * \brief Most copy sources the delta builder tries at each position.
+ */
+#define MAX_CANDIDATES 64
+
+/**
+ * \def CHECK
+ * \brief Report a failed check with its line and fail the test.
+ */
+#define CHECK(cond) \
+    do { if (!(cond)) { printf("FAIL line %d: %s\n", __LINE__, #cond); return (false); } } while (0)
+
+// msgOtaUpgrade.c is built into this file with the link addresses of
+// the MSP430 images.
+#define getBackupImageStartAddr() ((uint16_t)BACKUP_START)
+#define getBackupImageEndAddr() ((uint16_t)(BACKUP_START + IMAGE_LENGTH - 1))
+#define getAppImageStartAddr() ((uint16_t)APP_START)
+#define getAppImageLength() ((uint16_t)IMAGE_LENGTH)
+#define getNumSectorsInImage() ((uint16_t)IMAGE_SEGMENTS)
+
+#include "../src/msgOtaUpgrade.c"
+
+/**
+ * \typedef fakeModem_t
+ * \brief State of the modem model.  It holds one upgrade message
+ *        and returns the part of it each incoming partial command
+ *        asks for.
+ */
+typedef struct fakeModem_s {
+    uint8_t msg[MAX_MSG_SIZE];                             /**< the upgrade message */
+    long msgLength;                                        /**< its length */
+    uint8_t buf[OTA_PAYLOAD_MAX_RX_READ_LENGTH];           /**< the OTA response buffer */
+    otaResponse_t response;                                /**< the last OTA response */
+    modemCmdWriteData_t cmd;                               /**< the command in progress */
+    bool busy;                                             /**< a command is in progress */
+    bool complete;                                         /**< the command completed */
+    bool error;                                            /**< the command failed */
+    bool held;                                             /**< the OTA buffer is held */
+    long commands;                                         /**< commands completed */
+    long failAfter;                                        /**< commands before every command fails, -1 for never */
+    long bytesSent;                                        /**< message bytes returned */
+} fakeModem_t;
+
+/**
+ * \typedef fakeFlash_t
+ * \brief State of the flash model.  The erase and write run one
+ *        step per poll, programming only clears bits.
+ */
+typedef struct fakeFlash_s {
+    uint8_t *eraseP;                                       /**< next segment to erase */
+    uint16_t eraseLeft;                                    /**< segments left to erase */
+    uint8_t *writeP;                                       /**< next byte to write */
+    const uint8_t *srcP;                                   /**< next byte to write from */
+    uint16_t writeLeft;                                    /**< bytes left to write */
+    long outside;                                          /**< erases or writes outside the backup image */
+} fakeFlash_t;
+
+volatile uint16_t WDTCTL;
+
+static uint8_t *const backupP = (uint8_t *)BACKUP_START;
+static uint8_t *const appP = (uint8_t *)APP_START;
+// The record is const to the compiler, read it through a volatile
+// pointer so the reads are not folded across the upgrade
+static const volatile upgradeProgress_t *const progressP = &upgradeProgress;
+static fakeModem_t modem;
+static fakeFlash_t flash;
+static uint8_t factoryImage[IMAGE_LENGTH];
+static uint8_t appImage[IMAGE_LENGTH];
+static uint8_t patchImage[IMAGE_LENGTH];
+static uint8_t deltaOps[MAX_MSG_SIZE];
+
+/*******************************************************************************
+* Flash and modem models
+*******************************************************************************/
+
+/**
+* \brief Count an erase or write that is outside the backup image
+*        and the progress record, or an erase of the backup image
+*        that does not start on a segment.
+*/
+static void checkFlashAddr(const uint8_t *flashP, uint16_t length, bool erase)
+{
+    const uint8_t *progressP = (const uint8_t *)&upgradeProgress;
+
+    if ((flashP >= progressP) && (flashP + length <= progressP + sizeof(upgradeProgress)))
+    {
+        return;
+    }
+    if ((flashP >= backupP) && (flashP + length <= backupP + IMAGE_LENGTH) &&
+        (!erase || (((flashP - backupP) % UPGRADE_SEGMENT_SIZE) == 0)))
+    {
+        return;
+    }
+    flash.outside++;
+}
+
+/**
+* \brief Erase the segment that starts at flashP.  The progress
+*        record is not segment aligned on the host.
+*/
+static void eraseSegment(uint8_t *flashP)
+{
+    checkFlashAddr(flashP, UPGRADE_SEGMENT_SIZE, true);
+    memset(flashP, 0xFF, UPGRADE_SEGMENT_SIZE);
+}
+
+static void programBytes(uint8_t *flashP, const uint8_t *srcP, uint16_t length)
+{
+    checkFlashAddr(flashP, length, false);
+    while (length-- > 0)
+    {
+        *flashP++ &= *srcP++;
+    }
+}
+
+bool msp430Flash_submitErase(uint8_t *flashSegmentAddrP, uint16_t num_segments)
+{
+    flash.eraseP = flashSegmentAddrP;
+    flash.eraseLeft = num_segments;
+    return (true);
+}
+
+bool msp430Flash_submitWrite(uint8_t *flashP, const uint8_t *srcP, uint16_t num_bytes)
+{
+    flash.writeP = flashP;
+    flash.srcP = srcP;
+    flash.writeLeft = num_bytes;
+    return (true);
+}
+
+bool msp430Flash_isBusy(void)
+{
+    return ((flash.eraseLeft != 0) || (flash.writeLeft != 0));
+}
+
+bool msp430Flash_poll(void)
+{
+    if (flash.eraseLeft != 0)
+    {
+        eraseSegment(flash.eraseP);
+        flash.eraseP += UPGRADE_SEGMENT_SIZE;
+        flash.eraseLeft--;
+    }
+    else if (flash.writeLeft != 0)
+    {
+        uint16_t length = (flash.writeLeft < FLASH_WRITE_STEP) ? flash.writeLeft : FLASH_WRITE_STEP;
+
+        programBytes(flash.writeP, flash.srcP, length);
+        flash.writeP += length;
+        flash.srcP += length;
+        flash.writeLeft -= length;
+    }
+    return (msp430Flash_isBusy());
+}
+
+void msp430Flash_erase_segment(uint8_t *flashSectorAddrP)
+{
+    eraseSegment(flashSectorAddrP);
+}
+
+void msp430Flash_write_bytes(uint8_t *flashP, uint8_t *srcP, uint16_t num_bytes)
+{
+    programBytes(flashP, srcP, num_bytes);
+}
+
+otaResponse_t *modemMgr_getLastOtaResponse(void)
+{
+    return (&modem.response);
+}
+
+void modemMgr_sendModemCmdBatch(modemCmdWriteData_t *cmdWriteP)
+{
+    modem.cmd = *cmdWriteP;
+    modem.busy = true;
+    modem.complete = false;
+    modem.error = false;
+}
+
+void modemMgr_stopModemCmdBatch(void)
+{
+    modem.busy = false;
+}
+
+bool modemMgr_isModemCmdComplete(void)
+{
+    return (modem.complete);
+}
+
+bool modemMgr_isModemCmdError(void)
+{
+    return (modem.error);
+}
+
+void modemMgr_holdOtaResponse(void)
+{
+    modem.held = true;
+}
+
+void modemMgr_releaseOtaResponse(void)
+{
+    modem.held = false;
+}
+
+/**
+* \brief Complete the command in progress.  The response is not
+*        written to the OTA buffer while it is held.
+*/
+void modemMgr_exec(void)
+{
+    long length;
+
+    if (!modem.busy || modem.held)
+    {
+        return;
+    }
+    modem.busy = false;
+    if ((modem.failAfter >= 0) && (modem.commands >= modem.failAfter))
+    {
+        modem.error = true;
+        return;
+    }
+    length = modem.cmd.payloadLength;
+    if (modem.cmd.payloadOffset + length > modem.msgLength)
+    {
+        length = modem.msgLength - modem.cmd.payloadOffset;
+    }
+    if (length < 0)
+    {
+        length = 0;
+    }
+    memcpy(modem.buf, &modem.msg[modem.cmd.payloadOffset], length);
+    modem.response.lengthInBytes = (uint16_t)length;
+    modem.response.remainingInBytes = (uint16_t)(modem.msgLength - modem.cmd.payloadOffset - length);
+    modem.bytesSent += length;
+    modem.commands++;
+    modem.complete = true;
+}
+
+void modemCmd_exec(void)
+{
+}
+
+bool appRecord_updateFwInfo(bool newFwIsReady, uint16_t newFwCrc)
+{
+    return (true);
+}
+
+uint32_t getSecondsSinceBoot(void)
+{
+    return (0);
+}
+
+/*******************************************************************************
+* Images and messages
+*******************************************************************************/
+
+/**
+* \brief Read the app image range of a TI-TXT rom file.  The rest of
+*        the image is erased flash.
+*
+* @return bool false if the file could not be read
+*/
+static bool readRom(const char *fileName, uint8_t *imageP)
+{
+    FILE *fileP = fopen(fileName, "r");
+    char word[16];
+    long addr = -1;
+
+    if (fileP == NULL)
+    {
+        printf("FAIL can not open %s\n", fileName);
+        return (false);
+    }
+    memset(imageP, 0xFF, IMAGE_LENGTH);
+    while (fscanf(fileP, "%15s", word) == 1)
+    {
+        if (word[0] == '@')
+        {
+            addr = strtol(&word[1], NULL, 16);
+        }
+        else if (word[0] == 'q')
+        {
+            break;
+        }
+        else if (addr >= 0)
+        {
+            if ((addr >= APP_START) && (addr < APP_START + IMAGE_LENGTH))
+            {
+                imageP[addr - APP_START] = (uint8_t)strtol(word, NULL, 16);
+            }
+            addr++;
+        }
+    }
+    fclose(fileP);
+    return (true);
+}
+
+/**
+* \brief Load the modem with a message file of hex bytes.
+*
+* @return bool false if the file could not be read
+*/
+static bool readMsg(const char *fileName)
+{
+    FILE *fileP = fopen(fileName, "r");
+    unsigned int value;
+
+    if (fileP == NULL)
+    {
+        printf("FAIL can not open %s\n", fileName);
+        return (false);
+    }
+    modem.msgLength = 0;
+    while ((modem.msgLength < MAX_MSG_SIZE) && (fscanf(fileP, "%x", &value) == 1))
+    {
+        modem.msg[modem.msgLength++] = (uint8_t)value;
+    }
+    fclose(fileP);
+    return (true);
+}
+
+static uint16_t putOp(uint16_t length, uint8_t op, uint16_t value, uint16_t opLength)
+{
+    deltaOps[length++] = op;
+    deltaOps[length++] = (uint8_t)(value >> 8);
+    deltaOps[length++] = (uint8_t)value;
+    if (op == DELTA_OP_COPY)
+    {
+        deltaOps[length++] = (uint8_t)(opLength >> 8);
+        deltaOps[length++] = (uint8_t)opLength;
+    }
+    return (length);
+}
+
+/**
+* \brief Build the delta ops that rebuild the new image from the
+*        base image, the same ops as createDelta() in
+*        afridevV2RomToDeltaMsg.py: the longest copy from the base
+*        image, else a run of one value, else literal bytes.
+*
+* @return uint16_t length of the ops in deltaOps
+*/
+static uint16_t buildDelta(const uint8_t *baseP, const uint8_t *newP)
+{
+    static int32_t first[0x10000];
+    static int32_t next[IMAGE_LENGTH];
+    uint16_t length = 0;
+    long literal = -1;
+    long i = 0;
+    long j;
+
+    // Chain the base positions by the hash of the bytes there
+    for (j = 0; j < 0x10000; j++)
+    {
+        first[j] = -1;
+    }
+    for (j = IMAGE_LENGTH - MIN_COPY_LENGTH; j >= 0; j--)
+    {
+        uint16_t hash = (uint16_t)gen_crc16(&baseP[j], MIN_COPY_LENGTH);
+
+        next[j] = first[hash];
+        first[hash] = (int32_t)j;
+    }
+
+    while (i < IMAGE_LENGTH)
+    {
+        long copyLength = 0;
+        long copyOffset = 0;
+        long fillLength = 0;
+        int candidates = 0;
+
+        if (i <= IMAGE_LENGTH - MIN_COPY_LENGTH)
+        {
+            for (j = first[(uint16_t)gen_crc16(&newP[i], MIN_COPY_LENGTH)];
+                 (j >= 0) && (candidates < MAX_CANDIDATES); j = next[j], candidates++)
+            {
+                long n = 0;
+
+                while ((i + n < IMAGE_LENGTH) && (j + n < IMAGE_LENGTH) && (newP[i + n] == baseP[j + n]))
+                {
+                    n++;
+                }
+                if (n > copyLength)
+                {
+                    copyLength = n;
+                    copyOffset = j;
+                }
+            }
+        }
+        while ((i + fillLength < IMAGE_LENGTH) && (newP[i + fillLength] == newP[i]))
+        {
+            fillLength++;
+        }
+
+        if (((copyLength >= MIN_COPY_LENGTH) && (copyLength >= fillLength)) || (fillLength >= MIN_FILL_LENGTH))
+        {
+            if (literal >= 0)
+            {
+                length = putOp(length, DELTA_OP_INSERT, (uint16_t)(i - literal), 0);
+                memcpy(&deltaOps[length], &newP[literal], i - literal);
+                length += (uint16_t)(i - literal);
+                literal = -1;
+            }
+            if ((copyLength >= MIN_COPY_LENGTH) && (copyLength >= fillLength))
+            {
+                length = putOp(length, DELTA_OP_COPY, (uint16_t)copyOffset, (uint16_t)copyLength);
+                i += copyLength;
+            }
+            else
+            {
+                length = putOp(length, DELTA_OP_FILL, (uint16_t)fillLength, 0);
+                deltaOps[length++] = newP[i];
+                i += fillLength;
+            }
+        }
+        else
+        {
+            if (literal < 0)
+            {
+                literal = i;
+            }
+            i++;
+        }
+    }
+    if (literal >= 0)
+    {
+        length = putOp(length, DELTA_OP_INSERT, (uint16_t)(i - literal), 0);
+        memcpy(&deltaOps[length], &newP[literal], i - literal);
+        length += (uint16_t)(i - literal);
+    }
+    return (length);
+}
+
+/**
+* \brief Find where the last op in deltaOps starts.
+*
+* @return uint16_t offset of the last op
+*/
+static uint16_t lastOpStart(uint16_t opsLength)
+{
+    uint16_t start = 0;
+    uint16_t i = 0;
+
+    while (i < opsLength)
+    {
+        start = i;
+        switch (deltaOps[i])
+        {
+            case DELTA_OP_COPY:
+                i += 5;
+                break;
+            case DELTA_OP_INSERT:
+                i += 3 + ((deltaOps[i + 1] << 8) | deltaOps[i + 2]);
+                break;
+            default:
+                i += 4;
+                break;
+        }
+    }
+    return (start);
+}
+
+/**
+* \brief Load the modem with a delta message for a section of the
+*        app image, the same layout as afridevV2RomToDeltaMsg.py
+*        writes.
+*/
+static void loadDeltaMsg(uint16_t sectionLength, uint16_t sectionCrc16, uint16_t baseCrc16,
+                         const uint8_t *opsP, uint16_t opsLength)
+{
+    static const uint8_t header[8] = { 0x10, 0x01, 0x02, 0x31, 0x41, 0x59, 0x26, 0x01 };
+    uint8_t *msgP = &modem.msg[0];
+
+    memcpy(msgP, header, sizeof(header));
+    msgP += sizeof(header);
+    *msgP++ = FLASH_UPGRADE_DELTA_SECTION_START;
+    *msgP++ = 0;
+    *msgP++ = (uint8_t)(APP_START >> 8);
+    *msgP++ = (uint8_t)APP_START;
+    *msgP++ = (uint8_t)(sectionLength >> 8);
+    *msgP++ = (uint8_t)sectionLength;
+    *msgP++ = (uint8_t)(sectionCrc16 >> 8);
+    *msgP++ = (uint8_t)sectionCrc16;
+    *msgP++ = (uint8_t)(baseCrc16 >> 8);
+    *msgP++ = (uint8_t)baseCrc16;
+    *msgP++ = (uint8_t)(opsLength >> 8);
+    *msgP++ = (uint8_t)opsLength;
+    memmove(msgP, opsP, opsLength);
+    modem.msgLength = MSG_HEADER_SIZE + OTA_UPDATE_DELTA_HEADER_SIZE + opsLength;
+}
+
+/**
+* \brief Load the modem with the delta message that rebuilds the
+*        new image from the base image.
+*
+* @return uint16_t length of the ops
+*/
+static uint16_t loadDelta(const uint8_t *baseP, const uint8_t *newP)
+{
+    uint16_t opsLength = buildDelta(baseP, newP);
+
+    loadDeltaMsg(IMAGE_LENGTH, gen_crc16(newP, IMAGE_LENGTH), gen_crc16(baseP, IMAGE_LENGTH),
+                 deltaOps, opsLength);
+    return (opsLength);
+}
+
+/*******************************************************************************
+* Tests
+*******************************************************************************/
+
+/**
+* \brief Set up the unit running an image.  The backup image holds
+*        old data, and the progress record is erased.
+*/
+static void setupUnit(const uint8_t *runningP)
+{
+    int i;
+
+    memcpy(appP, runningP, IMAGE_LENGTH);
+    for (i = 0; i < IMAGE_LENGTH; i++)
+    {
+        backupP[i] = (uint8_t)(i * 13 + 7);
+    }
+    memset((void *)&upgradeProgress, 0xFF, sizeof(upgradeProgress));
+}
+
+/**
+* \brief Run the upgrade message in the modem.
+*
+* @return int8_t the error code, FW_UP_ERR_NONE on success
+*/
+static int8_t runUpgrade(long failAfter)
+{
+    fwUpdateResult_t result;
+
+    modem.response.buf = &modem.buf[0];
+    modem.busy = false;
+    modem.held = false;
+    modem.commands = 0;
+    modem.bytesSent = 0;
+    modem.failAfter = failAfter;
+    memset(&flash, 0, sizeof(flash));
+
+    result = otaUpgrade_processOtaUpgradeMessage();
+    if ((int8_t)otaUpgrade_getErrorCode() == FW_UP_ERR_NONE)
+    {
+        return ((result == RESULT_DONE_SUCCESS) ? FW_UP_ERR_NONE : FW_UP_ERR_PARAMETER);
+    }
+    return ((int8_t)otaUpgrade_getErrorCode());
+}
+
+/**
+* \brief The full upgrade message of the image builder writes the
+*        app image from its rom file into the backup image.
+*
+* @return bool false on a failure
+*/
+static bool testFullImage(void)
+{
+    setupUnit(factoryImage);
+    CHECK(readMsg(ROM_DIR "AfridevV2_MSP430_msg.txt"));
+    CHECK(runUpgrade(-1) == FW_UP_ERR_NONE);
+    CHECK(memcmp(backupP, appImage, IMAGE_LENGTH) == 0);
+    CHECK(otaUpgrade_getFwCalculatedCrc() == gen_crc16(appImage, IMAGE_LENGTH));
+    CHECK(flash.outside == 0);
+    CHECK(modem.bytesSent == modem.msgLength - 8);
+    printf("full image: %ld message bytes\n", modem.msgLength);
+    return (true);
+}
+
+/**
+* \brief A full download that fails part way continues from its last
+*        checkpoint, and does not request the data before it again.
+*
+* @return bool false on a failure
+*/
+static bool testResume(void)
+{
+    long firstBytes;
+
+    setupUnit(factoryImage);
+    CHECK(readMsg(ROM_DIR "AfridevV2_MSP430_msg.txt"));
+    CHECK(runUpgrade(20) == FW_UP_ERR_MODEM);
+    firstBytes = modem.bytesSent;
+    CHECK(progressP->progress.magic == UPGRADE_PROGRESS_MAGIC);
+    CHECK(progressP->progress.checkpoints[0].bytesCommitted != UPGRADE_NO_CHECKPOINT);
+
+    CHECK(runUpgrade(-1) == FW_UP_ERR_NONE);
+    CHECK(memcmp(backupP, appImage, IMAGE_LENGTH) == 0);
+    CHECK(modem.bytesSent + firstBytes < modem.msgLength + 2 * OTA_PAYLOAD_MAX_RX_READ_LENGTH);
+    CHECK(progressP->progress.magic == 0xFFFF);
+    CHECK(flash.outside == 0);
+    return (true);
+}
+
+/**
+* \brief Delta messages rebuild the app image on a unit running the
+*        factory image, and the patch image on a unit running the
+*        app image.
+*
+* @return bool false on a failure
+*/
+static bool testDelta(void)
+{
+    uint16_t opsLength;
+
+    setupUnit(factoryImage);
+    opsLength = loadDelta(factoryImage, appImage);
+    CHECK(runUpgrade(-1) == FW_UP_ERR_NONE);
+    CHECK(memcmp(backupP, appImage, IMAGE_LENGTH) == 0);
+    CHECK(memcmp(appP, factoryImage, IMAGE_LENGTH) == 0);
+    CHECK(flash.outside == 0);
+    printf("factory->app delta: %u op bytes, %ld message bytes\n", opsLength, modem.msgLength);
+
+    setupUnit(appImage);
+    opsLength = loadDelta(appImage, patchImage);
+    CHECK(runUpgrade(-1) == FW_UP_ERR_NONE);
+    CHECK(memcmp(backupP, patchImage, IMAGE_LENGTH) == 0);
+    CHECK(otaUpgrade_getFwCalculatedCrc() == gen_crc16(patchImage, IMAGE_LENGTH));
+    CHECK(flash.outside == 0);
+    printf("app->patch delta: %u op bytes, %ld message bytes\n", opsLength, modem.msgLength);
+    return (true);
+}
+
+/**
+* \brief A delta after an interrupted full download clears the
+*        progress of the full download, even when the delta fails
+*        too, so a later full download starts over.
+*
+* @return bool false on a failure
+*/
+static bool testDeltaClearsProgress(void)
+{
+    setupUnit(factoryImage);
+    CHECK(readMsg(ROM_DIR "AfridevV2_MSP430_msg.txt"));
+    CHECK(runUpgrade(20) == FW_UP_ERR_MODEM);
+    CHECK(progressP->progress.magic == UPGRADE_PROGRESS_MAGIC);
+
+    loadDelta(factoryImage, appImage);
+    CHECK(runUpgrade(6) == FW_UP_ERR_MODEM);
+    CHECK(progressP->progress.magic == 0xFFFF);
+
+    CHECK(readMsg(ROM_DIR "AfridevV2_MSP430_msg.txt"));
+    CHECK(runUpgrade(-1) == FW_UP_ERR_NONE);
+    CHECK(memcmp(backupP, appImage, IMAGE_LENGTH) == 0);
+    CHECK(modem.bytesSent == modem.msgLength - 8);
+    CHECK(flash.outside == 0);
+    return (true);
+}
+
+/**
+* \brief A delta made against another image is refused before the
+*        backup image is erased.
+*
+* @return bool false on a failure
+*/
+static bool testWrongBase(void)
+{
+    uint8_t backup[IMAGE_LENGTH];
+
+    setupUnit(factoryImage);
+    memcpy(backup, backupP, IMAGE_LENGTH);
+    loadDelta(appImage, patchImage);
+    CHECK(runUpgrade(-1) == FW_UP_ERR_DELTA_BASE);
+    CHECK(memcmp(backup, backupP, IMAGE_LENGTH) == 0);
+    return (true);
+}
+
+/**
+* \brief Ops with an unknown opcode, ops that stop before the end of
+*        the section and a message shorter than its ops are refused.
+*
+* @return bool false on a failure
+*/
+static bool testBadOps(void)
+{
+    uint16_t opsLength;
+
+    // Unknown opcode in the middle of the ops
+    setupUnit(factoryImage);
+    opsLength = loadDelta(factoryImage, appImage);
+    CHECK(modem.msg[MSG_HEADER_SIZE + OTA_UPDATE_DELTA_HEADER_SIZE] == DELTA_OP_COPY);
+    modem.msg[MSG_HEADER_SIZE + OTA_UPDATE_DELTA_HEADER_SIZE] = 0x07;
+    CHECK(runUpgrade(-1) == FW_UP_ERR_PARAMETER);
+
+    // The last op left out
+    setupUnit(appImage);
+    opsLength = loadDelta(appImage, patchImage);
+    loadDeltaMsg(IMAGE_LENGTH, gen_crc16(patchImage, IMAGE_LENGTH), gen_crc16(appImage, IMAGE_LENGTH),
+                 deltaOps, lastOpStart(opsLength));
+    CHECK(runUpgrade(-1) == FW_UP_ERR_PARAMETER);
+
+    // The message ends before the ops do
+    loadDeltaMsg(IMAGE_LENGTH, gen_crc16(patchImage, IMAGE_LENGTH), gen_crc16(appImage, IMAGE_LENGTH),
+                 deltaOps, opsLength);
+    modem.msgLength -= 10;
+    CHECK(runUpgrade(-1) == FW_UP_ERR_PARAMETER);
+    CHECK(flash.outside == 0);
+    return (true);
+}
+
+/**
+* \brief Run delta ops on a 64 byte section.  The section CRC16 is
+*        the one of the expected section.
+*
+* @return int8_t the error code, FW_UP_ERR_NONE on success
+*/
+static int8_t runSmallDelta(const uint8_t *opsP, uint16_t opsLength, const uint8_t *expectP)
+{
+    setupUnit(appImage);
+    loadDeltaMsg(64, gen_crc16(expectP, 64), gen_crc16(appImage, 64), opsP, opsLength);
+    return (runUpgrade(-1));
+}
+
+/**
+* \brief Each delta op is checked against the section: a copy must
+*        lie in the running app section, an insert or fill must fit
+*        in the section.  A rejected op writes none of its bytes.
+*
+* @return bool false on a failure
+*/
+static bool testOpBounds(void)
+{
+    static const uint8_t good[] = { 0x01, 0x00, 0x08, 0x00, 0x20, 0x03, 0x00, 0x10, 0xAB,
+                                    0x02, 0x00, 0x10, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16 };
+    static const uint8_t copyStart[] = { 0x01, 0x00, 0x40, 0x00, 0x01 };
+    static const uint8_t copyEnd[] = { 0x01, 0x00, 0x38, 0x00, 0x09 };
+    static const uint8_t copyWrap[] = { 0x01, 0x00, 0x10, 0xFF, 0xF8 };
+    static const uint8_t copyPast[] = { 0x01, 0x01, 0x00, 0x00, 0x01 };
+    static const uint8_t fillEnd[] = { 0x01, 0x00, 0x00, 0x00, 0x28, 0x03, 0x00, 0x28, 0x00 };
+    static const uint8_t unknown[] = { 0x00, 0x00, 0x00, 0x00, 0x40 };
+    uint8_t expect[64];
+    uint16_t length;
+    int i;
+
+    // Copy 32 bytes from offset 8, fill 16 and insert 16
+    memcpy(expect, &appImage[8], 32);
+    memset(&expect[32], 0xAB, 16);
+    for (i = 0; i < 16; i++)
+    {
+        expect[48 + i] = (uint8_t)(i + 1);
+    }
+    CHECK(runSmallDelta(good, sizeof(good), expect) == FW_UP_ERR_NONE);
+    CHECK(memcmp(backupP, expect, 64) == 0);
+
+    // Copies that start at or run past the end of the section
+    CHECK(runSmallDelta(copyStart, sizeof(copyStart), expect) == FW_UP_ERR_PARAMETER);
+    CHECK(runSmallDelta(copyEnd, sizeof(copyEnd), expect) == FW_UP_ERR_PARAMETER);
+    CHECK(runSmallDelta(copyWrap, sizeof(copyWrap), expect) == FW_UP_ERR_PARAMETER);
+    CHECK(runSmallDelta(copyPast, sizeof(copyPast), expect) == FW_UP_ERR_PARAMETER);
+
+    // A fill and an insert that run past the end write nothing
+    CHECK(runSmallDelta(fillEnd, sizeof(fillEnd), expect) == FW_UP_ERR_PARAMETER);
+    CHECK(memcmp(backupP, appImage, 40) == 0);
+    for (i = 40; i < 64; i++)
+    {
+        CHECK(backupP[i] == 0xFF);
+    }
+
+    // The insert data is split across two modem chunks, the first
+    // part would fit.  Empty copies move the insert to the end of the
+    // first chunk.
+    memcpy(deltaOps, fillEnd, 5);
+    for (length = 5; length < OTA_PAYLOAD_MAX_RX_READ_LENGTH - 20; )
+    {
+        length = putOp(length, DELTA_OP_COPY, 0, 0);
+    }
+    length = putOp(length, DELTA_OP_INSERT, 25, 0);
+    for (i = 0; i < 25; i++)
+    {
+        deltaOps[length++] = (uint8_t)i;
+    }
+    CHECK(runSmallDelta(deltaOps, length, expect) == FW_UP_ERR_PARAMETER);
+    for (i = 40; i < 64; i++)
+    {
+        CHECK(backupP[i] == 0xFF);
+    }
+
+    CHECK(runSmallDelta(unknown, sizeof(unknown), expect) == FW_UP_ERR_PARAMETER);
+    CHECK(flash.outside == 0);
+    return (true);
+}
+
+int main(void)
+{
+    if (mmap((void *)MAP_START, MAP_LENGTH, PROT_READ | PROT_WRITE,
+             MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED_NOREPLACE, -1, 0) != (void *)MAP_START)
+    {
+        printf("SKIP OTA upgrade: can not map the MSP430 flash addresses\n");
+        return (0);
+    }
+    memset((void *)MAP_START, 0xFF, MAP_LENGTH);
+
+    if (!readRom(ROM_DIR "Factory_App_Boot_MSP430.txt", factoryImage) ||
+        !readRom(ROM_DIR "AfridevV2_MSP430_rom.txt", appImage))
+    {
+        return (1);
+    }
+    // The patch inserts six bytes, the end of the image is erased flash
+    memcpy(patchImage, appImage, PATCH_OFFSET);
+    memcpy(&patchImage[PATCH_OFFSET], "\x3F\x40\x34\x12\x0F\x93", 6);
+    memcpy(&patchImage[PATCH_OFFSET + 6], &appImage[PATCH_OFFSET], IMAGE_LENGTH - PATCH_OFFSET - 6);
+
+    if (!testFullImage() ||
+        !testResume() ||
+        !testDelta() ||
+        !testDeltaClearsProgress() ||
+        !testWrongBase() ||
+        !testBadOps() ||
+        !testOpBounds())
+    {
+        return (1);
+    }
+    printf("PASS OTA upgrade\n");
+    return (0);
+}
@@ -0,0 +1,435 @@
+/**
+ * @file test_probeSim.c
+ * \n Source File
+ * \n AfridevV2 MSP430 Firmware Host Tests
+ *
+ * \brief Simulate days of pump use through waterSense.c and the
+ *        algorithm, the way the sysExec main loop runs them, to
+ *        measure what the low rate pad probe costs.  Each tick runs
+ *        waterSense_takeReading(), APP_ALGO_runNest(), the dry count
+ *        reset on APP_ALGO_needsAllPads() or a front candidate, and
+ *        every TICKS_PER_TREND ticks the dry count increment.  The
+ *        hourly volume is read on the hour, as storageMgr does.
+ *
+ *        TI_CAPT_RawStart() is replaced by a model that fills the
+ *        counts of the requested pads from a generated pour trace and
+ *        completes the sweep at once.  The trace is a function of the
+ *        tick only, so each run sees the same water whatever it
+ *        measures.  The days are run twice, with dry_wake_time 0 (no
+ *        probing, the reference) and DRY_WAKE_TIME_DEFAULT, and for
+ *        each the pads measured, the pours the algorithm never saw,
+ *        the volume and the delay to the first sign of water are
+ *        reported.
+ *
+ *        Usage: test_probeSim [days]
+ *
+ * \par   Copyright Notice
+ *        Copyright 2021 charity: water
+ *
+ *        Licensed under the Apache License, Version 2.0 (the "License");
+ *        you may not use this file except in compliance with the License.
+ *        You may obtain a copy of the License at
+ *
+ *            http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *        Unless required by applicable law or agreed to in writing, software
+ *        distributed under the License is distributed on an "AS IS" BASIS,
+ *        WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *        See the License for the specific language governing permissions and
+ *        limitations under the License.
+ *
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "outpour.h"
+#include "CTS_Layer.h"
+#include "appAlgo.h"
+#include "padTrace.h"
+
+/**
+ * \def TICKS_PER_SECOND
+ * \brief Main loop ticks per second.
+ */
+#define TICKS_PER_SECOND 10L
+
+/**
+ * \def TICKS_PER_HOUR
+ * \brief Main loop ticks per hour.
+ */
+#define TICKS_PER_HOUR (3600L * TICKS_PER_SECOND)
+
+/**
+ * \def TICKS_PER_DAY
+ * \brief Main loop ticks per day.
+ */
+#define TICKS_PER_DAY (24L * TICKS_PER_HOUR)
+
+/**
+ * \def MAX_POURS
+ * \brief Most pours in one simulation.
+ */
+#define MAX_POURS 20000
+
+/**
+ * \def LONG_POUR_ODDS
+ * \brief One pour in this many is a long one.
+ */
+#define LONG_POUR_ODDS 20
+
+/**
+ * \def DETECT_GRACE_TICKS
+ * \brief A pour counts as seen if the water is present within this
+ *        many ticks after it ends.  Covers the WVS_PRESENT_LAG
+ *        samples a short pour is seen late by at the full rate.
+ */
+#define DETECT_GRACE_TICKS (10 * TICKS_PER_SECOND)
+
+/**
+ * \def MAX_DUTY_PERCENT
+ * \brief Most pad measurements, as a percentage of measuring all six
+ *        pads every tick, the probe may take over the simulation.
+ */
+#define MAX_DUTY_PERCENT 40.0
+
+/**
+ * \def MAX_VOLUME_PERCENT
+ * \brief Largest difference of the total volume from the reference,
+ *        as a percentage.
+ */
+#define MAX_VOLUME_PERCENT 1.0
+
+/**
+ * \def MAX_DELAY_TICKS
+ * \brief Longest the probe may delay the first sign of a pour
+ *        compared to the reference.  One probe interval plus the
+ *        full rate's own spread.
+ */
+#define MAX_DELAY_TICKS 10
+
+/**
+ * \typedef pour_t
+ * \brief One pour of the simulated pump.
+ */
+typedef struct pour_s {
+    long start;                                            /**< first tick with water on pad5 */
+    long end;                                              /**< tick the water is gone */
+    int level;                                             /**< pads covered while pumping */
+} pour_t;
+
+/**
+ * \typedef simResult_t
+ * \brief What one run measured.
+ */
+typedef struct simResult_s {
+    long padGates;                                         /**< pads measured */
+    long missed;                                           /**< pours never seen */
+    long probingWet;                                       /**< ticks probing while water is present */
+    long detectTick[MAX_POURS];                            /**< first tick water was present, -1 if never */
+    uint64_t volume_ml;                                    /**< sum of the hourly volumes */
+} simResult_t;
+
+volatile uint16_t WDTCTL;
+volatile uint8_t P2SEL;
+volatile uint8_t P2SEL2;
+volatile uint8_t P3SEL;
+volatile uint8_t P3SEL2;
+volatile uint8_t P4SEL;
+volatile uint8_t P4SEL2;
+uint8_t CAPSENSE_ACTIVE;
+uint8_t CAPSENSE_LATE;
+sysExecData_t sysExecData;
+
+static pour_t pours[MAX_POURS];
+static int numPours;
+static padTrace_t well;
+static uint16_t padNow[NUM_PADS];
+static long simTick;
+static long simGates;
+static simResult_t reference;
+static simResult_t probed;
+
+// Nothing else in use while the simulation runs
+bool modemMgr_isAllocated(void) { return (false); }
+bool modemMgr_isTransmitting(void) { return (false); }
+bool gps_isActive(void) { return (false); }
+bool manufRecord_getGateInfo(MDRgateRecord_t *gt) { return (false); }
+bool manufRecord_checkForValidManufRecord(void) { return (false); }
+bool manufRecord_updateManufRecord(MDR_type_e mr_type, uint8_t *mr_in, uint8_t len_in) { return (false); }
+bool manufRecord_getWaterInfo(MDRwaterRecord_t *wr) { return (false); }
+uint8_t getLastRebootReason(void) { return (0); }
+void msp430Flash_erase_segment(uint8_t *flashSectorAddrP) { }
+void msp430Flash_write_bytes(uint8_t *flashP, uint8_t *srcP, uint16_t num_bytes) { }
+
+/**
+* \brief Measure the pads of a group from the current trace sample.
+*        The sweep is done when this returns, so xWaitForSweep()
+*        does not sleep.
+*/
+void TI_CAPT_RawStart(const struct Sensor *groupP, uint16_t *counts, TI_CTS_DoneCallback_t doneCallback)
+{
+    uint8_t first = (groupP == &pad_presence_sensors) ? (NUM_PADS - groupP->numElements) : 0;
+    uint8_t i;
+
+    for (i = 0; i < groupP->numElements; i++)
+    {
+        counts[i] = padNow[first + i];
+    }
+    simGates += groupP->numElements;
+    CAPSENSE_LATE = 0;
+    CAPSENSE_ACTIVE = 0;
+    if (doneCallback != NULL)
+    {
+        doneCallback(counts);
+    }
+}
+
+// The sweeps complete at once, nothing sleeps
+uint16_t __get_SR_register(void) { return (0); }
+void __bic_SR_register(uint16_t bits) { }
+void __bis_SR_register(uint16_t bits) { }
+
+/**
+* \brief Plan the pours.  The pump is used from 06:00 to 19:00, with
+*        gaps of one minute to an hour, so there are dry spells both
+*        shorter and longer than the probe wait.  Each pour lasts 20
+*        seconds to 4 minutes and covers 2 to 6 pads.  One in
+*        LONG_POUR_ODDS pumps for 10 minutes, longer than the probe
+*        wait, so it is only measured at the full rate if the dry
+*        count is held at zero while water is present.
+*/
+static void planPours(int days)
+{
+    long t;
+    int day;
+
+    numPours = 0;
+    for (day = 0; day < days; day++)
+    {
+        t = day * TICKS_PER_DAY + 6 * TICKS_PER_HOUR + padTrace_range(&well, 0, 60 * 60 * TICKS_PER_SECOND);
+        while ((t < day * TICKS_PER_DAY + 19 * TICKS_PER_HOUR) && (numPours < MAX_POURS))
+        {
+            pour_t *pourP = &pours[numPours++];
+
+            pourP->start = t;
+            if (padTrace_range(&well, 1, LONG_POUR_ODDS) == 1)
+            {
+                pourP->end = t + 600 * TICKS_PER_SECOND;
+            }
+            else
+            {
+                pourP->end = t + padTrace_range(&well, 20 * TICKS_PER_SECOND, 240 * TICKS_PER_SECOND);
+            }
+            pourP->level = padTrace_range(&well, 2, 6);
+            t = pourP->end + padTrace_range(&well, 60 * TICKS_PER_SECOND, 3600 * TICKS_PER_SECOND);
+        }
+    }
+}
+
+/**
+* \brief Number of pads covered at a tick.  The water rises one pad
+*        every half second, sways one pad with the pump strokes and
+*        drains one pad every two seconds after the pour.
+*/
+static int waterLevel(long tick)
+{
+    int lo = 0;
+    int hi = numPours - 1;
+
+    // Last pour that started at or before the tick
+    while (lo <= hi)
+    {
+        int mid = (lo + hi) / 2;
+
+        if (pours[mid].start <= tick)
+        {
+            lo = mid + 1;
+        }
+        else
+        {
+            hi = mid - 1;
+        }
+    }
+    if (hi >= 0)
+    {
+        const pour_t *pourP = &pours[hi];
+        long rising = (tick - pourP->start) / 5 + 1;
+        long level;
+
+        if (tick < pourP->end)
+        {
+            level = (rising < pourP->level) ? rising : pourP->level;
+            if ((rising > pourP->level) && (((tick - pourP->start) / 15) & 1))
+            {
+                level--;
+            }
+            return ((int)level);
+        }
+        level = pourP->level - (tick - pourP->end) / 20;
+        if (level > 0)
+        {
+            return ((int)((level < rising) ? level : rising));
+        }
+    }
+    return (0);
+}
+
+/**
+* \brief Set the pad counts for the current tick.  Each pad reads its
+*        dry level less its drop when covered, with a few counts of
+*        noise.
+*/
+static void updatePads(void)
+{
+    int level = waterLevel(simTick);
+    int i;
+
+    for (i = 0; i < NUM_PADS; i++)
+    {
+        int covered = (5 - i) < level;
+
+        padNow[i] = (uint16_t)(well.base[i] - (covered ? well.drop[i] : 0) + padTrace_range(&well, -3, 3));
+    }
+}
+
+/**
+* \brief Run the days through the main loop with one dry_wake_time.
+*/
+static void runDays(int days, uint32_t seed, uint16_t dryWakeTime, simResult_t *resultP)
+{
+    uint8_t exec_main_loop_counter = 0;
+    long ticks = days * TICKS_PER_DAY;
+    int pour = 0;
+    int i;
+
+    memset(resultP, 0, sizeof(simResult_t));
+    for (i = 0; i < numPours; i++)
+    {
+        resultP->detectTick[i] = -1;
+    }
+    padTrace_init(&well, seed);
+    for (i = 0; i < NUM_PADS; i++)
+    {
+        well.drop[i] = padTrace_range(&well, 150, 300);
+    }
+
+    memset(&sysExecData, 0, sizeof(sysExecData_t));
+    sysExecData.dry_wake_time = dryWakeTime;
+    waterSense_init();
+    APP_ALGO_init();
+    simGates = 0;
+
+    for (simTick = 0; simTick < ticks; simTick++)
+    {
+        updatePads();
+
+        waterSense_takeReading();
+        APP_ALGO_runNest();
+
+        if (APP_ALGO_needsAllPads() || APP_ALGO_isFrontCandidate())
+        {
+            sysExecData.dry_count = 0;
+        }
+
+        exec_main_loop_counter++;
+        if (exec_main_loop_counter >= TICKS_PER_TREND)
+        {
+            exec_main_loop_counter = 0;
+            if (sysExecData.dry_count < UINT16_MAX)
+            {
+                sysExecData.dry_count++;
+            }
+        }
+
+        if (waterSense_isProbing() && APP_ALGO_isWaterPresent())
+        {
+            resultP->probingWet++;
+        }
+
+        if (((simTick + 1) % TICKS_PER_HOUR) == 0)
+        {
+            resultP->volume_ml += APP_ALGO_getHourlyWaterVolume_ml();
+        }
+
+        // Note when each pour is first seen
+        while ((pour < numPours) && (simTick >= pours[pour].end + DETECT_GRACE_TICKS))
+        {
+            pour++;
+        }
+        if ((pour < numPours) && (simTick >= pours[pour].start) &&
+            (resultP->detectTick[pour] < 0) && APP_ALGO_isWaterPresent())
+        {
+            resultP->detectTick[pour] = simTick;
+        }
+    }
+
+    resultP->padGates = simGates;
+    for (i = 0; i < numPours; i++)
+    {
+        if (resultP->detectTick[i] < 0)
+        {
+            resultP->missed++;
+        }
+    }
+}
+
+int main(int argc, char **argv)
+{
+    const uint32_t seed = 0x5EED0006UL;
+    int days = 10;
+    double duty;
+    double volumeError;
+    long delaySum = 0;
+    long delayMax = 0;
+    long seen = 0;
+    int i;
+
+    if ((argc > 1) && (atoi(argv[1]) > 0))
+    {
+        days = atoi(argv[1]);
+    }
+    padTrace_init(&well, seed ^ 0xA5A5A5A5UL);
+    planPours(days);
+
+    runDays(days, seed, 0, &reference);
+    runDays(days, seed, DRY_WAKE_TIME_DEFAULT, &probed);
+
+    for (i = 0; i < numPours; i++)
+    {
+        if ((reference.detectTick[i] >= 0) && (probed.detectTick[i] >= 0))
+        {
+            long delay = probed.detectTick[i] - reference.detectTick[i];
+
+            delaySum += delay;
+            if (delay > delayMax)
+            {
+                delayMax = delay;
+            }
+            seen++;
+        }
+    }
+    duty = 100.0 * probed.padGates / ((double)days * TICKS_PER_DAY * NUM_PADS);
+    volumeError = (reference.volume_ml == 0) ? 100.0 :
+                  100.0 * ((double)probed.volume_ml - (double)reference.volume_ml) / (double)reference.volume_ml;
+
+    printf("%d days, %d pours\n", days, numPours);
+    printf("reference: %.1f%% of full pad measurements, %ld missed, %llu ml\n",
+           100.0 * reference.padGates / ((double)days * TICKS_PER_DAY * NUM_PADS),
+           reference.missed, (unsigned long long)reference.volume_ml);
+    printf("probe: %.1f%% of full pad measurements, %ld missed, %llu ml (%+.3f%%), %ld wet probe ticks\n",
+           duty, probed.missed, (unsigned long long)probed.volume_ml, volumeError, probed.probingWet);
+    printf("probe detection delay: %.2f s average, %.1f s max\n",
+           (seen == 0) ? 0.0 : (double)delaySum / seen / TICKS_PER_SECOND,
+           (double)delayMax / TICKS_PER_SECOND);
+
+    if ((reference.missed != 0) || (probed.missed != 0) || (probed.probingWet != 0) ||
+        (duty > MAX_DUTY_PERCENT) ||
+        (volumeError > MAX_VOLUME_PERCENT) || (volumeError < -MAX_VOLUME_PERCENT) ||
+        (delayMax > MAX_DELAY_TICKS))
+    {
+        printf("FAIL probe simulation\n");
+        return (1);
+    }
+    printf("PASS probe simulation\n");
+    return (0);
+}
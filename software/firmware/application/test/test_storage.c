@@ -0,0 +1,428 @@
+/**
+ * @file test_storage.c
+ * \n Source File
+ * \n AfridevV2 MSP430 Firmware Host Tests
+ *
+ * \brief Run the storage manager through days with resets in the
+ *        middle of them.  storage.c is built into this file so the
+ *        test can look at today's log record and the RAM copy of
+ *        the day.  The flash driver is replaced by a model of the
+ *        flash that only clears bits when programmed, the RTC by a
+ *        test clock and the algorithm by a water volume the test
+ *        sets for each hour or quarter hour.
+ *
+ *        A reset is modeled the way the unit comes back up: the RTC
+ *        restarts at 00:00, storageMgr_init() is called and the GMT
+ *        clock setting message later calls storageMgr_setStorageTime().
+ *
+ * \par   Copyright Notice
+ *        Copyright 2021 charity: water
+ *
+ *        Licensed under the Apache License, Version 2.0 (the "License");
+ *        you may not use this file except in compliance with the License.
+ *        You may obtain a copy of the License at
+ *
+ *            http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *        Unless required by applicable law or agreed to in writing, software
+ *        distributed under the License is distributed on an "AS IS" BASIS,
+ *        WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *        See the License for the specific language governing permissions and
+ *        limitations under the License.
+ *
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../src/storage.c"
+
+/**
+ * \def CHECK
+ * \brief Report a failed check with its line and fail the test.
+ */
+#define CHECK(cond) \
+    do { if (!(cond)) { printf("FAIL line %d: %s\n", __LINE__, #cond); return (false); } } while (0)
+
+static timePacket_t testTime;
+static uint32_t pendingMl;
+static uint16_t setBitErrors;
+static uint8_t sharedBuffer[SHARED_BUFFER_SIZE];
+
+volatile uint16_t WDTCTL;
+
+/*******************************************************************************
+* Stubs of the modules storage.c uses
+*******************************************************************************/
+
+void getBinTime(timePacket_t *tpP)
+{
+    *tpP = testTime;
+}
+
+uint32_t APP_ALGO_getHourlyWaterVolume_ml(void)
+{
+    uint32_t ml = pendingMl;
+
+    pendingMl = 0;
+    return (ml);
+}
+
+uint16_t APP_ALGO_reportAlgoErrors(void)
+{
+    return (0);
+}
+
+uint16_t sysExec_getErrorBits(void)
+{
+    return (0);
+}
+
+void sysError(void)
+{
+    printf("FAIL sysError\n");
+    exit(1);
+}
+
+uint8_t* modemMgr_getSharedBuffer(void)
+{
+    return (sharedBuffer);
+}
+
+void all_timers_adjust_time_end_of_day(void) {}
+void msgSched_scheduleDailyWaterLogMessage(void) {}
+void msgSched_scheduleDailyLogBackfillMessage(void) {}
+void msgSched_scheduleActivatedMessage(void) {}
+void msgSched_scheduleMonthlyCheckInMessage(void) {}
+void msgSched_scheduleGpsMeasurement(void) {}
+void msgSched_scheduleFinalAssemblyMessage(void) {}
+
+void msp430Flash_erase_segment(uint8_t *flashSectorAddrP)
+{
+    memset(flashSectorAddrP, 0xFF, FLASH_BLOCK_SIZE);
+}
+
+void msp430Flash_write_bytes(uint8_t *flashP, uint8_t *srcP, uint16_t num_bytes)
+{
+    uint16_t i;
+
+    for (i = 0; i < num_bytes; i++)
+    {
+        // Programming can only clear bits
+        if ((flashP[i] & srcP[i]) != srcP[i])
+        {
+            setBitErrors++;
+        }
+        flashP[i] &= srcP[i];
+    }
+}
+
+void msp430Flash_write_int16(uint8_t *flashP, uint16_t val16)
+{
+    uint8_t bytes[2];
+
+    bytes[0] = val16 >> 8;
+    bytes[1] = val16 & 0xFF;
+    msp430Flash_write_bytes(flashP, bytes, sizeof(bytes));
+}
+
+/*******************************************************************************
+* Test helpers
+*******************************************************************************/
+
+/**
+* \brief Erase the daily log and checkpoint regions.
+*/
+static void eraseFlash(void)
+{
+    memset((void *)logSegments, 0xFF, sizeof(logSegments));
+    memset((void *)storageCheckpoints, 0xFF, sizeof(storageCheckpoints));
+    setBitErrors = 0;
+}
+
+/**
+* \brief Set the test clock and run the storage manager once.
+*/
+static void runAt(uint8_t hour, uint8_t minute, uint32_t ml)
+{
+    testTime.hour24 = hour;
+    testTime.minute = minute;
+    testTime.second = 0;
+    pendingMl = ml;
+    storageMgr_exec();
+}
+
+/**
+* \brief Reset the unit.  The RTC restarts at 00:00.
+*/
+static void reboot(void)
+{
+    testTime.hour24 = 0;
+    testTime.minute = 0;
+    testTime.second = 0;
+    storageMgr_init();
+}
+
+/**
+* \brief Set the clock, the same as the GMT clock setting message.
+*/
+static void setClock(uint8_t hour, uint8_t minute)
+{
+    testTime.hour24 = hour;
+    testTime.minute = minute;
+    testTime.second = 0;
+    storageMgr_setStorageTime(0, minute, hour);
+}
+
+/**
+* \brief Daily log records given out in all the segments.
+*/
+static uint16_t countUsedRecords(void)
+{
+    uint16_t count = 0;
+    uint8_t i;
+
+    for (i = 0; i < TOTAL_LOG_SEGMENTS; i++)
+    {
+        count += logIndex.usedRecords[i];
+    }
+    return (count);
+}
+
+/**
+* \brief Start with erased flash, activate the unit in the given
+*        daily log format and boot with it.  Today's log is opened
+*        at boot.
+*/
+static bool startActivated(uint8_t format)
+{
+    eraseFlash();
+    testTime.day = 1;
+    testTime.month = 1;
+    testTime.year = 21;
+    reboot();
+    storageMgr_overrideUnitActivation(true);
+    CHECK(storageMgr_setDailyLogFormat(format));
+    storageMgr_saveCheckpoint();
+    reboot();
+    CHECK(todayRecordP != NULL);
+    CHECK(countUsedRecords() == 1);
+    CHECK(getLogDayIndex(todayRecordP) == 1);
+    return (true);
+}
+
+/*******************************************************************************
+* Tests
+*******************************************************************************/
+
+/**
+* \brief Reset mid-day on an hourly day.  The day total and the
+*        record carry on from the hours already in flash.
+*/
+static bool testHourlyResetMidDay(void)
+{
+    logRecord_t *recordP;
+    uint32_t expectedMl = 0;
+    uint8_t hour;
+    uint8_t reset;
+
+    if (!startActivated(DAILY_LOG_FORMAT_STANDARD))
+    {
+        return (false);
+    }
+    recordP = todayRecordP;
+
+    // Hours 0-8 with water
+    for (hour = 1; hour <= 9; hour++)
+    {
+        runAt(hour, 0, hour * 320UL);
+        expectedMl += hour * 320UL;
+    }
+    CHECK(stData.dayMilliliterSum == expectedMl);
+
+    // Reset at 09:30, the day total is back before the clock is set
+    reboot();
+    CHECK(todayRecordP == recordP);
+    CHECK(countUsedRecords() == 1);
+    CHECK(stData.dayMilliliterSum == expectedMl);
+    setClock(9, 30);
+    CHECK(stData.dayMilliliterSum == expectedMl);
+
+    // Reset again and let the clock run from 00:00.  Hour 0 already
+    // holds water and is not written again.
+    reboot();
+    runAt(1, 0, 640);
+    CHECK(getLogInt16(&recordP->logData.dailyLog.litersPerHour[0]) == 10);
+    CHECK(setBitErrors == 0);
+    setClock(10, 0);
+    CHECK(stData.dayMilliliterSum == expectedMl);
+
+    // Rest of the day
+    for (hour = 11; hour <= 24; hour++)
+    {
+        runAt(hour % 24, 0, 3200);
+        expectedMl += 3200;
+    }
+    CHECK(isDailyLogReady(recordP));
+    CHECK(getLogInt16(&recordP->logData.dailyLog.totalLiters) == expectedMl / ML_PER_LITER);
+    for (hour = 0; hour < 9; hour++)
+    {
+        CHECK(getLogInt16(&recordP->logData.dailyLog.litersPerHour[hour]) == (hour + 1) * 10);
+    }
+    CHECK(getLogInt16(&recordP->logData.dailyLog.litersPerHour[9]) == 0);
+    CHECK(getLogInt16(&recordP->logData.dailyLog.litersPerHour[23]) == 100);
+    CHECK(setBitErrors == 0);
+
+    // The next day is open, resets keep using it
+    CHECK(stData.daysActivated == 2);
+    CHECK(countUsedRecords() == 2);
+    recordP = todayRecordP;
+    for (reset = 0; reset < 5; reset++)
+    {
+        reboot();
+        CHECK(todayRecordP == recordP);
+        CHECK(stData.dayMilliliterSum == 0);
+    }
+    CHECK(countUsedRecords() == 2);
+    return (true);
+}
+
+/**
+* \brief Reset mid-day on a quarter hour day.  The day total and
+*        the quarter hour bins carry on from the bins in flash.
+*/
+static bool testQuarterHourResetMidDay(void)
+{
+    logRecord_t *recordP;
+    uint32_t expectedMl = 0;
+    uint8_t quarter;
+
+    if (!startActivated(DAILY_LOG_FORMAT_QUARTER_HOUR))
+    {
+        return (false);
+    }
+    recordP = todayRecordP;
+    CHECK(isQuarterHourRecord(recordP));
+
+    // Quarter hours of 00:00-05:45 with water
+    for (quarter = 1; quarter <= 24; quarter++)
+    {
+        runAt(quarter / 4, (quarter % 4) * 15, quarter * 64UL);
+        expectedMl += quarter * 64UL;
+    }
+    CHECK(stData.dayMilliliterSum == expectedMl);
+
+    // Reset at 06:10
+    reboot();
+    CHECK(todayRecordP == recordP);
+    CHECK(quarterHourDay);
+    CHECK(countUsedRecords() == 1);
+    CHECK(stData.dayMilliliterSum == expectedMl);
+    setClock(6, 10);
+    CHECK(stData.dayMilliliterSum == expectedMl);
+
+    // Rest of the day, one quarter hour of water each hour
+    runAt(6, 15, 0);
+    for (quarter = 1 + (7 * 4); quarter <= (24 * 4); quarter++)
+    {
+        runAt((quarter / 4) % 24, (quarter % 4) * 15, (quarter % 4) ? 0 : 960);
+        expectedMl += (quarter % 4) ? 0 : 960;
+    }
+    CHECK(isDailyLogReady(recordP));
+    CHECK(getLogInt16(&recordP->logData.quarterHourLog.totalLiters) == expectedMl / ML_PER_LITER);
+    CHECK(setBitErrors == 0);
+    CHECK(countUsedRecords() == 2);
+    return (true);
+}
+
+/**
+* \brief Reset every hour for a week.  Each day keeps to one log
+*        record, numbered by its days activated.
+*/
+static bool testResetEveryHour(void)
+{
+    logRecord_t *recordP;
+    uint32_t expectedMl = 0;
+    uint16_t day;
+    uint8_t hour;
+
+    if (!startActivated(DAILY_LOG_FORMAT_STANDARD))
+    {
+        return (false);
+    }
+
+    for (day = 1; day <= TOTAL_DAYS_IN_A_WEEK; day++)
+    {
+        recordP = todayRecordP;
+        expectedMl = 0;
+        for (hour = 1; hour <= 24; hour++)
+        {
+            runAt(hour % 24, 0, 1024);
+            expectedMl += 1024;
+            if (hour < 24)
+            {
+                reboot();
+                CHECK(todayRecordP == recordP);
+                setClock(hour, 5);
+                CHECK(stData.dayMilliliterSum == expectedMl);
+            }
+        }
+        CHECK(isDailyLogReady(recordP));
+        CHECK(getLogDayIndex(recordP) == day);
+        CHECK(getLogInt16(&recordP->logData.dailyLog.totalLiters) == expectedMl / ML_PER_LITER);
+        CHECK(getLogDayIndex(todayRecordP) == day + 1);
+        CHECK(countUsedRecords() == day + 1);
+    }
+    CHECK(setBitErrors == 0);
+    return (true);
+}
+
+/**
+* \brief Reset the daily logs mid-day.  Today's log starts over
+*        in a new record with its header and is found again after
+*        a reset.
+*/
+static bool testResetWeeklyLogs(void)
+{
+    logRecord_t *recordP;
+    uint8_t hour;
+
+    if (!startActivated(DAILY_LOG_FORMAT_STANDARD))
+    {
+        return (false);
+    }
+    for (hour = 1; hour <= 24; hour++)
+    {
+        runAt(hour % 24, 0, 640);
+    }
+    runAt(1, 0, 640);
+    CHECK(stData.daysActivated == 2);
+    CHECK(countUsedRecords() == 2);
+
+    storageMgr_resetWeeklyLogs();
+    recordP = todayRecordP;
+    CHECK(recordP != NULL);
+    CHECK(countUsedRecords() == 1);
+    CHECK(getLogDayIndex(recordP) == 2);
+    CHECK(stData.dayMilliliterSum == 0);
+
+    runAt(2, 0, 640);
+    reboot();
+    CHECK(todayRecordP == recordP);
+    CHECK(countUsedRecords() == 1);
+    CHECK(stData.dayMilliliterSum == 640);
+    CHECK(setBitErrors == 0);
+    return (true);
+}
+
+int main(void)
+{
+    if (!testHourlyResetMidDay() ||
+        !testQuarterHourResetMidDay() ||
+        !testResetEveryHour() ||
+        !testResetWeeklyLogs())
+    {
+        return (1);
+    }
+    printf("PASS\n");
+    return (0);
+}
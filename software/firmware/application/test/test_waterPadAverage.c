@@ -0,0 +1,214 @@
+/**
+ * @file test_waterPadAverage.c
+ * \n Source File
+ * \n AfridevV2 MSP430 Firmware Host Tests
+ *
+ * \brief Check the running sum pad filter against the MATLAB generated
+ *        waterPadFiltering() it replaces, then time both.  The filters
+ *        are fed the same raw samples and reset at the same points,
+ *        and every filtered sample must match.
+ *
+ *        Usage: test_waterPadAverage [samples] [trace.txt ...]
+ *        A recorded trace file (see padTrace.h) is run in addition to
+ *        the generated streams.
+ *
+ * \par   Copyright Notice
+ *        Copyright 2021 charity: water
+ *
+ *        Licensed under the Apache License, Version 2.0 (the "License");
+ *        you may not use this file except in compliance with the License.
+ *        You may obtain a copy of the License at
+ *
+ *            http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *        Unless required by applicable law or agreed to in writing, software
+ *        distributed under the License is distributed on an "AS IS" BASIS,
+ *        WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *        See the License for the specific language governing permissions and
+ *        limitations under the License.
+ *
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "initializeWaterAlgorithm.h"
+#include "waterPadFiltering.h"
+#include "waterPadAverage.h"
+#include "padTrace.h"
+
+/**
+ * \def BENCH_SAMPLES
+ * \brief Number of samples each filter is timed over.
+ */
+#define BENCH_SAMPLES 20000000L
+
+/**
+ * \typedef streamType_t
+ * \brief Kind of raw sample stream.
+ */
+typedef enum streamType_e {
+    STREAM_PAD_TRACE,                                      /**< generated pad trace */
+    STREAM_RANDOM,                                         /**< full range random counts */
+    STREAM_NEAR_MAX,                                       /**< counts just below 0xFFFF */
+    STREAM_TYPES,
+} streamType_t;
+
+/**
+* \brief Reset both filters the way the application does.
+*/
+static void resetFilters(padFilteringData_t *refP, padAverage_t *newP)
+{
+    waterAlgoData_t algoData;
+
+    // Leave garbage in the generated buffer, initializeWaterAlgorithm()
+    // only resets the index.
+    memset(refP, 0x33, sizeof(padFilteringData_t));
+    initializeWaterAlgorithm(&algoData, refP);
+    waterPadAverage_init(newP);
+}
+
+/**
+* \brief Run one stream through both filters.
+*
+* @return long number of samples compared, -1 on a mismatch
+*/
+static long runStream(padTrace_t *traceP, streamType_t type, long numSamples)
+{
+    padFilteringData_t filterRef;
+    padAverage_t filterNew;
+    long n;
+    int i;
+
+    resetFilters(&filterRef, &filterNew);
+
+    for (n = 0; (numSamples < 0) || (n < numSamples); n++)
+    {
+        uint16_t pads[6];
+        padSample_t sample;
+        padSample_t outRef;
+        padSample_t outNew;
+
+        if (type == STREAM_PAD_TRACE)
+        {
+            if (!padTrace_next(traceP, pads))
+            {
+                break;
+            }
+        }
+        else
+        {
+            for (i = 0; i < 6; i++)
+            {
+                uint32_t r = padTrace_rand(traceP);
+                pads[i] = (type == STREAM_RANDOM) ? (uint16_t)r : (uint16_t)(0xFFFF - (r & 7));
+            }
+        }
+        sample.pad0 = pads[0];
+        sample.pad1 = pads[1];
+        sample.pad2 = pads[2];
+        sample.pad3 = pads[3];
+        sample.pad4 = pads[4];
+        sample.pad5 = pads[5];
+
+        // The application filters in place
+        outRef = sample;
+        outNew = sample;
+        waterPadFiltering(&outRef, &filterRef, &outRef);
+        waterPadAverage_filter(&filterNew, &outNew, &outNew);
+        if (memcmp(&outRef, &outNew, sizeof(padSample_t)) != 0)
+        {
+            printf("FAIL sample %ld\n", n);
+            return (-1);
+        }
+
+        // Reset now and then to check the warm-up
+        if (padTrace_range(traceP, 0, 20000) == 0)
+        {
+            resetFilters(&filterRef, &filterNew);
+        }
+    }
+    return (n);
+}
+
+/**
+* \brief Time a filter over BENCH_SAMPLES samples.
+*
+* @return double nanoseconds per sample
+*/
+static double benchFilter(bool generated)
+{
+    padFilteringData_t filterRef;
+    padAverage_t filterNew;
+    padSample_t sample = { 1, 2, 3, 4, 5, 6 };
+    padSample_t out;
+    clock_t start;
+    long i;
+
+    resetFilters(&filterRef, &filterNew);
+    start = clock();
+    for (i = 0; i < BENCH_SAMPLES; i++)
+    {
+        sample.pad0 = (uint16_t)i;
+        if (generated)
+        {
+            waterPadFiltering(&sample, &filterRef, &out);
+        }
+        else
+        {
+            waterPadAverage_filter(&filterNew, &sample, &out);
+        }
+        // Keep the output live
+        sample.pad1 ^= out.pad0;
+    }
+    return ((double)(clock() - start) * 1e9 / CLOCKS_PER_SEC / BENCH_SAMPLES);
+}
+
+int main(int argc, char **argv)
+{
+    long numSamples = 400000;
+    long total = 0;
+    long count;
+    padTrace_t trace;
+    int argi = 1;
+    int seed;
+
+    if ((argi < argc) && (atol(argv[argi]) > 0))
+    {
+        numSamples = atol(argv[argi++]);
+    }
+
+    for (seed = 1; seed <= 12; seed++)
+    {
+        padTrace_init(&trace, seed * 7919UL);
+        count = runStream(&trace, (streamType_t)(seed % STREAM_TYPES), numSamples);
+        if (count < 0)
+        {
+            printf("FAIL seed %d\n", seed);
+            return (1);
+        }
+        total += count;
+    }
+
+    for (; argi < argc; argi++)
+    {
+        if (!padTrace_open(&trace, argv[argi]))
+        {
+            printf("FAIL cannot open %s\n", argv[argi]);
+            return (1);
+        }
+        count = runStream(&trace, STREAM_PAD_TRACE, -1);
+        fclose(trace.fileP);
+        if (count < 0)
+        {
+            printf("FAIL trace %s\n", argv[argi]);
+            return (1);
+        }
+        total += count;
+    }
+
+    printf("PASS %ld samples\n", total);
+    printf("generated filter %.1f ns/sample, running sum %.1f ns/sample\n",
+           benchFilter(true), benchFilter(false));
+    return (0);
+}
@@ -0,0 +1,242 @@
+/**
+ * @file test_waterVolumeStream.c
+ * \n Source File
+ * \n AfridevV2 MSP430 Firmware Host Tests
+ *
+ * \brief Check the per-sample water volume engine against the MATLAB
+ *        generated calculateWaterVolume() it replaces.  Both are fed
+ *        the same filtered pad samples.  At every window boundary the
+ *        waterAlgoData_t and the reason codes must match, and random
+ *        hourly volume reads must match hourlyWaterVolume().
+ *
+ *        Usage: test_waterVolumeStream [seeds [samples]] [trace.txt ...]
+ *        A recorded trace file (see padTrace.h) is run in addition to
+ *        the generated traces.
+ *
+ * \par   Copyright Notice
+ *        Copyright 2021 charity: water
+ *
+ *        Licensed under the Apache License, Version 2.0 (the "License");
+ *        you may not use this file except in compliance with the License.
+ *        You may obtain a copy of the License at
+ *
+ *            http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *        Unless required by applicable law or agreed to in writing, software
+ *        distributed under the License is distributed on an "AS IS" BASIS,
+ *        WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *        See the License for the specific language governing permissions and
+ *        limitations under the License.
+ *
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "calculateWaterVolume.h"
+#include "clearPadWindowProcess.h"
+#include "hourlyWaterVolume.h"
+#include "initializeWaterAlgorithm.h"
+#include "initializeWindows.h"
+#include "waterPadFiltering.h"
+#include "writePadSample.h"
+#include "waterVolumeStream.h"
+#include "padTrace.h"
+
+/**
+* \brief Collapse a reason code list to one bit per code.
+*/
+static unsigned reasonBits(const ReasonCodes *reasonP)
+{
+    unsigned bits = 0;
+    int i;
+
+    for (i = 0; i < WVS_MAX_REASON_CODES; i++)
+    {
+        if (reasonP[i] == water_bad_sample)
+        {
+            bits |= 1;
+        }
+        if (reasonP[i] == water_volume_capped)
+        {
+            bits |= 2;
+        }
+        if (reasonP[i] == water_flow_standing_water)
+        {
+            bits |= 4;
+        }
+    }
+    return (bits);
+}
+
+/**
+* \brief Run one trace through both engines.
+*
+* @return long number of windows compared, -1 on a mismatch
+*/
+static long runTrace(padTrace_t *traceP, long numSamples, bool nearCap, unsigned *allBitsP)
+{
+    padWindows_t windows;
+    padHistory_t history;
+    padFilteringData_t filterRef;
+    padFilteringData_t filterNew;
+    waterAlgoData_t dataRef;
+    waterAlgoData_t dataNew;
+    unsigned bitsRef = 0;
+    unsigned bitsNew = 0;
+    long windowCount = 0;
+    long n;
+
+    memset(&windows, 0, sizeof(windows));
+    memset(&history, 0x5A, sizeof(history));
+    initializeWindows(&windows);
+    waterVolumeStream_initHistory(&history);
+    memset(&dataRef, 0, sizeof(dataRef));
+    memset(&dataNew, 0, sizeof(dataNew));
+    initializeWaterAlgorithm(&dataRef, &filterRef);
+    initializeWaterAlgorithm(&dataNew, &filterNew);
+    if (nearCap)
+    {
+        // Reach the volume capped case
+        dataRef.accum_water_volume = 0xFFFFFFFFUL - 5000UL;
+        dataNew.accum_water_volume = dataRef.accum_water_volume;
+    }
+
+    for (n = 0; (numSamples < 0) || (n < numSamples); n++)
+    {
+        uint16_t pads[6];
+        padSample_t sample;
+        padSample_t sampleRef;
+        padSample_t sampleNew;
+        ReasonCodes reasons[WVS_MAX_REASON_CODES];
+
+        if (!padTrace_next(traceP, pads))
+        {
+            break;
+        }
+        sample.pad0 = pads[0];
+        sample.pad1 = pads[1];
+        sample.pad2 = pads[2];
+        sample.pad3 = pads[3];
+        sample.pad4 = pads[4];
+        sample.pad5 = pads[5];
+
+        waterPadFiltering(&sample, &filterRef, &sampleRef);
+        writePadSample(&windows, &sampleRef);
+        waterPadFiltering(&sample, &filterNew, &sampleNew);
+        waterVolumeStream_writeSample(&history, &sampleNew);
+        if (history.process != windows.process)
+        {
+            printf("FAIL process flag, sample %ld\n", n);
+            return (-1);
+        }
+
+        waterVolumeStream_processSample(&dataNew, &history, reasons);
+        bitsNew |= reasonBits(reasons);
+
+        if (windows.process)
+        {
+            calculateWaterVolume(&dataRef, &windows, reasons);
+            bitsRef |= reasonBits(reasons);
+            clearPadWindowProcess(&windows);
+            waterVolumeStream_clearProcess(&history);
+            windowCount++;
+
+            if ((memcmp(&dataRef, &dataNew, sizeof(dataRef)) != 0) || (bitsRef != bitsNew))
+            {
+                printf("FAIL window at sample %ld, reason bits %x %x\n", n, bitsRef, bitsNew);
+                return (-1);
+            }
+
+            // Read the hourly volume now and then, mid session too
+            if (padTrace_range(traceP, 0, 100) == 0)
+            {
+                ReasonCodes reasonRef;
+                ReasonCodes reasonNew;
+                uint32_t mlRef;
+                uint32_t litersRef;
+                uint32_t mlNew;
+
+                hourlyWaterVolume(&dataRef, &reasonRef, &mlRef, &litersRef);
+                mlNew = waterVolumeStream_hourlyVolume(&dataNew, &reasonNew);
+                if ((mlRef != mlNew) || (reasonRef != reasonNew) ||
+                    (memcmp(&dataRef, &dataNew, sizeof(dataRef)) != 0))
+                {
+                    printf("FAIL hourly volume at sample %ld, %lu %lu\n", n,
+                           (unsigned long)mlRef, (unsigned long)mlNew);
+                    return (-1);
+                }
+                if (nearCap)
+                {
+                    dataRef.accum_water_volume = 0xFFFFFFFFUL - 5000UL;
+                    dataNew.accum_water_volume = dataRef.accum_water_volume;
+                }
+            }
+            *allBitsP |= bitsRef;
+            bitsRef = 0;
+            bitsNew = 0;
+        }
+    }
+    return (windowCount);
+}
+
+int main(int argc, char **argv)
+{
+    int numSeeds = 20;
+    long numSamples = 200000;
+    long windowCount = 0;
+    long count;
+    unsigned allBits = 0;
+    padTrace_t trace;
+    int argi = 1;
+    int seed;
+
+    if ((argi < argc) && (atoi(argv[argi]) > 0))
+    {
+        numSeeds = atoi(argv[argi++]);
+        if ((argi < argc) && (atol(argv[argi]) > 0))
+        {
+            numSamples = atol(argv[argi++]);
+        }
+    }
+
+    for (seed = 1; seed <= numSeeds; seed++)
+    {
+        padTrace_init(&trace, seed * 2654435761UL);
+        count = runTrace(&trace, numSamples, (seed % 7) == 0, &allBits);
+        if (count < 0)
+        {
+            printf("FAIL seed %d\n", seed);
+            return (1);
+        }
+        windowCount += count;
+    }
+
+    for (; argi < argc; argi++)
+    {
+        if (!padTrace_open(&trace, argv[argi]))
+        {
+            printf("FAIL cannot open %s\n", argv[argi]);
+            return (1);
+        }
+        count = runTrace(&trace, -1, false, &allBits);
+        fclose(trace.fileP);
+        if (count < 0)
+        {
+            printf("FAIL trace %s\n", argv[argi]);
+            return (1);
+        }
+        windowCount += count;
+    }
+
+    // The generated traces must reach the volume capped and standing water
+    // reason codes.  water_bad_sample is only returned for a window that is
+    // not valid, which the window bookkeeping never produces.
+    if ((numSeeds >= 7) && ((allBits & 6) != 6))
+    {
+        printf("FAIL reason codes reached %x\n", allBits);
+        return (1);
+    }
+
+    printf("PASS %ld windows, reason bits %x\n", windowCount, allBits);
+    return (0);
+}
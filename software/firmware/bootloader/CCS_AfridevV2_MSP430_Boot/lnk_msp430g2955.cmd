@@ -82,7 +82,10 @@ MEMORY
     SFR                     : origin = 0x0000, length = 0x0010
     PERIPHERALS_8BIT        : origin = 0x0010, length = 0x00F0
     PERIPHERALS_16BIT       : origin = 0x0100, length = 0x0100
-    RAM                     : origin = 0x1100, length = 0x0F00
+    RAM                     : origin = 0x1100, length = 0x0D70
+    // The application keeps its algorithm state in ALGO_STATE over
+    // a watchdog reset, so the bootloader must not place anything there.
+    ALGO_STATE              : origin = 0x1E70, length = 0x0190
     STACK                   : origin = 0x2000, length = 0x0100
     INFOA                   : origin = 0x10C0, length = 0x0040
     INFOB                   : origin = 0x1080, length = 0x0040
@@ -111,6 +114,8 @@ SECTIONS
     .text       : {} > FLASH              /* CODE                              */
     .cinit      : {} > FLASH              /* INITIALIZATION TABLES             */
     .const      : {} > FLASH              /* CONSTANT DATA                     */
+    .TI.ramfunc : {} load = FLASH, run = RAM, table(BINIT) /* FLASH BLOCK WRITE, RUNS FROM RAM */
+    .binit      : {} > FLASH              /* RAM FUNCTION COPY TABLE           */
     .cio        : {} > RAM                /* C I/O BUFFER                      */
 
     .pinit      : {} > FLASH              /* C++ CONSTRUCTOR TABLES            */
@@ -29,15 +29,31 @@
  * Module Data Definitions
  **************************/
 
+/**
+ * \def FLASH_BLOCK_BYTES
+ * \brief Size of one flash block.  A block write (BLKWRT) must
+ *        stay within one block.
+ */
+#define FLASH_BLOCK_BYTES ((uint16_t)64)
+
 /***************************
  * Module Data Declarations
  **************************/
 
+/**
+* \var blockBuf
+* \brief RAM copy of the block being programmed.  Flash can not
+*        be read while a block is programmed.
+*/
+static uint8_t blockBuf[FLASH_BLOCK_BYTES];
+
 /**************************
  * Module Prototypes
  **************************/
 static void msp430Flash_eraseAppImage(void);
-static void msp420Flash_copyBackupToApp(void);
+static void msp420Flash_copyBackupToApp(bool useBlockWrite);
+static void msp430Flash_write_block(uint8_t *flashP, const uint8_t *srcP);
+static void msp430Flash_programBlock(uint8_t *flashP);
 static bool msp430Flash_doesAppMatchBackup(void);
 
 /***************************
@@ -54,7 +70,6 @@ void msp430Flash_erase_segment(uint8_t *flashSegmentAddrP)
 {
     volatile uint16_t ms_check_count;
     volatile uint8_t contextSaveSR;
-    volatile uint8_t checkCount = 0;
     contextSaveSR = __get_SR_register();
 
     // Clear GIE
@@ -95,7 +110,8 @@ void msp430Flash_erase_segment(uint8_t *flashSegmentAddrP)
         }
     }
 
-    FCTL1 = (FWKEY | LOCK);         // Set LOCK bit
+    FCTL1 = FWKEY;                  // Clear Erase bit
+    FCTL3 = (FWKEY | LOCK);         // Set LOCK bit
 
     // If the GIE was set, restore it.
     if (contextSaveSR & GIE) 
@@ -119,7 +135,6 @@ void msp430Flash_write_bytes(uint8_t *flashP, uint8_t *srcP, uint16_t num_bytes)
     volatile uint16_t i;
     volatile uint16_t us100_check_count;
     volatile uint8_t contextSaveSR;
-    volatile uint8_t checkCount = 0;
     contextSaveSR = __get_SR_register();
 
     // Clear GIE
@@ -166,7 +181,7 @@ void msp430Flash_write_bytes(uint8_t *flashP, uint8_t *srcP, uint16_t num_bytes)
     }
 
     FCTL1 = FWKEY;                 // Clear WRT
-    FCTL1 = (FWKEY | LOCK);        // Set Lock
+    FCTL3 = (FWKEY | LOCK);        // Set Lock
 
     // If the GIE was set, restore it.
     if (contextSaveSR & GIE) 
@@ -239,8 +254,9 @@ fwCopyResult_t msp430Flash_moveAndVerifyBackupToApp(void)
 		{
             // Erase main image
             msp430Flash_eraseAppImage();
-            // Copy the Backup flash image to the App flash area
-            msp420Flash_copyBackupToApp();
+            // Copy the Backup flash image to the App flash area.
+            // Use block writes the first time, byte writes on a retry.
+            msp420Flash_copyBackupToApp(retryCount == 0);
             // Verify that backup matches app
             copySuccess = msp430Flash_doesAppMatchBackup();
         } while (!copySuccess && ++retryCount < 4);
@@ -280,8 +296,8 @@ fwCopyResult_t msp430Flash_moveAndVerifyBackupToApp(void)
 */
 void msp430Flash_zeroAppResetVector(void) 
 {
-    void (*tempP)(void) = 0;
-    msp430Flash_write_bytes((uint8_t *)&__App_Reset_Vector, (uint8_t *)&tempP, sizeof(void (*)(void)));
+    uint16_t zeroVector = 0;
+    msp430Flash_write_bytes((uint8_t *)&__App_Reset_Vector, (uint8_t *)&zeroVector, sizeof(__App_Reset_Vector));
 }
 
 /***************************
@@ -316,9 +332,13 @@ static void msp430Flash_eraseAppImage(void)
 /**
 * \brief Copy the backup image in flash to the main image 
 *        location in flash.
+* 
+* @param useBlockWrite true to program with block writes, 
+*                      false to program one byte at a time
 */
-static void msp420Flash_copyBackupToApp(void) 
+static void msp420Flash_copyBackupToApp(bool useBlockWrite) 
 {
+    uint16_t j;
     uint8_t i;
     // Get number of sectors in the backup flash
     uint16_t numSectors = getNumSectorsInImage();
@@ -334,7 +354,98 @@ static void msp420Flash_copyBackupToApp(void)
 		{
             // Tickle the watchdog before writing to flash
             WATCHDOG_TICKLE();
-            msp430Flash_write_bytes(flashDstAddrP, flashSrcAddrP, 0x200);
+            if (useBlockWrite) 
+			{
+                for (j = 0; j < 0x200; j += FLASH_BLOCK_BYTES) 
+				{
+                    msp430Flash_write_block(flashDstAddrP + j, flashSrcAddrP + j);
+                }
+            } 
+			else 
+			{
+                msp430Flash_write_bytes(flashDstAddrP, flashSrcAddrP, 0x200);
+            }
+        }
+    }
+}
+
+/**
+* \brief Write one 64 byte flash block using a block write.
+*        The data is copied to RAM first since flash can not be
+*        read while the block is programmed.
+* 
+* @param flashP start of the flash block to write
+* @param srcP addr where the block data is read from
+*/
+static void msp430Flash_write_block(uint8_t *flashP, const uint8_t *srcP) 
+{
+    volatile uint8_t contextSaveSR;
+
+    memcpy(blockBuf, srcP, FLASH_BLOCK_BYTES);
+
+    contextSaveSR = __get_SR_register();
+
+    // Clear GIE, the vector table can not be read during the block write
+    __bic_SR_register(GIE);
+
+    FCTL2 = (FWKEY | FSSEL_1 | FN1);  // Set up clock
+    FCTL3 = FWKEY;                    // Clear Lock bit
+
+    msp430Flash_programBlock(flashP);
+
+    FCTL1 = FWKEY;                    // Clear WRT
+    FCTL3 = (FWKEY | LOCK);           // Set Lock
+
+    // If the GIE was set, restore it.
+    if (contextSaveSR & GIE) 
+	{
+        __bis_SR_register(GIE);
+    }
+}
+
+/**
+* \brief Program one block from blockBuf with BLKWRT.  Runs 
+*        from RAM, the CPU can not fetch from flash until BUSY
+*        clears at the end of the block.  Must not call any
+*        function located in flash.
+* 
+* @param flashP start of the flash block to write
+*/
+#pragma CODE_SECTION(msp430Flash_programBlock, ".TI.ramfunc")
+static void msp430Flash_programBlock(uint8_t *flashP) 
+{
+    uint8_t i;
+    volatile uint16_t check_count;
+
+    FCTL1 = (FWKEY | BLKWRT | WRT);   // Enable block write
+
+    for (i = 0; i < FLASH_BLOCK_BYTES; i++) 
+	{
+        *flashP++ = blockBuf[i];
+        // Wait until the flash is ready for the next byte
+        // (~.06ms, timeout after ~10ms).
+        check_count = 0;
+        while (!(FCTL3 & WAIT)) 
+		{
+            _delay_cycles(100);
+            check_count++;
+            if (check_count > 100) 
+			{
+                break;
+            }
+        }
+    }
+
+    FCTL1 = FWKEY;                    // Clear BLKWRT, end the block
+
+    check_count = 0;
+    while (FCTL3 & BUSY) 
+	{
+        _delay_cycles(100);
+        check_count++;
+        if (check_count > 100) 
+		{
+            break;
         }
     }
 }
@@ -318,6 +318,9 @@ int main(void)
             disableGlobalInterrupt();
             // Stop timer
             timerA1_0_halt();
+            // Hand the reset flags cleared above to the app, it uses them
+            // to tell a watchdog reset (RAM kept) from a power-on reset.
+            IFG1 |= bootData.rebootReason & (WDTIFG | RSTIFG | PORIFG | NMIIFG);
             // Jump to app
             TI_MSPBoot_APPMGR_JUMPTOAPP();
         }
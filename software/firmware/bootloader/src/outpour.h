@@ -232,6 +232,9 @@ void sysError(void);
 /*******************************************************************************
 * utils.c
 *******************************************************************************/
+uint16_t crc16_init(void);
+uint16_t crc16_update(uint16_t crc, const uint8_t *data, uint16_t size);
+uint16_t crc16_final(uint16_t crc);
 unsigned int gen_crc16(const unsigned char *data, unsigned int size);
 
 // WDTPW+WDTCNTCL+WDTSSEL
@@ -0,0 +1,204 @@
+#!/usr/bin/python3
+
+# Convert two TI rom files to an AfridevV2 delta upgrade message.
+# The delta rebuilds the new app image from the app running on the unit
+# (the base image) and carries only the bytes that are not in it.
+#
+# The message has the same message header and section header as the
+# full upgrade message created by afridevV2RomToMsg.py, except the
+# section start byte is 0xD5.  The section length and crc16 are the ones
+# of the new image.  The section header is followed by:
+#   crc16 of the base image section (2 bytes, MSB first)
+#   length of the delta ops         (2 bytes, MSB first)
+#   delta ops
+#
+# Delta ops (all values MSB first):
+#   0x01 offset[2] length[2]  copy length bytes of the base image section
+#                             starting at offset
+#   0x02 length[2] data[len]  insert the data
+#   0x03 length[2] value[1]   write length bytes of value
+#
+# The ops are applied to the base image and the result is checked against
+# the new image before the message is written.
+#
+# Usage:
+#   afridevV2RomToDeltaMsg.py base_rom.txt new_rom.txt [output_msg.txt]
+
+import sys
+
+# The app image location, see afridevV2_app_to_rom.cmd
+IMAGE_START = 0x9000
+IMAGE_LENGTH = 0x5000
+
+DELTA_SECTION_START = 0xD5
+OP_COPY = 0x01
+OP_INSERT = 0x02
+OP_FILL = 0x03
+OP_MAX_LENGTH = 0xFFFF
+
+# Shortest copy and fill worth an op, an insert op costs 3 bytes.
+MIN_COPY_LENGTH = 8
+MIN_FILL_LENGTH = 6
+# Limit the match candidates searched at each position.
+MAX_CANDIDATES = 64
+
+# The modem returns the message in chunks of this size, the check applies
+# the ops one chunk at a time the way the unit does.
+OTA_PAYLOAD_MAX_RX_READ_LENGTH = 512
+
+
+def crc16(data):
+    # CRC16 ANSI, polynomial = 0x8005 reversed, init 0, as done on the
+    # MSP430.  Same as crcmod.mkCrcFun(0x18005, rev=True, initCrc=0x0000,
+    # xorOut=0x0000) used by afridevV2RomToMsg.py.
+    crc = 0
+    for b in data:
+        crc ^= b
+        for _ in range(8):
+            crc = (crc >> 1) ^ 0xA001 if crc & 1 else crc >> 1
+    return crc
+
+
+def readRom(fileName):
+    # Read a TI-TXT file.  Only the app image range is kept, the rest of the
+    # image is 0xFF (erased flash) as filled by hex430.
+    image = bytearray(b'\xff' * IMAGE_LENGTH)
+    addr = None
+    for line in open(fileName, 'r'):
+        line = line.strip()
+        if line.startswith('@'):
+            addr = int(line[1:], 16)
+        elif line.startswith('q'):
+            break
+        elif line and addr is not None:
+            for value in line.split():
+                if IMAGE_START <= addr < IMAGE_START + IMAGE_LENGTH:
+                    image[addr - IMAGE_START] = int(value, 16)
+                addr += 1
+    return bytes(image)
+
+
+def createDelta(base, new):
+    index = {}
+    for i in range(len(base) - MIN_COPY_LENGTH + 1):
+        index.setdefault(base[i:i + MIN_COPY_LENGTH], []).append(i)
+
+    ops = bytearray()
+    literal = bytearray()
+
+    def flushLiteral():
+        while literal:
+            chunk = literal[:OP_MAX_LENGTH]
+            ops.extend(bytes([OP_INSERT, len(chunk) >> 8, len(chunk) & 0xFF]))
+            ops.extend(chunk)
+            del literal[:len(chunk)]
+
+    i = 0
+    while i < len(new):
+        # Longest copy from the base image
+        copyLength, copyOffset = 0, 0
+        for j in index.get(new[i:i + MIN_COPY_LENGTH], [])[:MAX_CANDIDATES]:
+            n = 0
+            while (i + n < len(new)) and (j + n < len(base)) and (new[i + n] == base[j + n]) and (n < OP_MAX_LENGTH):
+                n += 1
+            if n > copyLength:
+                copyLength, copyOffset = n, j
+        # Run of one value
+        fillLength = 0
+        while (i + fillLength < len(new)) and (new[i + fillLength] == new[i]) and (fillLength < OP_MAX_LENGTH):
+            fillLength += 1
+
+        if (copyLength >= MIN_COPY_LENGTH) and (copyLength >= fillLength):
+            flushLiteral()
+            ops.extend(bytes([OP_COPY, copyOffset >> 8, copyOffset & 0xFF, copyLength >> 8, copyLength & 0xFF]))
+            i += copyLength
+        elif fillLength >= MIN_FILL_LENGTH:
+            flushLiteral()
+            ops.extend(bytes([OP_FILL, fillLength >> 8, fillLength & 0xFF, new[i]]))
+            i += fillLength
+        else:
+            literal.append(new[i])
+            i += 1
+    flushLiteral()
+    return bytes(ops)
+
+
+def applyDelta(base, ops, length):
+    # Reference applier, decodes the ops one modem chunk at a time like
+    # otaUpgrade_writeDeltaData().
+    out = bytearray()
+    header = bytearray()
+    insertRemaining = 0
+    headerSize = {OP_COPY: 5, OP_INSERT: 3, OP_FILL: 4}
+    for pos in range(0, len(ops), OTA_PAYLOAD_MAX_RX_READ_LENGTH):
+        for b in ops[pos:pos + OTA_PAYLOAD_MAX_RX_READ_LENGTH]:
+            if insertRemaining:
+                out.append(b)
+                insertRemaining -= 1
+                continue
+            header.append(b)
+            if header[0] not in headerSize:
+                raise ValueError("bad op 0x%02X" % header[0])
+            if len(header) < headerSize[header[0]]:
+                continue
+            n = (header[1] << 8) | header[2]
+            if header[0] == OP_COPY:
+                offset, n = n, (header[3] << 8) | header[4]
+                out.extend(base[offset:offset + n])
+            elif header[0] == OP_INSERT:
+                insertRemaining = n
+            else:
+                out.extend(bytes([header[3]]) * n)
+            header = bytearray()
+            if len(out) > length:
+                raise ValueError("ops write past the section")
+    return bytes(out)
+
+
+def main():
+    if len(sys.argv) not in (3, 4):
+        print("Usage: afridevV2RomToDeltaMsg.py base_rom.txt new_rom.txt [output_msg.txt]")
+        sys.exit(1)
+    base = readRom(sys.argv[1])
+    new = readRom(sys.argv[2])
+    outputFileName = sys.argv[3] if len(sys.argv) == 4 else None
+
+    ops = createDelta(base, new)
+    if len(ops) > OP_MAX_LENGTH:
+        print("The delta ops are too long for one message, send the full image.")
+        sys.exit(1)
+    if applyDelta(base, ops, len(new)) != new:
+        print("The delta ops do not rebuild the new image.")
+        sys.exit(1)
+
+    crc16New = crc16(new)
+    crc16Base = crc16(base)
+
+    # Message header, the same as afridevV2RomToMsg.py:
+    # msgNumber, msgId[2], key0-3, number of sections
+    msg = bytearray([0x10, 0x01, 0x02, 0x31, 0x41, 0x59, 0x26, 0x01])
+    # Section header: start byte, section number, start address, length, crc16
+    msg += bytes([DELTA_SECTION_START, 0x00,
+                  IMAGE_START >> 8, IMAGE_START & 0xFF,
+                  len(new) >> 8, len(new) & 0xFF,
+                  crc16New >> 8, crc16New & 0xFF])
+    # Delta header: base image crc16, length of the ops
+    msg += bytes([crc16Base >> 8, crc16Base & 0xFF, len(ops) >> 8, len(ops) & 0xFF])
+    msg += ops
+
+    fullLength = 16 + len(new)
+    print("base crc16 {0:04X}, new crc16 {1:04X}".format(crc16Base, crc16New))
+    print("full message {0} bytes, delta message {1} bytes ({2:.1f}%)".format(
+        fullLength, len(msg), 100.0 * len(msg) / fullLength))
+
+    msgString = "".join("{0:02X} ".format(b) for b in msg)
+    if outputFileName is not None:
+        f = open(outputFileName, 'w')
+        f.write(msgString)
+        f.close()
+    else:
+        print(msgString)
+
+
+if __name__ == "__main__":
+    main()
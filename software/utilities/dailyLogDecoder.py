@@ -0,0 +1,315 @@
+#!/usr/bin/python3
+
+# Reference decoder for the AfridevV2 daily water log messages.
+#
+# Decodes both the standard daily log message (0x21, fixed 128 bytes)
+# and the compact daily log message (0x25, variable length).  A compact
+# message is expanded back to the standard 128 byte packet, the same
+# packet the unit sends in the standard format.  A daily log bundle
+# (0x26) is split into the daily log messages it carries.  A quarter hour
+# daily log (0x27) is decoded to its 96 quarter hour bins, and expanded
+# to the standard packet with the hourly liters (the sum of the four
+# quarter hour bins of each hour).
+#
+# Usage:
+#   dailyLogDecoder.py [file]          decode one hex message per line
+#                                      (file or stdin), print the fields,
+#                                      bundles are split into their days
+#   dailyLogDecoder.py --benchmark [n] encode and decode n synthetic daily
+#                                      logs, report size and throughput
+
+import sys
+import time
+import random
+import binascii
+
+MSG_TYPE_DAILY_LOG = 0x21
+MSG_TYPE_DAILY_LOG_COMPACT = 0x25
+MSG_TYPE_DAILY_LOG_BUNDLE = 0x26
+MSG_TYPE_DAILY_LOG_QUARTER_HOUR = 0x27
+
+HEADER_LENGTH = 16
+PACKET_LENGTH = 128
+TOTAL_HOURS = 24
+TOTAL_PAD_COUNTS = 6
+QUARTERS_IN_A_HOUR = 4
+TOTAL_QUARTER_HOURS = TOTAL_HOURS * QUARTERS_IN_A_HOUR
+QUARTER_HOUR_FIXED_LENGTH = 8
+QUARTER_HOUR_BINS_LENGTH = 99
+QUARTER_HOUR_TOKEN_HOURLY = 0x00
+QUARTER_HOUR_TOKEN_MAX_LENGTH = 3
+
+COMPACT_FLAG_RED_FLAG = 0x01
+
+
+def getVarint(msg, pos):
+    value = 0
+    shift = 0
+    while True:
+        b = msg[pos]
+        pos += 1
+        value |= (b & 0x7F) << shift
+        if not (b & 0x80):
+            return value, pos
+        shift += 7
+
+
+def putVarint(out, value):
+    while value > 0x7F:
+        out.append((value & 0x7F) | 0x80)
+        value >>= 7
+    out.append(value)
+
+
+def unzigzag(z):
+    return (z >> 1) if not (z & 1) else -((z + 1) >> 1)
+
+
+def zigzag(delta):
+    return (delta << 1) if delta >= 0 else ((-delta) << 1) - 1
+
+
+def decodeCompact(msg):
+    """Expand a compact daily log message to the standard 128 byte packet."""
+    if msg[1] != MSG_TYPE_DAILY_LOG_COMPACT:
+        raise ValueError("not a compact daily log message")
+    pkt = bytearray(b'\xff' * PACKET_LENGTH)
+    pkt[0:HEADER_LENGTH] = msg[0:HEADER_LENGTH]
+    pkt[1] = MSG_TYPE_DAILY_LOG
+
+    pos = HEADER_LENGTH
+    flags = msg[pos]
+    pos += 1
+    totalLiters, pos = getVarint(msg, pos)
+    averageLiters, pos = getVarint(msg, pos)
+    errorBits, pos = getVarint(msg, pos)
+
+    hours = []
+    prev = 0
+    while len(hours) < TOTAL_HOURS:
+        token, pos = getVarint(msg, pos)
+        if token & 1:
+            prev = (prev + unzigzag(token >> 1)) & 0xFFFF
+            hours.append(prev)
+        else:
+            hours.extend([0] * (token >> 1))
+            prev = 0
+    if len(hours) != TOTAL_HOURS:
+        raise ValueError("hourly bins overrun")
+
+    if pos != len(msg):
+        raise ValueError("%d trailing bytes" % (len(msg) - pos))
+
+    d = HEADER_LENGTH
+    for i, v in enumerate(hours):
+        pkt[d + 2 * i:d + 2 * i + 2] = v.to_bytes(2, 'big')
+    pkt[d + 48:d + 50] = totalLiters.to_bytes(2, 'big')
+    pkt[d + 50:d + 52] = averageLiters.to_bytes(2, 'big')
+    pkt[d + 52] = 1 if (flags & COMPACT_FLAG_RED_FLAG) else 0
+    pkt[d + 54:d + 56] = errorBits.to_bytes(2, 'big')
+    return bytes(pkt)
+
+
+def encodeCompact(pkt):
+    """Same encoding as the firmware, used to build benchmark data."""
+    d = HEADER_LENGTH
+    word = lambda off: int.from_bytes(pkt[d + off:d + off + 2], 'big')
+    out = bytearray(pkt[0:HEADER_LENGTH])
+    out[1] = MSG_TYPE_DAILY_LOG_COMPACT
+    flags = COMPACT_FLAG_RED_FLAG if pkt[d + 52] else 0
+    out.append(flags)
+    putVarint(out, word(48))
+    putVarint(out, word(50))
+    putVarint(out, word(54))
+    prev = 0
+    run = 0
+    for i in range(TOTAL_HOURS):
+        v = word(2 * i)
+        if v == 0:
+            run += 1
+        else:
+            if run:
+                putVarint(out, run << 1)
+                run = 0
+            putVarint(out, (zigzag(v - prev) << 1) | 1)
+        prev = v
+    if run:
+        putVarint(out, run << 1)
+    return bytes(out)
+
+
+def splitBundle(msg):
+    """Return the daily log messages carried in a bundle, oldest first."""
+    if msg[1] != MSG_TYPE_DAILY_LOG_BUNDLE:
+        raise ValueError("not a daily log bundle")
+    count = msg[HEADER_LENGTH]
+    pos = HEADER_LENGTH + 1
+    messages = []
+    for i in range(count):
+        length = msg[pos]
+        messages.append(bytes(msg[pos + 1:pos + 1 + length]))
+        pos += 1 + length
+    if pos != len(msg):
+        raise ValueError("bundle length mismatch")
+    return messages
+
+
+def decodeQuarterHourBins(msg):
+    """Return the 96 quarter hour bins of a quarter hour daily log.
+
+    Non-zero hours the unit recorded at hourly resolution (the end of a
+    heavy day) have None for their quarter hour bins, their total is
+    returned in the hours list.  Returns (quarterBins, hours).
+    """
+    if msg[1] != MSG_TYPE_DAILY_LOG_QUARTER_HOUR:
+        raise ValueError("not a quarter hour daily log message")
+    quarters = [0] * TOTAL_QUARTER_HOURS
+    hours = [0] * TOTAL_HOURS
+    pos = HEADER_LENGTH + QUARTER_HOUR_FIXED_LENGTH
+    end = min(len(msg), pos + QUARTER_HOUR_BINS_LENGTH)
+    bin = 0
+    prev = 0
+    hourly = False
+    while pos < end:
+        # The bins end at erased flash (0xFF) or the end of the message
+        token = 0
+        for i in range(QUARTER_HOUR_TOKEN_MAX_LENGTH):
+            if pos + i >= end:
+                token = None
+                break
+            token |= (msg[pos + i] & 0x7F) << (7 * i)
+            if not (msg[pos + i] & 0x80):
+                break
+        else:
+            token = None
+        if token is None:
+            break
+        pos += i + 1
+        step = QUARTERS_IN_A_HOUR if hourly else 1
+        if token == QUARTER_HOUR_TOKEN_HOURLY:
+            hourly = True
+            prev = 0
+        elif not (token & 1):
+            bin += (token >> 1) * step
+            prev = 0
+        else:
+            prev = (prev + unzigzag(token >> 1)) & 0xFFFF
+            if hourly:
+                for q in range(QUARTERS_IN_A_HOUR):
+                    quarters[bin + q] = None
+            else:
+                quarters[bin] = prev
+            hours[bin // QUARTERS_IN_A_HOUR] += prev
+            bin += step
+    return quarters, [min(h, 0xFFFE) for h in hours]
+
+
+def decodeQuarterHour(msg):
+    """Expand a quarter hour daily log message to the standard 128 byte packet."""
+    quarters, hours = decodeQuarterHourBins(msg)
+    pkt = bytearray(b'\xff' * PACKET_LENGTH)
+    pkt[0:HEADER_LENGTH] = msg[0:HEADER_LENGTH]
+    pkt[1] = MSG_TYPE_DAILY_LOG
+    d = HEADER_LENGTH
+    for i, v in enumerate(hours):
+        pkt[d + 2 * i:d + 2 * i + 2] = v.to_bytes(2, 'big')
+    # totalLiters, averageLiters, redFlag, reserved, errorBits
+    pkt[d + 48:d + 56] = msg[d:d + QUARTER_HOUR_FIXED_LENGTH]
+    return bytes(pkt)
+
+
+def decodeMessage(msg):
+    """Return the fields of a standard or compact daily log message."""
+    quarters = None
+    if msg[1] == MSG_TYPE_DAILY_LOG_COMPACT:
+        pkt = decodeCompact(msg)
+    elif msg[1] == MSG_TYPE_DAILY_LOG_QUARTER_HOUR:
+        pkt = decodeQuarterHour(msg)
+        quarters = decodeQuarterHourBins(msg)[0]
+    elif msg[1] == MSG_TYPE_DAILY_LOG and len(msg) == PACKET_LENGTH:
+        pkt = msg
+    else:
+        raise ValueError("not a daily log message")
+    d = HEADER_LENGTH
+    word = lambda off: int.from_bytes(pkt[d + off:d + off + 2], 'big')
+    fields = {
+        'msgId': msg[1],
+        'length': len(msg),
+        'gmt': "20%02d-%02d-%02d %02d:%02d:%02d" % (pkt[8], pkt[7], pkt[6], pkt[5], pkt[4], pkt[3]),
+        'fw': "%d.%d" % (pkt[9], pkt[10]),
+        'daysActivated': (pkt[11] << 8) | pkt[12],
+        'week': pkt[13],
+        'day': pkt[14],
+        'litersPerHour': [word(2 * i) for i in range(TOTAL_HOURS)],
+        'totalLiters': word(48),
+        'averageLiters': word(50),
+        'redFlag': pkt[d + 52],
+        'errorBits': word(54),
+        'padSubmergedCount': [word(56 + 2 * i) for i in range(TOTAL_PAD_COUNTS)],
+    }
+    if quarters is not None:
+        fields['litersPerQuarterHour'] = quarters
+    return fields
+
+
+def syntheticPacket(rnd, day):
+    pkt = bytearray(b'\xff' * PACKET_LENGTH)
+    pkt[0:HEADER_LENGTH] = bytes([0x01, MSG_TYPE_DAILY_LOG, 0x00, 0, 0, 0, day % 28 + 1, 3, 21,
+                                  3, 7, (day >> 8) & 0xFF, day & 0xFF, (day // 7) & 0xFF, day % 7, 0xFF])
+    d = HEADER_LENGTH
+    total = 0
+    for h in range(TOTAL_HOURS):
+        v = rnd.randrange(0, 900) if 6 < h < 20 and rnd.random() > 0.2 else 0
+        total += v
+        pkt[d + 2 * h:d + 2 * h + 2] = v.to_bytes(2, 'big')
+    pkt[d + 48:d + 50] = total.to_bytes(2, 'big')
+    pkt[d + 50:d + 52] = rnd.randrange(0, 5000).to_bytes(2, 'big')
+    pkt[d + 52] = 1 if rnd.random() < 0.05 else 0
+    pkt[d + 54:d + 56] = (0x12).to_bytes(2, 'big')
+    return bytes(pkt)
+
+
+def benchmark(count):
+    rnd = random.Random(7)
+    packets = [syntheticPacket(rnd, day) for day in range(count)]
+    messages = [encodeCompact(p) for p in packets]
+    for p, m in zip(packets, messages):
+        if decodeCompact(m) != p:
+            raise AssertionError("round trip mismatch")
+    compactBytes = sum(len(m) for m in messages)
+    start = time.perf_counter()
+    for m in messages:
+        decodeCompact(m)
+    elapsed = time.perf_counter() - start
+    print("messages:          %d" % count)
+    print("standard bytes:    %d (%d per message)" % (count * PACKET_LENGTH, PACKET_LENGTH))
+    print("compact bytes:     %d (%.1f per message, %.1f%%)" %
+          (compactBytes, compactBytes / count, 100.0 * compactBytes / (count * PACKET_LENGTH)))
+    print("decode throughput: %.0f messages/s, %.2f MB/s of compact input" %
+          (count / elapsed, compactBytes / elapsed / 1e6))
+
+
+def main():
+    if len(sys.argv) > 1 and sys.argv[1] == '--benchmark':
+        benchmark(int(sys.argv[2]) if len(sys.argv) > 2 else 100000)
+        return
+    f = open(sys.argv[1], 'r') if len(sys.argv) > 1 else sys.stdin
+    for line in f:
+        line = line.strip()
+        if not line:
+            continue
+        msg = binascii.unhexlify(line.split()[-1])
+        messages = [msg]
+        if msg[1] == MSG_TYPE_DAILY_LOG_BUNDLE:
+            messages = splitBundle(msg)
+            print("bundle of %d daily logs, %d bytes" % (len(messages), len(msg)))
+            print()
+        for m in messages:
+            fields = decodeMessage(m)
+            for key, value in fields.items():
+                print("%-18s %s" % (key, value))
+            print()
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,145 @@
+#!/usr/bin/python3
+
+# Timing simulation of the AfridevV2 OTA firmware download
+# (msgOtaUpgrade.c).  A fake modem and a fake flash are driven by a model
+# of the upgrade loop to compare the serial download (each chunk is
+# requested, then written to flash, then the next chunk is requested)
+# with the pipelined download (the next chunk is requested while a chunk
+# is written, the modem manager holds the next chunk in the modemCmd
+# buffer until the OTA buffer is released).
+#
+# The image is checked against the bytes "written" to the fake flash, and
+# the end to end upgrade time and the bytes/s achieved are reported.
+#
+# Usage:
+#   otaDownloadSim.py [image_bytes] [modem_latency_ms]
+#
+# Timing defaults come from the firmware and the modem interface:
+#   UART 9600 baud, 10 bits per byte
+#   byte mode flash write ~0.15ms per byte, block write about half
+#   segment erase ~15ms, one segment or 32 bytes per msp430Flash_poll()
+
+import sys
+import random
+
+UART_MS_PER_BYTE = 10.0 * 1000.0 / 9600.0
+MODEM_LATENCY_MS = 50.0
+LOOP_MS = 1.0
+
+FLASH_BYTE_WRITE_MS = 0.15
+FLASH_BLOCK_WRITE_MS = 0.075
+FLASH_SEGMENT_ERASE_MS = 15.0
+FLASH_SEGMENT_SIZE = 512
+FLASH_WRITE_CHUNK_BYTES = 32
+
+OTA_PAYLOAD_MAX_RX_READ_LENGTH = 512
+OTA_UPDATE_MSG_HEADER_SIZE = 8
+IMAGE_LENGTH = 0x5000
+
+# Frame sizes: tx = start, header, crc[2], end.  rx as listed in modemCmd.c.
+PING_TX, PING_RX = 5, 5
+PARTIAL_TX, PARTIAL_RX = 13, 13
+MODEM_STATUS_TX, MODEM_STATUS_RX = 5, 15
+MSG_STATUS_TX, MSG_STATUS_RX = 5, 23
+
+
+class FakeModem:
+    """Returns the upgrade message in partial reads and accounts for
+    the UART time of each modem command."""
+
+    def __init__(self, message, latencyMs):
+        self.message = message
+        self.latencyMs = latencyMs
+
+    def cmdTime(self, txBytes, rxBytes):
+        return (txBytes + rxBytes) * UART_MS_PER_BYTE + self.latencyMs
+
+    def partial(self, offset, length):
+        """Time for the ping and the partial command, the payload, and
+        the time for the status commands that finish the batch."""
+        data = self.message[offset:offset + length]
+        t = self.cmdTime(PING_TX, PING_RX) + self.cmdTime(PARTIAL_TX, PARTIAL_RX + len(data))
+        tail = self.cmdTime(MODEM_STATUS_TX, MODEM_STATUS_RX) + self.cmdTime(MSG_STATUS_TX, MSG_STATUS_RX)
+        return t, data, tail
+
+
+class FakeFlash:
+    """Erased flash that is programmed the way flash.c does it."""
+
+    def __init__(self, length):
+        self.mem = bytearray(b'\xff' * length)
+
+    def eraseTime(self, length):
+        segments = (length + FLASH_SEGMENT_SIZE - 1) // FLASH_SEGMENT_SIZE
+        return segments * (FLASH_SEGMENT_ERASE_MS + LOOP_MS)
+
+    def write(self, addr, data):
+        for i, b in enumerate(data):
+            self.mem[addr + i] &= b
+
+    def blockWriteTime(self, length):
+        # msp430Flash_write_blocks(), run to completion
+        return length * FLASH_BLOCK_WRITE_MS
+
+    def pollWriteTime(self, length):
+        # msp430Flash_submitWrite(), 32 bytes per upgrade loop pass
+        polls = (length + FLASH_WRITE_CHUNK_BYTES - 1) // FLASH_WRITE_CHUNK_BYTES
+        return length * FLASH_BYTE_WRITE_MS + polls * LOOP_MS
+
+
+def simulate(image, latencyMs, pipelined):
+    message = bytes(OTA_UPDATE_MSG_HEADER_SIZE) + image
+    modem = FakeModem(message, latencyMs)
+    flash = FakeFlash(len(image))
+
+    # Section info, then the erase runs from the loop while the first
+    # chunk is requested.
+    t, data, tail = modem.partial(0, OTA_UPDATE_MSG_HEADER_SIZE)
+    now = t + tail
+    flashIdleAt = now + flash.eraseTime(len(image))
+
+    offset = 0
+    while offset < len(image):
+        length = min(OTA_PAYLOAD_MAX_RX_READ_LENGTH, len(image) - offset)
+        t, data, tail = modem.partial(OTA_UPDATE_MSG_HEADER_SIZE + offset, length)
+        if pipelined:
+            # The partial response is held until the last chunk is
+            # written and released.
+            rxDone = max(now + t, flashIdleAt)
+            now = rxDone + tail
+            # The first chunk waits for the erase, then the write runs
+            # while the next chunk is requested.
+            now = max(now, flashIdleAt)
+            flash.write(offset, data)
+            flashIdleAt = now + flash.pollWriteTime(len(data))
+        else:
+            now = max(now + t + tail, flashIdleAt)
+            flash.write(offset, data)
+            now += flash.blockWriteTime(len(data))
+            flashIdleAt = now
+        offset += len(data)
+
+    now = max(now, flashIdleAt)
+    return now, bytes(flash.mem) == image
+
+
+def main():
+    imageLength = int(sys.argv[1], 0) if len(sys.argv) > 1 else IMAGE_LENGTH
+    latencyMs = float(sys.argv[2]) if len(sys.argv) > 2 else MODEM_LATENCY_MS
+
+    random.seed(1)
+    image = bytes(random.getrandbits(8) for _ in range(imageLength))
+
+    print("image %d bytes, modem latency %.0fms" % (imageLength, latencyMs))
+    results = []
+    for name, pipelined in (("serial", False), ("pipelined", True)):
+        ms, ok = simulate(image, latencyMs, pipelined)
+        results.append(ms)
+        print("%-10s %8.2fs %7.1f bytes/s  image %s" %
+              (name, ms / 1000.0, imageLength * 1000.0 / ms, "ok" if ok else "MISMATCH"))
+    print("saved      %8.2fs (%.1f%%)" % ((results[0] - results[1]) / 1000.0,
+                                           100.0 * (results[0] - results[1]) / results[0]))
+
+
+if __name__ == "__main__":
+    main()